@@ -0,0 +1,54 @@
+#-------------------------------------------------
+#
+# Micro-benchmarks for the parts of adcVis that do not need a window. Build and run with
+#   qmake Benchmarks.pro && make && ./adcVisBenchmarks --help
+#
+#-------------------------------------------------
+
+QT       -= core gui
+CONFIG   -= qt app_bundle
+CONFIG   += console c++11 thread
+
+LIBS += -lGLEW -lGLU -lGL -lpng -lz
+
+TARGET = adcVisBenchmarks
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+
+SOURCES += main.cpp \
+    MeshGenerator.cpp \
+    ../IO/FileReader.cpp \
+    ../IO/ChunkedMeshFile.cpp \
+    ../IO/GlobalOutputFile.cpp \
+    ../IO/TimestepPrefetcher.cpp \
+    ../IO/QuantizedTimestepStore.cpp \
+    ../IO/TimeSeriesCache.cpp \
+    ../IO/ChunkedOutputFile.cpp \
+    ../IO/OutputStatistics.cpp \
+    ../IO/TemporalRangeIndex.cpp \
+    ../Layers/Layer.cpp \
+    ../Layers/Quadtree.cpp \
+    ../Layers/NodeGrid.cpp \
+    ../Layers/NodePicker.cpp \
+    ../Layers/MeshDecimator.cpp \
+    ../OpenGL/glew.c \
+    ../OpenGL/GLCamera.cpp \
+    ../OpenGL/GLPickingBuffer.cpp \
+    ../OpenGL/GLProfiler.cpp \
+    ../OpenGL/GLResidencyManager.cpp \
+    ../Shaders/GLShader.cpp \
+    ../Shaders/ColorMap.cpp \
+    ../Shaders/PickingShader.cpp \
+    ../Rasterizer/MeshRasterizer.cpp
+
+HEADERS  += MeshGenerator.h
+
+# Build with "qmake CONFIG+=netcdf" to also compare the ASCII output readers with
+# NetcdfOutputFile
+netcdf {
+    DEFINES += ADCVIS_NETCDF
+    LIBS += -lnetcdf
+    SOURCES += ../IO/NetcdfOutputFile.cpp
+}
@@ -0,0 +1,447 @@
+#include "MeshGenerator.h"
+#include <math.h>
+#include <algorithm>
+
+#ifdef ADCVIS_NETCDF
+#include <netcdf.h>
+#endif
+
+
+/**
+ * @brief Builds a synthetic mesh
+ *
+ * The mesh has the smallest square grid of Nodes with at least targetNodes Nodes, and two
+ * Elements per grid cell. Any data already in the node and element lists is cleared.
+ *
+ * @param type The kind of triangulation to build
+ * @param targetNodes The smallest number of Nodes in the mesh
+ * @param seed The seed used for the random parts of the mesh, must not be 0
+ * @param nodes A pointer to the node list
+ * @param elements A pointer to the element list
+ * @return 0 if the mesh was built
+ * @return 1 if the lists are missing or the mesh would have too many Nodes
+ */
+int MeshGenerator::Generate(MeshType type, unsigned int targetNodes, unsigned int seed, std::vector<Node> *nodes, std::vector<Element> *elements)
+{
+	if (nodes == 0 || elements == 0 || seed == 0)
+		return 1;
+
+	unsigned int side = (unsigned int)ceil(sqrt((double)targetNodes));
+	if (side < 2)
+		side = 2;
+	if ((double)side*side > 4.0e9)
+		return 1;
+
+	const unsigned int numNodes = side*side;
+	const unsigned int numElements = 2*(side-1)*(side-1);
+	const float MinX = -80.0, MaxX = -60.0, MinY = 25.0, MaxY = 45.0;
+	const float Grading = 5.0;
+	const float Jitter = 0.2;
+	unsigned int state = seed;
+
+	// Node and Element numbers are only shuffled for RandomMesh
+	std::vector<unsigned int> nodeNumbers (numNodes);
+	for (unsigned int i=0; i<numNodes; i++)
+		nodeNumbers[i] = i+1;
+	if (type == RandomMesh)
+		for (unsigned int i=numNodes-1; i>0; i--)
+			std::swap(nodeNumbers[i], nodeNumbers[NextRandom(&state) % (i+1)]);
+
+	nodes->clear();
+	nodes->resize(numNodes);
+	for (unsigned int row=0; row<side; row++)
+	{
+		for (unsigned int column=0; column<side; column++)
+		{
+			float s = (float)column/(side-1);
+			float t = (float)row/(side-1);
+			if (type == RandomMesh && column > 0 && column < side-1 && row > 0 && row < side-1)
+			{
+				// Moving a Node by less than a quarter of a cell keeps every cell convex, so
+				// both diagonals give valid Elements
+				s += Jitter*(2.0*NextRandomFloat(&state) - 1.0)/(side-1);
+				t += Jitter*(2.0*NextRandomFloat(&state) - 1.0)/(side-1);
+			}
+			if (type == GradedMesh)
+				s = (exp(Grading*s) - 1.0)/(exp(Grading) - 1.0);
+
+			Node *currNode = &(*nodes)[nodeNumbers[row*side + column]-1];
+			currNode->nodeNumber = nodeNumbers[row*side + column];
+			currNode->x = MinX + s*(MaxX - MinX);
+			currNode->y = MinY + t*(MaxY - MinY);
+			currNode->z = 4000.0*s*s - 5.0;
+		}
+	}
+
+	std::vector<unsigned int> elementNumbers (numElements);
+	for (unsigned int i=0; i<numElements; i++)
+		elementNumbers[i] = i+1;
+	if (type == RandomMesh)
+		for (unsigned int i=numElements-1; i>0; i--)
+			std::swap(elementNumbers[i], elementNumbers[NextRandom(&state) % (i+1)]);
+
+	elements->clear();
+	elements->resize(numElements);
+	unsigned int count = 0;
+	for (unsigned int row=0; row<side-1; row++)
+	{
+		for (unsigned int column=0; column<side-1; column++)
+		{
+			// Corners of the cell, counterclockwise from the bottom left
+			const unsigned int a = nodeNumbers[row*side + column];
+			const unsigned int b = nodeNumbers[row*side + column+1];
+			const unsigned int c = nodeNumbers[(row+1)*side + column+1];
+			const unsigned int d = nodeNumbers[(row+1)*side + column];
+			const bool otherDiagonal = type == RandomMesh && (NextRandom(&state) & 1);
+
+			Element *first = &(*elements)[elementNumbers[count]-1];
+			first->elementNumber = elementNumbers[count++];
+			first->n1 = a;
+			first->n2 = b;
+			first->n3 = otherDiagonal ? d : c;
+
+			Element *second = &(*elements)[elementNumbers[count]-1];
+			second->elementNumber = elementNumbers[count++];
+			second->n1 = otherDiagonal ? b : a;
+			second->n2 = c;
+			second->n3 = d;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Writes a mesh to a fort.14 file with no boundary segments
+ *
+ * Nodes and Elements are written in the order they appear in the lists.
+ *
+ * @param fileLoc The fort.14 file location
+ * @param nodes A pointer to the node list
+ * @param elements A pointer to the element list
+ * @return 0 if the file was written
+ * @return 1 if an error occurred
+ */
+int MeshGenerator::WriteFort14(std::string fileLoc, std::vector<Node> *nodes, std::vector<Element> *elements)
+{
+	if (nodes == 0 || elements == 0)
+		return 1;
+
+	FILE *file = fopen(fileLoc.data(), "w");
+	if (file == 0)
+	{
+		DEBUG("Unable to create %s\n", fileLoc.data());
+		return 1;
+	}
+
+	std::vector<char> buffer (1 << 20);
+	setvbuf(file, &buffer[0], _IOFBF, buffer.size());
+
+	fprintf(file, "adcVis synthetic mesh\n");
+	fprintf(file, "%u %u\n", (unsigned int)elements->size(), (unsigned int)nodes->size());
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		Node *currNode = &(*nodes)[i];
+		fprintf(file, "%u %.6f %.6f %.3f\n", currNode->nodeNumber, currNode->x, currNode->y, currNode->z);
+	}
+	for (unsigned int i=0; i<elements->size(); i++)
+	{
+		Element *currElement = &(*elements)[i];
+		fprintf(file, "%u 3 %u %u %u\n", currElement->elementNumber, currElement->n1, currElement->n2, currElement->n3);
+	}
+	fprintf(file, "0 = Number of open boundaries\n");
+	fprintf(file, "0 = Total number of open boundary nodes\n");
+	fprintf(file, "0 = Number of land boundaries\n");
+	fprintf(file, "0 = Total number of land boundary nodes\n");
+
+	bool failed = ferror(file) != 0;
+	if (fclose(file) != 0)
+		failed = true;
+	return failed ? 1 : 0;
+}
+
+
+/**
+ * @brief Writes water levels for a mesh to a fort.63 file
+ *
+ * The Nodes of every timestep are written in node number order. In the full format dry
+ * Nodes are written as -99999, in the sparse format only wet Nodes are written.
+ *
+ * @param fileLoc The fort.63 file location
+ * @param nodes A pointer to the node list, in node number order
+ * @param numTimesteps The number of timesteps to write
+ * @param interval The model time between timesteps in seconds
+ * @param sparse true to write the sparse format
+ * @return 0 if the file was written
+ * @return 1 if an error occurred
+ */
+int MeshGenerator::WriteFort63(std::string fileLoc, std::vector<Node> *nodes, unsigned int numTimesteps, double interval, bool sparse)
+{
+	if (nodes == 0)
+		return 1;
+
+	FILE *file = fopen(fileLoc.data(), "w");
+	if (file == 0)
+	{
+		DEBUG("Unable to create %s\n", fileLoc.data());
+		return 1;
+	}
+
+	std::vector<char> buffer (1 << 20);
+	setvbuf(file, &buffer[0], _IOFBF, buffer.size());
+
+	const unsigned int StepsPerOutput = 60;
+	std::vector<float> elevations (nodes->size());
+	fprintf(file, "adcVis synthetic water levels\n");
+	fprintf(file, "%u %u %.7E %u 1\n", numTimesteps, (unsigned int)nodes->size(), interval, StepsPerOutput);
+	for (unsigned int timestep=0; timestep<numTimesteps; timestep++)
+	{
+		const double Time = (timestep+1)*interval;
+		unsigned int numWet = 0;
+		for (unsigned int i=0; i<nodes->size(); i++)
+		{
+			elevations[i] = GetElevation(&(*nodes)[i], Time);
+			if (elevations[i] != -99999.0)
+				numWet++;
+		}
+
+		if (sparse)
+			fprintf(file, "%.10E %u %u -99999.0\n", Time, (timestep+1)*StepsPerOutput, numWet);
+		else
+			fprintf(file, "%.10E %u\n", Time, (timestep+1)*StepsPerOutput);
+		for (unsigned int i=0; i<nodes->size(); i++)
+			if (!sparse || elevations[i] != -99999.0)
+				fprintf(file, "%u %.10E\n", (*nodes)[i].nodeNumber, elevations[i]);
+	}
+
+	bool failed = ferror(file) != 0;
+	if (fclose(file) != 0)
+		failed = true;
+	return failed ? 1 : 0;
+}
+
+
+#ifdef ADCVIS_NETCDF
+/**
+ * @brief Writes a mesh and its water levels to a fort.63.nc file
+ *
+ * The file uses the NetCDF-4 format and ADCIRC's variable names. zeta is chunked by 8
+ * timesteps and 16384 Nodes, with dry Nodes written as the fill value -99999.
+ *
+ * @param fileLoc The fort.63.nc file location
+ * @param nodes A pointer to the node list, in node number order
+ * @param elements A pointer to the element list, in element number order
+ * @param numTimesteps The number of timesteps to write
+ * @param interval The model time between timesteps in seconds
+ * @return 0 if the file was written
+ * @return 1 if an error occurred
+ */
+int MeshGenerator::WriteNetcdf(std::string fileLoc, std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int numTimesteps, double interval)
+{
+	if (nodes == 0 || elements == 0)
+		return 1;
+
+	int fileID;
+	if (nc_create(fileLoc.data(), NC_CLOBBER | NC_NETCDF4, &fileID) != NC_NOERR)
+	{
+		DEBUG("Unable to create %s\n", fileLoc.data());
+		return 1;
+	}
+
+	int status = NC_NOERR;
+	int timeDim, nodeDim, elementDim, vertexDim;
+	int timeID, xID, yID, depthID, elementID, zetaID;
+	status |= nc_def_dim(fileID, "time", NC_UNLIMITED, &timeDim);
+	status |= nc_def_dim(fileID, "node", nodes->size(), &nodeDim);
+	status |= nc_def_dim(fileID, "nele", elements->size(), &elementDim);
+	status |= nc_def_dim(fileID, "nvertex", 3, &vertexDim);
+	int elementDims[2] = {elementDim, vertexDim};
+	int zetaDims[2] = {timeDim, nodeDim};
+	status |= nc_def_var(fileID, "time", NC_DOUBLE, 1, &timeDim, &timeID);
+	status |= nc_def_var(fileID, "x", NC_DOUBLE, 1, &nodeDim, &xID);
+	status |= nc_def_var(fileID, "y", NC_DOUBLE, 1, &nodeDim, &yID);
+	status |= nc_def_var(fileID, "depth", NC_DOUBLE, 1, &nodeDim, &depthID);
+	status |= nc_def_var(fileID, "element", NC_INT, 2, elementDims, &elementID);
+	status |= nc_def_var(fileID, "zeta", NC_DOUBLE, 2, zetaDims, &zetaID);
+	size_t chunkSizes[2] = {8, std::min((size_t)16384, nodes->size())};
+	const float Dry = -99999.0;
+	status |= nc_def_var_chunking(fileID, zetaID, NC_CHUNKED, chunkSizes);
+	status |= nc_put_att_float(fileID, zetaID, "_FillValue", NC_DOUBLE, 1, &Dry);
+	status |= nc_enddef(fileID);
+
+	std::vector<float> values (3*nodes->size());
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		values[i] = (*nodes)[i].x;
+		values[nodes->size() + i] = (*nodes)[i].y;
+		values[2*nodes->size() + i] = (*nodes)[i].z;
+	}
+	status |= nc_put_var_float(fileID, xID, &values[0]);
+	status |= nc_put_var_float(fileID, yID, &values[nodes->size()]);
+	status |= nc_put_var_float(fileID, depthID, &values[2*nodes->size()]);
+
+	std::vector<int> indices (3*elements->size());
+	for (unsigned int i=0; i<elements->size(); i++)
+	{
+		indices[3*i+0] = (*elements)[i].n1;
+		indices[3*i+1] = (*elements)[i].n2;
+		indices[3*i+2] = (*elements)[i].n3;
+	}
+	if (!indices.empty())
+		status |= nc_put_var_int(fileID, elementID, &indices[0]);
+
+	for (unsigned int timestep=0; timestep<numTimesteps && status == NC_NOERR; timestep++)
+	{
+		const double Time = (timestep+1)*interval;
+		for (unsigned int i=0; i<nodes->size(); i++)
+			values[i] = GetElevation(&(*nodes)[i], Time);
+		size_t start[2] = {timestep, 0};
+		size_t count[2] = {1, nodes->size()};
+		status |= nc_put_vara_double(fileID, timeID, start, count, &Time);
+		status |= nc_put_vara_float(fileID, zetaID, start, count, &values[0]);
+	}
+
+	if (nc_close(fileID) != NC_NOERR)
+		status = 1;
+	return status == NC_NOERR ? 0 : 1;
+}
+#endif
+
+
+/**
+ * @brief Writes depth-averaged velocities for a mesh to a fort.64 file
+ *
+ * The file uses the full (not sparse) ASCII format, with the Nodes of every timestep in
+ * node number order and dry Nodes written with zero velocity.
+ *
+ * @param fileLoc The fort.64 file location
+ * @param nodes A pointer to the node list, in node number order
+ * @param numTimesteps The number of timesteps to write
+ * @param interval The model time between timesteps in seconds
+ * @return 0 if the file was written
+ * @return 1 if an error occurred
+ */
+int MeshGenerator::WriteFort64(std::string fileLoc, std::vector<Node> *nodes, unsigned int numTimesteps, double interval)
+{
+	if (nodes == 0)
+		return 1;
+
+	FILE *file = fopen(fileLoc.data(), "w");
+	if (file == 0)
+	{
+		DEBUG("Unable to create %s\n", fileLoc.data());
+		return 1;
+	}
+
+	std::vector<char> buffer (1 << 20);
+	setvbuf(file, &buffer[0], _IOFBF, buffer.size());
+
+	const unsigned int StepsPerOutput = 60;
+	fprintf(file, "adcVis synthetic velocities\n");
+	fprintf(file, "%u %u %.7E %u 2\n", numTimesteps, (unsigned int)nodes->size(), interval, StepsPerOutput);
+	for (unsigned int timestep=0; timestep<numTimesteps; timestep++)
+	{
+		const double Time = (timestep+1)*interval;
+		fprintf(file, "%.10E %u\n", Time, (timestep+1)*StepsPerOutput);
+		for (unsigned int i=0; i<nodes->size(); i++)
+		{
+			float u, v;
+			GetVelocity(&(*nodes)[i], Time, &u, &v);
+			fprintf(file, "%u %.10E %.10E\n", (*nodes)[i].nodeNumber, u, v);
+		}
+	}
+
+	bool failed = ferror(file) != 0;
+	if (fclose(file) != 0)
+		failed = true;
+	return failed ? 1 : 0;
+}
+
+
+/**
+ * @brief Returns the synthetic water level of a Node
+ *
+ * The water level is an M2 tide of 1.5 m that travels from east to west. Nodes whose
+ * ground lies above the water level are dry.
+ *
+ * @param node The Node
+ * @param time The model time in seconds
+ * @return The water level in meters, or -99999 if the Node is dry
+ */
+float MeshGenerator::GetElevation(Node *node, double time)
+{
+	const double Period = 44712.0;
+	const double Phase = 2.0*M_PI*time/Period + 0.3*node->x;
+	const float Elevation = 1.5*sin(Phase);
+	return Elevation + node->z > 0.0 ? Elevation : -99999.0;
+}
+
+
+/**
+ * @brief Returns the synthetic depth-averaged velocity of a Node
+ *
+ * The velocity follows the tide of GetElevation(), flowing mostly east-west with the
+ * flood and ebb. Dry Nodes have zero velocity.
+ *
+ * @param node The Node
+ * @param time The model time in seconds
+ * @param u A pointer to the variable that will hold the eastward velocity in m/s
+ * @param v A pointer to the variable that will hold the northward velocity in m/s
+ */
+void MeshGenerator::GetVelocity(Node *node, double time, float *u, float *v)
+{
+	const double Period = 44712.0;
+	const double Phase = 2.0*M_PI*time/Period + 0.3*node->x;
+	const bool Dry = GetElevation(node, time) == -99999.0;
+	*u = Dry ? 0.0 : 0.8*cos(Phase);
+	*v = Dry ? 0.0 : 0.2*sin(Phase + 0.1*node->y);
+}
+
+
+/**
+ * @brief Returns the name used for a mesh type on the command line and in results
+ * @param type The mesh type
+ * @return The name of the mesh type
+ */
+const char* MeshGenerator::GetTypeName(MeshType type)
+{
+	switch (type)
+	{
+		case StructuredMesh:	return "structured";
+		case GradedMesh:	return "graded";
+		case RandomMesh:	return "random";
+	}
+	return "unknown";
+}
+
+
+/**
+ * @brief Returns the next number from a xorshift random number generator
+ *
+ * The generator is used instead of the standard library's so that meshes are the same
+ * on every platform.
+ *
+ * @param state The state of the generator, must not be 0
+ * @return The next random number
+ */
+unsigned int MeshGenerator::NextRandom(unsigned int *state)
+{
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+
+/**
+ * @brief Returns the next random number in the range [0, 1)
+ * @param state The state of the generator, must not be 0
+ * @return The next random number
+ */
+float MeshGenerator::NextRandomFloat(unsigned int *state)
+{
+	return (NextRandom(state) >> 8)*(1.0f/16777216.0f);
+}
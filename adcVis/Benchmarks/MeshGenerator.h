@@ -0,0 +1,62 @@
+#ifndef MESHGENERATOR_H
+#define MESHGENERATOR_H
+
+#include "adcData.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief A set of functions that build synthetic ADCIRC meshes for benchmarking
+ *
+ * Every mesh is a triangulated grid of about the requested number of Nodes over a
+ * lon/lat box off the U.S. east coast, with depths that increase away from a coastline
+ * along the western edge. Three kinds of triangulation are available:
+ *
+ * - StructuredMesh: evenly spaced Nodes, numbered row by row, with every cell split along
+ *   the same diagonal. This is the best case for anything that walks the Node list.
+ * - GradedMesh: the same topology, but the spacing grows geometrically away from the
+ *   coastline (by about 150x across the domain), the way real coastal meshes are refined
+ *   near shore. Leaves of a Quadtree fill up unevenly on these meshes.
+ * - RandomMesh: evenly spaced Nodes moved by a random offset, cells split along a random
+ *   diagonal, and Node and Element numbers shuffled so that neighbours in the mesh are far
+ *   apart in memory. This is closest to a mesh that was generated and renumbered by an
+ *   external tool.
+ *
+ * WriteFort63() and WriteFort64() add synthetic water levels and velocities for the mesh: a
+ * tide that travels across the domain and floods and drains the Nodes near the coastline
+ * (see GetElevation() and GetVelocity()). When built with NetCDF, WriteNetcdf() writes the
+ * mesh and the same water levels as a fort.63.nc file.
+ *
+ * Meshes are deterministic: the same type, size and seed always give the same mesh, so
+ * results from separate runs can be compared.
+ *
+ */
+class MeshGenerator
+{
+	public:
+
+		/**
+		 * @brief The kinds of triangulation that can be generated
+		 */
+		enum MeshType {
+			StructuredMesh,	/**< Evenly spaced, in-order Nodes */
+			GradedMesh,	/**< Spacing graded away from the coastline */
+			RandomMesh	/**< Jittered Nodes, random diagonals and shuffled numbering */
+		};
+
+		static int		Generate(MeshType type, unsigned int targetNodes, unsigned int seed, std::vector<Node> *nodes, std::vector<Element> *elements);
+		static int		WriteFort14(std::string fileLoc, std::vector<Node> *nodes, std::vector<Element> *elements);
+		static int		WriteFort63(std::string fileLoc, std::vector<Node> *nodes, unsigned int numTimesteps, double interval, bool sparse);
+#ifdef ADCVIS_NETCDF
+		static int		WriteNetcdf(std::string fileLoc, std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int numTimesteps, double interval);
+#endif
+		static int		WriteFort64(std::string fileLoc, std::vector<Node> *nodes, unsigned int numTimesteps, double interval);
+		static float		GetElevation(Node *node, double time);
+		static void		GetVelocity(Node *node, double time, float *u, float *v);
+		static const char*	GetTypeName(MeshType type);
+		static unsigned int	NextRandom(unsigned int *state);
+		static float		NextRandomFloat(unsigned int *state);
+};
+
+#endif // MESHGENERATOR_H
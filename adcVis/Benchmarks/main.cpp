@@ -0,0 +1,1080 @@
+#include "MeshGenerator.h"
+#include "IO/FileReader.h"
+#include "IO/GlobalOutputFile.h"
+#include "IO/TimestepPrefetcher.h"
+#include "IO/QuantizedTimestepStore.h"
+#include "IO/TimeSeriesCache.h"
+#include "IO/ChunkedOutputFile.h"
+#include "IO/OutputStatistics.h"
+#include "IO/TemporalRangeIndex.h"
+#ifdef ADCVIS_NETCDF
+#include "IO/NetcdfOutputFile.h"
+#endif
+#include "Layers/Quadtree.h"
+#include "Layers/NodePicker.h"
+#include "Layers/Layer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+
+/** Receives results that would otherwise be optimized away */
+static volatile size_t resultSink;
+
+
+/**
+ * @brief The options shared by every benchmark
+ */
+struct BenchmarkOptions {
+		unsigned int	minNodes;	/**< The smallest mesh measured */
+		unsigned int	maxNodes;	/**< The largest mesh measured */
+		unsigned int	repeats;	/**< The number of times each measurement is repeated */
+		unsigned int	queries;	/**< The number of FindNode() calls per measurement */
+		unsigned int	binSize;	/**< The Quadtree leaf size */
+		unsigned int	timesteps;	/**< The number of timesteps in generated fort.63 files */
+		unsigned int	seed;		/**< The seed for the meshes and query points */
+		std::string	benchmarks;	/**< Comma separated list of the benchmarks to run */
+		std::string	tempDir;	/**< The directory that receives the fort.14 files */
+		FILE*		csv;		/**< The CSV file that receives every result, or 0 */
+};
+
+
+/**
+ * @brief Prints the command line options
+ */
+static void PrintUsage(const char *program)
+{
+	fprintf(stderr, "Usage: %s [options]\n"
+			"  --types <list>             comma separated mesh types: structured,graded,random (default all)\n"
+			"  --benchmarks <list>        comma separated benchmarks: read,output,build,find,pick,pack,crossover (default all)\n"
+			"  --min-nodes <n>            smallest mesh of the size sweep (default 10000)\n"
+			"  --max-nodes <n>            largest mesh of the size sweep (default 20000000)\n"
+			"  --repeats <n>              repeats of each measurement, the median is reported (default 5)\n"
+			"  --queries <n>              FindNode calls per measurement (default 100000)\n"
+			"  --bin-size <n>             Quadtree leaf size (default 100)\n"
+			"  --timesteps <n>            timesteps in the generated fort.63 files, limited to 40M lines (default 24)\n"
+			"  --seed <n>                 seed for the meshes and query points (default 1)\n"
+			"  --temp <dir>               directory for the generated fort.14/63 files (default /tmp)\n"
+			"  --csv <file>               also write every result to a CSV file\n", program);
+}
+
+
+/**
+ * @brief Returns true if a benchmark is in the comma separated list
+ */
+static bool IsSelected(std::string list, const char *name)
+{
+	return ("," + list + ",").find("," + std::string(name) + ",") != std::string::npos;
+}
+
+
+/**
+ * @brief Runs a function repeatedly and returns the median time
+ * @param repeats The number of runs
+ * @param function The function to time
+ * @param minSeconds A pointer to the variable that will hold the fastest run, or 0
+ * @return The median time of one run in seconds
+ */
+template <typename Function>
+static double Measure(unsigned int repeats, Function function, double *minSeconds)
+{
+	std::vector<double> times;
+	for (unsigned int i=0; i<repeats || times.empty(); i++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		function();
+		times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	if (minSeconds)
+		*minSeconds = times[0];
+	return times[times.size()/2];
+}
+
+
+/**
+ * @brief Prints one result and adds it to the CSV file
+ */
+static void Report(BenchmarkOptions *options, const char *type, std::vector<Node> *nodes, std::vector<Element> *elements,
+		   const char *benchmark, double seconds, double minSeconds, double throughput, const char *unit)
+{
+	printf("%-10s %10u %10u  %-16s %12.3f ms %14.2f %s\n", type, (unsigned int)nodes->size(), (unsigned int)elements->size(),
+	       benchmark, 1000.0*seconds, throughput, unit);
+	fflush(stdout);
+	if (options->csv)
+		fprintf(options->csv, "%s,%u,%u,%s,%.6f,%.6f,%.6f,%s\n", type, (unsigned int)nodes->size(), (unsigned int)elements->size(),
+			benchmark, 1000.0*seconds, 1000.0*minSeconds, throughput, unit);
+}
+
+
+/**
+ * @brief Returns a set of query points spread over the bounds of the mesh
+ */
+static void MakeQueries(std::vector<Node> *nodes, unsigned int count, unsigned int seed, std::vector<float> *queries)
+{
+	float minX = nodes->at(0).x, maxX = minX, minY = nodes->at(0).y, maxY = minY;
+	for (unsigned int i=1; i<nodes->size(); i++)
+	{
+		minX = std::min(minX, (*nodes)[i].x);
+		maxX = std::max(maxX, (*nodes)[i].x);
+		minY = std::min(minY, (*nodes)[i].y);
+		maxY = std::max(maxY, (*nodes)[i].y);
+	}
+
+	unsigned int state = seed;
+	queries->resize(2*count);
+	for (unsigned int i=0; i<count; i++)
+	{
+		(*queries)[2*i+0] = minX + MeshGenerator::NextRandomFloat(&state)*(maxX - minX);
+		(*queries)[2*i+1] = minY + MeshGenerator::NextRandomFloat(&state)*(maxY - minY);
+	}
+}
+
+
+/**
+ * @brief Finds the Node closest to a point by checking every Node
+ *
+ * This is the search that a Quadtree replaces.
+ *
+ */
+static Node* FindNodeLinear(std::vector<Node> *nodes, float x, float y)
+{
+	Node *closest = 0;
+	float closestDistance = 0.0;
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		const float dx = (*nodes)[i].x - x;
+		const float dy = (*nodes)[i].y - y;
+		const float distance = dx*dx + dy*dy;
+		if (closest == 0 || distance < closestDistance)
+		{
+			closest = &(*nodes)[i];
+			closestDistance = distance;
+		}
+	}
+	return closest;
+}
+
+
+/**
+ * @brief Returns the bounds of the mesh as passed to the Quadtree constructor
+ */
+static void GetBounds(std::vector<Node> *nodes, float *bounds)
+{
+	bounds[0] = bounds[2] = 99999.0;
+	bounds[1] = bounds[3] = -99999.0;
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		bounds[0] = std::min(bounds[0], (*nodes)[i].x);
+		bounds[1] = std::max(bounds[1], (*nodes)[i].x);
+		bounds[2] = std::min(bounds[2], (*nodes)[i].y);
+		bounds[3] = std::max(bounds[3], (*nodes)[i].y);
+	}
+}
+
+
+// The number of Nodes whose values are checked against MeshGenerator after reading a series
+static const unsigned int NumSampleNodes = 200;
+
+
+/**
+ * @brief A generated mesh and the fort.63 file written from it, shared by the output
+ * benchmarks
+ */
+struct OutputBenchmark {
+		const char*		typeName;	/**< The name of the mesh type */
+		std::vector<Node>*	nodes;		/**< The Nodes of the mesh */
+		std::vector<Element>*	elements;	/**< The Elements of the mesh */
+		unsigned int		numTimesteps;	/**< The number of timesteps in every generated file */
+		double			interval;	/**< The model time between timesteps in seconds */
+		std::string		fileLoc;	/**< The generated fort.63 file */
+		double			fileMB;		/**< The size of the fort.63 file in MB */
+		GlobalOutputFile	outputFile;	/**< The fort.63 file, opened by RunIndexBenchmark() */
+		std::vector<float>	lastValues;	/**< The values of the last timestep of the fort.63 file */
+};
+
+
+/**
+ * @brief Returns the location of a generated file for the mesh of an output benchmark
+ */
+static std::string GetOutputLocation(BenchmarkOptions *options, OutputBenchmark *output, const char *suffix)
+{
+	return options->tempDir + "/adcVisBenchmark_" + output->typeName + suffix;
+}
+
+
+/**
+ * @brief Returns one of a spread of Nodes whose values are checked
+ */
+static Node* GetSampleNode(OutputBenchmark *output, unsigned int k)
+{
+	return &(*output->nodes)[(k*7919ull) % output->nodes->size()];
+}
+
+
+/**
+ * @brief Prints one result for the mesh of an output benchmark and adds it to the CSV file
+ */
+static void ReportOutput(BenchmarkOptions *options, OutputBenchmark *output, const char *benchmark, double seconds, double minSeconds,
+			 double throughput, const char *unit)
+{
+	Report(options, output->typeName, output->nodes, output->elements, benchmark, seconds, minSeconds, throughput, unit);
+}
+
+
+/**
+ * @brief Generates the mesh's water levels and writes them to a fort.63 file
+ * @return 0 if the file was written successfully
+ * @return 1 otherwise
+ */
+static int WriteOutputBenchmark(BenchmarkOptions *options, const char *typeName, std::vector<Node> *nodes, std::vector<Element> *elements,
+				OutputBenchmark *output)
+{
+	output->typeName = typeName;
+	output->nodes = nodes;
+	output->elements = elements;
+	output->numTimesteps = std::max(2u, std::min(options->timesteps, (unsigned int)(40000000/nodes->size())));
+	output->interval = 3600.0;
+	output->fileLoc = GetOutputLocation(options, output, ".63");
+	output->fileMB = 0.0;
+	if (MeshGenerator::WriteFort63(output->fileLoc, nodes, output->numTimesteps, output->interval, false) != 0)
+	{
+		fprintf(stderr, "Unable to write %s\n", output->fileLoc.data());
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Measures indexing the fort.63 file and reading its last timestep
+ * @return 0 if the file was indexed, so that the other output benchmarks can use it
+ * @return 1 otherwise
+ */
+static int RunIndexBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	std::vector<Node> *nodes = output->nodes;
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const double NodeMB = nodes->size()/1.0e6;
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(options->repeats, [&]() {
+		result |= output->outputFile.Open(output->fileLoc);
+	}, &minSeconds);
+	OutputTimestepInfo *last = output->outputFile.GetTimestepInfo(NumTimesteps-1);
+	if (result != 0 || last == 0 || output->outputFile.GetNumTimesteps() != NumTimesteps)
+	{
+		fprintf(stderr, "GlobalOutputFile did not index %s\n", output->fileLoc.data());
+		return 1;
+	}
+	output->fileMB = (last->offset + last->size)/1.0e6;
+	ReportOutput(options, output, "Fort63 index", seconds, minSeconds, output->fileMB/seconds, "MB/s");
+
+	// Only the last timestep is parsed
+	std::vector<float> *values = &output->lastValues;
+	values->resize(nodes->size());
+	seconds = Measure(options->repeats, [&]() {
+		result |= output->outputFile.ReadTimestep(NumTimesteps-1, &(*values)[0]);
+	}, &minSeconds);
+	unsigned int wrong = 0;
+	for (unsigned int i=0; i<nodes->size(); i++)
+		if (fabs((*values)[(*nodes)[i].nodeNumber-1] - MeshGenerator::GetElevation(&(*nodes)[i], NumTimesteps*output->interval)) > 1.0e-5)
+			wrong++;
+	if (result != 0 || wrong > 0)
+		fprintf(stderr, "ReadTimestep read %u wrong values from %s\n", wrong, output->fileLoc.data());
+	ReportOutput(options, output, "Fort63 last step", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+	return 0;
+}
+
+
+/**
+ * @brief Measures the stalls of playing every timestep with a fixed frame time, reading
+ * on the drawing thread or through a TimestepPrefetcher, then jumping back to the start
+ */
+static void RunPrefetchBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const std::chrono::milliseconds FrameTime (33);
+	std::vector<float> values (output->nodes->size());
+	std::vector<double> stalls;
+	int result = 0;
+	for (unsigned int t=0; t<NumTimesteps; t++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		result |= output->outputFile.ReadTimestep(t, &values[0]);
+		stalls.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		std::this_thread::sleep_for(FrameTime);
+	}
+	std::sort(stalls.begin(), stalls.end());
+	ReportOutput(options, output, "Play sync stall", stalls[stalls.size()/2], stalls[0], 1.0/stalls[stalls.size()/2], "steps/s");
+
+	TimestepPrefetcher prefetcher;
+	prefetcher.Start(&output->outputFile, 8, 2);
+	stalls.clear();
+	for (unsigned int t=0; t<=NumTimesteps; t++)
+	{
+		const unsigned int Timestep = t < NumTimesteps ? t : 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		float *prefetched = prefetcher.Acquire(Timestep, true);
+		stalls.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		if (prefetched == 0)
+			result = 1;
+		else if (t == NumTimesteps-1 && memcmp(prefetched, &output->lastValues[0], values.size()*sizeof(float)) != 0)
+			fprintf(stderr, "TimestepPrefetcher returned wrong values for timestep %u\n", t);
+		prefetcher.Release(Timestep);
+		std::this_thread::sleep_for(FrameTime);
+	}
+	if (result != 0)
+		fprintf(stderr, "Unable to play every timestep of %s\n", output->fileLoc.data());
+	const double SeekStall = stalls.back();
+	stalls.pop_back();
+	std::sort(stalls.begin(), stalls.end());
+	ReportOutput(options, output, "Play fetch stall", stalls[stalls.size()/2], stalls[0], 1.0/stalls[stalls.size()/2], "steps/s");
+	PrefetchStats prefetchStats = prefetcher.GetStats();
+	printf("%-10s %10s %10s  prefetch: %lu hits, %lu waits, seek back %.1f ms, %lu timesteps discarded\n", "", "", "",
+	       prefetchStats.hits, prefetchStats.waits, 1000.0*SeekStall, prefetchStats.discarded);
+	prefetcher.Stop();
+}
+
+
+/**
+ * @brief Measures loading every timestep into a QuantizedTimestepStore, in 16 bits and in
+ * 8 bits where that stays within 1 cm, and decoding the last one
+ */
+static void RunQuantizedBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	const unsigned int NumNodes = output->nodes->size();
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const std::vector<float> &values = output->lastValues;
+	const float MaxError[2] = {0.0, 0.01};
+	const char *QuantizeNames[2] = {"Quantize16 load", "Quantize8 load"};
+	const char *DecodeNames[2] = {"Quantize16 decode", "Quantize8 decode"};
+	double minSeconds;
+	int result = 0;
+	for (unsigned int q=0; q<2; q++)
+	{
+		QuantizedTimestepStore store;
+		double seconds = Measure(1, [&]() {
+			store.Reset(NumNodes, MaxError[q]);
+			result |= store.Load(&output->outputFile);
+		}, &minSeconds);
+		ReportOutput(options, output, QuantizeNames[q], seconds, minSeconds, NumTimesteps/seconds, "steps/s");
+
+		std::vector<float> decoded (NumNodes);
+		seconds = Measure(options->repeats, [&]() {
+			result |= store.DecodeTimestep(NumTimesteps-1, &decoded[0]);
+		}, &minSeconds);
+		float maxError = 0.0;
+		for (unsigned int i=0; i<NumNodes; i++)
+		{
+			if ((values[i] == -99999.0) != (decoded[i] == -99999.0))
+				maxError = 99999.0;
+			else if (fabs(values[i] - decoded[i]) > maxError)
+				maxError = fabs(values[i] - decoded[i]);
+		}
+		if (result != 0 || maxError > 1.0001*store.GetMaxError(NumTimesteps-1) + 1.0e-6)
+			fprintf(stderr, "QuantizedTimestepStore decoded values %g off, more than its bound of %g\n", maxError, store.GetMaxError(NumTimesteps-1));
+		ReportOutput(options, output, DecodeNames[q], seconds, minSeconds, NumNodes/1.0e6/seconds, "Mnodes/s");
+		printf("%-10s %10s %10s  %u bit: %.1f MB for %u timesteps (%.1f MB as floats), error %.2g m\n", "", "", "",
+		       store.GetBitsPerValue(NumTimesteps-1), store.GetMemorySize()/1.0e6, NumTimesteps,
+		       4.0*NumNodes*NumTimesteps/1.0e6, maxError);
+	}
+}
+
+
+/**
+ * @brief Measures converting to a node-major TimeSeriesCache in the background, with room
+ * for only a few timesteps at a time, then reading the series of a spread of Nodes
+ */
+static void RunSeriesBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const std::string SeriesLoc = output->fileLoc + ".series";
+	const size_t SeriesBudget = 4*output->nodes->size()*sizeof(float);
+	TimeSeriesCache seriesCache;
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(1, [&]() {
+		result |= seriesCache.StartConversion(&output->outputFile, SeriesLoc, SeriesBudget);
+		while (seriesCache.IsConverting())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}, &minSeconds);
+	ReportOutput(options, output, "Series convert", seconds, minSeconds, NumTimesteps/seconds, "steps/s");
+
+	std::vector<float> series (NumTimesteps);
+	seconds = Measure(options->repeats, [&]() {
+		for (unsigned int k=0; k<NumSampleNodes; k++)
+			result |= seriesCache.ReadSeries(GetSampleNode(output, k)->nodeNumber, &series[0]);
+	}, &minSeconds);
+	unsigned int wrong = 0;
+	for (unsigned int k=0; k<NumSampleNodes; k++)
+	{
+		Node *node = GetSampleNode(output, k);
+		result |= seriesCache.ReadSeries(node->nodeNumber, &series[0]);
+		for (unsigned int t=0; t<NumTimesteps; t++)
+			if (fabs(series[t] - MeshGenerator::GetElevation(node, (t+1)*output->interval)) > 1.0e-5)
+				wrong++;
+	}
+	if (result != 0 || !seriesCache.IsOpen() || wrong > 0)
+		fprintf(stderr, "TimeSeriesCache read %u wrong values from %s\n", wrong, SeriesLoc.data());
+	ReportOutput(options, output, "Series read", seconds/NumSampleNodes, minSeconds/NumSampleNodes, NumSampleNodes/seconds, "series/s");
+	printf("%-10s %10s %10s  series: %u reads of %u timesteps each\n", "", "", "",
+	       (NumTimesteps + seriesCache.GetTimestepsPerTile() - 1)/seriesCache.GetTimestepsPerTile(), seriesCache.GetTimestepsPerTile());
+	seriesCache.Close();
+	remove(SeriesLoc.data());
+}
+
+
+/**
+ * @brief Measures converting to a ChunkedOutputFile, then playing every timestep and
+ * reading a window of Nodes over every timestep
+ */
+static void RunChunkedBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	std::vector<Node> *nodes = output->nodes;
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const double NodeMB = nodes->size()/1.0e6;
+	const std::string ChunkedLoc = output->fileLoc + ".chunked";
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(1, [&]() {
+		result |= ChunkedOutputFile::Write(&output->outputFile, ChunkedLoc, 16384, 8);
+	}, &minSeconds);
+	ReportOutput(options, output, "Chunked convert", seconds, minSeconds, NumTimesteps/seconds, "steps/s");
+
+	ChunkedOutputFile chunkedFile;
+	result |= chunkedFile.Open(ChunkedLoc);
+	std::vector<float> chunkedValues (nodes->size());
+	seconds = Measure(options->repeats, [&]() {
+		for (unsigned int t=0; t<NumTimesteps; t++)
+			result |= chunkedFile.ReadTimestep(t, &chunkedValues[0]);
+	}, &minSeconds);
+	if (result != 0 || memcmp(&chunkedValues[0], &output->lastValues[0], chunkedValues.size()*sizeof(float)) != 0)
+		fprintf(stderr, "ChunkedOutputFile did not read back the last timestep of %s\n", ChunkedLoc.data());
+	ReportOutput(options, output, "Chunked play step", seconds/NumTimesteps, minSeconds/NumTimesteps, NodeMB*NumTimesteps/seconds, "Mnodes/s");
+
+	const unsigned int WindowFirst = nodes->size()/2 + 1;
+	const unsigned int WindowLast = WindowFirst + 9999 < nodes->size() ? WindowFirst + 9999 : nodes->size();
+	const unsigned int WindowNodes = WindowLast - WindowFirst + 1;
+	std::vector<float> window ((size_t)WindowNodes*NumTimesteps);
+	seconds = Measure(options->repeats, [&]() {
+		result |= chunkedFile.ReadWindow(WindowFirst, WindowLast, 0, NumTimesteps-1, &window[0]);
+	}, &minSeconds);
+	unsigned int wrong = 0;
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		Node *node = &(*nodes)[i];
+		if (node->nodeNumber < WindowFirst || node->nodeNumber > WindowLast)
+			continue;
+		for (unsigned int t=0; t<NumTimesteps; t++)
+			if (fabs(window[(size_t)t*WindowNodes + node->nodeNumber - WindowFirst] - MeshGenerator::GetElevation(node, (t+1)*output->interval)) > 1.0e-5)
+				wrong++;
+	}
+	if (result != 0 || wrong > 0)
+		fprintf(stderr, "ChunkedOutputFile read %u wrong values in a window of %s\n", wrong, ChunkedLoc.data());
+	ReportOutput(options, output, "Chunked window", seconds, minSeconds, WindowNodes*NumTimesteps/1.0e6/seconds, "Mvalues/s");
+	printf("%-10s %10s %10s  chunked: %.1f MB (%.1f MB as text, %.1f MB as floats)\n", "", "", "",
+	       chunkedFile.GetCompressedSize()/1.0e6, output->fileMB, 4.0*nodes->size()*NumTimesteps/1.0e6);
+	remove(ChunkedLoc.data());
+}
+
+
+/**
+ * @brief Measures per-Node OutputStatistics of the whole file in one pass, and the cost of
+ * adding one timestep that is already in memory
+ */
+static void RunStatisticsBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	const unsigned int NumNodes = output->nodes->size();
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const double Interval = output->interval;
+	OutputStatistics statistics;
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(1, [&]() {
+		statistics.Reset(NumNodes);
+		result |= statistics.AddFile(&output->outputFile);
+	}, &minSeconds);
+	ReportOutput(options, output, "Statistics file", seconds, minSeconds, NumTimesteps/seconds, "steps/s");
+
+	std::vector<float> maxValues (NumNodes), timesOfMax (NumNodes), hoursWet (NumNodes);
+	result |= statistics.GetStatistic(OutputStatistics::MaxValue, &maxValues[0]);
+	result |= statistics.GetStatistic(OutputStatistics::TimeOfMax, &timesOfMax[0]);
+	result |= statistics.GetStatistic(OutputStatistics::HoursWet, &hoursWet[0]);
+	unsigned int wrong = 0;
+	for (unsigned int k=0; k<NumSampleNodes; k++)
+	{
+		Node *node = GetSampleNode(output, k);
+		float expectedMax = -99999.0, expectedTime = -99999.0;
+		unsigned int expectedWet = 0;
+		for (unsigned int t=0; t<NumTimesteps; t++)
+		{
+			const float Value = MeshGenerator::GetElevation(node, (t+1)*Interval);
+			if (Value == -99999.0)
+				continue;
+			expectedWet++;
+			if (expectedWet == 1 || Value > expectedMax + 1.0e-5)
+			{
+				expectedMax = Value;
+				expectedTime = (t+1)*Interval;
+			}
+		}
+		const unsigned int Index = node->nodeNumber-1;
+		if (fabs(maxValues[Index] - expectedMax) > 1.0e-5 || (expectedWet > 0 && fabs(timesOfMax[Index] - expectedTime) > 1.0) ||
+		    fabs(hoursWet[Index] - expectedWet*Interval/3600.0) > 1.0e-3)
+			wrong++;
+	}
+	if (result != 0 || statistics.GetNumTimesteps() != NumTimesteps || wrong > 0)
+		fprintf(stderr, "OutputStatistics got %u of %u Nodes wrong\n", wrong, NumSampleNodes);
+
+	seconds = Measure(options->repeats, [&]() {
+		result |= statistics.AddTimestep(&output->lastValues[0], NumTimesteps*Interval);
+	}, &minSeconds);
+	ReportOutput(options, output, "Statistics step", seconds, minSeconds, NumNodes/1.0e6/seconds, "Mnodes/s");
+}
+
+
+/**
+ * @brief Measures building a TemporalRangeIndex of every timestep, then finding the
+ * largest value of every Node over a window in the middle of the run
+ */
+static void RunRangeIndexBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	const unsigned int NumNodes = output->nodes->size();
+	const unsigned int NumTimesteps = output->numTimesteps;
+	TemporalRangeIndex rangeIndex;
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(1, [&]() {
+		rangeIndex.Reset(NumNodes, NumTimesteps);
+		result |= rangeIndex.AddFile(&output->outputFile);
+	}, &minSeconds);
+	ReportOutput(options, output, "Range index build", seconds, minSeconds, NumTimesteps/seconds, "steps/s");
+
+	const unsigned int WindowStart = NumTimesteps/4, WindowEnd = NumTimesteps - NumTimesteps/4 - 1;
+	std::vector<float> windowMax (NumNodes), windowMin (NumNodes);
+	seconds = Measure(options->repeats, [&]() {
+		result |= rangeIndex.GetMax(WindowStart, WindowEnd, &windowMax[0]);
+	}, &minSeconds);
+	result |= rangeIndex.GetMin(WindowStart, WindowEnd, &windowMin[0]);
+	unsigned int wrong = 0;
+	for (unsigned int k=0; k<NumSampleNodes; k++)
+	{
+		Node *node = GetSampleNode(output, k);
+		float expectedMax = -99999.0, expectedMin = -99999.0;
+		for (unsigned int t=WindowStart; t<=WindowEnd; t++)
+		{
+			const float Value = MeshGenerator::GetElevation(node, (t+1)*output->interval);
+			if (Value == -99999.0)
+				continue;
+			expectedMax = expectedMax == -99999.0 || Value > expectedMax ? Value : expectedMax;
+			expectedMin = expectedMin == -99999.0 || Value < expectedMin ? Value : expectedMin;
+		}
+		if (fabs(windowMax[node->nodeNumber-1] - expectedMax) > 1.0e-5 || fabs(windowMin[node->nodeNumber-1] - expectedMin) > 1.0e-5)
+			wrong++;
+	}
+	if (result != 0 || wrong > 0)
+		fprintf(stderr, "TemporalRangeIndex got %u of %u Nodes wrong\n", wrong, NumSampleNodes);
+	ReportOutput(options, output, "Range index max", seconds, minSeconds, NumNodes/1.0e6/seconds, "Mnodes/s");
+	printf("%-10s %10s %10s  range index: timesteps %u-%u, %u levels, %.1f MB\n", "", "", "",
+	       WindowStart, WindowEnd, rangeIndex.GetNumLevels(), rangeIndex.GetMemorySize()/1.0e6);
+}
+
+
+/**
+ * @brief Measures reading the last timestep without an index, where every earlier
+ * timestep has to be parsed as well
+ */
+static void RunScanBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	const unsigned int NumNodes = output->nodes->size();
+	const unsigned int NumTimesteps = output->numTimesteps;
+	std::vector<float> values (NumNodes);
+	double minSeconds;
+	double seconds = Measure(1, [&]() {
+		std::ifstream fort63 (output->fileLoc.data());
+		std::string line;
+		std::getline(fort63, line);
+		std::getline(fort63, line);
+		double time;
+		unsigned int iteration, node;
+		for (unsigned int t=0; t<NumTimesteps; t++)
+		{
+			fort63 >> time >> iteration;
+			for (unsigned int i=0; i<NumNodes; i++)
+			{
+				fort63 >> node;
+				fort63 >> values[i];
+			}
+		}
+	}, &minSeconds);
+	ReportOutput(options, output, "Fort63 scan+step", seconds, minSeconds, NumTimesteps*NumNodes/1.0e6/seconds, "Mnodes/s");
+}
+
+
+#ifdef ADCVIS_NETCDF
+/**
+ * @brief Measures reading the mesh and the same water levels from a fort.63.nc file
+ */
+static void RunNetcdfBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	std::vector<Node> *nodes = output->nodes;
+	std::vector<Element> *elements = output->elements;
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const double NodeMB = nodes->size()/1.0e6;
+	const std::string FileLoc = GetOutputLocation(options, output, ".63.nc");
+	if (MeshGenerator::WriteNetcdf(FileLoc, nodes, elements, NumTimesteps, output->interval) != 0)
+	{
+		fprintf(stderr, "Unable to write %s\n", FileLoc.data());
+		remove(FileLoc.data());
+		return;
+	}
+
+	NetcdfOutputFile netcdfFile;
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(options->repeats, [&]() {
+		result |= netcdfFile.Open(FileLoc);
+	}, &minSeconds);
+	ReportOutput(options, output, "NetCDF open", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+
+	std::vector<Node> readNodes;
+	std::vector<Element> readElements;
+	seconds = Measure(options->repeats, [&]() {
+		result |= netcdfFile.ReadMesh(&readNodes, &readElements);
+	}, &minSeconds);
+	if (result != 0 || readNodes.size() != nodes->size() || readElements.size() != elements->size())
+		fprintf(stderr, "ReadMesh did not read back %s\n", FileLoc.data());
+	ReportOutput(options, output, "NetCDF mesh", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+
+	std::vector<float> values (nodes->size());
+	seconds = Measure(options->repeats, [&]() {
+		result |= netcdfFile.ReadTimestep(NumTimesteps-1, &values[0]);
+	}, &minSeconds);
+	unsigned int wrong = 0;
+	for (unsigned int i=0; i<nodes->size(); i++)
+		if (fabs(values[(*nodes)[i].nodeNumber-1] - MeshGenerator::GetElevation(&(*nodes)[i], NumTimesteps*output->interval)) > 1.0e-5)
+			wrong++;
+	if (result != 0 || wrong > 0)
+		fprintf(stderr, "ReadTimestep read %u wrong values from %s\n", wrong, FileLoc.data());
+	ReportOutput(options, output, "NetCDF last step", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+
+	// Playing every timestep in order reuses the chunks in the cache
+	seconds = Measure(options->repeats, [&]() {
+		for (unsigned int t=0; t<NumTimesteps; t++)
+			result |= netcdfFile.ReadTimestep(t, &values[0]);
+	}, &minSeconds);
+	ReportOutput(options, output, "NetCDF every step", seconds/NumTimesteps, minSeconds/NumTimesteps, NumTimesteps*NodeMB/seconds, "Mnodes/s");
+	remove(FileLoc.data());
+}
+#endif
+
+
+/**
+ * @brief Measures reading the same water levels in the sparse format, which leaves out
+ * dry Nodes
+ */
+static void RunSparseBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	std::vector<Node> *nodes = output->nodes;
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const std::string FileLoc = GetOutputLocation(options, output, "_sparse.63");
+	GlobalOutputFile sparseFile;
+	if (MeshGenerator::WriteFort63(FileLoc, nodes, NumTimesteps, output->interval, true) != 0 || sparseFile.Open(FileLoc) != 0)
+	{
+		fprintf(stderr, "Unable to write %s\n", FileLoc.data());
+		remove(FileLoc.data());
+		return;
+	}
+
+	std::vector<float> values (nodes->size());
+	unsigned int numWet = 0, expectedWet = 0;
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(options->repeats, [&]() {
+		result |= sparseFile.ReadTimestep(NumTimesteps-1, &values[0], &numWet);
+	}, &minSeconds);
+	unsigned int wrong = 0;
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		const float Expected = MeshGenerator::GetElevation(&(*nodes)[i], NumTimesteps*output->interval);
+		if (Expected != -99999.0)
+			expectedWet++;
+		if (fabs(values[(*nodes)[i].nodeNumber-1] - Expected) > 1.0e-5)
+			wrong++;
+	}
+	if (result != 0 || wrong > 0 || numWet != expectedWet)
+		fprintf(stderr, "ReadTimestep read %u wrong values and %u of %u wet nodes from %s\n", wrong, numWet, expectedWet, FileLoc.data());
+	ReportOutput(options, output, "Fort63 sparse step", seconds, minSeconds, nodes->size()/1.0e6/seconds, "Mnodes/s");
+	OutputTimestepInfo *last = sparseFile.GetTimestepInfo(NumTimesteps-1);
+	printf("%-10s %10s %10s  sparse timestep: %u of %u nodes wet, %.1f MB\n", "", "", "", numWet, (unsigned int)nodes->size(), last->size/1.0e6);
+	remove(FileLoc.data());
+}
+
+
+/**
+ * @brief Measures reading the velocities of a fort.64 file and computing their magnitude
+ */
+static void RunVelocityBenchmark(BenchmarkOptions *options, OutputBenchmark *output)
+{
+	std::vector<Node> *nodes = output->nodes;
+	const unsigned int NumTimesteps = output->numTimesteps;
+	const double NodeMB = nodes->size()/1.0e6;
+	const std::string FileLoc = GetOutputLocation(options, output, ".64");
+	GlobalOutputFile velocityFile;
+	if (MeshGenerator::WriteFort64(FileLoc, nodes, NumTimesteps, output->interval) != 0 || velocityFile.Open(FileLoc) != 0)
+	{
+		fprintf(stderr, "Unable to write %s\n", FileLoc.data());
+		remove(FileLoc.data());
+		return;
+	}
+
+	std::vector<float> u (nodes->size()), v (nodes->size()), magnitude (nodes->size());
+	double minSeconds;
+	int result = 0;
+	double seconds = Measure(options->repeats, [&]() {
+		result |= velocityFile.ReadTimestep(NumTimesteps-1, &u[0], &v[0], &magnitude[0]);
+	}, &minSeconds);
+	unsigned int wrong = 0;
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		float expectedU, expectedV;
+		MeshGenerator::GetVelocity(&(*nodes)[i], NumTimesteps*output->interval, &expectedU, &expectedV);
+		const unsigned int Index = (*nodes)[i].nodeNumber-1;
+		if (fabs(u[Index] - expectedU) > 1.0e-5 || fabs(v[Index] - expectedV) > 1.0e-5 ||
+		    fabs(magnitude[Index] - sqrt(expectedU*expectedU + expectedV*expectedV)) > 1.0e-5)
+			wrong++;
+	}
+	if (result != 0 || wrong > 0)
+		fprintf(stderr, "ReadTimestep read %u wrong vectors from %s\n", wrong, FileLoc.data());
+	ReportOutput(options, output, "Fort64 last step", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+
+	seconds = Measure(options->repeats, [&]() {
+		GlobalOutputFile::ComputeMagnitude(&u[0], &v[0], &magnitude[0], nodes->size());
+	}, &minSeconds);
+	ReportOutput(options, output, "Magnitude", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+	remove(FileLoc.data());
+}
+
+/**
+ * @brief Measures reading, indexing, searching and packing one mesh
+ */
+static void RunSizeBenchmarks(BenchmarkOptions *options, MeshGenerator::MeshType type, unsigned int targetNodes)
+{
+	const char *typeName = MeshGenerator::GetTypeName(type);
+	std::vector<Node> nodes;
+	std::vector<Element> elements;
+	if (MeshGenerator::Generate(type, targetNodes, options->seed, &nodes, &elements) != 0)
+	{
+		fprintf(stderr, "Unable to generate a %s mesh with %u nodes\n", typeName, targetNodes);
+		return;
+	}
+
+	const double NodeMB = nodes.size()/1.0e6;
+	double minSeconds;
+
+	if (IsSelected(options->benchmarks, "read"))
+	{
+		std::string fileLoc = options->tempDir + "/adcVisBenchmark_" + typeName + ".14";
+		if (MeshGenerator::WriteFort14(fileLoc, &nodes, &elements) == 0)
+		{
+			std::vector<Node> readNodes;
+			std::vector<Element> readElements;
+			unsigned int numNodes, numElements;
+			float minX, maxX, minY, maxY, minZ, maxZ;
+			int result = 0;
+			double seconds = Measure(options->repeats, [&]() {
+				result |= FileReader::ReadFort14(fileLoc, &readNodes, &readElements, &numNodes, &numElements,
+								 &minX, &maxX, &minY, &maxY, &minZ, &maxZ);
+			}, &minSeconds);
+			if (result != 0 || readNodes.size() != nodes.size() || readElements.size() != elements.size())
+				fprintf(stderr, "ReadFort14 did not read back %s\n", fileLoc.data());
+			else
+				Report(options, typeName, &nodes, &elements, "ReadFort14", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+		} else {
+			fprintf(stderr, "Unable to write %s\n", fileLoc.data());
+		}
+		remove(fileLoc.data());
+	}
+
+	if (IsSelected(options->benchmarks, "output"))
+	{
+		OutputBenchmark output;
+		if (WriteOutputBenchmark(options, typeName, &nodes, &elements, &output) == 0 && RunIndexBenchmark(options, &output) == 0)
+		{
+			RunPrefetchBenchmark(options, &output);
+			RunQuantizedBenchmark(options, &output);
+			RunSeriesBenchmark(options, &output);
+			RunChunkedBenchmark(options, &output);
+			RunStatisticsBenchmark(options, &output);
+			RunRangeIndexBenchmark(options, &output);
+			RunScanBenchmark(options, &output);
+		}
+		remove(output.fileLoc.data());
+
+#ifdef ADCVIS_NETCDF
+		RunNetcdfBenchmark(options, &output);
+#endif
+		RunSparseBenchmark(options, &output);
+		RunVelocityBenchmark(options, &output);
+	}
+
+	float bounds[4];
+	GetBounds(&nodes, bounds);
+
+	if (IsSelected(options->benchmarks, "build"))
+	{
+		double seconds = Measure(options->repeats, [&]() {
+			Quadtree quadtree (nodes, options->binSize, bounds[0], bounds[1], bounds[2], bounds[3]);
+		}, &minSeconds);
+		Report(options, typeName, &nodes, &elements, "Quadtree build", seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+	}
+
+	if (IsSelected(options->benchmarks, "find"))
+	{
+		Quadtree quadtree (nodes, options->binSize, bounds[0], bounds[1], bounds[2], bounds[3]);
+		std::vector<float> queries;
+		MakeQueries(&nodes, options->queries, options->seed, &queries);
+		unsigned int misses = 0;
+		double seconds = Measure(options->repeats, [&]() {
+			misses = 0;
+			for (unsigned int i=0; i<options->queries; i++)
+				if (quadtree.FindNode(queries[2*i+0], queries[2*i+1]) == 0)
+					misses++;
+		}, &minSeconds);
+		Report(options, typeName, &nodes, &elements, "FindNode", seconds, minSeconds, options->queries/seconds/1.0e6, "Mqueries/s");
+		if (misses > 0)
+			printf("%-10s %10s %10s  %u of %u queries landed in an empty leaf\n", "", "", "", misses, options->queries);
+	}
+
+	if (IsSelected(options->benchmarks, "pick"))
+	{
+		// Linear picks are slow on large meshes, so fewer are timed
+		std::vector<float> queries;
+		MakeQueries(&nodes, options->queries, options->seed, &queries);
+		const NodePicker::Strategy Strategies[3] = {NodePicker::LinearSearch, NodePicker::GridSearch, NodePicker::QuadtreeSearch};
+		const char *BuildNames[3] = {"", "Pick build grid", "Pick build qt"};
+		const char *PickNames[3] = {"Pick linear", "Pick grid", "Pick quadtree"};
+		std::vector<Node*> linearResults;
+		for (unsigned int s=0; s<3; s++)
+		{
+			const unsigned int NumQueries = s == 0 ? std::max(10u, std::min(options->queries, (unsigned int)(1.0e9/nodes.size()))) : options->queries;
+			NodePicker picker;
+			picker.SetStrategy(Strategies[s]);
+			double seconds = Measure(options->repeats, [&]() {
+				picker.Build(&nodes, bounds[0], bounds[1], bounds[2], bounds[3]);
+			}, &minSeconds);
+			if (s > 0)
+				Report(options, typeName, &nodes, &elements, BuildNames[s], seconds, minSeconds, NodeMB/seconds, "Mnodes/s");
+
+			std::vector<Node*> results (NumQueries);
+			seconds = Measure(options->repeats, [&]() {
+				for (unsigned int i=0; i<NumQueries; i++)
+					results[i] = picker.FindNode(queries[2*i+0], queries[2*i+1]);
+			}, &minSeconds);
+			Report(options, typeName, &nodes, &elements, PickNames[s], seconds/NumQueries, minSeconds/NumQueries, 1.0e9*seconds/NumQueries, "ns/pick");
+
+			// The grid must find exactly the Nodes a linear search finds, the Quadtree only
+			// searches one leaf and may not
+			if (s == 0)
+				linearResults = results;
+			unsigned int mismatches = 0;
+			for (unsigned int i=0; i<linearResults.size() && i<NumQueries; i++)
+				if (results[i] != linearResults[i])
+					mismatches++;
+			if (mismatches > 0)
+				printf("%-10s %10s %10s  %s search: %u of %u picks differ from a linear search\n", "", "", "",
+				       NodePicker::GetStrategyName(Strategies[s]), mismatches, (unsigned int)linearResults.size());
+		}
+
+		NodePicker picker;
+		picker.Build(&nodes, bounds[0], bounds[1], bounds[2], bounds[3]);
+		printf("%-10s %10s %10s  auto: %s search, %s\n", "", "", "", NodePicker::GetStrategyName(picker.GetStrategy()), picker.GetReason().data());
+		picker.SetCalibration(true);
+		picker.Build(&nodes, bounds[0], bounds[1], bounds[2], bounds[3]);
+		printf("%-10s %10s %10s  calibrated: %s search, %s\n", "", "", "", NodePicker::GetStrategyName(picker.GetStrategy()), picker.GetReason().data());
+	}
+
+	if (IsSelected(options->benchmarks, "pack"))
+	{
+		std::vector<GLfloat> vertexData (4*nodes.size());
+		std::vector<GLuint> indexData (3*elements.size());
+		const double MB = (vertexData.size()*sizeof(GLfloat) + indexData.size()*sizeof(GLuint))/1.0e6;
+		double seconds = Measure(options->repeats, [&]() {
+			Layer::PackVertexData(&nodes, &vertexData[0]);
+			Layer::PackIndexData(&elements, &indexData[0]);
+		}, &minSeconds);
+		Report(options, typeName, &nodes, &elements, "Pack GPU data", seconds, minSeconds, MB/seconds, "MB/s");
+	}
+}
+
+
+/**
+ * @brief Finds the number of Nodes above which a Quadtree finds Nodes faster than a
+ * linear search
+ *
+ * Meshes from 4 Nodes upward are searched both ways. The crossover is the smallest mesh
+ * where a Quadtree query is faster than a linear one. Since the Quadtree must be built
+ * first, the number of picks needed to pay back the build is also reported.
+ *
+ */
+static void RunCrossoverBenchmark(BenchmarkOptions *options, MeshGenerator::MeshType type)
+{
+	const char *typeName = MeshGenerator::GetTypeName(type);
+	printf("\n%-10s %10s  %14s %14s %14s %12s\n", typeName, "nodes", "linear ns", "quadtree ns", "build us", "break-even");
+
+	unsigned int crossover = 0;
+	for (unsigned int targetNodes=4; targetNodes<=262144; targetNodes*=2)
+	{
+		std::vector<Node> nodes;
+		std::vector<Element> elements;
+		if (MeshGenerator::Generate(type, targetNodes, options->seed, &nodes, &elements) != 0)
+			return;
+
+		float bounds[4];
+		GetBounds(&nodes, bounds);
+		std::vector<float> queries;
+		const unsigned int NumQueries = std::max(100u, std::min(options->queries, (unsigned int)(20000000/nodes.size())));
+		MakeQueries(&nodes, NumQueries, options->seed, &queries);
+
+		// Every query must be answered by both searches for the comparison to be fair
+		Quadtree quadtree (nodes, options->binSize, bounds[0], bounds[1], bounds[2], bounds[3]);
+		size_t checksum = 0;
+		double linearSeconds = Measure(options->repeats, [&]() {
+			for (unsigned int i=0; i<NumQueries; i++)
+				checksum += (size_t)FindNodeLinear(&nodes, queries[2*i+0], queries[2*i+1]);
+		}, 0)/NumQueries;
+		double quadtreeSeconds = Measure(options->repeats, [&]() {
+			for (unsigned int i=0; i<NumQueries; i++)
+				checksum += (size_t)quadtree.FindNode(queries[2*i+0], queries[2*i+1]);
+		}, 0)/NumQueries;
+		double buildSeconds = Measure(options->repeats, [&]() {
+			Quadtree tempQuadtree (nodes, options->binSize, bounds[0], bounds[1], bounds[2], bounds[3]);
+		}, 0);
+
+		if (crossover == 0 && quadtreeSeconds < linearSeconds)
+			crossover = nodes.size();
+
+		char breakEven[32] = "never";
+		if (quadtreeSeconds < linearSeconds)
+			snprintf(breakEven, sizeof(breakEven), "%.0f picks", ceil(buildSeconds/(linearSeconds - quadtreeSeconds)));
+		printf("%-10s %10u  %14.1f %14.1f %14.1f %12s\n", "", (unsigned int)nodes.size(), 1.0e9*linearSeconds,
+		       1.0e9*quadtreeSeconds, 1.0e6*buildSeconds, breakEven);
+		if (options->csv)
+		{
+			fprintf(options->csv, "%s,%u,%u,FindNode linear,%.6f,,%.6f,ns/query\n", typeName, (unsigned int)nodes.size(),
+				(unsigned int)elements.size(), 1000.0*linearSeconds, 1.0e9*linearSeconds);
+			fprintf(options->csv, "%s,%u,%u,FindNode quadtree,%.6f,,%.6f,ns/query\n", typeName, (unsigned int)nodes.size(),
+				(unsigned int)elements.size(), 1000.0*quadtreeSeconds, 1.0e9*quadtreeSeconds);
+		}
+		resultSink = checksum;
+	}
+
+	if (crossover > 0)
+		printf("%-10s crossover: a Quadtree query is faster than a linear search from %u nodes\n", typeName, crossover);
+	else
+		printf("%-10s crossover: a linear search was faster at every size\n", typeName);
+	fflush(stdout);
+}
+
+
+/**
+ * @brief Runs the adcVis micro-benchmarks on synthetic meshes
+ *
+ * Every selected benchmark is run on every selected mesh type at 10K, 100K, 1M, 5M and
+ * 20M Nodes (limited by --min-nodes and --max-nodes). The crossover benchmark sweeps
+ * small meshes separately. Results are printed as a table and optionally written to CSV.
+ *
+ */
+int main(int argc, char *argv[])
+{
+	BenchmarkOptions options;
+	options.minNodes = 10000;
+	options.maxNodes = 20000000;
+	options.repeats = 5;
+	options.queries = 100000;
+	options.binSize = 100;
+	options.seed = 1;
+	options.timesteps = 24;
+	options.benchmarks = "read,output,build,find,pick,pack,crossover";
+	options.tempDir = "/tmp";
+	options.csv = 0;
+	std::string types = "structured,graded,random";
+	std::string csvLoc;
+
+	for (int i=1; i<argc; i++)
+	{
+		bool hasValue = i+1 < argc;
+		if (strcmp(argv[i], "--types") == 0 && hasValue)
+			types = argv[++i];
+		else if (strcmp(argv[i], "--benchmarks") == 0 && hasValue)
+			options.benchmarks = argv[++i];
+		else if (strcmp(argv[i], "--min-nodes") == 0 && hasValue)
+			options.minNodes = strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--max-nodes") == 0 && hasValue)
+			options.maxNodes = strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--repeats") == 0 && hasValue)
+			options.repeats = strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--queries") == 0 && hasValue)
+			options.queries = strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--bin-size") == 0 && hasValue)
+			options.binSize = strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--timesteps") == 0 && hasValue)
+			options.timesteps = strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.seed = strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--temp") == 0 && hasValue)
+			options.tempDir = argv[++i];
+		else if (strcmp(argv[i], "--csv") == 0 && hasValue)
+			csvLoc = argv[++i];
+		else {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (options.seed == 0 || options.queries == 0 || options.binSize == 0)
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	if (!csvLoc.empty())
+	{
+		options.csv = fopen(csvLoc.data(), "w");
+		if (options.csv == 0)
+		{
+			fprintf(stderr, "Unable to create %s\n", csvLoc.data());
+			return 1;
+		}
+		fprintf(options.csv, "type,nodes,elements,benchmark,median_ms,min_ms,throughput,unit\n");
+	}
+
+	const MeshGenerator::MeshType AllTypes[3] = {MeshGenerator::StructuredMesh, MeshGenerator::GradedMesh, MeshGenerator::RandomMesh};
+	const unsigned int Sizes[5] = {10000, 100000, 1000000, 5000000, 20000000};
+
+	printf("%-10s %10s %10s  %-16s %15s %14s\n", "type", "nodes", "elements", "benchmark", "median", "throughput");
+	for (unsigned int t=0; t<3; t++)
+	{
+		if (!IsSelected(types, MeshGenerator::GetTypeName(AllTypes[t])))
+			continue;
+		for (unsigned int s=0; s<5; s++)
+			if (Sizes[s] >= options.minNodes && Sizes[s] <= options.maxNodes)
+				RunSizeBenchmarks(&options, AllTypes[t], Sizes[s]);
+	}
+
+	if (IsSelected(options.benchmarks, "crossover"))
+		for (unsigned int t=0; t<3; t++)
+			if (IsSelected(types, MeshGenerator::GetTypeName(AllTypes[t])))
+				RunCrossoverBenchmark(&options, AllTypes[t]);
+
+	if (options.csv)
+		fclose(options.csv);
+	return 0;
+}
@@ -8,7 +8,7 @@
  * Defines a generic 4x4 matrix
  */
 typedef struct {
-		float m[16]; /**< The matrix in row-major order */
+		float m[16]; /**< The matrix in column-major order, as expected by glUniformMatrix4fv() without transposing */
 } Matrix;
 
 
@@ -58,6 +58,8 @@ struct UniformColors {
 			Color4[0] = -1.0; Color4[1] = -1.0; Color4[2] = -1.0; Color4[3] = -1.0;
 			Color5[0] = -1.0; Color5[1] = -1.0; Color5[2] = -1.0; Color5[3] = -1.0;
 			Color6[0] = -1.0; Color6[1] = -1.0; Color6[2] = -1.0; Color6[3] = -1.0;
+			Color7[0] = -1.0; Color7[1] = -1.0; Color7[2] = -1.0; Color7[3] = -1.0;
+			Color8[0] = -1.0; Color8[1] = -1.0; Color8[2] = -1.0; Color8[3] = -1.0;
 		}
 };
 
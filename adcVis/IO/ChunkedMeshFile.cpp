@@ -0,0 +1,524 @@
+#include "ChunkedMeshFile.h"
+#include "../Layers/MeshDecimator.h"
+#include "TraceWriter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+#include <math.h>
+
+
+// Identifies a chunked mesh file
+static const char FileMagic[8] = {'A', 'D', 'C', 'M', 'E', 'S', 'H', '1'};
+
+// The version of the file layout
+static const unsigned int FileVersion = 1;
+
+// The overview mesh has roughly this many times fewer Nodes than the full mesh
+static const unsigned int OverviewReduction = 64;
+
+
+/**
+ * @brief The header at the start of every chunked mesh file
+ */
+struct ChunkedMeshHeader {
+		char		magic[8];		/**< Always FileMagic */
+		unsigned int	version;		/**< The version of the file layout */
+		unsigned int	numNodes;		/**< The number of Nodes in the full mesh */
+		unsigned int	numElements;		/**< The number of Elements in the full mesh */
+		unsigned int	numChunks;		/**< The number of chunks */
+		unsigned int	numOverviewVertices;	/**< The number of Nodes in the overview mesh */
+		unsigned int	numOverviewElements;	/**< The number of Elements in the overview mesh */
+		float		bounds[6];		/**< The bounding box [minX, maxX, minY, maxY, minZ, maxZ] */
+};
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+ChunkedMeshFile::ChunkedMeshFile()
+{
+	fileOpen = false;
+	numNodes = 0;
+	numElements = 0;
+	for (int i=0; i<6; i++)
+		bounds[i] = 0.0;
+}
+
+
+/**
+ * @brief Writes a mesh to a chunked mesh file
+ *
+ * Elements are sorted into a uniform grid of square cells by their centroids. The grid
+ * has roughly one cell for every elementsPerChunk Elements, and every cell that contains
+ * at least one Element becomes a chunk. Invalid Elements (Node numbers out of range) are
+ * skipped.
+ *
+ * The overview mesh is built with MeshDecimator::ClusterVertices(), and each overview
+ * Element is assigned to the chunk its centroid falls in (or the nearest chunk if that
+ * cell is empty).
+ *
+ * @param fileLoc The location of the file to write
+ * @param nodes A pointer to the node list
+ * @param elements A pointer to the element list
+ * @param elementsPerChunk The approximate number of Elements in each chunk
+ * @return 0 if the file was written successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedMeshFile::Write(std::string fileLoc, std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int elementsPerChunk)
+{
+	if (nodes == 0 || elements == 0 || nodes->size() == 0 || elementsPerChunk == 0)
+		return 1;
+
+	TRACE_SCOPE("io", "ChunkedMeshFile::Write");
+
+	const unsigned int nn = nodes->size();
+
+	// Keep the valid elements
+	std::vector<GLuint> triangles;
+	triangles.reserve(3*elements->size());
+	for (unsigned int i=0; i<elements->size(); i++)
+	{
+		Element *currElement = &(*elements)[i];
+		if (currElement->n1 == 0 || currElement->n2 == 0 || currElement->n3 == 0 ||
+		    currElement->n1 > nn || currElement->n2 > nn || currElement->n3 > nn)
+			continue;
+		triangles.push_back(currElement->n1-1);
+		triangles.push_back(currElement->n2-1);
+		triangles.push_back(currElement->n3-1);
+	}
+	const unsigned int ne = triangles.size()/3;
+	if (ne == 0)
+		return 1;
+
+	// Find the bounding box
+	ChunkedMeshHeader header;
+	memcpy(header.magic, FileMagic, 8);
+	header.version = FileVersion;
+	header.numNodes = nn;
+	header.numElements = ne;
+	header.bounds[0] = header.bounds[1] = (*nodes)[0].x;
+	header.bounds[2] = header.bounds[3] = (*nodes)[0].y;
+	header.bounds[4] = header.bounds[5] = (*nodes)[0].z;
+	for (unsigned int i=1; i<nn; i++)
+	{
+		header.bounds[0] = std::min(header.bounds[0], (*nodes)[i].x);
+		header.bounds[1] = std::max(header.bounds[1], (*nodes)[i].x);
+		header.bounds[2] = std::min(header.bounds[2], (*nodes)[i].y);
+		header.bounds[3] = std::max(header.bounds[3], (*nodes)[i].y);
+		header.bounds[4] = std::min(header.bounds[4], (*nodes)[i].z);
+		header.bounds[5] = std::max(header.bounds[5], (*nodes)[i].z);
+	}
+
+	// Size the grid so that it has roughly one square cell per chunk
+	float width = std::max(header.bounds[1] - header.bounds[0], 1e-12f);
+	float height = std::max(header.bounds[3] - header.bounds[2], 1e-12f);
+	float numCells = std::max(1.0f, (float)ne/elementsPerChunk);
+	float cellSize = sqrt(width*height/numCells);
+	unsigned int cellsX = std::max(1u, (unsigned int)ceil(width/cellSize));
+	unsigned int cellsY = std::max(1u, (unsigned int)ceil(height/cellSize));
+
+	// Finds the cell that holds the centroid of a triangle
+	struct CellFinder {
+			std::vector<Node>	*nodes;
+			float			minX, minY, cellSize;
+			unsigned int		cellsX, cellsY;
+			unsigned int operator()(const GLuint *t) const
+			{
+				float x = ((*nodes)[t[0]].x + (*nodes)[t[1]].x + (*nodes)[t[2]].x)/3.0;
+				float y = ((*nodes)[t[0]].y + (*nodes)[t[1]].y + (*nodes)[t[2]].y)/3.0;
+				unsigned int cx = std::min(cellsX-1, (unsigned int)std::max(0.0f, (x - minX)/cellSize));
+				unsigned int cy = std::min(cellsY-1, (unsigned int)std::max(0.0f, (y - minY)/cellSize));
+				return cy*cellsX + cx;
+			}
+	};
+	CellFinder findCell = {nodes, header.bounds[0], header.bounds[2], cellSize, cellsX, cellsY};
+
+	// Sort the elements by cell
+	std::vector<unsigned int> cellStart (cellsX*cellsY+1, 0);
+	std::vector<unsigned int> elementCell (ne);
+	for (unsigned int i=0; i<ne; i++)
+	{
+		elementCell[i] = findCell(&triangles[3*i]);
+		cellStart[elementCell[i]+1]++;
+	}
+	for (unsigned int c=0; c<cellsX*cellsY; c++)
+		cellStart[c+1] += cellStart[c];
+	std::vector<unsigned int> sortedElements (ne);
+	std::vector<unsigned int> cellFill (cellStart.begin(), cellStart.end()-1);
+	for (unsigned int i=0; i<ne; i++)
+		sortedElements[cellFill[elementCell[i]]++] = i;
+	std::vector<unsigned int>().swap(elementCell);
+
+	// Every non-empty cell becomes a chunk
+	const unsigned int NoChunk = 0xFFFFFFFF;
+	std::vector<unsigned int> cellChunk (cellsX*cellsY, NoChunk);
+	std::vector<unsigned int> chunkCell;
+	for (unsigned int c=0; c<cellsX*cellsY; c++)
+	{
+		if (cellStart[c+1] > cellStart[c])
+		{
+			cellChunk[c] = chunkCell.size();
+			chunkCell.push_back(c);
+		}
+	}
+	const unsigned int numChunks = chunkCell.size();
+	header.numChunks = numChunks;
+
+	// Build the overview mesh and group its elements by chunk
+	std::vector<GLuint> overview;
+	MeshDecimator::ClusterVertices(nodes, elements, std::max(1u, nn/OverviewReduction), &overview);
+	const unsigned int numOverview = overview.size()/3;
+	std::vector<unsigned int> overviewChunk (numOverview);
+	std::vector<unsigned int> chunkCoarseCount (numChunks+1, 0);
+	for (unsigned int i=0; i<numOverview; i++)
+	{
+		unsigned int cell = findCell(&overview[3*i]);
+		unsigned int chunk = cellChunk[cell];
+		if (chunk == NoChunk)
+		{
+			// Use the nearest chunk instead
+			int cx = cell%cellsX, cy = cell/cellsX;
+			int bestDistance = -1;
+			for (unsigned int k=0; k<numChunks; k++)
+			{
+				int dx = (int)(chunkCell[k]%cellsX) - cx;
+				int dy = (int)(chunkCell[k]/cellsX) - cy;
+				int distance = dx*dx + dy*dy;
+				if (bestDistance < 0 || distance < bestDistance)
+				{
+					bestDistance = distance;
+					chunk = k;
+				}
+			}
+		}
+		overviewChunk[i] = chunk;
+		chunkCoarseCount[chunk+1]++;
+	}
+	for (unsigned int k=0; k<numChunks; k++)
+		chunkCoarseCount[k+1] += chunkCoarseCount[k];
+
+	// Compact the overview nodes
+	const GLuint NoVertex = 0xFFFFFFFF;
+	std::vector<GLuint> remap (nn, NoVertex);
+	std::vector<GLfloat> overviewVertices;
+	std::vector<GLuint> overviewIndices (overview.size());
+	std::vector<unsigned int> coarseFill (chunkCoarseCount.begin(), chunkCoarseCount.end()-1);
+	for (unsigned int i=0; i<numOverview; i++)
+	{
+		unsigned int slot = coarseFill[overviewChunk[i]]++;
+		for (int j=0; j<3; j++)
+		{
+			GLuint node = overview[3*i+j];
+			if (remap[node] == NoVertex)
+			{
+				remap[node] = overviewVertices.size()/4;
+				overviewVertices.push_back((*nodes)[node].x);
+				overviewVertices.push_back((*nodes)[node].y);
+				overviewVertices.push_back((*nodes)[node].z);
+				overviewVertices.push_back(1.0);
+			}
+			overviewIndices[3*slot+j] = remap[node];
+		}
+	}
+	header.numOverviewVertices = overviewVertices.size()/4;
+	header.numOverviewElements = numOverview;
+
+	// Build the chunk table
+	std::vector<MeshChunkInfo> chunks (numChunks);
+	std::vector<GLuint> stamp (nn, NoVertex);
+	unsigned long long offset = sizeof(ChunkedMeshHeader) + numChunks*sizeof(MeshChunkInfo) +
+				    overviewVertices.size()*sizeof(GLfloat) + overviewIndices.size()*sizeof(GLuint);
+	for (unsigned int k=0; k<numChunks; k++)
+	{
+		MeshChunkInfo *info = &chunks[k];
+		unsigned int cell = chunkCell[k];
+		info->numVertices = 0;
+		info->numElements = cellStart[cell+1] - cellStart[cell];
+		for (unsigned int e=cellStart[cell]; e<cellStart[cell+1]; e++)
+		{
+			for (int j=0; j<3; j++)
+			{
+				GLuint node = triangles[3*sortedElements[e]+j];
+				if (stamp[node] != k)
+				{
+					stamp[node] = k;
+					const Node *currNode = &(*nodes)[node];
+					if (info->numVertices == 0)
+					{
+						info->minX = info->maxX = currNode->x;
+						info->minY = info->maxY = currNode->y;
+						info->minZ = info->maxZ = currNode->z;
+					}
+					info->minX = std::min(info->minX, currNode->x);
+					info->maxX = std::max(info->maxX, currNode->x);
+					info->minY = std::min(info->minY, currNode->y);
+					info->maxY = std::max(info->maxY, currNode->y);
+					info->minZ = std::min(info->minZ, currNode->z);
+					info->maxZ = std::max(info->maxZ, currNode->z);
+					info->numVertices++;
+				}
+			}
+		}
+		info->firstCoarseElement = chunkCoarseCount[k];
+		info->numCoarseElements = chunkCoarseCount[k+1] - chunkCoarseCount[k];
+		info->offset = offset;
+		info->size = info->numVertices*(4*sizeof(GLfloat) + sizeof(GLuint)) + info->numElements*3*sizeof(GLuint);
+		offset += info->size;
+	}
+
+	// Write everything to the file
+	std::ofstream file (fileLoc.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		DEBUG("Unable to open chunked mesh file %s for writing\n", fileLoc.data());
+		return 1;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&chunks[0], numChunks*sizeof(MeshChunkInfo));
+	if (overviewVertices.size() > 0)
+	{
+		file.write((const char*)&overviewVertices[0], overviewVertices.size()*sizeof(GLfloat));
+		file.write((const char*)&overviewIndices[0], overviewIndices.size()*sizeof(GLuint));
+	}
+
+	MeshChunkData data;
+	std::vector<GLuint> local (nn, NoVertex);
+	for (unsigned int k=0; k<numChunks; k++)
+	{
+		unsigned int cell = chunkCell[k];
+		data.vertices.clear();
+		data.nodeIndices.clear();
+		data.indices.clear();
+		for (unsigned int e=cellStart[cell]; e<cellStart[cell+1]; e++)
+		{
+			for (int j=0; j<3; j++)
+			{
+				GLuint node = triangles[3*sortedElements[e]+j];
+				if (local[node] == NoVertex)
+				{
+					local[node] = data.nodeIndices.size();
+					data.nodeIndices.push_back(node);
+					data.vertices.push_back((*nodes)[node].x);
+					data.vertices.push_back((*nodes)[node].y);
+					data.vertices.push_back((*nodes)[node].z);
+					data.vertices.push_back(1.0);
+				}
+				data.indices.push_back(local[node]);
+			}
+		}
+		for (unsigned int i=0; i<data.nodeIndices.size(); i++)
+			local[data.nodeIndices[i]] = NoVertex;
+
+		file.write((const char*)&data.vertices[0], data.vertices.size()*sizeof(GLfloat));
+		file.write((const char*)&data.nodeIndices[0], data.nodeIndices.size()*sizeof(GLuint));
+		file.write((const char*)&data.indices[0], data.indices.size()*sizeof(GLuint));
+	}
+
+	bool success = file.good();
+	file.close();
+	if (!success)
+	{
+		DEBUG("Error writing chunked mesh file %s\n", fileLoc.data());
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Reads the header, chunk table and overview mesh of a chunked mesh file
+ *
+ * None of the chunks' data is read.
+ *
+ * @param fileLoc The location of the chunked mesh file
+ * @return 0 if the file was opened successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedMeshFile::Open(std::string fileLoc)
+{
+	TRACE_SCOPE("io", "ChunkedMeshFile::Open");
+	fileOpen = false;
+
+	std::ifstream file (fileLoc.data(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 1;
+
+	ChunkedMeshHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file.good() || memcmp(header.magic, FileMagic, 8) != 0 || header.version != FileVersion)
+	{
+		DEBUG("%s is not a chunked mesh file\n", fileLoc.data());
+		return 1;
+	}
+
+	chunks.resize(header.numChunks);
+	overviewVertices.resize(4*header.numOverviewVertices);
+	overviewIndices.resize(3*header.numOverviewElements);
+	if (header.numChunks > 0)
+		file.read((char*)&chunks[0], header.numChunks*sizeof(MeshChunkInfo));
+	if (header.numOverviewVertices > 0)
+		file.read((char*)&overviewVertices[0], overviewVertices.size()*sizeof(GLfloat));
+	if (header.numOverviewElements > 0)
+		file.read((char*)&overviewIndices[0], overviewIndices.size()*sizeof(GLuint));
+	if (!file.good())
+	{
+		DEBUG("Error reading chunked mesh file %s\n", fileLoc.data());
+		return 1;
+	}
+
+	fileLocation = fileLoc;
+	numNodes = header.numNodes;
+	numElements = header.numElements;
+	for (int i=0; i<6; i++)
+		bounds[i] = header.bounds[i];
+	fileOpen = true;
+	return 0;
+}
+
+
+/**
+ * @brief Reads the data of one chunk
+ *
+ * The file is opened separately for every call, so this function may be called from
+ * several threads at the same time.
+ *
+ * @param chunk The index of the chunk
+ * @param data A pointer to the MeshChunkData that will hold the chunk's data
+ * @return 0 if the chunk was read successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedMeshFile::ReadChunk(unsigned int chunk, MeshChunkData *data)
+{
+	if (!fileOpen || chunk >= chunks.size() || data == 0)
+		return 1;
+
+	TRACE_SCOPE("io", "ReadChunk");
+
+	std::ifstream file (fileLocation.data(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 1;
+
+	MeshChunkInfo *info = &chunks[chunk];
+	data->vertices.resize(4*info->numVertices);
+	data->nodeIndices.resize(info->numVertices);
+	data->indices.resize(3*info->numElements);
+
+	file.seekg(info->offset);
+	if (info->numVertices > 0)
+	{
+		file.read((char*)&data->vertices[0], data->vertices.size()*sizeof(GLfloat));
+		file.read((char*)&data->nodeIndices[0], data->nodeIndices.size()*sizeof(GLuint));
+	}
+	if (info->numElements > 0)
+		file.read((char*)&data->indices[0], data->indices.size()*sizeof(GLuint));
+
+	if (!file.good())
+	{
+		DEBUG("Error reading chunk %i of %s\n", chunk, fileLocation.data());
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Returns true if a file has been opened successfully
+ * @return true if a file is open
+ */
+bool ChunkedMeshFile::IsOpen()
+{
+	return fileOpen;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in the full mesh
+ * @return The number of Nodes
+ */
+unsigned int ChunkedMeshFile::GetNumNodes()
+{
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of Elements in the full mesh
+ * @return The number of Elements
+ */
+unsigned int ChunkedMeshFile::GetNumElements()
+{
+	return numElements;
+}
+
+
+/**
+ * @brief Returns the number of chunks
+ * @return The number of chunks
+ */
+unsigned int ChunkedMeshFile::GetNumChunks()
+{
+	return chunks.size();
+}
+
+
+/**
+ * @brief Returns the description of a chunk
+ * @param chunk The index of the chunk
+ * @return A pointer to the chunk's MeshChunkInfo
+ * @return 0 if the chunk does not exist
+ */
+MeshChunkInfo* ChunkedMeshFile::GetChunkInfo(unsigned int chunk)
+{
+	if (chunk >= chunks.size())
+		return 0;
+	return &chunks[chunk];
+}
+
+
+/**
+ * @brief Returns the overview Nodes
+ * @return A pointer to the overview Nodes [x1, y1, z1, 1.0, ...]
+ */
+std::vector<GLfloat>* ChunkedMeshFile::GetOverviewVertices()
+{
+	return &overviewVertices;
+}
+
+
+/**
+ * @brief Returns the overview Elements
+ *
+ * The Elements covering each chunk are stored together, starting at
+ * MeshChunkInfo::firstCoarseElement.
+ *
+ * @return A pointer to the overview Elements [e1n1, e1n2, e1n3, ...]
+ */
+std::vector<GLuint>* ChunkedMeshFile::GetOverviewIndices()
+{
+	return &overviewIndices;
+}
+
+
+/**
+ * @brief Returns the bounding box of the mesh
+ *
+ * If any of the values are not needed, pass in 0 for the unneeded value.
+ *
+ * @param minX A pointer to the variable that will hold the minimum x-value
+ * @param maxX A pointer to the variable that will hold the maximum x-value
+ * @param minY A pointer to the variable that will hold the minimum y-value
+ * @param maxY A pointer to the variable that will hold the maximum y-value
+ * @param minZ A pointer to the variable that will hold the minimum z-value
+ * @param maxZ A pointer to the variable that will hold the maximum z-value
+ */
+void ChunkedMeshFile::GetBounds(float *minX, float *maxX, float *minY, float *maxY, float *minZ, float *maxZ)
+{
+	if (minX) *minX = bounds[0];
+	if (maxX) *maxX = bounds[1];
+	if (minY) *minY = bounds[2];
+	if (maxY) *maxY = bounds[3];
+	if (minZ) *minZ = bounds[4];
+	if (maxZ) *maxZ = bounds[5];
+}
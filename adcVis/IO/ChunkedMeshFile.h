@@ -0,0 +1,98 @@
+#ifndef CHUNKEDMESHFILE_H
+#define CHUNKEDMESHFILE_H
+
+#include "adcData.h"
+#include "../GLData.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Describes one spatial chunk of a ChunkedMeshFile
+ *
+ * Written to and read from the file as is.
+ */
+struct MeshChunkInfo {
+		float			minX;			/**< The minimum x-coordinate of the chunk's Nodes */
+		float			maxX;			/**< The maximum x-coordinate of the chunk's Nodes */
+		float			minY;			/**< The minimum y-coordinate of the chunk's Nodes */
+		float			maxY;			/**< The maximum y-coordinate of the chunk's Nodes */
+		float			minZ;			/**< The minimum z-coordinate of the chunk's Nodes */
+		float			maxZ;			/**< The maximum z-coordinate of the chunk's Nodes */
+		unsigned int		numVertices;		/**< The number of Nodes used by the chunk's Elements */
+		unsigned int		numElements;		/**< The number of Elements in the chunk */
+		unsigned int		firstCoarseElement;	/**< The first overview Element that covers the chunk */
+		unsigned int		numCoarseElements;	/**< The number of overview Elements that cover the chunk */
+		unsigned long long	offset;			/**< The position of the chunk's data in the file in bytes */
+		unsigned long long	size;			/**< The size of the chunk's data in the file in bytes */
+};
+
+
+/**
+ * @brief The data of one chunk, ready to be loaded to the OpenGL context
+ */
+struct MeshChunkData {
+		std::vector<GLfloat>	vertices;	/**< The chunk's Nodes, densely packed [x1, y1, z1, 1.0, ...] */
+		std::vector<GLuint>	nodeIndices;	/**< The index of each of the chunk's Nodes in the full mesh (node number - 1) */
+		std::vector<GLuint>	indices;	/**< The chunk's Elements as indices into vertices [e1n1, e1n2, e1n3, ...] */
+};
+
+
+/**
+ * @brief Reads and writes meshes that are split into spatial chunks
+ *
+ * A chunked mesh file holds a mesh whose Elements are sorted into a uniform grid of chunks
+ * by their centroids. Each chunk is stored with its own copy of the Nodes it uses, so a
+ * single chunk can be read and drawn without reading the rest of the mesh. The file also
+ * holds a small overview mesh (see MeshDecimator::ClusterVertices()) whose Elements are
+ * grouped by chunk, so that a coarse version of any chunk can be drawn while its full
+ * resolution data is not loaded.
+ *
+ * The file layout is (all values in native byte order):
+ * - Header: "ADCMESH1", version, number of Nodes, number of Elements, number of chunks,
+ * number of overview Nodes, number of overview Elements, bounding box
+ * - One MeshChunkInfo for every chunk
+ * - The overview Nodes [x1, y1, z1, 1.0, ...] and overview Elements [e1n1, e1n2, e1n3, ...]
+ * - For every chunk: its Nodes [x1, y1, z1, 1.0, ...], their indices in the full mesh, and
+ * its Elements
+ * .
+ *
+ * Use Write() to convert a mesh (eg. read with FileReader::ReadFort14()) into a chunked file.
+ * Once a file has been opened with Open(), ReadChunk() can be called from any number of
+ * threads at the same time.
+ *
+ */
+class ChunkedMeshFile
+{
+	public:
+
+		ChunkedMeshFile();
+
+		static int	Write(std::string fileLoc, std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int elementsPerChunk);
+
+		int		Open(std::string fileLoc);
+		int		ReadChunk(unsigned int chunk, MeshChunkData *data);
+
+		// Getter Methods
+		bool		IsOpen();
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumElements();
+		unsigned int	GetNumChunks();
+		MeshChunkInfo*	GetChunkInfo(unsigned int chunk);
+		std::vector<GLfloat>*	GetOverviewVertices();
+		std::vector<GLuint>*	GetOverviewIndices();
+		void		GetBounds(float *minX, float *maxX, float *minY, float *maxY, float *minZ, float *maxZ);
+
+	protected:
+
+		std::string			fileLocation;		/**< The location of the open file */
+		bool				fileOpen;		/**< Flag that shows if the header has been read successfully */
+		unsigned int			numNodes;		/**< The number of Nodes in the full mesh */
+		unsigned int			numElements;		/**< The number of Elements in the full mesh */
+		float				bounds[6];		/**< The bounding box of the mesh [minX, maxX, minY, maxY, minZ, maxZ] */
+		std::vector<MeshChunkInfo>	chunks;			/**< The table of chunks */
+		std::vector<GLfloat>		overviewVertices;	/**< The overview Nodes [x1, y1, z1, 1.0, ...] */
+		std::vector<GLuint>		overviewIndices;	/**< The overview Elements, grouped by chunk */
+};
+
+#endif // CHUNKEDMESHFILE_H
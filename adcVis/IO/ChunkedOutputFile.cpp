@@ -0,0 +1,602 @@
+#include "ChunkedOutputFile.h"
+#include "TraceWriter.h"
+#include "../Threading/ParallelFor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+
+// The first bytes of every chunked output file
+static const char FileMagic[8] = {'A', 'D', 'C', 'O', 'U', 'T', 'C', '1'};
+
+// The version of the file layout
+static const unsigned int FileVersion = 1;
+
+
+/**
+ * @brief The first bytes of a chunked output file, written to and read from the file as is
+ */
+struct ChunkedOutputHeader {
+		char		magic[8];		/**< Always FileMagic, written last */
+		unsigned int	version;		/**< The version of the file layout */
+		unsigned int	numNodes;		/**< The number of Nodes */
+		unsigned int	numTimesteps;		/**< The number of timesteps */
+		unsigned int	numValues;		/**< The number of values per Node */
+		unsigned int	nodesPerBlock;		/**< The number of Nodes in each block */
+		unsigned int	timestepsPerChunk;	/**< The number of timesteps in each chunk */
+};
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+ChunkedOutputFile::ChunkedOutputFile()
+{
+	fileOpen = false;
+	numNodes = 0;
+	numTimesteps = 0;
+	numValues = 0;
+	nodesPerBlock = 0;
+	timestepsPerChunk = 0;
+	decodedGroup = -1;
+}
+
+
+/**
+ * @brief Converts an output file into a chunked output file
+ *
+ * The output file is read one group of timesteps at a time. The timesteps of a group are
+ * read in parallel, then every chunk of the group is encoded and compressed in parallel,
+ * and the chunks are written in order. Only one group is held in memory at a time. The
+ * header is written last, so a file from a conversion that failed is never opened.
+ *
+ * @param outputFile A pointer to an open GlobalOutputFile
+ * @param fileLoc The location of the file to write
+ * @param nodesPerBlock The number of Nodes in each chunk (eg. 16384)
+ * @param timestepsPerChunk The number of timesteps in each chunk (eg. 8)
+ * @return 0 if the file was written successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedOutputFile::Write(GlobalOutputFile *outputFile, std::string fileLoc, unsigned int nodesPerBlock, unsigned int timestepsPerChunk)
+{
+	if (outputFile == 0 || !outputFile->IsOpen() || outputFile->GetNumNodes() == 0 || outputFile->GetNumTimesteps() == 0)
+		return 1;
+
+	TRACE_SCOPE("io", "Write chunked output file");
+	const unsigned int NumNodes = outputFile->GetNumNodes();
+	const unsigned int NumTimesteps = outputFile->GetNumTimesteps();
+	const unsigned int NumValues = outputFile->GetNumValues() > 1 ? 2 : 1;
+	const unsigned int BlockSize = nodesPerBlock < 1 ? 1 : nodesPerBlock > NumNodes ? NumNodes : nodesPerBlock;
+	const unsigned int GroupSize = timestepsPerChunk < 1 ? 1 : timestepsPerChunk > NumTimesteps ? NumTimesteps : timestepsPerChunk;
+	const unsigned int NumBlocks = (NumNodes + BlockSize - 1)/BlockSize;
+	const unsigned int NumGroups = (NumTimesteps + GroupSize - 1)/GroupSize;
+
+	ChunkedOutputHeader header;
+	memset(&header, 0, sizeof(header));
+	header.version = FileVersion;
+	header.numNodes = NumNodes;
+	header.numTimesteps = NumTimesteps;
+	header.numValues = NumValues;
+	header.nodesPerBlock = BlockSize;
+	header.timestepsPerChunk = GroupSize;
+
+	std::vector<double> modelTimes (NumTimesteps);
+	for (unsigned int t=0; t<NumTimesteps; t++)
+		modelTimes[t] = outputFile->GetTimestepInfo(t)->time;
+	std::vector<OutputChunkInfo> chunkTable ((size_t)NumGroups*NumValues*NumBlocks);
+	memset(&chunkTable[0], 0, chunkTable.size()*sizeof(OutputChunkInfo));
+
+	std::ofstream file (fileLoc.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		DEBUG("Unable to open chunked output file %s for writing\n", fileLoc.data());
+		return 1;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&modelTimes[0], NumTimesteps*sizeof(double));
+	file.write((const char*)&chunkTable[0], chunkTable.size()*sizeof(OutputChunkInfo));
+	unsigned long long offset = sizeof(header) + NumTimesteps*sizeof(double) + chunkTable.size()*sizeof(OutputChunkInfo);
+
+	// [value][timestep][node]
+	std::vector<float> groupValues ((size_t)NumValues*GroupSize*NumNodes);
+	std::vector< std::vector<unsigned char> > compressed (NumValues*NumBlocks);
+	std::vector<int> results (GroupSize > NumValues*NumBlocks ? GroupSize : NumValues*NumBlocks);
+	int result = 0;
+	for (unsigned int group=0; group<NumGroups && result == 0; group++)
+	{
+		const unsigned int FirstTimestep = group*GroupSize;
+		const unsigned int Rows = FirstTimestep + GroupSize <= NumTimesteps ? GroupSize : NumTimesteps - FirstTimestep;
+
+		// Read the timesteps of the group
+		ParallelFor(Rows, 1, [&](size_t first, size_t last)
+		{
+			for (size_t r=first; r<last; r++)
+			{
+				float *u = &groupValues[r*NumNodes];
+				if (NumValues > 1)
+					results[r] = outputFile->ReadTimestep(FirstTimestep+r, u, u + (size_t)GroupSize*NumNodes, 0);
+				else
+					results[r] = outputFile->ReadTimestep(FirstTimestep+r, u);
+			}
+		});
+		for (unsigned int r=0; r<Rows; r++)
+			result |= results[r];
+		if (result != 0)
+			break;
+
+		// Encode and compress every chunk of the group
+		ParallelFor(NumValues*NumBlocks, 1, [&](size_t first, size_t last)
+		{
+			std::vector<unsigned char> encoded;
+			for (size_t k=first; k<last; k++)
+			{
+				const unsigned int Value = k/NumBlocks;
+				const unsigned int FirstNode = (k%NumBlocks)*BlockSize;
+				const unsigned int BlockNodes = FirstNode + BlockSize <= NumNodes ? BlockSize : NumNodes - FirstNode;
+				EncodeChunk(&groupValues[(size_t)Value*GroupSize*NumNodes + FirstNode], BlockNodes, Rows, NumNodes, &encoded);
+
+				uLongf compressedSize = compressBound(encoded.size());
+				compressed[k].resize(compressedSize);
+				results[k] = compress2(&compressed[k][0], &compressedSize, &encoded[0], encoded.size(), Z_BEST_SPEED) == Z_OK ? 0 : 1;
+				if (compressedSize < encoded.size())
+					compressed[k].resize(compressedSize);
+				else
+					compressed[k].swap(encoded);
+			}
+		});
+
+		for (unsigned int k=0; k<NumValues*NumBlocks; k++)
+		{
+			const unsigned int FirstNode = (k%NumBlocks)*BlockSize;
+			const unsigned int BlockNodes = FirstNode + BlockSize <= NumNodes ? BlockSize : NumNodes - FirstNode;
+			OutputChunkInfo *chunk = &chunkTable[(size_t)group*NumValues*NumBlocks + k];
+			chunk->offset = offset;
+			chunk->size = compressed[k].size();
+			chunk->rawSize = BlockNodes*Rows*sizeof(float);
+			file.write((const char*)&compressed[k][0], compressed[k].size());
+			offset += chunk->size;
+			result |= results[k];
+		}
+		if (!file.good())
+			result = 1;
+	}
+
+	if (result == 0)
+	{
+		memcpy(header.magic, FileMagic, 8);
+		file.seekp(sizeof(header) + NumTimesteps*sizeof(double));
+		file.write((const char*)&chunkTable[0], chunkTable.size()*sizeof(OutputChunkInfo));
+		file.seekp(0);
+		file.write((const char*)&header, sizeof(header));
+		result = file.good() ? 0 : 1;
+	}
+	file.close();
+	if (result != 0)
+	{
+		DEBUG("Error writing chunked output file %s\n", fileLoc.data());
+		remove(fileLoc.data());
+	}
+	return result;
+}
+
+
+/**
+ * @brief Reads the header and the table of chunks of a chunked output file
+ * @param fileLoc The location of the chunked output file
+ * @return 0 if the file was opened successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedOutputFile::Open(std::string fileLoc)
+{
+	fileOpen = false;
+
+	std::ifstream file (fileLoc.data(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 1;
+
+	ChunkedOutputHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file.good() || memcmp(header.magic, FileMagic, 8) != 0 || header.version != FileVersion ||
+	    header.numValues < 1 || header.numValues > 2 || header.nodesPerBlock == 0 || header.timestepsPerChunk == 0)
+	{
+		DEBUG("%s is not a chunked output file\n", fileLoc.data());
+		return 1;
+	}
+
+	numNodes = header.numNodes;
+	numTimesteps = header.numTimesteps;
+	numValues = header.numValues;
+	nodesPerBlock = header.nodesPerBlock;
+	timestepsPerChunk = header.timestepsPerChunk;
+	const unsigned int NumGroups = (numTimesteps + timestepsPerChunk - 1)/timestepsPerChunk;
+	times.resize(numTimesteps);
+	chunks.resize((size_t)NumGroups*numValues*GetNumBlocks());
+	if (numTimesteps > 0)
+		file.read((char*)&times[0], numTimesteps*sizeof(double));
+	if (chunks.size() > 0)
+		file.read((char*)&chunks[0], chunks.size()*sizeof(OutputChunkInfo));
+	if (!file.good())
+	{
+		DEBUG("Error reading chunked output file %s\n", fileLoc.data());
+		return 1;
+	}
+
+	std::lock_guard<std::mutex> lock (groupMutex);
+	decodedGroup = -1;
+	groupValues.clear();
+	fileLocation = fileLoc;
+	fileOpen = true;
+	return 0;
+}
+
+
+/**
+ * @brief Reads the values of one timestep
+ *
+ * Every chunk of the timestep's group is decompressed in parallel, and the group is kept
+ * so that the following timesteps of the group are copied from memory. For files with two
+ * values per Node (eg. fort.64) only the first value is read.
+ *
+ * @param timestep The index of the timestep, starting at 0
+ * @param values A pointer to an array of at least GetNumNodes() floats
+ * @return 0 if the timestep was read successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedOutputFile::ReadTimestep(unsigned int timestep, float *values)
+{
+	if (!fileOpen || timestep >= numTimesteps || values == 0)
+		return 1;
+
+	std::lock_guard<std::mutex> lock (groupMutex);
+	if (DecodeGroup(timestep/timestepsPerChunk) != 0)
+		return 1;
+	memcpy(values, &groupValues[(size_t)(timestep%timestepsPerChunk)*numNodes], numNodes*sizeof(float));
+	return 0;
+}
+
+
+/**
+ * @brief Reads the vectors of one timestep into separate component arrays
+ *
+ * See ReadTimestep(unsigned int, float*).
+ *
+ * @param timestep The index of the timestep, starting at 0
+ * @param u A pointer to an array of at least GetNumNodes() floats for the x-components, or 0
+ * @param v A pointer to an array of at least GetNumNodes() floats for the y-components, or 0
+ * @param magnitude A pointer to an array of at least GetNumNodes() floats for the length of
+ * each vector (see GlobalOutputFile::ComputeMagnitude()), or 0
+ * @return 0 if the timestep was read successfully
+ * @return 1 if an error occurred or the file does not hold vectors
+ */
+int ChunkedOutputFile::ReadTimestep(unsigned int timestep, float *u, float *v, float *magnitude)
+{
+	if (!fileOpen || timestep >= numTimesteps || numValues < 2)
+		return 1;
+
+	std::lock_guard<std::mutex> lock (groupMutex);
+	if (DecodeGroup(timestep/timestepsPerChunk) != 0)
+		return 1;
+	const float *GroupU = &groupValues[(size_t)(timestep%timestepsPerChunk)*numNodes];
+	const float *GroupV = GroupU + (size_t)timestepsPerChunk*numNodes;
+	if (u)
+		memcpy(u, GroupU, numNodes*sizeof(float));
+	if (v)
+		memcpy(v, GroupV, numNodes*sizeof(float));
+	if (magnitude)
+		GlobalOutputFile::ComputeMagnitude(GroupU, GroupV, magnitude, numNodes);
+	return 0;
+}
+
+
+/**
+ * @brief Reads the values of a range of Nodes over a range of timesteps
+ *
+ * Only the chunks that overlap the window are decompressed, in parallel. For files with
+ * two values per Node (eg. fort.64) only the first value is read.
+ *
+ * @param firstNode The node number of the first Node of the window
+ * @param lastNode The node number of the last Node of the window
+ * @param firstTimestep The index of the first timestep of the window
+ * @param lastTimestep The index of the last timestep of the window
+ * @param values A pointer to an array that receives the window one timestep after another,
+ * (lastNode-firstNode+1)*(lastTimestep-firstTimestep+1) floats
+ * @return 0 if the window was read successfully
+ * @return 1 if the window is not in the file or an error occurred
+ */
+int ChunkedOutputFile::ReadWindow(unsigned int firstNode, unsigned int lastNode, unsigned int firstTimestep, unsigned int lastTimestep, float *values)
+{
+	if (!fileOpen || values == 0 || firstNode == 0 || firstNode > lastNode || lastNode > numNodes ||
+	    firstTimestep > lastTimestep || lastTimestep >= numTimesteps)
+		return 1;
+
+	TRACE_SCOPE("io", "Read output window");
+	const unsigned int FirstIndex = firstNode-1;
+	const unsigned int WindowNodes = lastNode - firstNode + 1;
+	const unsigned int FirstBlock = FirstIndex/nodesPerBlock;
+	const unsigned int NumWindowBlocks = (lastNode-1)/nodesPerBlock - FirstBlock + 1;
+	const unsigned int FirstGroup = firstTimestep/timestepsPerChunk;
+	const unsigned int NumWindowGroups = lastTimestep/timestepsPerChunk - FirstGroup + 1;
+
+	std::vector<int> results (NumWindowGroups*NumWindowBlocks, 0);
+	ParallelFor(results.size(), 1, [&](size_t first, size_t last)
+	{
+		std::ifstream file (fileLocation.data(), std::ios::in | std::ios::binary);
+		std::vector<unsigned char> compressed, encoded;
+		std::vector<float> chunkValues;
+		for (size_t k=first; k<last; k++)
+		{
+			const unsigned int Group = FirstGroup + k/NumWindowBlocks;
+			const unsigned int Block = FirstBlock + k%NumWindowBlocks;
+			const unsigned int GroupStart = Group*timestepsPerChunk;
+			const unsigned int Rows = GroupStart + timestepsPerChunk <= numTimesteps ? timestepsPerChunk : numTimesteps - GroupStart;
+			const unsigned int BlockStart = Block*nodesPerBlock;
+			const unsigned int BlockNodes = BlockStart + nodesPerBlock <= numNodes ? nodesPerBlock : numNodes - BlockStart;
+			chunkValues.resize((size_t)Rows*BlockNodes);
+			results[k] = ReadChunk(&file, GetChunk(Group, 0, Block), BlockNodes, Rows, &compressed, &encoded, &chunkValues[0]);
+			if (results[k] != 0)
+				continue;
+
+			// Copy the part of the chunk inside the window
+			const unsigned int NodeStart = BlockStart > FirstIndex ? BlockStart : FirstIndex;
+			const unsigned int NodeEnd = BlockStart + BlockNodes < FirstIndex + WindowNodes ? BlockStart + BlockNodes : FirstIndex + WindowNodes;
+			for (unsigned int t=(GroupStart > firstTimestep ? GroupStart : firstTimestep); t<GroupStart+Rows && t<=lastTimestep; t++)
+				memcpy(values + (size_t)(t-firstTimestep)*WindowNodes + (NodeStart-FirstIndex),
+				       &chunkValues[(size_t)(t-GroupStart)*BlockNodes + (NodeStart-BlockStart)],
+				       (NodeEnd-NodeStart)*sizeof(float));
+		}
+	});
+
+	for (unsigned int k=0; k<results.size(); k++)
+		if (results[k] != 0)
+			return 1;
+	return 0;
+}
+
+
+/**
+ * @brief Returns true if a file has been opened successfully
+ * @return true if a file is open
+ */
+bool ChunkedOutputFile::IsOpen()
+{
+	return fileOpen;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in each timestep
+ * @return The number of Nodes
+ */
+unsigned int ChunkedOutputFile::GetNumNodes()
+{
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of values per Node
+ * @return 1 for scalar output (eg. fort.63), 2 for vector output (eg. fort.64)
+ */
+unsigned int ChunkedOutputFile::GetNumValues()
+{
+	return numValues;
+}
+
+
+/**
+ * @brief Returns the number of timesteps in the file
+ * @return The number of timesteps
+ */
+unsigned int ChunkedOutputFile::GetNumTimesteps()
+{
+	return numTimesteps;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in each chunk
+ * @return The number of Nodes per block
+ */
+unsigned int ChunkedOutputFile::GetNodesPerBlock()
+{
+	return nodesPerBlock;
+}
+
+
+/**
+ * @brief Returns the number of timesteps in each chunk
+ * @return The number of timesteps per group
+ */
+unsigned int ChunkedOutputFile::GetTimestepsPerChunk()
+{
+	return timestepsPerChunk;
+}
+
+
+/**
+ * @brief Returns the model time of a timestep
+ * @param timestep The index of the timestep
+ * @return The model time in seconds, or 0 if the timestep is not in the file
+ */
+double ChunkedOutputFile::GetTime(unsigned int timestep)
+{
+	return timestep < times.size() ? times[timestep] : 0.0;
+}
+
+
+/**
+ * @brief Returns the size of every chunk in the file
+ * @return The size of the compressed values in bytes
+ */
+unsigned long long ChunkedOutputFile::GetCompressedSize()
+{
+	unsigned long long size = 0;
+	for (unsigned int i=0; i<chunks.size(); i++)
+		size += chunks[i].size;
+	return size;
+}
+
+
+/**
+ * @brief Returns the number of blocks of Nodes
+ */
+unsigned int ChunkedOutputFile::GetNumBlocks()
+{
+	return (numNodes + nodesPerBlock - 1)/nodesPerBlock;
+}
+
+
+/**
+ * @brief Returns the entry of the table of chunks for one chunk
+ */
+OutputChunkInfo* ChunkedOutputFile::GetChunk(unsigned int group, unsigned int value, unsigned int block)
+{
+	return &chunks[((size_t)group*numValues + value)*GetNumBlocks() + block];
+}
+
+
+/**
+ * @brief Reads, decompresses and decodes one chunk
+ * @param file The open file to read from
+ * @param chunk The chunk to read
+ * @param rowLength The number of Nodes in the chunk
+ * @param numRows The number of timesteps in the chunk
+ * @param compressed A buffer for the chunk's data as stored in the file
+ * @param encoded A buffer for the chunk's decompressed data
+ * @param values The array that receives the chunk's values [timestep][node]
+ * @return 0 if the chunk was read successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedOutputFile::ReadChunk(std::ifstream *file, OutputChunkInfo *chunk, unsigned int rowLength, unsigned int numRows,
+				 std::vector<unsigned char> *compressed, std::vector<unsigned char> *encoded, float *values)
+{
+	if (!file->is_open() || chunk->rawSize != rowLength*numRows*sizeof(float) || chunk->size == 0)
+		return 1;
+
+	compressed->resize(chunk->size);
+	file->seekg(chunk->offset);
+	file->read((char*)&(*compressed)[0], chunk->size);
+	if (!file->good())
+		return 1;
+
+	// Chunks that did not get smaller were stored as they are
+	if (chunk->size == chunk->rawSize)
+	{
+		DecodeChunk(&(*compressed)[0], rowLength, numRows, values);
+		return 0;
+	}
+
+	encoded->resize(chunk->rawSize);
+	uLongf rawSize = chunk->rawSize;
+	if (uncompress(&(*encoded)[0], &rawSize, &(*compressed)[0], chunk->size) != Z_OK || rawSize != chunk->rawSize)
+		return 1;
+	DecodeChunk(&(*encoded)[0], rowLength, numRows, values);
+	return 0;
+}
+
+
+/**
+ * @brief Decompresses every chunk of a group of timesteps in parallel, the group mutex
+ * must be held
+ * @param group The index of the group
+ * @return 0 if the group was decoded successfully, or already had been
+ * @return 1 if an error occurred
+ */
+int ChunkedOutputFile::DecodeGroup(unsigned int group)
+{
+	if ((int)group == decodedGroup)
+		return 0;
+
+	TRACE_SCOPE("io", "Decode output group");
+	const unsigned int NumBlocks = GetNumBlocks();
+	const unsigned int GroupStart = group*timestepsPerChunk;
+	const unsigned int Rows = GroupStart + timestepsPerChunk <= numTimesteps ? timestepsPerChunk : numTimesteps - GroupStart;
+	groupValues.resize((size_t)numValues*timestepsPerChunk*numNodes);
+	decodedGroup = -1;
+
+	std::vector<int> results (numValues*NumBlocks, 0);
+	ParallelFor(results.size(), 1, [&](size_t first, size_t last)
+	{
+		std::ifstream file (fileLocation.data(), std::ios::in | std::ios::binary);
+		std::vector<unsigned char> compressed, encoded;
+		std::vector<float> chunkValues;
+		for (size_t k=first; k<last; k++)
+		{
+			const unsigned int Value = k/NumBlocks;
+			const unsigned int Block = k%NumBlocks;
+			const unsigned int BlockStart = Block*nodesPerBlock;
+			const unsigned int BlockNodes = BlockStart + nodesPerBlock <= numNodes ? nodesPerBlock : numNodes - BlockStart;
+			chunkValues.resize((size_t)Rows*BlockNodes);
+			results[k] = ReadChunk(&file, GetChunk(group, Value, Block), BlockNodes, Rows, &compressed, &encoded, &chunkValues[0]);
+			for (unsigned int r=0; r<Rows && results[k] == 0; r++)
+				memcpy(&groupValues[((size_t)Value*timestepsPerChunk + r)*numNodes + BlockStart],
+				       &chunkValues[(size_t)r*BlockNodes], BlockNodes*sizeof(float));
+		}
+	});
+
+	for (unsigned int k=0; k<results.size(); k++)
+		if (results[k] != 0)
+			return 1;
+	decodedGroup = group;
+	return 0;
+}
+
+
+/**
+ * @brief XORs each timestep of a chunk with the previous one and splits the values into
+ * byte planes
+ * @param values The chunk's first value, in an array of timesteps
+ * @param rowLength The number of Nodes in the chunk
+ * @param numRows The number of timesteps in the chunk
+ * @param rowStride The distance between two timesteps in values
+ * @param encoded The vector that receives the 4*rowLength*numRows encoded bytes
+ */
+void ChunkedOutputFile::EncodeChunk(const float *values, unsigned int rowLength, unsigned int numRows, unsigned int rowStride, std::vector<unsigned char> *encoded)
+{
+	const size_t Count = (size_t)rowLength*numRows;
+	encoded->resize(4*Count);
+	unsigned char *planes = &(*encoded)[0];
+	for (unsigned int r=0; r<numRows; r++)
+	{
+		const float *row = values + (size_t)r*rowStride;
+		for (unsigned int j=0; j<rowLength; j++)
+		{
+			unsigned int bits, previous = 0;
+			memcpy(&bits, row+j, 4);
+			if (r > 0)
+				memcpy(&previous, row+j-rowStride, 4);
+			bits ^= previous;
+
+			const size_t Index = (size_t)r*rowLength + j;
+			planes[Index] = bits;
+			planes[Count + Index] = bits >> 8;
+			planes[2*Count + Index] = bits >> 16;
+			planes[3*Count + Index] = bits >> 24;
+		}
+	}
+}
+
+
+/**
+ * @brief Reverses EncodeChunk()
+ * @param encoded The 4*rowLength*numRows encoded bytes
+ * @param rowLength The number of Nodes in the chunk
+ * @param numRows The number of timesteps in the chunk
+ * @param values The array that receives the values [timestep][node]
+ */
+void ChunkedOutputFile::DecodeChunk(const unsigned char *encoded, unsigned int rowLength, unsigned int numRows, float *values)
+{
+	const size_t Count = (size_t)rowLength*numRows;
+	for (size_t i=0; i<Count; i++)
+	{
+		unsigned int bits = encoded[i] | (encoded[Count+i] << 8) | (encoded[2*Count+i] << 16) | ((unsigned int)encoded[3*Count+i] << 24);
+		if (i >= rowLength)
+		{
+			unsigned int previous;
+			memcpy(&previous, values+i-rowLength, 4);
+			bits ^= previous;
+		}
+		memcpy(values+i, &bits, 4);
+	}
+}
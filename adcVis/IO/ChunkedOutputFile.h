@@ -0,0 +1,118 @@
+#ifndef CHUNKEDOUTPUTFILE_H
+#define CHUNKEDOUTPUTFILE_H
+
+#include "adcData.h"
+#include "GlobalOutputFile.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+
+
+/**
+ * @brief Describes one compressed chunk of a ChunkedOutputFile
+ *
+ * Written to and read from the file as is.
+ */
+struct OutputChunkInfo {
+		unsigned long long	offset;		/**< The position of the chunk's data in the file in bytes */
+		unsigned int		size;		/**< The size of the chunk's data in the file in bytes */
+		unsigned int		rawSize;	/**< The size of the chunk's values before compression in bytes */
+};
+
+
+/**
+ * @brief Reads and writes a compressed binary copy of an output file, split into chunks of
+ * timesteps and blocks of Nodes
+ *
+ * The values of an output file are split in two directions: the timesteps into groups of
+ * timestepsPerChunk, and the Nodes into blocks of nodesPerBlock consecutive node numbers.
+ * Each group of timesteps of each block (for each value of vector output) is one chunk,
+ * stored as its own compressed stream, so that either a whole timestep (every block of one
+ * group, see ReadTimestep()) or a window of Nodes and timesteps (see ReadWindow()) can be
+ * read without decompressing anything else.
+ *
+ * Before compression, the values of a chunk are encoded so that they compress well:
+ * - Each timestep's values are XORed with the previous timestep's values (the first
+ * timestep of the chunk is kept as is). Values that change slowly share their sign,
+ * exponent and high mantissa bits with the previous timestep, which XOR to zero, and dry
+ * Nodes, whose value does not change, become zero entirely.
+ * - The bytes are then shuffled so that the first byte of every value comes first, then
+ * the second byte of every value, and so on, which groups the runs of zeros together.
+ * .
+ * The result is compressed with zlib at its fastest level. A chunk that does not get
+ * smaller is stored uncompressed. The encoding is lossless, so decoded values are exactly
+ * the values read from the output file.
+ *
+ * The file layout is (all values in native byte order):
+ * - Header: "ADCOUTC1", version, number of Nodes, number of timesteps, number of values per
+ * Node, Nodes per block, timesteps per chunk
+ * - The model time of every timestep in seconds (doubles)
+ * - One OutputChunkInfo for every chunk, ordered by group of timesteps, then by value, then
+ * by block
+ * - The data of every chunk, in the same order
+ * .
+ *
+ * Write() converts an output file one group of timesteps at a time, with the timesteps of
+ * a group read in parallel and its chunks encoded and compressed in parallel. Readers
+ * decompress the chunks they need in parallel as well. ReadTimestep() keeps the last group
+ * of timesteps it decoded, so playing through the timesteps of a group in order only
+ * decompresses it once.
+ *
+ * Once a file has been opened, ReadTimestep() and ReadWindow() can be called from any number
+ * of threads at the same time.
+ *
+ */
+class ChunkedOutputFile
+{
+	public:
+
+		ChunkedOutputFile();
+
+		static int	Write(GlobalOutputFile *outputFile, std::string fileLoc, unsigned int nodesPerBlock, unsigned int timestepsPerChunk);
+
+		int		Open(std::string fileLoc);
+		int		ReadTimestep(unsigned int timestep, float *values);
+		int		ReadTimestep(unsigned int timestep, float *u, float *v, float *magnitude);
+		int		ReadWindow(unsigned int firstNode, unsigned int lastNode, unsigned int firstTimestep, unsigned int lastTimestep, float *values);
+
+		// Getter Methods
+		bool		IsOpen();
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumValues();
+		unsigned int	GetNumTimesteps();
+		unsigned int	GetNodesPerBlock();
+		unsigned int	GetTimestepsPerChunk();
+		double		GetTime(unsigned int timestep);
+		unsigned long long	GetCompressedSize();
+
+	protected:
+
+		std::string			fileLocation;		/**< The location of the open file */
+		bool				fileOpen;		/**< Flag that shows if the header has been read successfully */
+		unsigned int			numNodes;		/**< The number of Nodes */
+		unsigned int			numTimesteps;		/**< The number of timesteps */
+		unsigned int			numValues;		/**< The number of values per Node (1 for fort.63, 2 for fort.64) */
+		unsigned int			nodesPerBlock;		/**< The number of Nodes in each block (the last block may have fewer) */
+		unsigned int			timestepsPerChunk;	/**< The number of timesteps in each chunk (the last group may have fewer) */
+		std::vector<double>		times;			/**< The model time of every timestep in seconds */
+		std::vector<OutputChunkInfo>	chunks;			/**< The table of chunks */
+
+		// The last group of timesteps decoded by ReadTimestep()
+		std::mutex			groupMutex;		/**< Protects the decoded group */
+		int				decodedGroup;		/**< The index of the decoded group, or -1 */
+		std::vector<float>		groupValues;		/**< The group's values [value][timestep][node] */
+
+		// Protected Functions
+		unsigned int	GetNumBlocks();
+		OutputChunkInfo*	GetChunk(unsigned int group, unsigned int value, unsigned int block);
+		int		ReadChunk(std::ifstream *file, OutputChunkInfo *chunk, unsigned int rowLength, unsigned int numRows,
+					  std::vector<unsigned char> *compressed, std::vector<unsigned char> *encoded, float *values);
+		int		DecodeGroup(unsigned int group);
+
+		static void	EncodeChunk(const float *values, unsigned int rowLength, unsigned int numRows, unsigned int rowStride, std::vector<unsigned char> *encoded);
+		static void	DecodeChunk(const unsigned char *encoded, unsigned int rowLength, unsigned int numRows, float *values);
+};
+
+#endif // CHUNKEDOUTPUTFILE_H
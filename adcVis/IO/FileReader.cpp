@@ -1,4 +1,5 @@
 #include "FileReader.h"
+#include "TraceWriter.h"
 
 FileReader::FileReader()
 {
@@ -50,6 +51,7 @@ int FileReader::ReadFort14(std::string fileLoc,
 			   unsigned int *numNodes,
 			   unsigned int *numElements)
 {
+	TRACE_SCOPE("io", "ReadFort14");
 	std::ifstream fort14 (fileLoc.data());
 	if (fort14.is_open())
 	{
@@ -88,6 +90,7 @@ int FileReader::ReadFort14(std::string fileLoc,
 		// Read the element data
 		if (elements)
 		{
+			TRACE_SCOPE("io", "ReadFort14 elements");
 			Element currElement;
 			for (unsigned int i=0; i<ne; i++)
 			{
@@ -150,6 +153,7 @@ int FileReader::ReadFort14(std::string fileLoc,
 			   float *minZ,
 			   float *maxZ)
 {
+	TRACE_SCOPE("io", "ReadFort14");
 	std::ifstream fort14 (fileLoc.data());
 	if (fort14.is_open())
 	{
@@ -217,6 +221,7 @@ int FileReader::ReadFort14(std::string fileLoc,
 		// Read the element data
 		if (elements)
 		{
+			TRACE_SCOPE("io", "ReadFort14 elements");
 			Element currElement;
 			for (unsigned int i=0; i<ne; i++)
 			{
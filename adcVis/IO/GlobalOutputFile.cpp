@@ -0,0 +1,582 @@
+#include "GlobalOutputFile.h"
+#include "TraceWriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sstream>
+#include <algorithm>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+/**
+ * @brief Skips spaces and tabs, but not the end of the line
+ */
+static inline const char* SkipBlanks(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	return p;
+}
+
+
+/**
+ * @brief Parses a whole number from a line of a record
+ * @return A pointer to the first character after the number
+ * @return 0 if there is no number
+ */
+static inline const char* ParseInteger(const char *p, const char *end, long *result)
+{
+	p = SkipBlanks(p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+	if (p >= end || *p < '0' || *p > '9')
+		return 0;
+
+	long value = 0;
+	while (p < end && *p >= '0' && *p <= '9')
+		value = 10*value + (*p++ - '0');
+	*result = negative ? -value : value;
+	return p;
+}
+
+
+/**
+ * @brief Parses a number written by Fortran (eg. "-0.1234567890E+01", "1.5", "2.0D-03")
+ *
+ * Up to 19 significant digits are collected as an integer and scaled once by a power of
+ * ten, which is much faster than strtod() and exact to float precision. Anything unusual
+ * (eg. NaN or Infinity) is handed to strtod(), which needs the record to end with '\0'.
+ *
+ * @return A pointer to the first character after the number
+ * @return 0 if there is no number
+ */
+static inline const char* ParseValue(const char *p, const char *end, float *result)
+{
+	static const double PowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+					     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	p = SkipBlanks(p, end);
+	const char *start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+
+	unsigned long long mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool anyDigits = false;
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		if (digits < 19)
+		{
+			mantissa = 10*mantissa + (*p - '0');
+			if (mantissa > 0)
+				digits++;
+		} else {
+			exponent++;
+		}
+		anyDigits = true;
+		p++;
+	}
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (digits < 19)
+			{
+				mantissa = 10*mantissa + (*p - '0');
+				if (mantissa > 0)
+					digits++;
+				exponent--;
+			}
+			anyDigits = true;
+			p++;
+		}
+	}
+	if (!anyDigits)
+	{
+		char *parsed = 0;
+		*result = strtof(start, &parsed);
+		return parsed == start ? 0 : parsed;
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E' || *p == 'd' || *p == 'D'))
+	{
+		long power = 0;
+		const char *next = ParseInteger(p+1, end, &power);
+		if (next == 0)
+			return 0;
+		exponent += (int)power;
+		p = next;
+	}
+
+	double value = (double)mantissa;
+	if (exponent < 0 && exponent >= -22)
+		value /= PowersOfTen[-exponent];
+	else if (exponent > 0 && exponent <= 22)
+		value *= PowersOfTen[exponent];
+	else if (exponent != 0)
+		value *= pow(10.0, exponent);
+	*result = (float)(negative ? -value : value);
+	return p;
+}
+
+
+GlobalOutputFile::GlobalOutputFile()
+{
+	fileOpen = false;
+	numNodes = 0;
+	numValues = 0;
+}
+
+
+/**
+ * @brief Reads the header of a global output file and builds the index of its timesteps
+ *
+ * The whole file is read once, but only the header line of each timestep is parsed.
+ *
+ * @param fileLoc The location of the global output file
+ * @return 0 if the file was opened successfully
+ * @return 1 if an error occurred
+ */
+int GlobalOutputFile::Open(std::string fileLoc)
+{
+	TRACE_SCOPE("io", "GlobalOutputFile::Open");
+	fileOpen = false;
+	timesteps.clear();
+
+	std::ifstream file (fileLoc.data(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 1;
+
+	// Get the number of nodes and the number of values per node
+	std::string line;
+	std::getline(file, title);
+	std::getline(file, line);
+	unsigned int numDatasets = 0, outputSteps = 0;
+	double interval = 0.0;
+	numNodes = numValues = 0;
+	std::stringstream(line) >> numDatasets >> numNodes >> interval >> outputSteps >> numValues;
+	if (!file.good() || numNodes == 0 || numValues == 0 || numValues > 3)
+	{
+		DEBUG("%s is not an ADCIRC global output file\n", fileLoc.data());
+		return 1;
+	}
+	if (!title.empty() && title[title.size()-1] == '\r')
+		title.erase(title.size()-1);
+
+	if (ScanTimesteps(&file, (unsigned long long)file.tellg()) != 0)
+		return 1;
+
+	if (timesteps.size() != numDatasets)
+		DEBUG("%s lists %u timesteps, but holds %u\n", fileLoc.data(), numDatasets, (unsigned int)timesteps.size());
+
+	fileLocation = fileLoc;
+	fileOpen = true;
+	return 0;
+}
+
+
+/**
+ * @brief Reads the values of one timestep
+ *
+ * Values are stored by node number, so values[i] holds the value of the Node with node
+ * number i+1. For files with more than one value per Node (eg. fort.64) only the first
+ * value is read. The file is opened separately for every call, so this function may be
+ * called from several threads at the same time.
+ *
+ * @param timestep The index of the timestep, starting at 0
+ * @param values A pointer to an array of at least GetNumNodes() floats
+ * @return 0 if the timestep was read successfully
+ * @return 1 if an error occurred
+ */
+int GlobalOutputFile::ReadTimestep(unsigned int timestep, float *values)
+{
+	return ReadTimestep(timestep, values, 0);
+}
+
+
+/**
+ * @brief Reads the values of one timestep and counts the wet Nodes
+ *
+ * Values are stored by node number, as in ReadTimestep(unsigned int, float*).
+ *
+ * @param timestep The index of the timestep, starting at 0
+ * @param values A pointer to an array of at least GetNumNodes() floats
+ * @param numWet A pointer to the variable that will hold the number of wet Nodes
+ * @return 0 if the timestep was read successfully
+ * @return 1 if an error occurred
+ */
+int GlobalOutputFile::ReadTimestep(unsigned int timestep, float *values, unsigned int *numWet)
+{
+	if (values == 0)
+		return 1;
+
+	std::vector<char> record;
+	if (ReadRecord(timestep, &record) != 0)
+		return 1;
+	return ParseRecord(&record, timestep, &values, 1, numWet);
+}
+
+
+/**
+ * @brief Reads the vectors of one timestep of a file with two values per Node (eg. fort.64)
+ *
+ * Each component is stored in its own array by node number, so u[i] and v[i] hold the
+ * vector of the Node with node number i+1. Any of the arrays may be 0 if it is not needed.
+ * The file is opened separately for every call, so this function may be called from
+ * several threads at the same time.
+ *
+ * @param timestep The index of the timestep, starting at 0
+ * @param u A pointer to an array of at least GetNumNodes() floats for the x-components
+ * @param v A pointer to an array of at least GetNumNodes() floats for the y-components
+ * @param magnitude A pointer to an array of at least GetNumNodes() floats for the length
+ * of each vector, or 0
+ * @return 0 if the timestep was read successfully
+ * @return 1 if an error occurred
+ */
+int GlobalOutputFile::ReadTimestep(unsigned int timestep, float *u, float *v, float *magnitude)
+{
+	if (numValues < 2)
+	{
+		DEBUG("%s does not hold vectors\n", fileLocation.data());
+		return 1;
+	}
+
+	// Magnitudes need both components, even if the caller does not
+	std::vector<float> tempU, tempV;
+	if (magnitude && u == 0)
+	{
+		tempU.resize(numNodes);
+		u = &tempU[0];
+	}
+	if (magnitude && v == 0)
+	{
+		tempV.resize(numNodes);
+		v = &tempV[0];
+	}
+
+	std::vector<char> record;
+	if (ReadRecord(timestep, &record) != 0)
+		return 1;
+	float *values[2] = {u, v};
+	if (ParseRecord(&record, timestep, values, 2, 0) != 0)
+		return 1;
+
+	if (magnitude)
+		ComputeMagnitude(u, v, magnitude, numNodes);
+	return 0;
+}
+
+
+/**
+ * @brief Computes the length of every vector in a pair of component arrays
+ *
+ * Vectors with a component of -99999 (eg. dry Nodes) get a magnitude of -99999. Four
+ * vectors are done at a time with SSE when it is available.
+ *
+ * @param u The x-components
+ * @param v The y-components
+ * @param magnitude The array that receives the lengths, which may be u or v
+ * @param count The number of vectors
+ */
+void GlobalOutputFile::ComputeMagnitude(const float *u, const float *v, float *magnitude, unsigned int count)
+{
+	if (u == 0 || v == 0 || magnitude == 0)
+		return;
+
+	const float Dry = -99999.0;
+	unsigned int i = 0;
+#ifdef __SSE__
+	const __m128 DryVec = _mm_set1_ps(Dry);
+	for (; i+4<=count; i+=4)
+	{
+		const __m128 U = _mm_loadu_ps(u+i);
+		const __m128 V = _mm_loadu_ps(v+i);
+		const __m128 Length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(U, U), _mm_mul_ps(V, V)));
+		const __m128 IsDry = _mm_or_ps(_mm_cmpeq_ps(U, DryVec), _mm_cmpeq_ps(V, DryVec));
+		_mm_storeu_ps(magnitude+i, _mm_or_ps(_mm_and_ps(IsDry, DryVec), _mm_andnot_ps(IsDry, Length)));
+	}
+#endif
+	for (; i<count; i++)
+		magnitude[i] = (u[i] == Dry || v[i] == Dry) ? Dry : sqrtf(u[i]*u[i] + v[i]*v[i]);
+}
+
+
+/**
+ * @brief Returns true if a file has been opened successfully
+ * @return true if a file is open
+ */
+bool GlobalOutputFile::IsOpen()
+{
+	return fileOpen;
+}
+
+
+/**
+ * @brief Returns the first line of the file
+ * @return The run description, run ID and grid description
+ */
+std::string GlobalOutputFile::GetTitle()
+{
+	return title;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in each timestep
+ * @return The number of Nodes
+ */
+unsigned int GlobalOutputFile::GetNumNodes()
+{
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of values stored for each Node
+ * @return 1 for scalar output (eg. fort.63), 2 for vector output (eg. fort.64)
+ */
+unsigned int GlobalOutputFile::GetNumValues()
+{
+	return numValues;
+}
+
+
+/**
+ * @brief Returns the number of complete timesteps in the file
+ * @return The number of timesteps
+ */
+unsigned int GlobalOutputFile::GetNumTimesteps()
+{
+	return timesteps.size();
+}
+
+
+/**
+ * @brief Returns the index entry of a timestep
+ * @param timestep The index of the timestep, starting at 0
+ * @return A pointer to the timestep's OutputTimestepInfo
+ * @return 0 if there is no such timestep
+ */
+OutputTimestepInfo* GlobalOutputFile::GetTimestepInfo(unsigned int timestep)
+{
+	if (timestep < timesteps.size())
+		return &timesteps[timestep];
+	return 0;
+}
+
+
+/**
+ * @brief Reads the bytes of one timestep's record, followed by '\0'
+ * @param timestep The index of the timestep, starting at 0
+ * @param record Filled with the record
+ * @return 0 if the record was read successfully
+ * @return 1 if an error occurred
+ */
+int GlobalOutputFile::ReadRecord(unsigned int timestep, std::vector<char> *record)
+{
+	if (!fileOpen || timestep >= timesteps.size())
+		return 1;
+
+	TRACE_SCOPE("io", "ReadTimestep");
+
+	std::ifstream file (fileLocation.data(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 1;
+
+	OutputTimestepInfo *info = &timesteps[timestep];
+	record->resize(info->size + 1);
+	file.seekg(info->offset);
+	file.read(&(*record)[0], info->size);
+	if (!file.good())
+	{
+		DEBUG("Error reading timestep %u of %s\n", timestep, fileLocation.data());
+		return 1;
+	}
+	(*record)[info->size] = '\0';
+	return 0;
+}
+
+
+/**
+ * @brief Finds the byte offset of every timestep by counting lines
+ *
+ * Every record is one header line followed by one line per listed Node. A full record
+ * lists every Node, and a sparse record lists NNONDEF Nodes. Only the header lines are
+ * parsed. Blank lines between records are skipped. A record that is cut off by the end
+ * of the file is left out.
+ *
+ * @param file The open file
+ * @param dataStart The position of the first timestep's header line in bytes
+ * @return 0 if the file was scanned successfully
+ * @return 1 if an error occurred
+ */
+int GlobalOutputFile::ScanTimesteps(std::ifstream *file, unsigned long long dataStart)
+{
+	TRACE_SCOPE("io", "ScanTimesteps");
+	const size_t BlockSize = 1 << 22;
+	std::vector<char> block (BlockSize);
+	unsigned long long blockStart = dataStart;
+	unsigned long long lineStart = dataStart;
+	unsigned int lineInRecord = 0;
+	std::string header;
+	OutputTimestepInfo current;
+	bool done = false;
+
+	file->seekg(dataStart);
+	while (!done && *file)
+	{
+		file->read(&block[0], BlockSize);
+		const size_t Count = file->gcount();
+		const char *p = &block[0];
+		const char *end = p + Count;
+		while (p < end)
+		{
+			const char *newline = (const char*)memchr(p, '\n', end - p);
+			if (lineInRecord == 0)
+				header.append(p, (newline ? newline : end) - p);
+			if (newline == 0)
+				break;
+
+			const unsigned long long NextLineStart = blockStart + (newline + 1 - &block[0]);
+			if (lineInRecord == 0)
+			{
+				if (header.find_first_not_of(" \t\r") == std::string::npos)
+				{
+					header.clear();
+					lineStart = NextLineStart;
+					p = newline + 1;
+					continue;
+				}
+				current.offset = lineStart;
+				int fields = sscanf(header.data(), "%lf %d %u %f", &current.time, &current.iteration, &current.numListed, &current.defaultValue);
+				current.sparse = fields == 4;
+				if (!current.sparse)
+				{
+					current.numListed = numNodes;
+					current.defaultValue = -99999.0;
+				}
+				if (fields < 2 || fields == 3 || current.numListed > numNodes)
+				{
+					DEBUG("Unreadable header line of timestep %u: %s\n", (unsigned int)timesteps.size(), header.data());
+					done = true;
+					break;
+				}
+				header.clear();
+			}
+
+			if (++lineInRecord > current.numListed)
+			{
+				current.size = NextLineStart - current.offset;
+				timesteps.push_back(current);
+				lineInRecord = 0;
+			}
+			lineStart = NextLineStart;
+			p = newline + 1;
+		}
+		blockStart += Count;
+	}
+
+	// The last line of the file may not end with a newline
+	if (!done && lineInRecord > 0 && lineInRecord == current.numListed && blockStart > lineStart)
+	{
+		current.size = blockStart - current.offset;
+		timesteps.push_back(current);
+	}
+
+	if (file->bad())
+	{
+		DEBUG("Error scanning %u timesteps\n", (unsigned int)timesteps.size());
+		timesteps.clear();
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Parses the Node lines of one record into per-value arrays
+ *
+ * For a sparse record, every array is first filled with the record's default value. Values
+ * beyond count, or whose array is 0, are skipped.
+ *
+ * @param record The record as read by ReadRecord(), ending with '\0'
+ * @param timestep The index of the timestep
+ * @param values The arrays that receive each value, by node number
+ * @param count The number of arrays
+ * @param numWet A pointer to the variable that will hold the number of wet Nodes, or 0
+ * @return 0 if every listed Node was parsed
+ * @return 1 if an error occurred
+ */
+int GlobalOutputFile::ParseRecord(std::vector<char> *record, unsigned int timestep, float **values, unsigned int count, unsigned int *numWet)
+{
+	if (timestep >= timesteps.size() || record == 0 || record->empty() || values == 0)
+		return 1;
+
+	OutputTimestepInfo *info = &timesteps[timestep];
+	const char *p = &(*record)[0];
+	const char *end = p + record->size() - 1;
+
+	if (info->sparse)
+		for (unsigned int i=0; i<count; i++)
+			if (values[i])
+				std::fill(values[i], values[i] + numNodes, info->defaultValue);
+
+	// Skip the header line
+	p = (const char*)memchr(p, '\n', end - p);
+	if (p == 0)
+		return info->numListed == 0 ? 0 : 1;
+	p++;
+
+	const float Dry = -99999.0;
+	unsigned int lines = 0, wet = 0;
+	while (lines < info->numListed)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+			p++;
+		if (p >= end)
+			break;
+
+		long node = 0;
+		p = ParseInteger(p, end, &node);
+		if (p == 0 || node < 1 || node > (long)numNodes)
+		{
+			DEBUG("Bad node number on line %u of timestep %u\n", lines+1, timestep);
+			return 1;
+		}
+		for (unsigned int i=0; i<numValues; i++)
+		{
+			float value;
+			p = ParseValue(p, end, &value);
+			if (p == 0)
+			{
+				DEBUG("Bad value for node %li of timestep %u\n", node, timestep);
+				return 1;
+			}
+			if (i < count && values[i])
+				values[i][node-1] = value;
+			if (i == 0 && value != Dry && !(info->sparse && value == info->defaultValue))
+				wet++;
+		}
+
+		const char *newline = (const char*)memchr(p, '\n', end - p);
+		p = newline ? newline + 1 : end;
+		lines++;
+	}
+
+	if (lines != info->numListed)
+	{
+		DEBUG("Timestep %u holds %u of %u nodes\n", timestep, lines, info->numListed);
+		return 1;
+	}
+
+	if (numWet)
+		*numWet = wet;
+	return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef GLOBALOUTPUTFILE_H
+#define GLOBALOUTPUTFILE_H
+
+#include "adcData.h"
+#include <string>
+#include <vector>
+#include <fstream>
+
+
+/**
+ * @brief Describes where one timestep is stored in a GlobalOutputFile
+ */
+struct OutputTimestepInfo {
+		double			time;		/**< The model time of the timestep in seconds */
+		int			iteration;	/**< The model time step number of the timestep */
+		unsigned long long	offset;		/**< The position of the timestep's header line in the file in bytes */
+		unsigned long long	size;		/**< The size of the timestep's data, including the header line, in bytes */
+		unsigned int		numListed;	/**< The number of Nodes listed in the record (all of them unless the record is sparse) */
+		bool			sparse;		/**< Flag that shows if the record only lists Nodes that differ from defaultValue */
+		float			defaultValue;	/**< The value of every Node that a sparse record does not list */
+};
+
+
+/**
+ * @brief Reads single timesteps from ADCIRC global output files (eg. fort.63)
+ *
+ * A global output file holds one record per timestep, each made of a header line with the
+ * model time and time step number, followed by one line per Node with its node number and
+ * value(s) (See fort.63 in ADCIRC manual):
+ *
+ * - Line 1: RUNDES, RUNID, AGRID
+ * - Line 2: NDSETSE, NP, DTDP*NSPOOLGE, NSPOOLGE, IRTYPE
+ * - For every timestep: TIME, IT, then NP lines of JN, ETA2(JN) (fort.63) or JN, UU2(JN),
+ * VV2(JN) (fort.64)
+ * .
+ *
+ * ADCIRC can also write sparse records, whose header line is TIME, IT, NNONDEF, DEFVAL and
+ * which only list the NNONDEF Nodes whose value is not DEFVAL (eg. only wet Nodes). Both
+ * layouts may be mixed in one file. A sparse record is read by filling the output arrays
+ * with DEFVAL and then writing each listed Node into place, so the result is always one
+ * value per Node.
+ *
+ * Open() scans the file once, counting lines without parsing any values, and stores the
+ * byte offset and size of every timestep (see OutputTimestepInfo). ReadTimestep() then
+ * seeks straight to a timestep and parses only that record, so reading the last timestep
+ * of a large file costs the same as reading the first. The number of timesteps is taken
+ * from the scan rather than from NDSETSE, so files of runs that are still going (or were
+ * stopped early) can be read up to the last complete timestep.
+ *
+ * Vector output (eg. fort.64 depth-averaged velocity) is read into separate u and v arrays,
+ * optionally along with the magnitude of each vector (see ComputeMagnitude()), so that
+ * either component or the speed can be uploaded or colored directly.
+ *
+ * The number of wet Nodes (Nodes whose value is neither the dry value -99999 nor the
+ * default value of a sparse record) is counted while a scalar timestep is parsed.
+ *
+ * Reading a timestep is done in two steps, ReadRecord() and ParseRecord(), which can also be
+ * called separately (eg. to read on one thread and parse on another, see
+ * TimestepPrefetcher). Once a file has been opened, all of these functions can be called
+ * from any number of threads at the same time.
+ *
+ */
+class GlobalOutputFile
+{
+	public:
+
+		GlobalOutputFile();
+
+		int		Open(std::string fileLoc);
+		int		ReadTimestep(unsigned int timestep, float *values);
+		int		ReadTimestep(unsigned int timestep, float *values, unsigned int *numWet);
+		int		ReadTimestep(unsigned int timestep, float *u, float *v, float *magnitude);
+		int		ReadRecord(unsigned int timestep, std::vector<char> *record);
+		int		ParseRecord(std::vector<char> *record, unsigned int timestep, float **values, unsigned int count, unsigned int *numWet);
+
+		static void	ComputeMagnitude(const float *u, const float *v, float *magnitude, unsigned int count);
+
+		// Getter Methods
+		bool		IsOpen();
+		std::string	GetTitle();
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumValues();
+		unsigned int	GetNumTimesteps();
+		OutputTimestepInfo*	GetTimestepInfo(unsigned int timestep);
+
+	protected:
+
+		std::string			fileLocation;	/**< The location of the open file */
+		bool				fileOpen;	/**< Flag that shows if the file has been scanned successfully */
+		std::string			title;		/**< The first line of the file */
+		unsigned int			numNodes;	/**< The number of Nodes in each timestep (NP) */
+		unsigned int			numValues;	/**< The number of values per Node (IRTYPE) */
+		std::vector<OutputTimestepInfo>	timesteps;	/**< The index of every complete timestep */
+
+		// Protected Functions
+		int	ScanTimesteps(std::ifstream *file, unsigned long long dataStart);
+};
+
+#endif // GLOBALOUTPUTFILE_H
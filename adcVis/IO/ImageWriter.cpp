@@ -0,0 +1,284 @@
+#include "ImageWriter.h"
+#include "TraceWriter.h"
+
+#include <png.h>
+#include <stdio.h>
+
+
+ImageWriter::ImageWriter()
+{
+	maxQueued = 4;
+	active = 0;
+	numWritten = 0;
+	numErrors = 0;
+	compressionLevel = 6;
+	stopping = false;
+}
+
+
+ImageWriter::~ImageWriter()
+{
+	Finish();
+}
+
+
+/**
+ * @brief Starts the threads that encode images
+ *
+ * Any images still queued from a previous run are written first.
+ *
+ * @param numThreads The number of threads, or 0 to use one per core
+ * @param maxQueued The largest number of images waiting in the queue, or 0 for twice
+ * the number of threads
+ * @return 0 if the threads were started
+ * @return 1 if an error occurred
+ */
+int ImageWriter::Start(unsigned int numThreads, unsigned int maxQueued)
+{
+	Finish();
+
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+	if (numThreads == 0)
+		numThreads = 1;
+
+	std::lock_guard<std::mutex> lock(queueMutex);
+	this->maxQueued = maxQueued > 0 ? maxQueued : 2*numThreads;
+	numWritten = 0;
+	numErrors = 0;
+	stopping = false;
+	for (unsigned int i=0; i<numThreads; i++)
+		workers.push_back(std::thread(&ImageWriter::WorkerLoop, this));
+
+	return workers.empty() ? 1 : 0;
+}
+
+
+/**
+ * @brief Gets an empty pixel buffer, reusing the memory of an image that has been written
+ * @param buffer A pointer to the vector that will receive the buffer
+ */
+void ImageWriter::AcquireBuffer(std::vector<unsigned char> *buffer)
+{
+	if (buffer == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(queueMutex);
+	if (!freeBuffers.empty())
+	{
+		buffer->swap(freeBuffers.back());
+		freeBuffers.pop_back();
+	}
+}
+
+
+/**
+ * @brief Queues an image to be written as a PNG file
+ *
+ * The contents of pixels are moved into the queue and pixels is left empty. If the queue
+ * is full, waits until a thread has finished an image.
+ *
+ * @param fileLoc The location of the file to write
+ * @param width The width of the image in pixels
+ * @param height The height of the image in pixels
+ * @param pixels The RGBA pixels, bottom row first as read by glReadPixels()
+ * @return 0 if the image was queued
+ * @return 1 if the threads are not running or the buffer is too small
+ */
+int ImageWriter::Submit(std::string fileLoc, int width, int height, std::vector<unsigned char> *pixels)
+{
+	if (pixels == 0 || width <= 0 || height <= 0 || pixels->size() < 4*(size_t)width*height)
+		return 1;
+
+	std::unique_lock<std::mutex> lock(queueMutex);
+	if (workers.empty() || stopping)
+		return 1;
+
+	while (queue.size() >= maxQueued)
+		jobDone.wait(lock);
+
+	queue.push_back(ImageJob());
+	ImageJob &job = queue.back();
+	job.fileLoc = fileLoc;
+	job.width = width;
+	job.height = height;
+	job.pixels.swap(*pixels);
+	pixels->clear();
+
+	jobAdded.notify_one();
+	return 0;
+}
+
+
+/**
+ * @brief Waits for every queued image to be written
+ *
+ * The threads keep running, so more images can be submitted afterwards.
+ *
+ */
+void ImageWriter::Wait()
+{
+	std::unique_lock<std::mutex> lock(queueMutex);
+	while (!workers.empty() && (!queue.empty() || active > 0))
+		jobDone.wait(lock);
+}
+
+
+/**
+ * @brief Waits for every queued image to be written and stops the threads
+ */
+void ImageWriter::Finish()
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	jobAdded.notify_all();
+
+	for (unsigned int i=0; i<workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+}
+
+
+/**
+ * @brief Returns the number of images written successfully since Start()
+ * @return The number of images written
+ */
+unsigned int ImageWriter::GetNumWritten()
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return numWritten;
+}
+
+
+/**
+ * @brief Returns the number of images that could not be written since Start()
+ * @return The number of errors
+ */
+unsigned int ImageWriter::GetNumErrors()
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return numErrors;
+}
+
+
+/**
+ * @brief Sets the zlib compression level used for new images
+ *
+ * Lower levels are much faster and produce larger files. Level 1 is usually the best
+ * trade-off for large animations.
+ *
+ * @param level The compression level (0 - 9, default 6)
+ */
+void ImageWriter::SetCompressionLevel(int level)
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	compressionLevel = level < 0 ? 0 : (level > 9 ? 9 : level);
+}
+
+
+/**
+ * @brief Writes an RGBA image to a PNG file
+ *
+ * Can be called from any thread.
+ *
+ * @param fileLoc The location of the file to write
+ * @param width The width of the image in pixels
+ * @param height The height of the image in pixels
+ * @param pixels The RGBA pixels
+ * @param flipVertical true if the first row of pixels is the bottom of the image, as read
+ * by glReadPixels()
+ * @param compressionLevel The zlib compression level (0 - 9)
+ * @return 0 if the file was written successfully
+ * @return 1 if an error occurred
+ */
+int ImageWriter::WritePNG(std::string fileLoc, int width, int height, const unsigned char *pixels, bool flipVertical, int compressionLevel)
+{
+	TRACE_SCOPE("io", "WritePNG");
+	FILE *file = fopen(fileLoc.data(), "wb");
+	if (file == 0)
+	{
+		DEBUG("Unable to open %s for writing\n", fileLoc.data());
+		return 1;
+	}
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+	png_infop info = png ? png_create_info_struct(png) : 0;
+	if (png == 0 || info == 0)
+	{
+		png_destroy_write_struct(&png, 0);
+		fclose(file);
+		return 1;
+	}
+
+	// libpng reports errors by jumping back here
+	if (setjmp(png_jmpbuf(png)))
+	{
+		DEBUG("Error encoding %s\n", fileLoc.data());
+		png_destroy_write_struct(&png, &info);
+		fclose(file);
+		return 1;
+	}
+
+	png_init_io(png, file);
+	png_set_compression_level(png, compressionLevel);
+	png_set_filter(png, 0, compressionLevel <= 1 ? PNG_FILTER_SUB : PNG_ALL_FILTERS);
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+
+	const size_t RowSize = 4*(size_t)width;
+	for (int row=0; row<height; row++)
+	{
+		int sourceRow = flipVertical ? height-1-row : row;
+		png_write_row(png, (png_const_bytep)(pixels + RowSize*sourceRow));
+	}
+
+	png_write_end(png, 0);
+	png_destroy_write_struct(&png, &info);
+
+	if (fclose(file) != 0)
+		return 1;
+	return 0;
+}
+
+
+/**
+ * @brief Writes queued images until Finish() is called
+ */
+void ImageWriter::WorkerLoop()
+{
+	TRACE_THREAD_NAME("PNG writer");
+	std::unique_lock<std::mutex> lock(queueMutex);
+	while (true)
+	{
+		while (queue.empty() && !stopping)
+			jobAdded.wait(lock);
+		if (queue.empty())
+			return;
+
+		ImageJob job;
+		job.fileLoc.swap(queue.front().fileLoc);
+		job.width = queue.front().width;
+		job.height = queue.front().height;
+		job.pixels.swap(queue.front().pixels);
+		queue.pop_front();
+		int level = compressionLevel;
+		active++;
+		jobDone.notify_all();
+
+		lock.unlock();
+		int result = WritePNG(job.fileLoc, job.width, job.height, job.pixels.data(), true, level);
+		lock.lock();
+
+		active--;
+		if (result == 0)
+			numWritten++;
+		else
+			numErrors++;
+		freeBuffers.push_back(std::vector<unsigned char>());
+		freeBuffers.back().swap(job.pixels);
+		jobDone.notify_all();
+	}
+}
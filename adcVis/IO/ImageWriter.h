@@ -0,0 +1,81 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include "adcData.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/**
+ * @brief Encodes images to PNG files on a pool of background threads
+ *
+ * PNG compression is much slower than drawing a frame, so the thread that renders frames
+ * hands each one to an ImageWriter and moves on to the next frame while the previous ones
+ * are compressed and written in parallel.
+ *
+ * Pixel buffers are recycled: get an empty buffer with AcquireBuffer(), fill it, and pass
+ * it to Submit(), which takes the buffer's contents. Once the image has been written, the
+ * buffer is kept for the next call to AcquireBuffer(), so a long export does not allocate
+ * a new frame's worth of memory for every frame.
+ *
+ * The number of queued images is limited. When the queue is full, Submit() waits for a
+ * thread to finish an image, which keeps memory use bounded when rendering is faster than
+ * compression.
+ *
+ */
+class ImageWriter
+{
+	public:
+
+		ImageWriter();
+		~ImageWriter();
+
+		int		Start(unsigned int numThreads, unsigned int maxQueued);
+		void		AcquireBuffer(std::vector<unsigned char> *buffer);
+		int		Submit(std::string fileLoc, int width, int height, std::vector<unsigned char> *pixels);
+		void		Wait();
+		void		Finish();
+
+		// Getter Methods
+		unsigned int	GetNumWritten();
+		unsigned int	GetNumErrors();
+
+		// Setter Methods
+		void		SetCompressionLevel(int level);
+
+		static int	WritePNG(std::string fileLoc, int width, int height, const unsigned char *pixels, bool flipVertical, int compressionLevel);
+
+	protected:
+
+		/**
+		 * @brief An image waiting to be written
+		 */
+		struct ImageJob {
+				std::string			fileLoc;	/**< The location of the file to write */
+				int				width;		/**< The width of the image in pixels */
+				int				height;		/**< The height of the image in pixels */
+				std::vector<unsigned char>	pixels;		/**< The RGBA pixels, bottom row first as read by glReadPixels() */
+		};
+
+		std::vector<std::thread>		workers;	/**< The threads that encode images */
+		std::mutex				queueMutex;	/**< Protects every member below */
+		std::condition_variable			jobAdded;	/**< Wakes the workers when an image is queued or when stopping */
+		std::condition_variable			jobDone;	/**< Wakes Submit() and Wait() when an image has been written */
+		std::deque<ImageJob>			queue;		/**< The images waiting to be written */
+		std::vector<std::vector<unsigned char> >	freeBuffers;	/**< Pixel buffers that can be reused */
+		unsigned int				maxQueued;	/**< The largest number of images in the queue */
+		unsigned int				active;		/**< The number of images being written right now */
+		unsigned int				numWritten;	/**< The number of images written successfully */
+		unsigned int				numErrors;	/**< The number of images that could not be written */
+		int					compressionLevel;	/**< The zlib compression level (0 - 9) */
+		bool					stopping;	/**< Set to true to make the workers exit */
+
+		// Protected Functions
+		void		WorkerLoop();
+};
+
+#endif // IMAGEWRITER_H
@@ -0,0 +1,393 @@
+#include "NetcdfOutputFile.h"
+#include "GlobalOutputFile.h"
+#include "TraceWriter.h"
+
+#include <netcdf.h>
+
+
+NetcdfOutputFile::NetcdfOutputFile()
+{
+	fileID = -1;
+	numNodes = 0;
+	numElements = 0;
+	numValues = 0;
+	valueIDs[0] = valueIDs[1] = -1;
+	fillValue = -99999.0;
+	chunkCacheSize = 0;
+}
+
+
+/**
+ * @brief Deconstructor that closes the file
+ */
+NetcdfOutputFile::~NetcdfOutputFile()
+{
+	Close();
+}
+
+
+/**
+ * @brief Opens a NetCDF output file and reads its dimensions and model times
+ *
+ * The file must hold either zeta, or both u-vel and v-vel. Any file that is already open
+ * is closed first.
+ *
+ * @param fileLoc The location of the NetCDF file
+ * @return 0 if the file was opened successfully
+ * @return 1 if an error occurred
+ */
+int NetcdfOutputFile::Open(std::string fileLoc)
+{
+	TRACE_SCOPE("io", "NetcdfOutputFile::Open");
+	Close();
+
+	int status = nc_open(fileLoc.data(), NC_NOWRITE, &fileID);
+	if (status != NC_NOERR)
+	{
+		DEBUG("Unable to open %s: %s\n", fileLoc.data(), nc_strerror(status));
+		fileID = -1;
+		return 1;
+	}
+
+	// Get the mesh and time dimensions
+	int nodeDim, elementDim, timeDim, timeID;
+	size_t length;
+	if (nc_inq_dimid(fileID, "node", &nodeDim) != NC_NOERR || nc_inq_dimlen(fileID, nodeDim, &length) != NC_NOERR)
+	{
+		DEBUG("%s has no node dimension\n", fileLoc.data());
+		Close();
+		return 1;
+	}
+	numNodes = length;
+	if (nc_inq_dimid(fileID, "nele", &elementDim) == NC_NOERR && nc_inq_dimlen(fileID, elementDim, &length) == NC_NOERR)
+		numElements = length;
+
+	if (nc_inq_dimid(fileID, "time", &timeDim) == NC_NOERR && nc_inq_dimlen(fileID, timeDim, &length) == NC_NOERR)
+	{
+		times.resize(length);
+		if (length > 0 && (nc_inq_varid(fileID, "time", &timeID) != NC_NOERR || nc_get_var_double(fileID, timeID, &times[0]) != NC_NOERR))
+			for (size_t i=0; i<length; i++)
+				times[i] = 0.0;
+	}
+
+	// Find the result variables
+	if (nc_inq_varid(fileID, "zeta", &valueIDs[0]) == NC_NOERR)
+		numValues = 1;
+	else if (nc_inq_varid(fileID, "u-vel", &valueIDs[0]) == NC_NOERR && nc_inq_varid(fileID, "v-vel", &valueIDs[1]) == NC_NOERR)
+		numValues = 2;
+	else {
+		DEBUG("%s holds neither zeta nor u-vel and v-vel\n", fileLoc.data());
+		Close();
+		return 1;
+	}
+
+	if (nc_get_att_float(fileID, valueIDs[0], "_FillValue", &fillValue) != NC_NOERR)
+		fillValue = -99999.0;
+
+	chunkCacheSize = 0;
+	for (unsigned int i=0; i<numValues; i++)
+		SetChunkCache(valueIDs[i]);
+
+	fileLocation = fileLoc;
+	return 0;
+}
+
+
+/**
+ * @brief Closes the file
+ */
+void NetcdfOutputFile::Close()
+{
+	if (fileID >= 0)
+		nc_close(fileID);
+	fileID = -1;
+	numNodes = 0;
+	numElements = 0;
+	numValues = 0;
+	valueIDs[0] = valueIDs[1] = -1;
+	times.clear();
+}
+
+
+/**
+ * @brief Reads the mesh into a node and element list
+ *
+ * Node and element numbers are taken from their position in the file, starting at 1. Any
+ * data that is already in the lists is cleared, unless an error occurs.
+ *
+ * @param nodes A pointer to the node list
+ * @param elements A pointer to the element list, or 0 if only the Nodes are needed
+ * @return 0 if the mesh was read successfully
+ * @return 1 if an error occurred
+ */
+int NetcdfOutputFile::ReadMesh(std::vector<Node> *nodes, std::vector<Element> *elements)
+{
+	if (fileID < 0 || nodes == 0)
+		return 1;
+
+	TRACE_SCOPE("io", "NetcdfOutputFile::ReadMesh");
+
+	int xID, yID, depthID, elementID;
+	if (nc_inq_varid(fileID, "x", &xID) != NC_NOERR || nc_inq_varid(fileID, "y", &yID) != NC_NOERR ||
+	    nc_inq_varid(fileID, "depth", &depthID) != NC_NOERR)
+	{
+		DEBUG("%s does not hold the mesh\n", fileLocation.data());
+		return 1;
+	}
+
+	// Read each coordinate in one call, then interleave them into the node list
+	std::vector<float> coordinates (3*(size_t)numNodes);
+	if (numNodes > 0 &&
+	    (nc_get_var_float(fileID, xID, &coordinates[0]) != NC_NOERR ||
+	     nc_get_var_float(fileID, yID, &coordinates[numNodes]) != NC_NOERR ||
+	     nc_get_var_float(fileID, depthID, &coordinates[2*(size_t)numNodes]) != NC_NOERR))
+	{
+		DEBUG("Error reading the nodes of %s\n", fileLocation.data());
+		return 1;
+	}
+
+	std::vector<int> indices;
+	if (elements && numElements > 0)
+	{
+		indices.resize(3*(size_t)numElements);
+		size_t start[2] = {0, 0};
+		size_t count[2] = {numElements, 3};
+		if (nc_inq_varid(fileID, "element", &elementID) != NC_NOERR ||
+		    nc_get_vara_int(fileID, elementID, start, count, &indices[0]) != NC_NOERR)
+		{
+			DEBUG("Error reading the elements of %s\n", fileLocation.data());
+			return 1;
+		}
+	}
+
+	nodes->resize(numNodes);
+	for (unsigned int i=0; i<numNodes; i++)
+	{
+		Node *currNode = &(*nodes)[i];
+		currNode->nodeNumber = i+1;
+		currNode->x = coordinates[i];
+		currNode->y = coordinates[numNodes + i];
+		currNode->z = coordinates[2*(size_t)numNodes + i];
+	}
+
+	if (elements)
+	{
+		elements->resize(numElements);
+		for (unsigned int i=0; i<numElements && !indices.empty(); i++)
+		{
+			Element *currElement = &(*elements)[i];
+			currElement->elementNumber = i+1;
+			currElement->n1 = indices[3*(size_t)i+0];
+			currElement->n2 = indices[3*(size_t)i+1];
+			currElement->n3 = indices[3*(size_t)i+2];
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Reads the values of one timestep
+ *
+ * values[i] holds the value of the Node with node number i+1. Dry Nodes are set to -99999,
+ * whatever fill value the file uses. For files with velocities only u-vel is read.
+ *
+ * @param timestep The index of the timestep, starting at 0
+ * @param values A pointer to an array of at least GetNumNodes() floats
+ * @return 0 if the timestep was read successfully
+ * @return 1 if an error occurred
+ */
+int NetcdfOutputFile::ReadTimestep(unsigned int timestep, float *values)
+{
+	return ReadRow(valueIDs[0], timestep, values);
+}
+
+
+/**
+ * @brief Reads the velocities of one timestep of a fort.64.nc file
+ *
+ * Each component is read into its own array with one hyperslab read. Any of the arrays may
+ * be 0 if it is not needed.
+ *
+ * @param timestep The index of the timestep, starting at 0
+ * @param u A pointer to an array of at least GetNumNodes() floats for u-vel
+ * @param v A pointer to an array of at least GetNumNodes() floats for v-vel
+ * @param magnitude A pointer to an array of at least GetNumNodes() floats for the length
+ * of each vector (see GlobalOutputFile::ComputeMagnitude()), or 0
+ * @return 0 if the timestep was read successfully
+ * @return 1 if an error occurred
+ */
+int NetcdfOutputFile::ReadTimestep(unsigned int timestep, float *u, float *v, float *magnitude)
+{
+	if (numValues < 2)
+		return 1;
+
+	// Magnitudes need both components, even if the caller does not
+	std::vector<float> tempU, tempV;
+	if (magnitude && u == 0)
+	{
+		tempU.resize(numNodes);
+		u = &tempU[0];
+	}
+	if (magnitude && v == 0)
+	{
+		tempV.resize(numNodes);
+		v = &tempV[0];
+	}
+
+	if ((u && ReadRow(valueIDs[0], timestep, u) != 0) || (v && ReadRow(valueIDs[1], timestep, v) != 0))
+		return 1;
+
+	if (magnitude)
+		GlobalOutputFile::ComputeMagnitude(u, v, magnitude, numNodes);
+	return 0;
+}
+
+
+/**
+ * @brief Returns true if a file is open
+ * @return true if a file is open
+ */
+bool NetcdfOutputFile::IsOpen()
+{
+	return fileID >= 0;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in the mesh and in each timestep
+ * @return The number of Nodes
+ */
+unsigned int NetcdfOutputFile::GetNumNodes()
+{
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of Elements in the mesh
+ * @return The number of Elements, or 0 if the file holds no mesh
+ */
+unsigned int NetcdfOutputFile::GetNumElements()
+{
+	return numElements;
+}
+
+
+/**
+ * @brief Returns the number of values stored for each Node
+ * @return 1 for water levels (zeta), 2 for velocities (u-vel and v-vel)
+ */
+unsigned int NetcdfOutputFile::GetNumValues()
+{
+	return numValues;
+}
+
+
+/**
+ * @brief Returns the number of timesteps in the file
+ * @return The number of timesteps
+ */
+unsigned int NetcdfOutputFile::GetNumTimesteps()
+{
+	return times.size();
+}
+
+
+/**
+ * @brief Returns the model time of a timestep
+ * @param timestep The index of the timestep, starting at 0
+ * @return The model time in seconds, or 0 if there is no such timestep
+ */
+double NetcdfOutputFile::GetTime(unsigned int timestep)
+{
+	return timestep < times.size() ? times[timestep] : 0.0;
+}
+
+
+/**
+ * @brief Returns the size of the chunk cache set for the result variables
+ * @return The size of each variable's cache in bytes, or 0 if the variables are not chunked
+ */
+size_t NetcdfOutputFile::GetChunkCacheSize()
+{
+	return chunkCacheSize;
+}
+
+
+/**
+ * @brief Sizes the chunk cache of a result variable for reading whole timesteps in order
+ *
+ * A chunk of a (time, node) variable holds a few timesteps of a block of Nodes. Reading one
+ * timestep touches every chunk of one row of chunks, so the cache holds exactly one row:
+ * the next timesteps in the same row are then read from memory, and every chunk is read
+ * from disk once. Chunks are preempted as soon as they have been read in full. Variables
+ * that are not chunked (eg. in NetCDF-3 files) are left alone.
+ *
+ * @param variableID The NetCDF ID of the variable
+ * @return 0 if the cache was set or is not needed
+ * @return 1 if an error occurred
+ */
+int NetcdfOutputFile::SetChunkCache(int variableID)
+{
+	int storage = NC_CONTIGUOUS;
+	size_t chunkSizes[2] = {1, 1};
+	if (nc_inq_var_chunking(fileID, variableID, &storage, chunkSizes) != NC_NOERR || storage != NC_CHUNKED)
+		return 0;
+
+	const size_t ChunksPerRow = (numNodes + chunkSizes[1] - 1)/chunkSizes[1];
+	const size_t Size = ChunksPerRow*chunkSizes[0]*chunkSizes[1]*sizeof(float);
+
+	// The number of hash slots should be a prime well above the number of cached chunks
+	size_t slots = 4*ChunksPerRow + 1;
+	bool prime = false;
+	while (!prime)
+	{
+		prime = true;
+		for (size_t d=3; d*d<=slots && prime; d+=2)
+			prime = slots % d != 0;
+		if (!prime)
+			slots += 2;
+	}
+
+	int status = nc_set_var_chunk_cache(fileID, variableID, Size, slots, 1.0);
+	if (status != NC_NOERR)
+	{
+		DEBUG("Unable to set the chunk cache of %s: %s\n", fileLocation.data(), nc_strerror(status));
+		return 1;
+	}
+	DEBUG("Chunk cache of %.1f MB for chunks of %u timesteps x %u nodes\n", Size/1.0e6, (unsigned int)chunkSizes[0], (unsigned int)chunkSizes[1]);
+	chunkCacheSize = Size;
+	return 0;
+}
+
+
+/**
+ * @brief Reads one timestep of a result variable with a single hyperslab read
+ *
+ * The file's fill value is replaced with -99999.
+ *
+ */
+int NetcdfOutputFile::ReadRow(int variableID, unsigned int timestep, float *values)
+{
+	if (fileID < 0 || variableID < 0 || values == 0 || timestep >= times.size())
+		return 1;
+
+	TRACE_SCOPE("io", "NetcdfOutputFile::ReadRow");
+
+	size_t start[2] = {timestep, 0};
+	size_t count[2] = {1, numNodes};
+	int status = nc_get_vara_float(fileID, variableID, start, count, values);
+	if (status != NC_NOERR)
+	{
+		DEBUG("Error reading timestep %u of %s: %s\n", timestep, fileLocation.data(), nc_strerror(status));
+		return 1;
+	}
+
+	if (fillValue != -99999.0)
+		for (unsigned int i=0; i<numNodes; i++)
+			if (values[i] == fillValue)
+				values[i] = -99999.0;
+	return 0;
+}
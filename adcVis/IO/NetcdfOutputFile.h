@@ -0,0 +1,69 @@
+#ifndef NETCDFOUTPUTFILE_H
+#define NETCDFOUTPUTFILE_H
+
+#include "adcData.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Reads the mesh and single timesteps from ADCIRC NetCDF output (eg. fort.63.nc)
+ *
+ * ADCIRC's NetCDF output holds the mesh along with the results, in the variables x, y,
+ * depth and element (dimensions node, nele and nvertex), and one variable per result with
+ * the dimensions (time, node): zeta for water levels (fort.63.nc), or u-vel and v-vel for
+ * depth-averaged velocities (fort.64.nc). Dry Nodes hold the fill value -99999.
+ *
+ * ReadMesh() reads the mesh straight into a node and element list, the same lists that
+ * FileReader::ReadFort14() fills, so a Layer can be built without a separate fort.14.
+ * ReadTimestep() reads one timestep with a single hyperslab read of the row (t, 0:NP) into
+ * the caller's array, which can be reused for every timestep. Since each call reads a full
+ * row, Open() sizes the chunk cache of the result variables to hold one row of chunks, so
+ * that the following timesteps in the same chunks are read from memory (see
+ * SetChunkCache()).
+ *
+ * This class is only compiled in when building with "qmake CONFIG+=netcdf", which defines
+ * ADCVIS_NETCDF and links the local libnetcdf. The NetCDF library is not thread safe, so a
+ * NetcdfOutputFile must only be used from one thread at a time.
+ *
+ */
+class NetcdfOutputFile
+{
+	public:
+
+		NetcdfOutputFile();
+		~NetcdfOutputFile();
+
+		int		Open(std::string fileLoc);
+		void		Close();
+		int		ReadMesh(std::vector<Node> *nodes, std::vector<Element> *elements);
+		int		ReadTimestep(unsigned int timestep, float *values);
+		int		ReadTimestep(unsigned int timestep, float *u, float *v, float *magnitude);
+
+		// Getter Methods
+		bool		IsOpen();
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumElements();
+		unsigned int	GetNumValues();
+		unsigned int	GetNumTimesteps();
+		double		GetTime(unsigned int timestep);
+		size_t		GetChunkCacheSize();
+
+	protected:
+
+		int			fileID;		/**< The NetCDF ID of the open file, or -1 */
+		std::string		fileLocation;	/**< The location of the open file */
+		unsigned int		numNodes;	/**< The length of the node dimension */
+		unsigned int		numElements;	/**< The length of the nele dimension */
+		unsigned int		numValues;	/**< The number of result variables (1 for zeta, 2 for u-vel and v-vel) */
+		int			valueIDs[2];	/**< The NetCDF IDs of the result variables */
+		float			fillValue;	/**< The value of dry Nodes in the result variables */
+		size_t			chunkCacheSize;	/**< The size of the chunk cache of each result variable in bytes */
+		std::vector<double>	times;		/**< The model time of every timestep in seconds */
+
+		// Protected Functions
+		int	SetChunkCache(int variableID);
+		int	ReadRow(int variableID, unsigned int timestep, float *values);
+};
+
+#endif // NETCDFOUTPUTFILE_H
@@ -0,0 +1,274 @@
+#include "OutputStatistics.h"
+#include "TraceWriter.h"
+#include "../Threading/ParallelFor.h"
+
+#include <float.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// The value of dry Nodes in output files
+static const float Dry = -99999.0;
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+OutputStatistics::OutputStatistics()
+{
+	numNodes = 0;
+}
+
+
+/**
+ * @brief Removes every timestep and sets the number of Nodes
+ * @param newNumNodes The number of Nodes in each timestep
+ */
+void OutputStatistics::Reset(unsigned int newNumNodes)
+{
+	numNodes = newNumNodes;
+	times.clear();
+	maxValues.assign(numNodes, -FLT_MAX);
+	minValues.assign(numNodes, FLT_MAX);
+	sums.assign(numNodes, 0.0);
+	maxTimesteps.assign(numNodes, 0);
+	wetCounts.assign(numNodes, 0);
+}
+
+
+/**
+ * @brief Adds one timestep to the statistics
+ *
+ * The Nodes are split into blocks that are updated on separate threads.
+ *
+ * @param values The value of every Node, with -99999 for dry Nodes
+ * @param time The model time of the timestep in seconds
+ * @return 0 if the timestep was added successfully
+ * @return 1 if no values were given
+ */
+int OutputStatistics::AddTimestep(const float *values, double time)
+{
+	if (values == 0)
+		return 1;
+
+	const unsigned int Timestep = times.size();
+	times.push_back(time);
+	ParallelFor(numNodes, 1 << 18, [this, values, Timestep](size_t first, size_t last)
+	{
+		Accumulate(values, Timestep, first, last);
+	});
+	return 0;
+}
+
+
+/**
+ * @brief Adds every timestep of an output file to the statistics
+ *
+ * The timesteps are split into one contiguous range per thread. Each thread reads its
+ * range one timestep at a time into its own running values, which are then merged in
+ * order. For files with more than one value per Node (eg. fort.64) the statistics are
+ * those of the magnitude of each vector.
+ *
+ * @param file A pointer to an open GlobalOutputFile with the same number of Nodes
+ * @return 0 if every timestep was added successfully
+ * @return 1 if the file does not match or a timestep could not be read
+ */
+int OutputStatistics::AddFile(GlobalOutputFile *file)
+{
+	if (file == 0 || !file->IsOpen() || file->GetNumNodes() != numNodes)
+		return 1;
+
+	TRACE_SCOPE("io", "Output statistics");
+	const unsigned int NumTimesteps = file->GetNumTimesteps();
+	const bool Vector = file->GetNumValues() > 1;
+	const unsigned int NumParts = NumTimesteps < GetNumThreads() ? NumTimesteps : GetNumThreads();
+	std::vector<OutputStatistics> parts (NumParts);
+	std::vector<int> results (NumParts, 0);
+
+	ParallelFor(NumParts, 1, [&](size_t first, size_t last)
+	{
+		std::vector<float> u (numNodes), v (Vector ? numNodes : 0);
+		for (size_t p=first; p<last; p++)
+		{
+			parts[p].Reset(numNodes);
+			const unsigned int Begin = (unsigned long long)p*NumTimesteps/NumParts;
+			const unsigned int End = (unsigned long long)(p+1)*NumTimesteps/NumParts;
+			for (unsigned int t=Begin; t<End && results[p] == 0; t++)
+			{
+				if (Vector)
+					results[p] = file->ReadTimestep(t, &u[0], &v[0], &u[0]);
+				else
+					results[p] = file->ReadTimestep(t, &u[0]);
+				if (results[p] == 0)
+				{
+					parts[p].times.push_back(file->GetTimestepInfo(t)->time);
+					parts[p].Accumulate(&u[0], t-Begin, 0, numNodes);
+				}
+			}
+		}
+	});
+
+	for (unsigned int p=0; p<NumParts; p++)
+		if (results[p] != 0 || Merge(&parts[p]) != 0)
+			return 1;
+	return 0;
+}
+
+
+/**
+ * @brief Adds the statistics of timesteps that follow the ones already added
+ *
+ * When the largest value of a Node is the same in both, the earlier timestep is kept as the
+ * time of the maximum.
+ *
+ * @param other Statistics of the same Nodes over later timesteps
+ * @return 0 if the statistics were merged successfully
+ * @return 1 if the number of Nodes does not match
+ */
+int OutputStatistics::Merge(OutputStatistics *other)
+{
+	if (other == 0 || other->numNodes != numNodes)
+		return 1;
+
+	const unsigned int Offset = times.size();
+	ParallelFor(numNodes, 1 << 18, [this, other, Offset](size_t first, size_t last)
+	{
+		for (size_t i=first; i<last; i++)
+		{
+			if (other->maxValues[i] > maxValues[i])
+			{
+				maxValues[i] = other->maxValues[i];
+				maxTimesteps[i] = other->maxTimesteps[i] + Offset;
+			}
+			minValues[i] = other->minValues[i] < minValues[i] ? other->minValues[i] : minValues[i];
+			sums[i] += other->sums[i];
+			wetCounts[i] += other->wetCounts[i];
+		}
+	});
+	times.insert(times.end(), other->times.begin(), other->times.end());
+	return 0;
+}
+
+
+/**
+ * @brief Fills an array with one statistic of every Node
+ * @param statistic The Statistic to return
+ * @param values A pointer to an array of at least GetNumNodes() floats, with -99999 for
+ * Nodes that were never wet (except for HoursWet)
+ * @return 0 if the statistic was copied successfully
+ * @return 1 if no values were given or no timesteps have been added
+ */
+int OutputStatistics::GetStatistic(Statistic statistic, float *values)
+{
+	if (values == 0 || times.empty())
+		return 1;
+
+	const double Interval = times.size() > 1 ? (times.back() - times.front())/(times.size() - 1) : 0.0;
+	for (unsigned int i=0; i<numNodes; i++)
+	{
+		const bool Wet = wetCounts[i] > 0;
+		switch (statistic)
+		{
+			case MaxValue:
+				values[i] = Wet ? maxValues[i] : Dry;
+				break;
+			case MinValue:
+				values[i] = Wet ? minValues[i] : Dry;
+				break;
+			case MeanValue:
+				values[i] = Wet ? sums[i]/wetCounts[i] : Dry;
+				break;
+			case TimeOfMax:
+				values[i] = Wet ? times[maxTimesteps[i]] : Dry;
+				break;
+			case HoursWet:
+				values[i] = wetCounts[i]*Interval/3600.0;
+				break;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in each timestep
+ * @return The number of Nodes
+ */
+unsigned int OutputStatistics::GetNumNodes()
+{
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of timesteps added so far
+ * @return The number of timesteps
+ */
+unsigned int OutputStatistics::GetNumTimesteps()
+{
+	return times.size();
+}
+
+
+/**
+ * @brief Updates the running values of a range of Nodes with one timestep
+ *
+ * Four Nodes are updated at a time with SSE2 when it is available. Dry values, and values
+ * that are not a number, are skipped.
+ *
+ * @param values The value of every Node
+ * @param timestep The index of the timestep among the ones added to these statistics
+ * @param first The first Node of the range
+ * @param last The Node after the last one of the range
+ */
+void OutputStatistics::Accumulate(const float *values, unsigned int timestep, size_t first, size_t last)
+{
+	float *maxData = &maxValues[0];
+	float *minData = &minValues[0];
+	float *sumData = &sums[0];
+	unsigned int *maxTimestepData = &maxTimesteps[0];
+	unsigned int *wetData = &wetCounts[0];
+	size_t i = first;
+#ifdef __SSE2__
+	const __m128 DryVec = _mm_set1_ps(Dry);
+	const __m128i TimestepVec = _mm_set1_epi32(timestep);
+	for (; i+4<=last; i+=4)
+	{
+		const __m128 V = _mm_loadu_ps(values+i);
+		const __m128 Wet = _mm_and_ps(_mm_cmpneq_ps(V, DryVec), _mm_cmpord_ps(V, V));
+
+		const __m128 Max = _mm_loadu_ps(maxData+i);
+		const __m128 Greater = _mm_and_ps(_mm_cmpgt_ps(V, Max), Wet);
+		_mm_storeu_ps(maxData+i, _mm_or_ps(_mm_and_ps(Greater, V), _mm_andnot_ps(Greater, Max)));
+		const __m128i GreaterInt = _mm_castps_si128(Greater);
+		const __m128i MaxTimestep = _mm_loadu_si128((const __m128i*)(maxTimestepData+i));
+		_mm_storeu_si128((__m128i*)(maxTimestepData+i), _mm_or_si128(_mm_and_si128(GreaterInt, TimestepVec), _mm_andnot_si128(GreaterInt, MaxTimestep)));
+
+		const __m128 Min = _mm_loadu_ps(minData+i);
+		const __m128 Less = _mm_and_ps(_mm_cmplt_ps(V, Min), Wet);
+		_mm_storeu_ps(minData+i, _mm_or_ps(_mm_and_ps(Less, V), _mm_andnot_ps(Less, Min)));
+
+		_mm_storeu_ps(sumData+i, _mm_add_ps(_mm_loadu_ps(sumData+i), _mm_and_ps(Wet, V)));
+
+		// The wet mask is -1 in every wet lane
+		const __m128i WetCount = _mm_loadu_si128((const __m128i*)(wetData+i));
+		_mm_storeu_si128((__m128i*)(wetData+i), _mm_sub_epi32(WetCount, _mm_castps_si128(Wet)));
+	}
+#endif
+	for (; i<last; i++)
+	{
+		const float Value = values[i];
+		if (Value == Dry || Value != Value)
+			continue;
+		if (Value > maxData[i])
+		{
+			maxData[i] = Value;
+			maxTimestepData[i] = timestep;
+		}
+		minData[i] = Value < minData[i] ? Value : minData[i];
+		sumData[i] += Value;
+		wetData[i]++;
+	}
+}
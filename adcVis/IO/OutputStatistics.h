@@ -0,0 +1,74 @@
+#ifndef OUTPUTSTATISTICS_H
+#define OUTPUTSTATISTICS_H
+
+#include "adcData.h"
+#include "GlobalOutputFile.h"
+
+#include <vector>
+
+
+/**
+ * @brief Keeps per-Node statistics of every timestep of an output file, in one pass and
+ * without holding more than one timestep at a time
+ *
+ * The statistics are those of ADCIRC's maxele.63 and minimum water level maps and more:
+ * the largest and smallest value of every Node, its mean, the model time of its largest
+ * value and the number of hours it was wet. Only wet timesteps of a Node (values other than
+ * -99999) are counted, so a Node that was never wet gets -99999 for every statistic except
+ * the hours wet.
+ *
+ * The running values are kept as one array per statistic (rather than one struct per Node),
+ * so that AddTimestep() can update four Nodes at a time with SSE2 when it is available, and
+ * the Nodes are split across threads (see ParallelFor()). AddFile() reduces a whole output
+ * file in parallel over its timesteps instead: each thread keeps its own running values for
+ * a contiguous range of timesteps, and the ranges are merged in order once they are done
+ * (see Merge()).
+ *
+ * Hours wet is the number of wet timesteps times the mean output interval, so it assumes
+ * evenly spaced output, as ADCIRC writes it. Means are accumulated in single precision.
+ *
+ * The results can be drawn as maps with a ScalarLayer.
+ *
+ */
+class OutputStatistics
+{
+	public:
+
+		/**
+		 * @brief The statistics kept for every Node
+		 */
+		enum Statistic {
+			MaxValue,	/**< The largest wet value */
+			MinValue,	/**< The smallest wet value */
+			MeanValue,	/**< The mean of the wet values */
+			TimeOfMax,	/**< The model time of the first timestep with the largest value, in seconds */
+			HoursWet	/**< The time the Node was wet, in hours */
+		};
+
+		OutputStatistics();
+
+		void		Reset(unsigned int newNumNodes);
+		int		AddTimestep(const float *values, double time);
+		int		AddFile(GlobalOutputFile *file);
+		int		Merge(OutputStatistics *other);
+		int		GetStatistic(Statistic statistic, float *values);
+
+		// Getter Methods
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumTimesteps();
+
+	protected:
+
+		unsigned int			numNodes;	/**< The number of Nodes in each timestep */
+		std::vector<double>		times;		/**< The model time of every timestep added, in seconds */
+		std::vector<float>		maxValues;	/**< The largest wet value of every Node */
+		std::vector<float>		minValues;	/**< The smallest wet value of every Node */
+		std::vector<float>		sums;		/**< The sum of the wet values of every Node */
+		std::vector<unsigned int>	maxTimesteps;	/**< The timestep of the largest wet value of every Node */
+		std::vector<unsigned int>	wetCounts;	/**< The number of wet timesteps of every Node */
+
+		// Protected Functions
+		void	Accumulate(const float *values, unsigned int timestep, size_t first, size_t last);
+};
+
+#endif // OUTPUTSTATISTICS_H
@@ -0,0 +1,355 @@
+#include "QuantizedTimestepStore.h"
+#include "TraceWriter.h"
+#include "../Threading/ParallelFor.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * @brief Returns the position of the lowest set bit in a non-zero word
+ * @param word The word to search
+ * @return The position of the lowest set bit (0 - 31)
+ */
+static inline unsigned int LowestBit(unsigned int word)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(word);
+#else
+	unsigned int bit = 0;
+	while (!((word >> bit) & 1))
+		bit++;
+	return bit;
+#endif
+}
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+QuantizedTimestepStore::QuantizedTimestepStore()
+{
+	numNodes = 0;
+	maxError = 0.0;
+}
+
+
+/**
+ * @brief Removes every timestep and sets the number of Nodes, every timestep added from
+ * now on is stored in 16 bits
+ * @param newNumNodes The number of Nodes in each timestep
+ */
+void QuantizedTimestepStore::Reset(unsigned int newNumNodes)
+{
+	Reset(newNumNodes, 0.0);
+}
+
+
+/**
+ * @brief Removes every timestep and sets the number of Nodes, every timestep added from
+ * now on is stored in 8 bits if its error stays within a bound, and in 16 bits otherwise
+ * @param newNumNodes The number of Nodes in each timestep
+ * @param newMaxError The largest error allowed for a timestep to be stored in 8 bits
+ * (eg. 0.01 for 1 cm of water level), or 0 to always use 16 bits
+ */
+void QuantizedTimestepStore::Reset(unsigned int newNumNodes, float newMaxError)
+{
+	numNodes = newNumNodes;
+	maxError = newMaxError > 0.0 ? newMaxError : 0.0;
+	timesteps.clear();
+}
+
+
+/**
+ * @brief Reads and stores every timestep of an output file
+ *
+ * The number of Nodes must match the file (see Reset()). Timesteps are read and quantized
+ * in parallel. For files with more than one value per Node (eg. fort.64) the magnitude
+ * of each vector is stored.
+ *
+ * @param file A pointer to an open GlobalOutputFile
+ * @return 0 if every timestep was stored successfully
+ * @return 1 if the file is not open, does not match the store, or a timestep could not be read
+ */
+int QuantizedTimestepStore::Load(GlobalOutputFile *file)
+{
+	if (file == 0 || !file->IsOpen() || file->GetNumNodes() != numNodes)
+		return 1;
+
+	TRACE_SCOPE("io", "Quantize timesteps");
+	const size_t FirstTimestep = timesteps.size();
+	const unsigned int NumTimesteps = file->GetNumTimesteps();
+	const bool Vector = file->GetNumValues() > 1;
+	timesteps.resize(FirstTimestep + NumTimesteps);
+	std::vector<int> results (NumTimesteps, 0);
+
+	ParallelFor(NumTimesteps, 1, [&](size_t first, size_t last)
+	{
+		std::vector<float> u (numNodes), v (Vector ? numNodes : 0);
+		for (size_t t=first; t<last; t++)
+		{
+			if (Vector)
+				results[t] = file->ReadTimestep(t, &u[0], &v[0], &u[0]);
+			else
+				results[t] = file->ReadTimestep(t, &u[0]);
+			if (results[t] == 0)
+				Encode(&u[0], &timesteps[FirstTimestep+t]);
+		}
+	});
+
+	for (unsigned int t=0; t<NumTimesteps; t++)
+	{
+		if (results[t] != 0)
+		{
+			DEBUG("Unable to read timestep %u into the quantized store\n", t);
+			timesteps.resize(FirstTimestep);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Quantizes and stores a timestep after the last one
+ * @param values A pointer to an array of GetNumNodes() floats, with -99999 for dry Nodes
+ * @return 0 if the timestep was stored successfully
+ * @return 1 if no array was given
+ */
+int QuantizedTimestepStore::AddTimestep(const float *values)
+{
+	if (values == 0)
+		return 1;
+
+	timesteps.push_back(QuantizedTimestep());
+	Encode(values, &timesteps.back());
+	return 0;
+}
+
+
+/**
+ * @brief Converts a stored timestep back to floats
+ *
+ * Dry Nodes are written as -99999. The Nodes are split into blocks that are decoded on
+ * separate threads.
+ *
+ * @param timestep The index of the timestep
+ * @param values A pointer to an array of at least GetNumNodes() floats (eg. a mapped buffer)
+ * @return 0 if the timestep was decoded successfully
+ * @return 1 if the timestep has not been stored
+ */
+int QuantizedTimestepStore::DecodeTimestep(unsigned int timestep, float *values)
+{
+	if (timestep >= timesteps.size() || values == 0)
+		return 1;
+
+	TRACE_SCOPE("io", "Decode timestep");
+	const QuantizedTimestep *Timestep = &timesteps[timestep];
+	ParallelFor(numNodes, 1 << 18, [this, Timestep, values](size_t first, size_t last)
+	{
+		Decode(Timestep, first, last, values);
+	});
+	return 0;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in each timestep
+ * @return The number of Nodes
+ */
+unsigned int QuantizedTimestepStore::GetNumNodes()
+{
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of stored timesteps
+ * @return The number of timesteps
+ */
+unsigned int QuantizedTimestepStore::GetNumTimesteps()
+{
+	return timesteps.size();
+}
+
+
+/**
+ * @brief Returns the size of each value of a timestep
+ * @param timestep The index of the timestep
+ * @return 8 or 16, or 0 if the timestep has not been stored
+ */
+unsigned int QuantizedTimestepStore::GetBitsPerValue(unsigned int timestep)
+{
+	return timestep < timesteps.size() ? timesteps[timestep].bits : 0;
+}
+
+
+/**
+ * @brief Returns the number of dry Nodes in a timestep
+ * @param timestep The index of the timestep
+ * @return The number of Nodes stored as -99999
+ */
+unsigned int QuantizedTimestepStore::GetNumDry(unsigned int timestep)
+{
+	return timestep < timesteps.size() ? timesteps[timestep].numDry : 0;
+}
+
+
+/**
+ * @brief Returns the largest difference between a value of a timestep and its decoded value
+ * @param timestep The index of the timestep
+ * @return Half the difference between two consecutive quantized values
+ */
+float QuantizedTimestepStore::GetMaxError(unsigned int timestep)
+{
+	return timestep < timesteps.size() ? 0.5*timesteps[timestep].scale : 0.0;
+}
+
+
+/**
+ * @brief Returns the memory used by the stored timesteps
+ * @return The size of every quantized array and dry Node mask in bytes
+ */
+size_t QuantizedTimestepStore::GetMemorySize()
+{
+	size_t size = 0;
+	for (unsigned int i=0; i<timesteps.size(); i++)
+		size += sizeof(QuantizedTimestep) +
+			timesteps[i].codes8.size()*sizeof(unsigned char) +
+			timesteps[i].codes16.size()*sizeof(unsigned short) +
+			timesteps[i].dryMask.size()*sizeof(unsigned int);
+	return size;
+}
+
+
+/**
+ * @brief Quantizes the values of one timestep
+ *
+ * The range is taken from the wet Nodes only. The timestep is stored in 8 bits if that
+ * keeps its error within maxError, and in 16 bits otherwise. Dry Nodes are stored as 0 and
+ * marked in the dry Node mask.
+ *
+ * @param values The value of every Node
+ * @param timestep The timestep that receives the quantized values
+ */
+void QuantizedTimestepStore::Encode(const float *values, QuantizedTimestep *timestep)
+{
+	const float Dry = -99999.0;
+	float minValue = 0.0, maxValue = 0.0;
+	unsigned int numDry = 0;
+	bool first = true;
+	for (unsigned int i=0; i<numNodes; i++)
+	{
+		if (values[i] == Dry || values[i] != values[i])
+		{
+			numDry++;
+		}
+		else if (first)
+		{
+			minValue = maxValue = values[i];
+			first = false;
+		} else {
+			minValue = values[i] < minValue ? values[i] : minValue;
+			maxValue = values[i] > maxValue ? values[i] : maxValue;
+		}
+	}
+
+	const float Range = maxValue - minValue;
+	timestep->bits = (maxError > 0.0 && 0.5*Range/255.0 <= maxError) ? 8 : 16;
+	const unsigned int MaxCode = timestep->bits == 8 ? 255 : 65535;
+	timestep->minValue = minValue;
+	timestep->scale = Range/MaxCode;
+	timestep->numDry = numDry;
+	timestep->codes8.assign(timestep->bits == 8 ? numNodes : 0, 0);
+	timestep->codes16.assign(timestep->bits == 16 ? numNodes : 0, 0);
+	timestep->dryMask.assign(numDry > 0 ? (numNodes+31)/32 : 0, 0);
+
+	const float InverseScale = Range > 0.0 ? MaxCode/Range : 0.0;
+	for (unsigned int i=0; i<numNodes; i++)
+	{
+		unsigned int code = 0;
+		if (values[i] == Dry || values[i] != values[i])
+		{
+			timestep->dryMask[i/32] |= 1u << (i%32);
+		} else {
+			code = (unsigned int)((values[i] - minValue)*InverseScale + 0.5f);
+			code = code > MaxCode ? MaxCode : code;
+		}
+		if (timestep->bits == 8)
+			timestep->codes8[i] = code;
+		else
+			timestep->codes16[i] = code;
+	}
+}
+
+
+/**
+ * @brief Converts a range of Nodes of a quantized timestep back to floats
+ *
+ * Sixteen (8 bit) or eight (16 bit) Nodes are converted at a time with SSE2 when it is
+ * available. Dry Nodes are then overwritten with -99999, skipping every group of 32 Nodes
+ * that has none.
+ *
+ * @param timestep The quantized timestep
+ * @param first The first Node of the range
+ * @param last The Node after the last one of the range
+ * @param values The array that receives the value of every Node
+ */
+void QuantizedTimestepStore::Decode(const QuantizedTimestep *timestep, size_t first, size_t last, float *values)
+{
+	const float MinValue = timestep->minValue;
+	const float Scale = timestep->scale;
+	size_t i = first;
+	if (timestep->bits == 8)
+	{
+		const unsigned char *codes = &timestep->codes8[0];
+#ifdef __SSE2__
+		const __m128 MinVec = _mm_set1_ps(MinValue);
+		const __m128 ScaleVec = _mm_set1_ps(Scale);
+		const __m128i Zero = _mm_setzero_si128();
+		for (; i+16<=last; i+=16)
+		{
+			const __m128i Codes = _mm_loadu_si128((const __m128i*)(codes+i));
+			const __m128i Low = _mm_unpacklo_epi8(Codes, Zero);
+			const __m128i High = _mm_unpackhi_epi8(Codes, Zero);
+			_mm_storeu_ps(values+i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(Low, Zero)), ScaleVec), MinVec));
+			_mm_storeu_ps(values+i+4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(Low, Zero)), ScaleVec), MinVec));
+			_mm_storeu_ps(values+i+8, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(High, Zero)), ScaleVec), MinVec));
+			_mm_storeu_ps(values+i+12, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(High, Zero)), ScaleVec), MinVec));
+		}
+#endif
+		for (; i<last; i++)
+			values[i] = MinValue + codes[i]*Scale;
+	} else {
+		const unsigned short *codes = &timestep->codes16[0];
+#ifdef __SSE2__
+		const __m128 MinVec = _mm_set1_ps(MinValue);
+		const __m128 ScaleVec = _mm_set1_ps(Scale);
+		const __m128i Zero = _mm_setzero_si128();
+		for (; i+8<=last; i+=8)
+		{
+			const __m128i Codes = _mm_loadu_si128((const __m128i*)(codes+i));
+			_mm_storeu_ps(values+i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(Codes, Zero)), ScaleVec), MinVec));
+			_mm_storeu_ps(values+i+4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(Codes, Zero)), ScaleVec), MinVec));
+		}
+#endif
+		for (; i<last; i++)
+			values[i] = MinValue + codes[i]*Scale;
+	}
+
+	if (timestep->numDry == 0)
+		return;
+	const float Dry = -99999.0;
+	for (size_t word=first/32; word*32<last; word++)
+	{
+		unsigned int bits = timestep->dryMask[word];
+		while (bits != 0)
+		{
+			const size_t Node = word*32 + LowestBit(bits);
+			bits &= bits - 1;
+			if (Node >= first && Node < last)
+				values[Node] = Dry;
+		}
+	}
+}
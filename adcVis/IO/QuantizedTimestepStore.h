@@ -0,0 +1,77 @@
+#ifndef QUANTIZEDTIMESTEPSTORE_H
+#define QUANTIZEDTIMESTEPSTORE_H
+
+#include "adcData.h"
+#include "GlobalOutputFile.h"
+
+#include <vector>
+
+
+/**
+ * @brief Keeps every timestep of a run in memory as 8 or 16 bit integers, so that any
+ * timestep can be shown without touching the file
+ *
+ * Each timestep is quantized separately, relative to the smallest and largest value of its
+ * wet Nodes: a value v is stored as the integer round((v - min)/scale), where scale is
+ * (max - min)/255 or (max - min)/65535. Decoding a value is then a single multiply and add,
+ * and the error of any decoded value is at most scale/2 (see GetMaxError()).
+ *
+ * Dry Nodes (value -99999) are not quantized. They are kept in a bitset with one bit per
+ * Node, which is only allocated for timesteps that have dry Nodes, and are written back as
+ * -99999 when the timestep is decoded.
+ *
+ * A store made with Reset(numNodes) keeps every timestep in 16 bits. A store made with
+ * Reset(numNodes, maxError) keeps a timestep in 8 bits when that keeps its error within
+ * maxError, and in 16 bits otherwise. At 16 bits, 500 timesteps of 3M Nodes take 3 GB
+ * instead of the 6 GB they would take as floats, and half that at 8 bits.
+ *
+ * DecodeTimestep() converts a timestep back to floats (eg. straight into a mapped upload
+ * buffer) with SSE2 when it is available, eight or sixteen Nodes at a time, and splits the
+ * Nodes across threads (see ParallelFor()).
+ *
+ */
+class QuantizedTimestepStore
+{
+	public:
+
+		QuantizedTimestepStore();
+
+		void		Reset(unsigned int newNumNodes);
+		void		Reset(unsigned int newNumNodes, float newMaxError);
+		int		Load(GlobalOutputFile *file);
+		int		AddTimestep(const float *values);
+		int		DecodeTimestep(unsigned int timestep, float *values);
+
+		// Getter Methods
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumTimesteps();
+		unsigned int	GetBitsPerValue(unsigned int timestep);
+		unsigned int	GetNumDry(unsigned int timestep);
+		float		GetMaxError(unsigned int timestep);
+		size_t		GetMemorySize();
+
+	protected:
+
+		/**
+		 * @brief One quantized timestep
+		 */
+		struct QuantizedTimestep {
+				float				minValue;	/**< The value of the integer 0 */
+				float				scale;		/**< The difference in value between two consecutive integers */
+				unsigned int			bits;		/**< 8 or 16 */
+				unsigned int			numDry;		/**< The number of dry Nodes */
+				std::vector<unsigned char>	codes8;		/**< The integer of every Node if bits is 8 */
+				std::vector<unsigned short>	codes16;	/**< The integer of every Node if bits is 16 */
+				std::vector<unsigned int>	dryMask;	/**< One bit per Node, set for dry Nodes (empty if numDry is 0) */
+		};
+
+		unsigned int			numNodes;	/**< The number of Nodes in each timestep */
+		float				maxError;	/**< The largest error allowed for 8 bit timesteps, or 0 to always use 16 bits */
+		std::vector<QuantizedTimestep>	timesteps;	/**< Every stored timestep */
+
+		// Protected Functions
+		void	Encode(const float *values, QuantizedTimestep *timestep);
+		void	Decode(const QuantizedTimestep *timestep, size_t first, size_t last, float *values);
+};
+
+#endif // QUANTIZEDTIMESTEPSTORE_H
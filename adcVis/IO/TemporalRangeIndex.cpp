@@ -0,0 +1,374 @@
+#include "TemporalRangeIndex.h"
+#include "TraceWriter.h"
+#include "../Threading/ParallelFor.h"
+
+#include <float.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+// The value of dry Nodes in output files
+static const float Dry = -99999.0;
+
+// The smallest number of Nodes worth giving to a thread when combining levels
+static const size_t NodesPerThread = 1 << 18;
+
+// The number of timesteps in each block of the first level of the pyramid. Smaller windows,
+// and the ends of larger ones, are combined from the timesteps themselves.
+static const unsigned int FirstBlockSize = 8;
+
+
+/**
+ * @brief Sets each value of a range to the larger of two arrays
+ */
+static void CombineMax(float *values, const float *other, size_t first, size_t last)
+{
+	size_t i = first;
+#ifdef __SSE__
+	for (; i+4<=last; i+=4)
+		_mm_storeu_ps(values+i, _mm_max_ps(_mm_loadu_ps(values+i), _mm_loadu_ps(other+i)));
+#endif
+	for (; i<last; i++)
+		values[i] = other[i] > values[i] ? other[i] : values[i];
+}
+
+
+/**
+ * @brief Sets each value of a range to the smaller of two arrays
+ */
+static void CombineMin(float *values, const float *other, size_t first, size_t last)
+{
+	size_t i = first;
+#ifdef __SSE__
+	for (; i+4<=last; i+=4)
+		_mm_storeu_ps(values+i, _mm_min_ps(_mm_loadu_ps(values+i), _mm_loadu_ps(other+i)));
+#endif
+	for (; i<last; i++)
+		values[i] = other[i] < values[i] ? other[i] : values[i];
+}
+
+
+/**
+ * @brief Sets each value of a range to the smaller of itself and a timestep, skipping dry
+ * Nodes of the timestep
+ */
+static void CombineMinWet(float *values, const float *timestep, size_t first, size_t last)
+{
+	size_t i = first;
+#ifdef __SSE__
+	const __m128 DryVec = _mm_set1_ps(Dry);
+	for (; i+4<=last; i+=4)
+	{
+		const __m128 V = _mm_loadu_ps(timestep+i);
+		const __m128 Min = _mm_loadu_ps(values+i);
+		const __m128 IsDry = _mm_cmpeq_ps(V, DryVec);
+		_mm_storeu_ps(values+i, _mm_or_ps(_mm_and_ps(IsDry, Min), _mm_andnot_ps(IsDry, _mm_min_ps(Min, V))));
+	}
+#endif
+	for (; i<last; i++)
+		values[i] = timestep[i] != Dry && timestep[i] < values[i] ? timestep[i] : values[i];
+}
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+TemporalRangeIndex::TemporalRangeIndex()
+{
+	numNodes = 0;
+	numTimesteps = 0;
+}
+
+
+/**
+ * @brief Removes every timestep and sets the number of Nodes
+ * @param newNumNodes The number of Nodes in each timestep
+ */
+void TemporalRangeIndex::Reset(unsigned int newNumNodes)
+{
+	Reset(newNumNodes, 0);
+}
+
+
+/**
+ * @brief Removes every timestep, sets the number of Nodes, and reserves memory for the
+ * number of timesteps that will be added, so that the levels are not copied as they grow
+ * @param newNumNodes The number of Nodes in each timestep
+ * @param expectedTimesteps The number of timesteps that will be added
+ */
+void TemporalRangeIndex::Reset(unsigned int newNumNodes, unsigned int expectedTimesteps)
+{
+	numNodes = newNumNodes;
+	numTimesteps = 0;
+	timesteps.clear();
+	timesteps.reserve((size_t)expectedTimesteps*numNodes);
+	maxLevels.clear();
+	minLevels.clear();
+	for (unsigned int level=0; (FirstBlockSize << level) <= expectedTimesteps; level++)
+	{
+		maxLevels.push_back(std::vector<float>());
+		minLevels.push_back(std::vector<float>());
+		maxLevels.back().reserve((size_t)(expectedTimesteps/(FirstBlockSize << level))*numNodes);
+		minLevels.back().reserve((size_t)(expectedTimesteps/(FirstBlockSize << level))*numNodes);
+	}
+}
+
+
+/**
+ * @brief Adds the timestep that follows the ones already added
+ *
+ * The timestep is stored, and every block of the pyramid that ends with it is completed:
+ * a block of the first level from its FirstBlockSize timesteps, and a block of a higher
+ * level from the two blocks below it.
+ *
+ * @param values The value of every Node, with -99999 for dry Nodes
+ * @return 0 if the timestep was added successfully
+ * @return 1 if no values were given
+ */
+int TemporalRangeIndex::AddTimestep(const float *values)
+{
+	if (values == 0 || numNodes == 0)
+		return 1;
+
+	// Values that are not a number are stored as dry
+	const size_t Start = (size_t)numTimesteps*numNodes;
+	timesteps.resize(Start + numNodes);
+	float *data = &timesteps[Start];
+	for (unsigned int i=0; i<numNodes; i++)
+		data[i] = values[i] != values[i] ? Dry : values[i];
+	numTimesteps++;
+
+	if (numTimesteps % FirstBlockSize != 0)
+		return 0;
+
+	if (maxLevels.empty())
+	{
+		maxLevels.resize(1);
+		minLevels.resize(1);
+	}
+
+	// Dry Nodes never win: -99999 is below every value, and minima start at FLT_MAX
+	const size_t Block = numTimesteps/FirstBlockSize - 1;
+	const float *first = &timesteps[Block*FirstBlockSize*numNodes];
+	maxLevels[0].insert(maxLevels[0].end(), first, first + numNodes);
+	minLevels[0].resize((Block+1)*numNodes, FLT_MAX);
+	float *maxBlock = &maxLevels[0][Block*numNodes];
+	float *minBlock = &minLevels[0][Block*numNodes];
+	ParallelFor(numNodes, NodesPerThread, [=](size_t firstNode, size_t lastNode)
+	{
+		CombineMinWet(minBlock, first, firstNode, lastNode);
+		for (unsigned int t=1; t<FirstBlockSize; t++)
+		{
+			CombineMax(maxBlock, first + t*numNodes, firstNode, lastNode);
+			CombineMinWet(minBlock, first + t*numNodes, firstNode, lastNode);
+		}
+	});
+
+	for (unsigned int level=1; numTimesteps % (FirstBlockSize << level) == 0; level++)
+	{
+		if (maxLevels.size() <= level)
+		{
+			maxLevels.resize(level+1);
+			minLevels.resize(level+1);
+		}
+
+		const size_t Block = numTimesteps/(FirstBlockSize << level) - 1;
+		const float *maxChildren = &maxLevels[level-1][2*Block*numNodes];
+		const float *minChildren = &minLevels[level-1][2*Block*numNodes];
+		maxLevels[level].insert(maxLevels[level].end(), maxChildren, maxChildren + numNodes);
+		minLevels[level].insert(minLevels[level].end(), minChildren, minChildren + numNodes);
+		float *maxBlock = &maxLevels[level][Block*numNodes];
+		float *minBlock = &minLevels[level][Block*numNodes];
+		ParallelFor(numNodes, NodesPerThread, [=](size_t first, size_t last)
+		{
+			CombineMax(maxBlock, maxChildren + numNodes, first, last);
+			CombineMin(minBlock, minChildren + numNodes, first, last);
+		});
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Adds every timestep of an output file after the ones already added
+ *
+ * Timesteps are read in batches of one per thread, in parallel, and added in order. For
+ * files with more than one value per Node (eg. fort.64) the magnitude of each vector is
+ * indexed.
+ *
+ * @param file A pointer to an open GlobalOutputFile with the same number of Nodes
+ * @return 0 if every timestep was added successfully
+ * @return 1 if the file does not match or a timestep could not be read
+ */
+int TemporalRangeIndex::AddFile(GlobalOutputFile *file)
+{
+	if (file == 0 || !file->IsOpen() || file->GetNumNodes() != numNodes)
+		return 1;
+
+	TRACE_SCOPE("io", "Build temporal range index");
+	const unsigned int NumTimesteps = file->GetNumTimesteps();
+	const bool Vector = file->GetNumValues() > 1;
+	const unsigned int BatchSize = GetNumThreads();
+	std::vector<float> batch ((size_t)BatchSize*numNodes);
+	std::vector<int> results (BatchSize);
+	for (unsigned int firstTimestep=0; firstTimestep<NumTimesteps; firstTimestep+=BatchSize)
+	{
+		const unsigned int Rows = firstTimestep + BatchSize <= NumTimesteps ? BatchSize : NumTimesteps - firstTimestep;
+		ParallelFor(Rows, 1, [&](size_t first, size_t last)
+		{
+			std::vector<float> v (Vector ? numNodes : 0);
+			for (size_t r=first; r<last; r++)
+			{
+				float *row = &batch[r*numNodes];
+				if (Vector)
+					results[r] = file->ReadTimestep(firstTimestep+r, row, &v[0], row);
+				else
+					results[r] = file->ReadTimestep(firstTimestep+r, row);
+			}
+		});
+
+		for (unsigned int r=0; r<Rows; r++)
+			if (results[r] != 0 || AddTimestep(&batch[(size_t)r*numNodes]) != 0)
+				return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Finds the largest value of every Node over a window of timesteps
+ * @param firstTimestep The index of the first timestep of the window
+ * @param lastTimestep The index of the last timestep of the window
+ * @param values A pointer to an array of at least GetNumNodes() floats, with -99999 for Nodes
+ * that are dry for the whole window
+ * @return 0 if the window was queried successfully
+ * @return 1 if the window has not been added
+ */
+int TemporalRangeIndex::GetMax(unsigned int firstTimestep, unsigned int lastTimestep, float *values)
+{
+	return Query(&maxLevels, true, firstTimestep, lastTimestep, values);
+}
+
+
+/**
+ * @brief Finds the smallest value of every Node over a window of timesteps
+ * @param firstTimestep The index of the first timestep of the window
+ * @param lastTimestep The index of the last timestep of the window
+ * @param values A pointer to an array of at least GetNumNodes() floats, with -99999 for Nodes
+ * that are dry for the whole window
+ * @return 0 if the window was queried successfully
+ * @return 1 if the window has not been added
+ */
+int TemporalRangeIndex::GetMin(unsigned int firstTimestep, unsigned int lastTimestep, float *values)
+{
+	return Query(&minLevels, false, firstTimestep, lastTimestep, values);
+}
+
+
+/**
+ * @brief Returns the number of Nodes in each timestep
+ * @return The number of Nodes
+ */
+unsigned int TemporalRangeIndex::GetNumNodes()
+{
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of timesteps added so far
+ * @return The number of timesteps
+ */
+unsigned int TemporalRangeIndex::GetNumTimesteps()
+{
+	return numTimesteps;
+}
+
+
+/**
+ * @brief Returns the number of levels of the pyramid
+ * @return The number of levels of blocks, not counting the timesteps themselves
+ */
+unsigned int TemporalRangeIndex::GetNumLevels()
+{
+	return maxLevels.size();
+}
+
+
+/**
+ * @brief Returns the memory used by the index
+ * @return The size of every level in bytes
+ */
+size_t TemporalRangeIndex::GetMemorySize()
+{
+	size_t size = timesteps.size()*sizeof(float);
+	for (unsigned int level=0; level<maxLevels.size(); level++)
+		size += (maxLevels[level].size() + minLevels[level].size())*sizeof(float);
+	return size;
+}
+
+
+/**
+ * @brief Combines the blocks of one pyramid that cover a window of timesteps
+ *
+ * The window is walked from its first timestep, taking the largest aligned block that
+ * starts there and fits in the rest of the window each time, which is at most two blocks
+ * per level. Where no block of the first level fits, at the ends of the window, single
+ * timesteps are taken instead.
+ *
+ * @param levels The pyramid of maxima or minima
+ * @param max true to combine with the largest value, false for the smallest
+ * @param firstTimestep The index of the first timestep of the window
+ * @param lastTimestep The index of the last timestep of the window
+ * @param values The array that receives the value of every Node
+ * @return 0 if the window was queried successfully
+ * @return 1 if the window has not been added
+ */
+int TemporalRangeIndex::Query(std::vector< std::vector<float> > *levels, bool max, unsigned int firstTimestep, unsigned int lastTimestep, float *values)
+{
+	if (values == 0 || firstTimestep > lastTimestep || lastTimestep >= numTimesteps)
+		return 1;
+
+	std::vector<const float*> blocks, rows;
+	for (unsigned int start=firstTimestep, end=lastTimestep+1; start<end;)
+	{
+		if (levels->empty() || start % FirstBlockSize != 0 || start + FirstBlockSize > end)
+		{
+			rows.push_back(&timesteps[(size_t)start*numNodes]);
+			start++;
+			continue;
+		}
+
+		unsigned int level = 0;
+		while (level+1 < levels->size() && start % (FirstBlockSize << (level+1)) == 0 && start + (FirstBlockSize << (level+1)) <= end)
+			level++;
+		blocks.push_back(&(*levels)[level][(size_t)(start/(FirstBlockSize << level))*numNodes]);
+		start += FirstBlockSize << level;
+	}
+
+	ParallelFor(numNodes, NodesPerThread, [&](size_t first, size_t last)
+	{
+		for (size_t i=first; i<last; i++)
+			values[i] = max ? Dry : FLT_MAX;
+		for (unsigned int b=0; b<blocks.size(); b++)
+		{
+			if (max)
+				CombineMax(values, blocks[b], first, last);
+			else
+				CombineMin(values, blocks[b], first, last);
+		}
+		for (unsigned int r=0; r<rows.size(); r++)
+		{
+			if (max)
+				CombineMax(values, rows[r], first, last);
+			else
+				CombineMinWet(values, rows[r], first, last);
+		}
+		if (!max)
+			for (size_t i=first; i<last; i++)
+				values[i] = values[i] == FLT_MAX ? Dry : values[i];
+	});
+	return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef TEMPORALRANGEINDEX_H
+#define TEMPORALRANGEINDEX_H
+
+#include "adcData.h"
+#include "GlobalOutputFile.h"
+
+#include <vector>
+
+
+/**
+ * @brief Answers "largest (or smallest) value of every Node between two timesteps" for any
+ * window of timesteps, without going back to the output file
+ *
+ * The index keeps every timestep, and a pyramid over time above them: level 0 holds the
+ * largest and smallest value of every Node over each aligned block of 8 timesteps, and
+ * level k over each aligned block of 8*2^k timesteps. Any window of timesteps is covered
+ * by at most two blocks per level plus up to 7 timesteps at each end (see GetMax()), so a
+ * query combines O(log T) arrays instead of T timesteps. Each entry holds every Node one
+ * after another, so combining two entries is a single pass over two arrays, done four
+ * Nodes at a time with SSE when it is available and split across threads (see
+ * ParallelFor()).
+ *
+ * The pyramid is built as timesteps come in: AddTimestep() stores the timestep and
+ * completes every block that ends with it, so the index can be queried at any point
+ * while a run is being read (eg. for the timesteps written so far by a running model). A
+ * full sparse table would answer queries with two entries instead of O(log T), but needs
+ * log T entries per timestep.
+ *
+ * Memory use is 4 bytes per Node for each timestep, and another 2 bytes for the pyramid
+ * (8 bytes per block of 8 timesteps at level 0, and as much again for the higher levels),
+ * so 1M Nodes and 500 timesteps take about 3 GB, one and a half times the size of the
+ * values themselves.
+ *
+ * Dry values (-99999) never win: a Node that is dry for the whole window gets -99999. The
+ * results can be passed straight to ScalarLayer::SetValues() to color a map of the window.
+ *
+ */
+class TemporalRangeIndex
+{
+	public:
+
+		TemporalRangeIndex();
+
+		void		Reset(unsigned int newNumNodes);
+		void		Reset(unsigned int newNumNodes, unsigned int expectedTimesteps);
+		int		AddTimestep(const float *values);
+		int		AddFile(GlobalOutputFile *file);
+		int		GetMax(unsigned int firstTimestep, unsigned int lastTimestep, float *values);
+		int		GetMin(unsigned int firstTimestep, unsigned int lastTimestep, float *values);
+
+		// Getter Methods
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumTimesteps();
+		unsigned int	GetNumLevels();
+		size_t		GetMemorySize();
+
+	protected:
+
+		unsigned int			numNodes;	/**< The number of Nodes in each timestep */
+		unsigned int			numTimesteps;	/**< The number of timesteps added */
+		std::vector<float>		timesteps;	/**< The value of every Node in each timestep, with -99999 for dry Nodes [timestep][node] */
+		std::vector< std::vector<float> >	maxLevels;	/**< For every level, the largest value of every Node in each block [block][node] */
+		std::vector< std::vector<float> >	minLevels;	/**< For every level, the smallest value of every Node in each block [block][node] */
+
+		// Protected Functions
+		int	Query(std::vector< std::vector<float> > *levels, bool max, unsigned int firstTimestep, unsigned int lastTimestep, float *values);
+};
+
+#endif // TEMPORALRANGEINDEX_H
@@ -0,0 +1,415 @@
+#include "TimeSeriesCache.h"
+#include "TraceWriter.h"
+#include "../Threading/ParallelFor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+
+
+// The first bytes of every time series cache
+static const char FileMagic[8] = {'A', 'D', 'C', 'T', 'S', 'E', 'R', '1'};
+
+// The version of the file layout
+static const unsigned int FileVersion = 1;
+
+// The number of Nodes in each block
+static const unsigned int NodesPerBlock = 4096;
+
+
+/**
+ * @brief The first bytes of a time series cache, written to and read from the file as is
+ */
+struct TimeSeriesHeader {
+		char		magic[8];		/**< Always FileMagic */
+		unsigned int	version;		/**< The version of the file layout */
+		unsigned int	numNodes;		/**< The number of Nodes */
+		unsigned int	numTimesteps;		/**< The number of timesteps */
+		unsigned int	nodesPerBlock;		/**< The number of Nodes in each block (the last block may have fewer) */
+		unsigned int	timestepsPerTile;	/**< The number of timesteps in each tile (the last tile may have fewer) */
+		unsigned int	complete;		/**< 1 once every block has been written */
+};
+
+
+/**
+ * @brief Returns the position of the first value of a tile in a time series cache
+ * @param header The header of the file
+ * @param block The index of the block of Nodes
+ * @param tile The index of the tile of timesteps
+ * @return The position in bytes
+ */
+static unsigned long long GetTileOffset(const TimeSeriesHeader *header, unsigned int block, unsigned int tile)
+{
+	const unsigned long long First = block*(unsigned long long)header->nodesPerBlock;
+	const unsigned long long NodesInBlock = First + header->nodesPerBlock <= header->numNodes ? header->nodesPerBlock : header->numNodes - First;
+	return sizeof(TimeSeriesHeader) + header->numTimesteps*sizeof(double) +
+	       (First*header->numTimesteps + NodesInBlock*tile*header->timestepsPerTile)*sizeof(float);
+}
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+TimeSeriesCache::TimeSeriesCache()
+{
+	fileOpen = false;
+	numNodes = 0;
+	numTimesteps = 0;
+	nodesPerBlock = 0;
+	timestepsPerTile = 0;
+
+	converting = false;
+	cancelled = false;
+	convertedTimesteps = 0;
+	convertingTimesteps = 0;
+}
+
+
+/**
+ * @brief Deconstructor that cancels a running conversion
+ */
+TimeSeriesCache::~TimeSeriesCache()
+{
+	CancelConversion();
+}
+
+
+/**
+ * @brief Converts an output file into a time series cache
+ *
+ * The output file is read one tile of timesteps at a time, and each tile is transposed and
+ * written block by block. The file is only marked as complete once every tile has been
+ * written, so a cache from a conversion that failed or was cancelled is never opened.
+ *
+ * @param outputFile A pointer to an open GlobalOutputFile
+ * @param fileLoc The location of the cache to write
+ * @param memoryBudget The largest amount of memory used to hold values while converting,
+ * in bytes (at least one timestep is always held)
+ * @return 0 if the cache was written successfully
+ * @return 1 if an error occurred or the conversion was cancelled
+ */
+int TimeSeriesCache::Write(GlobalOutputFile *outputFile, std::string fileLoc, size_t memoryBudget)
+{
+	if (outputFile == 0 || !outputFile->IsOpen() || outputFile->GetNumNodes() == 0 || outputFile->GetNumTimesteps() == 0)
+		return 1;
+
+	TRACE_SCOPE("io", "Write time series cache");
+	const unsigned int NumNodes = outputFile->GetNumNodes();
+	const unsigned int NumTimesteps = outputFile->GetNumTimesteps();
+	const bool Vector = outputFile->GetNumValues() > 1;
+
+	// One tile of timesteps for every Node, and one transposed block, must fit in the budget
+	size_t tileTimesteps = memoryBudget/(((size_t)NumNodes + NodesPerBlock)*sizeof(float));
+	tileTimesteps = tileTimesteps < 1 ? 1 : tileTimesteps > NumTimesteps ? NumTimesteps : tileTimesteps;
+
+	TimeSeriesHeader header;
+	memcpy(header.magic, FileMagic, 8);
+	header.version = FileVersion;
+	header.numNodes = NumNodes;
+	header.numTimesteps = NumTimesteps;
+	header.nodesPerBlock = NodesPerBlock;
+	header.timestepsPerTile = tileTimesteps;
+	header.complete = 0;
+
+	std::vector<double> modelTimes (NumTimesteps);
+	for (unsigned int t=0; t<NumTimesteps; t++)
+		modelTimes[t] = outputFile->GetTimestepInfo(t)->time;
+
+	std::ofstream file (fileLoc.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		DEBUG("Unable to open time series cache %s for writing\n", fileLoc.data());
+		return 1;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&modelTimes[0], NumTimesteps*sizeof(double));
+
+	const unsigned int NumBlocks = (NumNodes + NodesPerBlock - 1)/NodesPerBlock;
+	const unsigned int NumTiles = (NumTimesteps + tileTimesteps - 1)/tileTimesteps;
+	std::vector<float> tileValues (tileTimesteps*NumNodes);
+	std::vector<float> blockValues (tileTimesteps*NodesPerBlock);
+	std::vector<int> results (tileTimesteps);
+	int result = 0;
+	for (unsigned int tile=0; tile<NumTiles && result == 0; tile++)
+	{
+		const unsigned int FirstTimestep = tile*tileTimesteps;
+		const unsigned int TileTimesteps = FirstTimestep + tileTimesteps <= NumTimesteps ? tileTimesteps : NumTimesteps - FirstTimestep;
+
+		// Read the timesteps of the tile, each into its own row
+		ParallelFor(TileTimesteps, 1, [&](size_t first, size_t last)
+		{
+			std::vector<float> v (Vector ? NumNodes : 0);
+			for (size_t t=first; t<last; t++)
+			{
+				float *row = &tileValues[t*NumNodes];
+				if (cancelled)
+					results[t] = 1;
+				else if (Vector)
+					results[t] = outputFile->ReadTimestep(FirstTimestep+t, row, &v[0], row);
+				else
+					results[t] = outputFile->ReadTimestep(FirstTimestep+t, row);
+			}
+		});
+		for (unsigned int t=0; t<TileTimesteps; t++)
+			result |= results[t];
+		if (result != 0)
+			break;
+
+		// Transpose and write the tile of every block
+		for (unsigned int block=0; block<NumBlocks; block++)
+		{
+			const unsigned int FirstNode = block*NodesPerBlock;
+			const unsigned int BlockNodes = FirstNode + NodesPerBlock <= NumNodes ? NodesPerBlock : NumNodes - FirstNode;
+			for (unsigned int j=0; j<BlockNodes; j++)
+				for (unsigned int t=0; t<TileTimesteps; t++)
+					blockValues[j*TileTimesteps + t] = tileValues[(size_t)t*NumNodes + FirstNode + j];
+			file.seekp(GetTileOffset(&header, block, tile));
+			file.write((const char*)&blockValues[0], (size_t)BlockNodes*TileTimesteps*sizeof(float));
+		}
+		if (!file.good())
+		{
+			DEBUG("Error writing time series cache %s\n", fileLoc.data());
+			result = 1;
+		}
+		convertedTimesteps = FirstTimestep + TileTimesteps;
+	}
+
+	if (result == 0)
+	{
+		header.complete = 1;
+		file.seekp(0);
+		file.write((const char*)&header, sizeof(header));
+		result = file.good() ? 0 : 1;
+	}
+	file.close();
+	if (result != 0)
+		remove(fileLoc.data());
+	return result;
+}
+
+
+/**
+ * @brief Runs Write() on a background thread, and opens the cache once it is done
+ *
+ * Any open cache is closed first. Use IsConverting() and GetProgress() to follow the
+ * conversion. The output file must stay open until the conversion has finished.
+ *
+ * @param outputFile A pointer to an open GlobalOutputFile
+ * @param fileLoc The location of the cache to write
+ * @param memoryBudget The largest amount of memory used to hold values while converting, in bytes
+ * @return 0 if the conversion was started
+ * @return 1 if the output file is not open
+ */
+int TimeSeriesCache::StartConversion(GlobalOutputFile *outputFile, std::string fileLoc, size_t memoryBudget)
+{
+	CancelConversion();
+	Close();
+	if (outputFile == 0 || !outputFile->IsOpen())
+		return 1;
+
+	cancelled = false;
+	converting = true;
+	convertedTimesteps = 0;
+	convertingTimesteps = outputFile->GetNumTimesteps();
+	converter = std::thread([this, outputFile, fileLoc, memoryBudget]()
+	{
+		TRACE_THREAD_NAME("Time series conversion");
+		if (Write(outputFile, fileLoc, memoryBudget) == 0)
+			Open(fileLoc);
+		converting = false;
+	});
+	return 0;
+}
+
+
+/**
+ * @brief Stops a running conversion and waits for its thread to exit
+ *
+ * The partly written cache is removed.
+ *
+ */
+void TimeSeriesCache::CancelConversion()
+{
+	cancelled = true;
+	if (converter.joinable())
+		converter.join();
+	cancelled = false;
+}
+
+
+/**
+ * @brief Opens a complete time series cache
+ * @param fileLoc The location of the cache
+ * @return 0 if the file was opened successfully
+ * @return 1 if the file is not a complete time series cache
+ */
+int TimeSeriesCache::Open(std::string fileLoc)
+{
+	std::ifstream file (fileLoc.data(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 1;
+
+	TimeSeriesHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file.good() || memcmp(header.magic, FileMagic, 8) != 0 || header.version != FileVersion ||
+	    header.complete != 1 || header.nodesPerBlock == 0 || header.timestepsPerTile == 0)
+	{
+		DEBUG("%s is not a complete time series cache\n", fileLoc.data());
+		return 1;
+	}
+
+	std::vector<double> modelTimes (header.numTimesteps);
+	if (header.numTimesteps > 0)
+		file.read((char*)&modelTimes[0], header.numTimesteps*sizeof(double));
+	file.seekg(0, std::ios::end);
+	const unsigned long long ExpectedSize = sizeof(TimeSeriesHeader) + header.numTimesteps*sizeof(double) +
+						(unsigned long long)header.numNodes*header.numTimesteps*sizeof(float);
+	if (file.fail() || (unsigned long long)file.tellg() < ExpectedSize)
+	{
+		DEBUG("Error reading time series cache %s\n", fileLoc.data());
+		return 1;
+	}
+
+	std::lock_guard<std::mutex> lock (mutex);
+	fileLocation = fileLoc;
+	numNodes = header.numNodes;
+	numTimesteps = header.numTimesteps;
+	nodesPerBlock = header.nodesPerBlock;
+	timestepsPerTile = header.timestepsPerTile;
+	times.swap(modelTimes);
+	fileOpen = true;
+	return 0;
+}
+
+
+/**
+ * @brief Closes the open cache
+ */
+void TimeSeriesCache::Close()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	fileOpen = false;
+	numNodes = 0;
+	numTimesteps = 0;
+	times.clear();
+}
+
+
+/**
+ * @brief Reads the value of one Node at every timestep
+ *
+ * The file is opened separately for every call, and the series is read with one
+ * contiguous read per tile of timesteps.
+ *
+ * @param nodeNumber The node number as defined in the fort.14 file
+ * @param values A pointer to an array of at least GetNumTimesteps() floats
+ * @return 0 if the series was read successfully
+ * @return 1 if no cache is open, the node number is invalid, or an error occurred
+ */
+int TimeSeriesCache::ReadSeries(unsigned int nodeNumber, float *values)
+{
+	TimeSeriesHeader header;
+	std::string fileLoc;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		if (!fileOpen || nodeNumber == 0 || nodeNumber > numNodes || values == 0)
+			return 1;
+		header.numNodes = numNodes;
+		header.numTimesteps = numTimesteps;
+		header.nodesPerBlock = nodesPerBlock;
+		header.timestepsPerTile = timestepsPerTile;
+		fileLoc = fileLocation;
+	}
+
+	std::ifstream file (fileLoc.data(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return 1;
+
+	const unsigned int Block = (nodeNumber-1)/header.nodesPerBlock;
+	const unsigned int Index = (nodeNumber-1)%header.nodesPerBlock;
+	for (unsigned int first=0, tile=0; first<header.numTimesteps; first+=header.timestepsPerTile, tile++)
+	{
+		const unsigned int TileTimesteps = first + header.timestepsPerTile <= header.numTimesteps ? header.timestepsPerTile : header.numTimesteps - first;
+		file.seekg(GetTileOffset(&header, Block, tile) + (unsigned long long)Index*TileTimesteps*sizeof(float));
+		file.read((char*)(values + first), TileTimesteps*sizeof(float));
+	}
+	return file.good() ? 0 : 1;
+}
+
+
+/**
+ * @brief Returns true if a complete cache has been opened
+ * @return true if a cache is open
+ */
+bool TimeSeriesCache::IsOpen()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return fileOpen;
+}
+
+
+/**
+ * @brief Returns true while a conversion started with StartConversion() is running
+ * @return true if a conversion is running
+ */
+bool TimeSeriesCache::IsConverting()
+{
+	return converting;
+}
+
+
+/**
+ * @brief Returns how far the running conversion has got
+ * @return The fraction of timesteps written (0.0 - 1.0), or 1.0 if no conversion is running
+ */
+float TimeSeriesCache::GetProgress()
+{
+	if (!converting || convertingTimesteps == 0)
+		return 1.0;
+	return (float)convertedTimesteps/convertingTimesteps;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in the open cache
+ * @return The number of Nodes
+ */
+unsigned int TimeSeriesCache::GetNumNodes()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return numNodes;
+}
+
+
+/**
+ * @brief Returns the number of timesteps in the open cache
+ * @return The number of values in each series
+ */
+unsigned int TimeSeriesCache::GetNumTimesteps()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return numTimesteps;
+}
+
+
+/**
+ * @brief Returns the number of timesteps in each tile of the open cache
+ * @return The number of contiguous reads per tile
+ */
+unsigned int TimeSeriesCache::GetTimestepsPerTile()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return timestepsPerTile;
+}
+
+
+/**
+ * @brief Returns the model time of a timestep
+ * @param timestep The index of the timestep
+ * @return The model time in seconds, or 0 if the timestep is not in the cache
+ */
+double TimeSeriesCache::GetTime(unsigned int timestep)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return timestep < times.size() ? times[timestep] : 0.0;
+}
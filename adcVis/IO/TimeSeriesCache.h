@@ -0,0 +1,87 @@
+#ifndef TIMESERIESCACHE_H
+#define TIMESERIESCACHE_H
+
+#include "adcData.h"
+#include "GlobalOutputFile.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+
+/**
+ * @brief Reads and writes a copy of an output file with the values ordered by Node, so
+ * that the full time series of one Node (eg. a hydrograph) can be read at once
+ *
+ * An output file stores every Node of one timestep before the next timestep, so the time
+ * series of a single Node is spread across the whole file. A time series cache stores the
+ * same values transposed, in tiles: the Nodes are split into blocks of NodesPerBlock, the
+ * timesteps into tiles of timestepsPerTile, and each tile of a block holds the values of
+ * its Nodes one Node after another. Reading the series of a Node is then one contiguous
+ * read per tile of timesteps, all within the Node's block (see ReadSeries()).
+ *
+ * The file layout is (all values in native byte order):
+ * - Header: "ADCTSER1", version, number of Nodes, number of timesteps, Nodes per block,
+ * timesteps per tile, and a flag that is only set once the file is complete
+ * - The model time of every timestep in seconds (doubles)
+ * - For every block of Nodes, for every tile of timesteps: for every Node of the block, its
+ * values for the timesteps of the tile
+ * .
+ *
+ * Write() converts an output file by reading one tile of timesteps at a time, with the
+ * timesteps of a tile read in parallel, and writing the transposed tile of every block into
+ * place. Its memory use is bounded by the memoryBudget passed to it, which also sets the
+ * number of timesteps per tile. StartConversion() runs Write() on a background thread and
+ * opens the cache once it is done, so the application stays responsive while a large file
+ * is converted. For vector output (eg. fort.64) the magnitude of each vector is stored.
+ *
+ * Once a file has been opened, ReadSeries() can be called from any number of threads at
+ * the same time.
+ *
+ */
+class TimeSeriesCache
+{
+	public:
+
+		TimeSeriesCache();
+		~TimeSeriesCache();
+
+		int		Write(GlobalOutputFile *outputFile, std::string fileLoc, size_t memoryBudget);
+		int		StartConversion(GlobalOutputFile *outputFile, std::string fileLoc, size_t memoryBudget);
+		void		CancelConversion();
+
+		int		Open(std::string fileLoc);
+		void		Close();
+		int		ReadSeries(unsigned int nodeNumber, float *values);
+
+		// Getter Methods
+		bool		IsOpen();
+		bool		IsConverting();
+		float		GetProgress();
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumTimesteps();
+		unsigned int	GetTimestepsPerTile();
+		double		GetTime(unsigned int timestep);
+
+	protected:
+
+		std::string			fileLocation;		/**< The location of the open file */
+		bool				fileOpen;		/**< Flag that shows if a complete file has been opened */
+		unsigned int			numNodes;		/**< The number of Nodes in the open file */
+		unsigned int			numTimesteps;		/**< The number of timesteps in the open file */
+		unsigned int			nodesPerBlock;		/**< The number of Nodes in each block of the open file */
+		unsigned int			timestepsPerTile;	/**< The number of timesteps in each tile of the open file */
+		std::vector<double>		times;			/**< The model time of every timestep in seconds */
+
+		// Background conversion
+		std::thread			converter;		/**< The thread running StartConversion() */
+		std::mutex			mutex;			/**< Protects the variables of the open file */
+		std::atomic<bool>		converting;		/**< Flag that shows if a conversion is running */
+		std::atomic<bool>		cancelled;		/**< Set to true to stop the running conversion */
+		std::atomic<unsigned int>	convertedTimesteps;	/**< The number of timesteps written by the running conversion */
+		std::atomic<unsigned int>	convertingTimesteps;	/**< The number of timesteps of the running conversion */
+};
+
+#endif // TIMESERIESCACHE_H
@@ -0,0 +1,408 @@
+#include "TimestepPrefetcher.h"
+#include "TraceWriter.h"
+
+#include <stdlib.h>
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ *
+ * No threads are started until Start() is called.
+ *
+ */
+TimestepPrefetcher::TimestepPrefetcher()
+{
+	file = 0;
+	nextTimestep = -1;
+	playhead = -1;
+	direction = 1;
+	generation = 0;
+	stopping = false;
+
+	stats.readyTimesteps = 0;
+	stats.pendingTimesteps = 0;
+	stats.hits = 0;
+	stats.waits = 0;
+	stats.misses = 0;
+	stats.seeks = 0;
+	stats.discarded = 0;
+}
+
+
+/**
+ * @brief Deconstructor that stops the background threads
+ */
+TimestepPrefetcher::~TimestepPrefetcher()
+{
+	Stop();
+}
+
+
+/**
+ * @brief Sets the file that timesteps are read from and starts the background threads
+ *
+ * Nothing is read until the first call to Acquire() or Seek().
+ *
+ * @param newFile A pointer to an open GlobalOutputFile, the prefetcher does not take ownership
+ * @param ringSize The number of timestep buffers (at least 2)
+ * @param numDecoders The number of threads that parse timesteps (at least 1)
+ * @return 0 if the prefetcher is running
+ * @return 1 if the file is not open
+ */
+int TimestepPrefetcher::Start(GlobalOutputFile *newFile, unsigned int ringSize, unsigned int numDecoders)
+{
+	Stop();
+	if (newFile == 0 || !newFile->IsOpen())
+		return 1;
+
+	file = newFile;
+	slots.resize(ringSize < 2 ? 2 : ringSize);
+	for (unsigned int i=0; i<slots.size(); i++)
+	{
+		slots[i].state = FreeSlot;
+		slots[i].timestep = -1;
+		slots[i].generation = 0;
+	}
+	nextTimestep = -1;
+	playhead = -1;
+	direction = 1;
+	stopping = false;
+
+	ioThread = std::thread(&TimestepPrefetcher::IOLoop, this);
+	for (unsigned int i=0; i<(numDecoders < 1 ? 1 : numDecoders); i++)
+		decoders.push_back(std::thread(&TimestepPrefetcher::DecodeLoop, this));
+	return 0;
+}
+
+
+/**
+ * @brief Stops the background threads and frees every buffer
+ *
+ * Buffers that have been acquired must not be used after this call.
+ *
+ */
+void TimestepPrefetcher::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopping = true;
+	}
+	workChanged.notify_all();
+	slotReady.notify_all();
+
+	if (ioThread.joinable())
+		ioThread.join();
+	for (unsigned int i=0; i<decoders.size(); i++)
+		decoders[i].join();
+	decoders.clear();
+
+	slots.clear();
+	file = 0;
+	stopping = false;
+}
+
+
+/**
+ * @brief Moves the prefetch position and cancels all work for other timesteps
+ *
+ * Buffers that have been acquired are kept until they are released.
+ *
+ * @param timestep The next timestep to read
+ * @param newDirection 1 to read the following timesteps, -1 to read the previous ones
+ */
+void TimestepPrefetcher::Seek(unsigned int timestep, int newDirection)
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		SeekLocked(timestep, newDirection);
+	}
+	workChanged.notify_all();
+}
+
+
+/**
+ * @brief Takes the parsed values of a timestep
+ *
+ * Timesteps behind the requested one, in the play direction, are dropped. If the timestep
+ * has not been requested yet, or the direction has changed, the prefetcher seeks to it.
+ * The buffer belongs to the caller until it is passed to Release(), and must be released
+ * before the same timestep can be acquired again. At most one buffer less than the size of
+ * the ring may be held at a time.
+ *
+ * @param timestep The index of the timestep
+ * @param wait true to block until the timestep has been parsed
+ * @return A pointer to the timestep's values (see GetNumValues())
+ * @return 0 if the timestep is not ready and wait is false, or could not be read
+ */
+float* TimestepPrefetcher::Acquire(unsigned int timestep, bool wait)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (file == 0 || timestep >= file->GetNumTimesteps())
+		return 0;
+
+	const int Timestep = timestep;
+	int newDirection = direction;
+	if (playhead >= 0 && Timestep != playhead)
+		newDirection = Timestep > playhead ? 1 : -1;
+	if ((FindSlot(Timestep) == 0 && Timestep != nextTimestep) || newDirection != direction)
+		SeekLocked(Timestep, newDirection);
+	playhead = Timestep;
+
+	// Drop the timesteps that have been passed
+	for (unsigned int i=0; i<slots.size(); i++)
+	{
+		PrefetchSlot *slot = &slots[i];
+		if ((slot->state == ReadSlot || slot->state == ReadySlot || slot->state == FailedSlot) &&
+		    direction*(slot->timestep - Timestep) < 0)
+			slot->state = FreeSlot;
+	}
+	workChanged.notify_all();
+
+	bool waited = false;
+	while (!stopping)
+	{
+		// The timestep may not have been claimed by the I/O thread yet
+		PrefetchSlot *slot = FindSlot(Timestep);
+		if ((slot == 0 && Timestep != nextTimestep) || (slot && slot->state == FailedSlot))
+		{
+			if (slot)
+				slot->state = FreeSlot;
+			return 0;
+		}
+		if (slot && slot->state == ReadySlot)
+		{
+			slot->state = AcquiredSlot;
+			if (waited)
+				stats.waits++;
+			else
+				stats.hits++;
+			return &slot->values[0];
+		}
+		if (!wait)
+		{
+			stats.misses++;
+			return 0;
+		}
+		waited = true;
+		slotReady.wait(lock);
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Hands the buffer of an acquired timestep back to the prefetcher
+ *
+ * The timestep at the playhead is kept until the playhead moves, so that it can be
+ * acquired again (eg. while paused) without being read again.
+ *
+ * @param timestep The index of the timestep
+ */
+void TimestepPrefetcher::Release(unsigned int timestep)
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		for (unsigned int i=0; i<slots.size(); i++)
+			if (slots[i].state == AcquiredSlot && slots[i].timestep == (int)timestep)
+				slots[i].state = slots[i].timestep == playhead && slots[i].generation == generation ? ReadySlot : FreeSlot;
+	}
+	workChanged.notify_all();
+}
+
+
+/**
+ * @brief Returns the number of Nodes in each timestep
+ * @return The number of Nodes, or 0 if the prefetcher has not been started
+ */
+unsigned int TimestepPrefetcher::GetNumNodes()
+{
+	return file ? file->GetNumNodes() : 0;
+}
+
+
+/**
+ * @brief Returns the number of arrays in each timestep's buffer
+ * @return 1 for scalar output (eg. fort.63), 2 for vector output (eg. fort.64)
+ */
+unsigned int TimestepPrefetcher::GetNumValues()
+{
+	return file ? file->GetNumValues() : 0;
+}
+
+
+/**
+ * @brief Returns the current play direction
+ * @return 1 if the following timesteps are prefetched, -1 if the previous ones are
+ */
+int TimestepPrefetcher::GetDirection()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return direction;
+}
+
+
+/**
+ * @brief Returns the current counters
+ * @return The counters
+ */
+PrefetchStats TimestepPrefetcher::GetStats()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stats.readyTimesteps = 0;
+	stats.pendingTimesteps = 0;
+	for (unsigned int i=0; i<slots.size(); i++)
+	{
+		if (slots[i].state == ReadySlot)
+			stats.readyTimesteps++;
+		else if (slots[i].state == ReadingSlot || slots[i].state == ReadSlot || slots[i].state == DecodingSlot)
+			stats.pendingTimesteps++;
+	}
+	return stats;
+}
+
+
+/**
+ * @brief The loop run by the I/O thread
+ *
+ * Whenever a buffer is free, the next timestep in the play direction is claimed and its
+ * raw bytes are read. A timestep whose seek has been superseded while it was read is
+ * dropped.
+ *
+ */
+void TimestepPrefetcher::IOLoop()
+{
+	TRACE_THREAD_NAME("Prefetch I/O");
+	std::unique_lock<std::mutex> lock (mutex);
+	while (true)
+	{
+		PrefetchSlot *slot = 0;
+		while (!stopping)
+		{
+			if (nextTimestep >= 0 && nextTimestep < (int)file->GetNumTimesteps())
+				for (unsigned int i=0; i<slots.size() && slot == 0; i++)
+					if (slots[i].state == FreeSlot)
+						slot = &slots[i];
+			if (slot)
+				break;
+			workChanged.wait(lock);
+		}
+		if (stopping)
+			return;
+
+		slot->state = ReadingSlot;
+		slot->timestep = nextTimestep;
+		slot->generation = generation;
+		nextTimestep += direction;
+
+		lock.unlock();
+		int result;
+		{
+			TRACE_SCOPE("io", "Prefetch read");
+			result = file->ReadRecord(slot->timestep, &slot->record);
+		}
+		lock.lock();
+
+		if (slot->generation != generation)
+		{
+			slot->state = FreeSlot;
+			stats.discarded++;
+		} else {
+			slot->state = result == 0 ? ReadSlot : FailedSlot;
+		}
+		workChanged.notify_all();
+		if (result != 0)
+			slotReady.notify_all();
+	}
+}
+
+
+/**
+ * @brief The loop run by each decode thread
+ *
+ * Raw timesteps are parsed closest to the playhead first. A timestep whose seek has been
+ * superseded while it was parsed is dropped.
+ *
+ */
+void TimestepPrefetcher::DecodeLoop()
+{
+	TRACE_THREAD_NAME("Prefetch decode");
+	std::unique_lock<std::mutex> lock (mutex);
+	while (true)
+	{
+		PrefetchSlot *slot = 0;
+		while (!stopping)
+		{
+			for (unsigned int i=0; i<slots.size(); i++)
+				if (slots[i].state == ReadSlot && (slot == 0 || abs(slots[i].timestep - playhead) < abs(slot->timestep - playhead)))
+					slot = &slots[i];
+			if (slot)
+				break;
+			workChanged.wait(lock);
+		}
+		if (stopping)
+			return;
+
+		slot->state = DecodingSlot;
+		const unsigned int NumNodes = file->GetNumNodes();
+		const unsigned int NumValues = file->GetNumValues();
+
+		lock.unlock();
+		int result;
+		{
+			TRACE_SCOPE("io", "Prefetch decode");
+			slot->values.resize((size_t)NumValues*NumNodes);
+			float *values[3];
+			for (unsigned int i=0; i<NumValues && i<3; i++)
+				values[i] = &slot->values[(size_t)i*NumNodes];
+			result = file->ParseRecord(&slot->record, slot->timestep, values, NumValues, 0);
+		}
+		lock.lock();
+
+		if (slot->generation != generation)
+		{
+			slot->state = FreeSlot;
+			stats.discarded++;
+			workChanged.notify_all();
+		} else {
+			slot->state = result == 0 ? ReadySlot : FailedSlot;
+			slotReady.notify_all();
+		}
+	}
+}
+
+
+/**
+ * @brief Moves the prefetch position, the mutex must be held
+ */
+void TimestepPrefetcher::SeekLocked(int timestep, int newDirection)
+{
+	generation++;
+	stats.seeks++;
+	direction = newDirection < 0 ? -1 : 1;
+	nextTimestep = timestep;
+	playhead = timestep;
+
+	// Work in flight is dropped by its thread when it finishes
+	for (unsigned int i=0; i<slots.size(); i++)
+	{
+		if (slots[i].state == ReadSlot || slots[i].state == ReadySlot || slots[i].state == FailedSlot)
+		{
+			slots[i].state = FreeSlot;
+			stats.discarded++;
+		}
+	}
+}
+
+
+/**
+ * @brief Finds the buffer of a timestep requested since the last seek, the mutex must be held
+ * @return A pointer to the buffer, or 0 if the timestep is not in the pipeline
+ */
+TimestepPrefetcher::PrefetchSlot* TimestepPrefetcher::FindSlot(int timestep)
+{
+	for (unsigned int i=0; i<slots.size(); i++)
+		if (slots[i].state != FreeSlot && slots[i].state != AcquiredSlot &&
+		    slots[i].timestep == timestep && slots[i].generation == generation)
+			return &slots[i];
+	return 0;
+}
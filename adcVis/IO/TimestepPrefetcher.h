@@ -0,0 +1,121 @@
+#ifndef TIMESTEPPREFETCHER_H
+#define TIMESTEPPREFETCHER_H
+
+#include "adcData.h"
+#include "GlobalOutputFile.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/**
+ * @brief Counters that describe the state of a TimestepPrefetcher
+ */
+struct PrefetchStats {
+		unsigned int	readyTimesteps;		/**< The number of timesteps parsed and waiting to be acquired */
+		unsigned int	pendingTimesteps;	/**< The number of timesteps being read or parsed, or waiting to be parsed */
+		unsigned long	hits;			/**< The number of timesteps that were ready when acquired */
+		unsigned long	waits;			/**< The number of timesteps that Acquire() had to wait for */
+		unsigned long	misses;			/**< The number of timesteps that were not ready when acquired without waiting */
+		unsigned long	seeks;			/**< The number of times the prefetch position was moved */
+		unsigned long	discarded;		/**< The number of timesteps read or parsed but dropped by a seek */
+};
+
+
+/**
+ * @brief Reads and parses the timesteps of a GlobalOutputFile ahead of the timestep being
+ * drawn, on background threads
+ *
+ * The prefetcher is a pipeline of three stages that share a fixed ring of timestep
+ * buffers:
+ * - One I/O thread reads the raw bytes of the next timesteps (GlobalOutputFile::ReadRecord())
+ * in the current play direction, as long as a buffer is free.
+ * - A pool of decode threads parses the raw records into per-Node values
+ * (GlobalOutputFile::ParseRecord()), the timestep closest to the playhead first.
+ * - The drawing thread takes parsed timesteps with Acquire(), uploads or copies them, and
+ * hands the buffer back with Release().
+ * .
+ *
+ * Since the ring is bounded, the pipeline never runs more than its size ahead of the
+ * playhead, and memory use is fixed. Acquire() follows the playhead: timesteps behind it
+ * are dropped, and asking for a timestep that is not in the pipeline (a jump, or a change
+ * of direction) seeks. A seek drops every buffer that has not been acquired and cancels
+ * the work in flight, whose results are thrown away as soon as the read or parse that is
+ * running has finished. Seek() can also be called directly, eg. when the user starts
+ * playing backwards.
+ *
+ * The buffer of a timestep holds GetNumValues() arrays of GetNumNodes() floats one after
+ * another, by node number (eg. u and then v for fort.64).
+ *
+ */
+class TimestepPrefetcher
+{
+	public:
+
+		TimestepPrefetcher();
+		~TimestepPrefetcher();
+
+		int		Start(GlobalOutputFile *newFile, unsigned int ringSize, unsigned int numDecoders);
+		void		Stop();
+		void		Seek(unsigned int timestep, int newDirection);
+		float*		Acquire(unsigned int timestep, bool wait);
+		void		Release(unsigned int timestep);
+
+		// Getter Methods
+		unsigned int	GetNumNodes();
+		unsigned int	GetNumValues();
+		int		GetDirection();
+		PrefetchStats	GetStats();
+
+	protected:
+
+		/**
+		 * @brief The states a buffer moves through
+		 */
+		enum SlotState {
+			FreeSlot,	/**< Not in use */
+			ReadingSlot,	/**< Being read by the I/O thread */
+			ReadSlot,	/**< Read, waiting for a decode thread */
+			DecodingSlot,	/**< Being parsed by a decode thread */
+			ReadySlot,	/**< Parsed, waiting to be acquired */
+			AcquiredSlot,	/**< Handed to the drawing thread */
+			FailedSlot	/**< Could not be read or parsed */
+		};
+
+		/**
+		 * @brief One buffer of the ring
+		 */
+		struct PrefetchSlot {
+				SlotState		state;		/**< The buffer's SlotState */
+				int			timestep;	/**< The timestep held by the buffer */
+				unsigned int		generation;	/**< The seek the timestep was requested by */
+				std::vector<char>	record;		/**< The raw bytes of the timestep */
+				std::vector<float>	values;		/**< The parsed values of the timestep */
+		};
+
+		GlobalOutputFile*		file;		/**< The file timesteps are read from */
+		std::vector<PrefetchSlot>	slots;		/**< The ring of buffers */
+		int				nextTimestep;	/**< The next timestep the I/O thread reads */
+		int				playhead;	/**< The last timestep passed to Acquire() or Seek() */
+		int				direction;	/**< 1 to prefetch forward, -1 to prefetch backward */
+		unsigned int			generation;	/**< Incremented by every seek */
+		bool				stopping;	/**< Set to true to make the threads exit */
+		PrefetchStats			stats;		/**< The current counters */
+
+		// Background threads
+		std::thread			ioThread;	/**< The thread that reads raw timesteps */
+		std::vector<std::thread>	decoders;	/**< The threads that parse raw timesteps */
+		std::mutex			mutex;		/**< Protects every member above */
+		std::condition_variable		workChanged;	/**< Wakes the background threads when there is work or when stopping */
+		std::condition_variable		slotReady;	/**< Wakes Acquire() when a timestep has been parsed */
+
+		// Protected Functions
+		void		IOLoop();
+		void		DecodeLoop();
+		void		SeekLocked(int timestep, int newDirection);
+		PrefetchSlot*	FindSlot(int timestep);
+};
+
+#endif // TIMESTEPPREFETCHER_H
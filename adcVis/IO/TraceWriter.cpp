@@ -0,0 +1,244 @@
+#include "TraceWriter.h"
+
+
+// Initialize static members
+std::atomic<bool>				TraceWriter::enabled (false);
+std::string					TraceWriter::traceLocation;
+std::chrono::steady_clock::time_point		TraceWriter::startTime;
+std::mutex					TraceWriter::buffersMutex;
+std::vector<TraceWriter::ThreadBuffer*>		TraceWriter::buffers;
+std::vector<TraceWriter::ThreadBuffer*>		TraceWriter::freeBuffers;
+
+
+/**
+ * @brief Owns the calling thread's buffer and hands it back when the thread exits
+ */
+struct ThreadBufferHandle {
+		TraceWriter::ThreadBuffer	*buffer;
+
+		ThreadBufferHandle() : buffer(0) {}
+		~ThreadBufferHandle()
+		{
+			if (buffer)
+				TraceWriter::ReleaseThreadBuffer(buffer);
+		}
+};
+
+static thread_local ThreadBufferHandle threadBuffer;
+
+
+/**
+ * @brief Starts recording events
+ *
+ * Any events recorded before are dropped. The file is created right away so that an
+ * invalid location is reported here rather than when the trace is written.
+ *
+ * @param fileLoc The location of the JSON trace file
+ * @return 0 if recording started
+ * @return 1 if the file could not be created
+ */
+int TraceWriter::Start(std::string fileLoc)
+{
+	FILE *file = fopen(fileLoc.data(), "w");
+	if (file == 0)
+	{
+		DEBUG("Unable to create trace file %s\n", fileLoc.data());
+		return 1;
+	}
+	fclose(file);
+
+	std::lock_guard<std::mutex> lock (buffersMutex);
+	for (unsigned int i=0; i<buffers.size(); i++)
+	{
+		std::lock_guard<std::mutex> bufferLock (buffers[i]->mutex);
+		buffers[i]->events.clear();
+	}
+	traceLocation = fileLoc;
+	startTime = std::chrono::steady_clock::now();
+	enabled = true;
+	return 0;
+}
+
+
+/**
+ * @brief Stops recording events and writes the trace file
+ *
+ * Events from scopes that are still open on other threads are not part of the trace.
+ *
+ * @return 0 if the trace file was written
+ * @return 1 if recording was not started or the file could not be written
+ */
+int TraceWriter::Stop()
+{
+	if (!enabled)
+		return 1;
+	enabled = false;
+
+	FILE *file = fopen(traceLocation.data(), "w");
+	if (file == 0)
+	{
+		DEBUG("Unable to write trace file %s\n", traceLocation.data());
+		return 1;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"adcVis\"}}");
+
+	std::lock_guard<std::mutex> lock (buffersMutex);
+	for (unsigned int i=0; i<buffers.size(); i++)
+	{
+		ThreadBuffer *buffer = buffers[i];
+		std::lock_guard<std::mutex> bufferLock (buffer->mutex);
+		if (!buffer->threadName.empty())
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				buffer->threadID, Escape(buffer->threadName).data());
+		for (unsigned int j=0; j<buffer->events.size(); j++)
+		{
+			TraceEvent *event = &buffer->events[j];
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+				Escape(event->name).data(), Escape(event->category).data(), event->start, event->duration, buffer->threadID);
+		}
+		buffer->events.clear();
+	}
+
+	fprintf(file, "\n]}\n");
+	bool failed = ferror(file) != 0;
+	fclose(file);
+	return failed ? 1 : 0;
+}
+
+
+/**
+ * @brief Returns true if events are being recorded
+ * @return true between Start() and Stop()
+ */
+bool TraceWriter::IsEnabled()
+{
+	return enabled;
+}
+
+
+/**
+ * @brief Names the calling thread in the trace
+ *
+ * The name is kept if a later thread reuses the buffer, until that thread names itself.
+ *
+ * @param name The name of the thread
+ */
+void TraceWriter::SetThreadName(std::string name)
+{
+	ThreadBuffer *buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock (buffer->mutex);
+	buffer->threadName = name;
+}
+
+
+/**
+ * @brief Adds a completed event to the calling thread's buffer
+ *
+ * Nothing is recorded unless recording has been started.
+ *
+ * @param category The category of the event, must be a string literal
+ * @param name The name of the event, must be a string literal
+ * @param start The time the event started
+ * @param end The time the event ended
+ */
+void TraceWriter::AddEvent(const char *category, const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+	if (!enabled)
+		return;
+
+	TraceEvent event;
+	event.category = category;
+	event.name = name;
+	event.start = std::chrono::duration<double, std::micro>(start - startTime).count();
+	event.duration = std::chrono::duration<double, std::micro>(end - start).count();
+
+	ThreadBuffer *buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock (buffer->mutex);
+	buffer->events.push_back(event);
+}
+
+
+/**
+ * @brief Returns the calling thread's buffer, reusing the buffer of an exited thread or
+ * creating a new one the first time it is called on a thread
+ * @return The calling thread's buffer
+ */
+TraceWriter::ThreadBuffer* TraceWriter::GetThreadBuffer()
+{
+	if (threadBuffer.buffer)
+		return threadBuffer.buffer;
+
+	std::lock_guard<std::mutex> lock (buffersMutex);
+	if (!freeBuffers.empty())
+	{
+		threadBuffer.buffer = freeBuffers.back();
+		freeBuffers.pop_back();
+	} else {
+		threadBuffer.buffer = new ThreadBuffer();
+		threadBuffer.buffer->threadID = buffers.size()+1;
+		buffers.push_back(threadBuffer.buffer);
+	}
+	return threadBuffer.buffer;
+}
+
+
+/**
+ * @brief Makes the buffer of an exiting thread available to the next new thread
+ *
+ * The buffer keeps its events until they are written by Stop().
+ *
+ * @param buffer The buffer
+ */
+void TraceWriter::ReleaseThreadBuffer(ThreadBuffer *buffer)
+{
+	std::lock_guard<std::mutex> lock (buffersMutex);
+	freeBuffers.push_back(buffer);
+}
+
+
+/**
+ * @brief Escapes quotes, backslashes and control characters for a JSON string
+ * @param text The text to escape
+ * @return The escaped text
+ */
+std::string TraceWriter::Escape(std::string text)
+{
+	std::string escaped;
+	for (unsigned int i=0; i<text.size(); i++)
+	{
+		if (text[i] == '"' || text[i] == '\\')
+			escaped += '\\';
+		if ((unsigned char)text[i] < 0x20)
+			escaped += ' ';
+		else
+			escaped += text[i];
+	}
+	return escaped;
+}
+
+
+/**
+ * @brief Enters the scope if recording has been started
+ * @param newCategory The category of the event, must be a string literal
+ * @param newName The name of the event, must be a string literal
+ */
+TraceScope::TraceScope(const char *newCategory, const char *newName)
+{
+	category = newCategory;
+	name = newName;
+	active = TraceWriter::IsEnabled();
+	if (active)
+		start = std::chrono::steady_clock::now();
+}
+
+
+/**
+ * @brief Adds the event to the calling thread's buffer
+ */
+TraceScope::~TraceScope()
+{
+	if (active)
+		TraceWriter::AddEvent(category, name, start, std::chrono::steady_clock::now());
+}
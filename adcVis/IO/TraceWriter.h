@@ -0,0 +1,120 @@
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include "adcData.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+
+/** TRACE_SCOPE Macro used to mark a block of code in the trace
+ *
+ * This macro records the time from where it is placed to the end of the enclosing block
+ * as one trace event, on the calling thread. It accepts a category and a name, both of
+ * which must be string literals (eg. TRACE_SCOPE("io", "ReadFort14")).
+ *
+ * TRACE_THREAD_NAME names the calling thread in the trace.
+ *
+ * Both macros only do something if ADCVIS_TRACE is defined (build with
+ * "qmake CONFIG+=trace"), otherwise they compile to nothing.
+ *
+ */
+#ifdef ADCVIS_TRACE
+#define TRACE_CONCAT_INNER(a, b) a ## b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope, __LINE__) (category, name)
+#define TRACE_THREAD_NAME(name) TraceWriter::SetThreadName(name)
+#else
+#define TRACE_SCOPE(category, name) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+#endif
+
+
+/**
+ * @brief Records timed events from every thread and writes them as a Chrome trace
+ *
+ * Between Start() and Stop(), every TRACE_SCOPE that is left adds one complete event
+ * (its category, name, start time and duration) to a buffer that belongs to the calling
+ * thread, so threads never wait on each other to record an event. Stop() writes every
+ * buffer to a JSON file in the Chrome trace event format, which can be opened in
+ * chrome://tracing or ui.perfetto.dev. Each thread gets its own track, so work done in
+ * parallel (eg. building the proxy mesh while the mesh is uploaded) can be seen side by side.
+ *
+ * Thread IDs in the trace are small numbers given out in the order threads first record
+ * an event. When a thread exits, its buffer and ID are reused by the next new thread, so
+ * short-lived worker threads (eg. those of ParallelFor()) do not add a track each.
+ *
+ */
+class TraceWriter
+{
+	public:
+
+		static int	Start(std::string fileLoc);
+		static int	Stop();
+		static bool	IsEnabled();
+		static void	SetThreadName(std::string name);
+		static void	AddEvent(const char *category, const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+	protected:
+
+		/**
+		 * @brief A completed trace event
+		 */
+		struct TraceEvent {
+				const char*	category;	/**< The category of the event */
+				const char*	name;		/**< The name of the event */
+				double		start;		/**< The start time in microseconds since Start() */
+				double		duration;	/**< The duration in microseconds */
+		};
+
+		/**
+		 * @brief The events recorded by one thread
+		 */
+		struct ThreadBuffer {
+				std::mutex		mutex;		/**< Protects the events while Stop() reads them */
+				unsigned int		threadID;	/**< The ID of the thread in the trace */
+				std::string		threadName;	/**< The name of the thread in the trace */
+				std::vector<TraceEvent>	events;		/**< The recorded events */
+		};
+
+		static std::atomic<bool>			enabled;	/**< Set to true between Start() and Stop() */
+		static std::string				traceLocation;	/**< The location of the trace file */
+		static std::chrono::steady_clock::time_point	startTime;	/**< The time Start() was called */
+		static std::mutex				buffersMutex;	/**< Protects buffers and freeBuffers */
+		static std::vector<ThreadBuffer*>		buffers;	/**< The buffer of every thread that has recorded an event */
+		static std::vector<ThreadBuffer*>		freeBuffers;	/**< The buffers of threads that have exited */
+
+		// Protected Functions
+		static ThreadBuffer*	GetThreadBuffer();
+		static void		ReleaseThreadBuffer(ThreadBuffer *buffer);
+		static std::string	Escape(std::string text);
+
+		friend struct ThreadBufferHandle;
+};
+
+
+/**
+ * @brief Records a trace event that lasts from its creation until it goes out of scope
+ *
+ * Use the TRACE_SCOPE macro instead of creating a TraceScope directly, so the event
+ * compiles out when tracing is disabled.
+ *
+ */
+class TraceScope
+{
+	public:
+
+		TraceScope(const char *newCategory, const char *newName);
+		~TraceScope();
+
+	protected:
+
+		const char*				category;	/**< The category of the event */
+		const char*				name;		/**< The name of the event */
+		std::chrono::steady_clock::time_point	start;		/**< The time the scope was entered */
+		bool					active;		/**< Set to true if tracing was enabled when the scope was entered */
+};
+
+#endif // TRACEWRITER_H
@@ -0,0 +1,302 @@
+#include "ChunkedTerrainLayer.h"
+#include "../OpenGL/GLProfiler.h"
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+ChunkedTerrainLayer::ChunkedTerrainLayer()
+{
+	loaderThreads = 2;
+	memoryBudget = 0;
+}
+
+
+/**
+ * @brief Deconstructor that releases every resident chunk
+ *
+ * The OpenGL context the Layer was drawn in must be current.
+ *
+ */
+ChunkedTerrainLayer::~ChunkedTerrainLayer()
+{
+	residency.SetFile(0, 0);
+}
+
+
+/**
+ * @brief Draws the visible chunks of the mesh
+ *
+ * Chunks that are outside the camera's view are skipped. Every visible chunk is requested
+ * from the GLResidencyManager, and is drawn at full resolution if it is resident or from
+ * the overview mesh if it is not. The fill of every visible chunk is drawn before the
+ * outline of any chunk.
+ *
+ */
+void ChunkedTerrainLayer::DrawBase()
+{
+	if (!glLoaded || outlineShader == 0 || fillShader == 0 || vaoID == 0)
+		return;
+
+	residency.BeginFrame();
+	{
+		GLProfileScope profile (GetID(), GLProfiler::UploadSection);
+		residency.Update();
+	}
+
+	// Sort the visible chunks by what can be drawn
+	GLCamera *camera = fillShader->GetCamera();
+	residentChunks.clear();
+	coarseChunks.clear();
+	for (unsigned int i=0; i<meshFile.GetNumChunks(); i++)
+	{
+		MeshChunkInfo *info = meshFile.GetChunkInfo(i);
+		if (camera && !camera->IsBoxVisible(info->minX, info->maxX, info->minY, info->maxY, info->minZ, info->maxZ))
+			continue;
+		if (residency.Request(i))
+			residentChunks.push_back(i);
+		else
+			coarseChunks.push_back(i);
+	}
+
+	GLProfiler::Begin(GetID(), GLProfiler::FillSection);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glPolygonOffset(offsetValue + 1, offsetValue + 1);
+	DrawChunks(fillShader);
+	GLProfiler::End();
+
+	GLProfiler::Begin(GetID(), GLProfiler::OutlineSection);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	glPolygonOffset(offsetValue, offsetValue);
+	DrawChunks(outlineShader);
+	GLProfiler::End();
+
+	glBindVertexArray(0);
+}
+
+
+/**
+ * @brief Draws the visible chunks of the mesh all at once
+ *
+ * Only the visible chunks are drawn, so drawing in pieces would gain very little.
+ *
+ * @param progress A pointer to the amount of work done so far
+ * @param budget Not used
+ * @return Always true
+ */
+bool ChunkedTerrainLayer::DrawBaseProgressive(unsigned int *progress, unsigned int budget)
+{
+	(void)progress;
+	(void)budget;
+	DrawBase();
+	return true;
+}
+
+
+/**
+ * @brief Draws nothing into a GLPickingBuffer
+ *
+ * The Layer's vertex array object only holds the overview mesh, and its Element list is
+ * never filled, so there is nothing that a picked Element index could refer to.
+ *
+ * @param shader Not used
+ */
+void ChunkedTerrainLayer::DrawPicking(PickingShader *shader)
+{
+	(void)shader;
+}
+
+
+/**
+ * @brief Returns the DirtyFlag values describing what changed since the Layer was last drawn
+ *
+ * Layer::DataDirty is added while chunks are waiting to be loaded to the OpenGL context,
+ * so that a GLScene keeps redrawing until they have arrived.
+ *
+ * @return A combination of Layer::DataDirty, Layer::UniformsDirty and Layer::SelectionDirty
+ * @return 0 if nothing has changed
+ */
+unsigned int ChunkedTerrainLayer::GetDirtyFlags()
+{
+	unsigned int flags = Layer::GetDirtyFlags();
+	if (residency.HasPendingUploads())
+		flags |= DataDirty;
+	return flags;
+}
+
+
+/**
+ * @brief Returns the location of the chunked mesh file
+ * @return The chunked mesh file location
+ */
+std::string ChunkedTerrainLayer::GetChunkedMeshLocation()
+{
+	return chunkedMeshLocation;
+}
+
+
+/**
+ * @brief Returns the counters of the Layer's GLResidencyManager
+ * @return The current ResidencyStats
+ */
+ResidencyStats ChunkedTerrainLayer::GetResidencyStats()
+{
+	return residency.GetStats();
+}
+
+
+/**
+ * @brief Returns the number of chunks that were visible during the last draw
+ * @return The number of visible chunks
+ */
+unsigned int ChunkedTerrainLayer::GetNumVisibleChunks()
+{
+	return residentChunks.size() + coarseChunks.size();
+}
+
+
+/**
+ * @brief Returns the number of visible chunks that were drawn from the overview mesh
+ * during the last draw
+ * @return The number of chunks that were not resident
+ */
+unsigned int ChunkedTerrainLayer::GetNumCoarseChunks()
+{
+	return coarseChunks.size();
+}
+
+
+/**
+ * @brief Opens a chunked mesh file
+ *
+ * The header, chunk table and overview mesh are read right away. The overview mesh is
+ * loaded to the OpenGL context, and chunks are streamed in as they become visible, so an
+ * OpenGL context must be current.
+ *
+ * @param newLocation The location of a file written by ChunkedMeshFile::Write()
+ * @return 0 if the file was opened successfully
+ * @return 1 if an error occurred
+ */
+int ChunkedTerrainLayer::SetChunkedMeshLocation(std::string newLocation)
+{
+	residency.SetFile(0, 0);
+	if (meshFile.Open(newLocation) != 0)
+		return 1;
+
+	chunkedMeshLocation = newLocation;
+	numNodes = meshFile.GetNumNodes();
+	numElements = meshFile.GetNumElements();
+	meshFile.GetBounds(&minX, &maxX, &minY, &maxY, &minZ, &maxZ);
+
+	LoadDataToGPU();
+	if (!glLoaded)
+		return 1;
+
+	size_t budget = memoryBudget;
+	if (budget == 0)
+		budget = GLResidencyManager::GetAvailableVideoMemory()/2;
+	if (budget > 0)
+		residency.SetBudget(budget);
+	return residency.SetFile(&meshFile, loaderThreads);
+}
+
+
+/**
+ * @brief Sets the largest amount of video memory used by resident chunks
+ *
+ * By default, half of the free video memory reported by the driver is used (see
+ * GLResidencyManager::GetAvailableVideoMemory()), or 256 MB if the driver does not
+ * report it.
+ *
+ * @param bytes The budget in bytes, or 0 to pick one automatically
+ */
+void ChunkedTerrainLayer::SetVideoMemoryBudget(size_t bytes)
+{
+	memoryBudget = bytes;
+	if (bytes > 0)
+		residency.SetBudget(bytes);
+	MarkDirty(DataDirty);
+}
+
+
+/**
+ * @brief Sets the number of threads used to read chunks from disk
+ *
+ * Takes effect the next time a file is opened.
+ *
+ * @param numThreads The number of threads (default 2)
+ */
+void ChunkedTerrainLayer::SetLoaderThreads(unsigned int numThreads)
+{
+	loaderThreads = numThreads > 0 ? numThreads : 1;
+}
+
+
+/**
+ * @brief Loads the overview mesh to the OpenGL context
+ *
+ * The overview mesh is stored in the Layer's vertex array object. No proxy mesh or levels
+ * of detail are built, since the overview mesh already serves as both.
+ *
+ */
+void ChunkedTerrainLayer::LoadDataToGPU()
+{
+	std::vector<GLfloat> *vertices = meshFile.GetOverviewVertices();
+	std::vector<GLuint> *indices = meshFile.GetOverviewIndices();
+
+	GLProfileScope profile (GetID(), GLProfiler::UploadSection);
+	GLProfiler::AddBytes(sizeof(GLfloat)*vertices->size() + sizeof(GLuint)*indices->size());
+	if (vaoID == 0)
+	{
+		glGenVertexArrays(1, &vaoID);
+		glGenBuffers(1, &vboID);
+		glGenBuffers(1, &iboID);
+	}
+
+	glBindVertexArray(vaoID);
+	glBindBuffer(GL_ARRAY_BUFFER, vboID);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*vertices->size(), vertices->size() ? &(*vertices)[0] : 0, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*indices->size(), indices->size() ? &(*indices)[0] : 0, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+
+	if (glGetError() == GL_NO_ERROR)
+	{
+		glLoaded = true;
+		MarkDirty(DataDirty);
+	} else {
+		glLoaded = false;
+		DEBUG("OpenGL Error found after loading the overview mesh of layer %i", GetID());
+	}
+}
+
+
+/**
+ * @brief Draws every visible chunk with one shader
+ *
+ * Resident chunks are drawn from their own vertex array objects, and the rest from the
+ * overview mesh.
+ *
+ * @param shader The shader to draw with
+ */
+void ChunkedTerrainLayer::DrawChunks(GLShader *shader)
+{
+	if (shader->Use() != 0)
+		return;
+
+	for (unsigned int i=0; i<residentChunks.size(); i++)
+	{
+		glBindVertexArray(residency.GetVertexArray(residentChunks[i]));
+		glDrawElements(GL_TRIANGLES, 3*meshFile.GetChunkInfo(residentChunks[i])->numElements, GL_UNSIGNED_INT, (GLvoid*)0);
+	}
+
+	glBindVertexArray(vaoID);
+	for (unsigned int i=0; i<coarseChunks.size(); i++)
+	{
+		MeshChunkInfo *info = meshFile.GetChunkInfo(coarseChunks[i]);
+		if (info->numCoarseElements > 0)
+			glDrawElements(GL_TRIANGLES, 3*info->numCoarseElements, GL_UNSIGNED_INT, (GLuint*)0+3*info->firstCoarseElement);
+	}
+}
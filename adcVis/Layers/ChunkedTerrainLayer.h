@@ -0,0 +1,64 @@
+#ifndef CHUNKEDTERRAINLAYER_H
+#define CHUNKEDTERRAINLAYER_H
+
+#include "Layer.h"
+#include "../IO/ChunkedMeshFile.h"
+#include "../OpenGL/GLResidencyManager.h"
+#include <string>
+
+
+/**
+ * @brief A subclass of Layer that draws a mesh too large for video memory from a
+ * ChunkedMeshFile
+ *
+ * Only the small overview mesh stored in the file is kept in the OpenGL context at all
+ * times, in the Layer's own vertex array object. Every frame, the chunks whose bounding
+ * boxes are visible to the fill shader's camera are requested from a GLResidencyManager,
+ * which streams them in from disk on background threads and evicts the least recently
+ * used chunks to stay within a video memory budget. Visible chunks that are resident are
+ * drawn at full resolution, and the rest are drawn from the overview mesh until they arrive.
+ *
+ * The Node and Element lists of the Layer are never filled, so Node and Element picking
+ * are not supported, and nothing is drawn into a GLPickingBuffer (see DrawPicking()).
+ *
+ */
+class ChunkedTerrainLayer : public Layer
+{
+	public:
+		ChunkedTerrainLayer();
+		~ChunkedTerrainLayer();
+
+		virtual void	DrawBase();
+		virtual bool	DrawBaseProgressive(unsigned int *progress, unsigned int budget);
+		virtual void	DrawPicking(PickingShader *shader);
+		virtual unsigned int	GetDirtyFlags();
+
+		// Getter Methods
+		std::string	GetChunkedMeshLocation();
+		ResidencyStats	GetResidencyStats();
+		unsigned int	GetNumVisibleChunks();
+		unsigned int	GetNumCoarseChunks();
+
+		// Setter Methods
+		int	SetChunkedMeshLocation(std::string newLocation);
+		void	SetVideoMemoryBudget(size_t bytes);
+		void	SetLoaderThreads(unsigned int numThreads);
+
+	protected:
+
+		std::string		chunkedMeshLocation;	/**< The chunked mesh file location */
+		ChunkedMeshFile		meshFile;		/**< The open chunked mesh file */
+		GLResidencyManager	residency;		/**< Keeps the visible chunks in the OpenGL context */
+		unsigned int		loaderThreads;		/**< The number of threads used to read chunks */
+		size_t			memoryBudget;		/**< The video memory budget, or 0 to pick one automatically */
+
+		// Per-frame Variables
+		std::vector<unsigned int>	residentChunks;	/**< The visible chunks drawn at full resolution this frame */
+		std::vector<unsigned int>	coarseChunks;	/**< The visible chunks drawn from the overview mesh this frame */
+
+		// Protected Functions
+		virtual void	LoadDataToGPU();
+		void		DrawChunks(GLShader *shader);
+};
+
+#endif // CHUNKEDTERRAINLAYER_H
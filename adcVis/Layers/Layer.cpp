@@ -1,4 +1,22 @@
 #include "Layer.h"
+#include "../OpenGL/GLResidencyManager.h"
+#include "../OpenGL/GLProfiler.h"
+#include "../IO/TraceWriter.h"
+
+#include <algorithm>
+
+
+// Layers with fewer Elements than this are always drawn at full resolution
+static const unsigned int ProxyElementThreshold = 250000;
+
+// The proxy mesh has roughly this many times fewer Nodes than the full mesh
+static const unsigned int ProxyReduction = 16;
+
+// Each level of detail has roughly this many times fewer Elements than the previous level
+static const unsigned int LODReduction = 4;
+
+// No level of detail has fewer Elements than this
+static const unsigned int LODMinElements = 10000;
 
 
 // Initialize static members
@@ -24,49 +42,220 @@ Layer::Layer()
 
 	selectedNode = 0;
 	selectedElement = 0;
+	pickingMode = QuadtreePicking;
+
+	glLoaded = false;
+	dirtyFlags = DataDirty | UniformsDirty | SelectionDirty;
+	interacting = false;
+	softwareOnly = false;
 
 	vaoID = 0;
 	vboID = 0;
 	iboID = 0;
+	scalarBufferID = 0;
+	scalarBufferSize = 0;
 	outlineShader = 0;
 	fillShader = 0;
 	offsetValue = 0.0;
+
+	proxyReady = false;
+	proxyIboID = 0;
+	numProxyElements = 0;
+
+	lodReady = false;
+	lodIboID = 0;
+	lodTolerance = 1.0;
+	currentLOD = -1;
+}
+
+
+/**
+ * @brief Deconstructor that waits for the proxy mesh thread to finish and deletes the
+ * proxy mesh and level of detail index buffers from the OpenGL context
+ */
+Layer::~Layer()
+{
+	if (proxyThread.joinable())
+		proxyThread.join();
+	if (proxyIboID)
+		glDeleteBuffers(1, &proxyIboID);
+	if (lodIboID)
+		glDeleteBuffers(1, &lodIboID);
 }
 
 
 /**
  * @brief Used to draw the layer in the OpenGL context.
  *
+ * This function draws the base of the Layer with Layer::DrawBase() and then draws
+ * anything on top of it with Layer::DrawOverlay().
+ *
+ * If a subclassed Layer needs to draw more (eg. selected nodes or elements), override
+ * Layer::DrawBase() or Layer::DrawOverlay() instead of this function, so that a GLScene
+ * can redraw overlays without redrawing the base.
+ *
+ */
+void Layer::Draw()
+{
+	DrawBase();
+	DrawOverlay();
+}
+
+
+/**
+ * @brief Used to draw the fill and outline of the layer in the OpenGL context.
+ *
  * This function first checks that data has been loaded to the OpenGL context and that
  * both shaders have been set before binding the Layer's vertex array object and
- * drawing the Layer.
+ * drawing the Layer. The mesh that is drawn is chosen by Layer::SelectBaseMesh().
  *
- * If a subclassed Layer needs to draw more (eg. selected nodes or elements), simply
- * override this function, call Layer::Draw(), and perform drawing operations. This function
- * does not unbind the vertex array after draw operations.
+ * If a subclassed Layer needs to draw its base differently, simply override this
+ * function. This function does not unbind the vertex array after draw operations.
  *
  */
-void Layer::Draw()
+void Layer::DrawBase()
 {
 	if (glLoaded && outlineShader != 0 && fillShader != 0 && vaoID != 0)
 	{
+		GLuint indexBuffer;
+		unsigned int firstElement, count;
+		SelectBaseMesh(&indexBuffer, &firstElement, &count);
+
 		glBindVertexArray(vaoID);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		DrawFill(firstElement, count);
+		DrawOutline(firstElement, count);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+	}
+}
 
-		// Draw Fill
+
+/**
+ * @brief Used to draw the fill and outline of the layer over several frames.
+ *
+ * This function draws the next part of the Layer, picking up where the previous call
+ * left off. The work is the fill of every Element followed by the outline of every
+ * Element of the mesh chosen by Layer::SelectBaseMesh(), so drawing it all in pieces
+ * produces exactly the same image as Layer::DrawBase(). At most budget Elements are
+ * drawn per call.
+ *
+ * Subclasses that override Layer::DrawBase() should also override this function. The
+ * simplest override draws everything at once and returns true.
+ *
+ * @param progress A pointer to the amount of work done so far, start at 0
+ * @param budget The maximum number of Elements to draw during this call
+ * @return true if the Layer has been completely drawn
+ * @return false if more calls are needed
+ */
+bool Layer::DrawBaseProgressive(unsigned int *progress, unsigned int budget)
+{
+	if (!glLoaded || outlineShader == 0 || fillShader == 0 || vaoID == 0 || progress == 0)
+		return true;
+
+	GLuint indexBuffer;
+	unsigned int firstElement, numDrawn;
+	SelectBaseMesh(&indexBuffer, &firstElement, &numDrawn);
+	glBindVertexArray(vaoID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	const unsigned int totalWork = 2*numDrawn;
+	while (budget > 0 && *progress < totalWork)
+	{
+		if (*progress < numDrawn)
+		{
+			unsigned int count = std::min(budget, numDrawn - *progress);
+			DrawFill(firstElement + *progress, count);
+			*progress += count;
+			budget -= count;
+		} else {
+			unsigned int first = *progress - numDrawn;
+			unsigned int count = std::min(budget, numDrawn - first);
+			DrawOutline(firstElement + first, count);
+			*progress += count;
+			budget -= count;
+		}
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+	return *progress >= totalWork;
+}
+
+
+/**
+ * @brief Used to draw anything that sits on top of the layer (eg. selections).
+ *
+ * This function is meant to be overridden by subclasses of Layer that draw things which
+ * change independently of the Layer's data, like selected Nodes and Elements. A GLScene
+ * redraws only the overlays when only Layer::SelectionDirty is set. Default behavior is
+ * to do nothing.
+ *
+ */
+void Layer::DrawOverlay()
+{
+	return;
+}
+
+
+/**
+ * @brief Used to draw the layer into a GLPickingBuffer.
+ *
+ * This function draws the Layer's Elements with the provided PickingShader so that the
+ * Element index and barycentric weights under every pixel are written into the currently
+ * bound GLPickingBuffer. Nothing is drawn unless the Layer's picking mode is
+ * Layer::BufferPicking.
+ *
+ * @param shader The PickingShader used to draw the Layer
+ */
+void Layer::DrawPicking(PickingShader *shader)
+{
+	if (pickingMode == BufferPicking && glLoaded && shader != 0 && vaoID != 0)
+	{
+		GLProfileScope profile (layerID, GLProfiler::PickingSection);
+		glBindVertexArray(vaoID);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		glPolygonOffset(offsetValue + 1, offsetValue + 1);
-		if (fillShader->Use() == 0)
-			glDrawElements(GL_TRIANGLES, numElements*3, GL_UNSIGNED_INT, (GLvoid*)0);
-
-		// Draw Outline
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glPolygonOffset(offsetValue, offsetValue);
-		if (outlineShader->Use() == 0)
+		shader->SetLayerID(layerID);
+		if (shader->Use() == 0)
 			glDrawElements(GL_TRIANGLES, numElements*3, GL_UNSIGNED_INT, (GLvoid*)0);
 	}
 }
 
 
+/**
+ * @brief Used to draw the layer without an OpenGL context.
+ *
+ * This function draws the full resolution fill and outline of the Layer into a
+ * MeshRasterizer, straight from the Node and Element lists. The rasterizer's fill,
+ * wireframe and highlight settings decide how the Layer looks. Subclasses that keep
+ * selections should override this function to pass them along as highlights.
+ *
+ * @param rasterizer The MeshRasterizer to draw into
+ */
+void Layer::DrawSoftware(MeshRasterizer *rasterizer)
+{
+	if (rasterizer != 0 && !nodes.empty() && !elements.empty())
+		rasterizer->DrawMesh(&nodes, &elements, 0, 0, 0, 0);
+}
+
+
+/**
+ * @brief Used to update the selection from a pixel read out of a GLPickingBuffer.
+ *
+ * This function is meant to be overridden by subclasses of Layer that support Node and
+ * Element picking. Subclasses should ignore results whose PickResult::layerID does not
+ * match their own ID. Default behavior is to do nothing.
+ *
+ * @param result The PickResult returned by GLPickingBuffer::GetResult()
+ * @return true if the result belonged to this Layer and the selection was updated
+ * @return false otherwise
+ */
+bool Layer::ApplyPickResult(PickResult *result)
+{
+	(void)result;
+	return false;
+}
+
+
 /**
  * @brief Used to inform the Layer object that the current timestep has
  * changed.
@@ -165,6 +354,16 @@ float Layer::GetMaxZ()
 }
 
 
+/**
+ * @brief Returns the number of Nodes in the Layer
+ * @return The number of Nodes as specified in the fort.14 file
+ */
+unsigned int Layer::GetNumNodes()
+{
+	return numNodes;
+}
+
+
 /**
  * @brief Returns a pointer to the requested Node.
  *
@@ -269,6 +468,73 @@ Element* Layer::GetElement(float x, float y)
 }
 
 
+/**
+ * @brief Returns the DirtyFlag values describing what changed since the Layer was last drawn.
+ *
+ * Subclasses that track changes elsewhere (eg. in a SelectionSet) should override this
+ * function and add their own flags to the result.
+ *
+ * @return A combination of Layer::DataDirty, Layer::UniformsDirty and Layer::SelectionDirty
+ * @return 0 if nothing has changed
+ */
+unsigned int Layer::GetDirtyFlags()
+{
+	// The levels of detail finishing in the background may change what is drawn
+	if (lodReady && lodIboID == 0 && lodLevels.size() > 0)
+		return dirtyFlags | DataDirty;
+	return dirtyFlags;
+}
+
+
+/**
+ * @brief Returns true if the proxy mesh has been built.
+ * @return true if the proxy mesh is ready to be drawn
+ */
+bool Layer::IsProxyReady()
+{
+	return proxyReady;
+}
+
+
+/**
+ * @brief Returns the number of levels of detail that have been built.
+ * @return The number of levels of detail, 0 until the background thread has finished
+ */
+unsigned int Layer::GetNumLODLevels()
+{
+	return lodReady ? lodLevels.size() : 0;
+}
+
+
+/**
+ * @brief Returns a level of detail.
+ *
+ * The vertex map of the level can be used to sample per-node values (eg. from a fort.63
+ * file) at the level. The level's indices are released once they have been loaded to
+ * the OpenGL context.
+ *
+ * @param level The level, from 0 (finest) to Layer::GetNumLODLevels()-1 (coarsest)
+ * @return A pointer to the level
+ * @return 0 if the level does not exist
+ */
+MeshLOD* Layer::GetLODLevel(unsigned int level)
+{
+	if (!lodReady || level >= lodLevels.size())
+		return 0;
+	return &lodLevels[level];
+}
+
+
+/**
+ * @brief Returns the level of detail that was drawn most recently.
+ * @return The level of detail, or -1 if the full resolution mesh (or the proxy mesh) was drawn
+ */
+int Layer::GetCurrentLODLevel()
+{
+	return currentLOD;
+}
+
+
 /**
  * @brief Returns a pointer to the currently selected Node.
  *
@@ -303,23 +569,45 @@ Element* Layer::GetSelectedElement()
 }
 
 
+/**
+ * @brief Returns the method used to find Nodes and Elements under the mouse.
+ * @return The Layer's picking mode
+ */
+Layer::PickingMode Layer::GetPickingMode()
+{
+	return pickingMode;
+}
+
+
 /**
  * @brief Sets the outline shader.
+ *
+ * The Layer's z-value range is passed to the new shader as the color range (see
+ * Layer::SetColorRange()).
+ *
  * @param newShader Pointer to the outline shader to be used when drawing.
  */
 void Layer::SetOutlineShader(GLShader *newShader)
 {
 	outlineShader = newShader;
+	SetColorRange(minZ, maxZ);
+	MarkDirty(UniformsDirty);
 }
 
 
 /**
  * @brief Sets the fill shader.
+ *
+ * The Layer's z-value range is passed to the new shader as the color range (see
+ * Layer::SetColorRange()).
+ *
  * @param newShader Pointer to the fill shader to be used when drawing.
  */
 void Layer::SetFillShader(GLShader *newShader)
 {
 	fillShader = newShader;
+	SetColorRange(minZ, maxZ);
+	MarkDirty(UniformsDirty);
 }
 
 
@@ -340,6 +628,119 @@ void Layer::SetFillShader(GLShader *newShader)
 void Layer::SetOffsetValue(GLfloat newOffset)
 {
 	offsetValue = newOffset;
+	MarkDirty(UniformsDirty);
+}
+
+
+/**
+ * @brief Sets the range of values used by the Layer's shaders to map data to colors.
+ *
+ * The minimum and maximum are passed to both the fill and outline shaders as Value1
+ * and Value2 of a UniformValues struct. Shaders that color by value (eg. GradientShader)
+ * only update their uniforms, so changing the range never reloads any data to the
+ * OpenGL context. Shaders that do not use the values ignore them.
+ *
+ * @param min The value mapped to the lowest color
+ * @param max The value mapped to the highest color
+ */
+void Layer::SetColorRange(float min, float max)
+{
+	UniformValues values;
+	values.Value1 = min;
+	values.Value2 = max;
+	if (fillShader)
+		fillShader->SetUniforms(0, &values);
+	if (outlineShader)
+		outlineShader->SetUniforms(0, &values);
+	MarkDirty(UniformsDirty);
+}
+
+
+/**
+ * @brief Sets the method used to find Nodes and Elements under the mouse.
+ *
+ * With Layer::QuadtreePicking (the default), subclasses search a CPU-side data structure
+ * with x-y coordinates (see Layer::GetNode(float, float)). With Layer::BufferPicking, the
+ * Layer is drawn into a GLPickingBuffer by Layer::DrawPicking() and the selection is
+ * updated from the pixel under the cursor by Layer::ApplyPickResult().
+ *
+ * @param newMode The new picking mode
+ */
+void Layer::SetPickingMode(PickingMode newMode)
+{
+	pickingMode = newMode;
+}
+
+
+/**
+ * @brief Tells the Layer if the camera is currently moving.
+ *
+ * While the camera is moving, Layer::DrawBase() draws the coarse proxy mesh (if it has
+ * been built) instead of the full resolution Layer. GLScene calls this function
+ * automatically based on camera activity.
+ *
+ * @param newInteracting true if the camera is moving
+ */
+void Layer::SetInteracting(bool newInteracting)
+{
+	interacting = newInteracting;
+}
+
+
+/**
+ * @brief Sets how much error is allowed when choosing a level of detail.
+ *
+ * The coarsest level of detail whose error covers no more than this many pixels on
+ * screen is drawn. A value of 0 always draws the full resolution mesh.
+ *
+ * @param pixels The allowed error in pixels (default 1.0)
+ */
+void Layer::SetLODTolerance(float pixels)
+{
+	lodTolerance = pixels > 0.0 ? pixels : 0.0;
+	MarkDirty(UniformsDirty);
+}
+
+
+/**
+ * @brief Sets if the Layer is only drawn with Layer::DrawSoftware().
+ *
+ * A software only Layer never loads anything to the OpenGL context, so it can read its
+ * files when no OpenGL context exists. This must be set before any data is read.
+ *
+ * @param newSoftwareOnly true if the Layer is only drawn by a MeshRasterizer (default false)
+ */
+void Layer::SetSoftwareOnly(bool newSoftwareOnly)
+{
+	softwareOnly = newSoftwareOnly;
+}
+
+
+/**
+ * @brief Flags part of the Layer as changed so that it is redrawn.
+ *
+ * Layer functions that change what is drawn call this function themselves. It only needs
+ * to be called directly when the Layer is changed from outside (eg. when the uniforms of a
+ * shader used by the Layer are set directly on the shader).
+ *
+ * @param flags A combination of Layer::DataDirty, Layer::UniformsDirty and Layer::SelectionDirty
+ */
+void Layer::MarkDirty(unsigned int flags)
+{
+	dirtyFlags |= flags;
+}
+
+
+/**
+ * @brief Marks the Layer as drawn.
+ *
+ * This function is called by GLScene after the Layer has been drawn. Subclasses that
+ * override Layer::GetDirtyFlags() should override this function as well.
+ *
+ */
+void Layer::ClearDirtyFlags()
+{
+	dirtyFlags = 0;
 }
 
 
@@ -364,17 +765,32 @@ void Layer::SetOffsetValue(GLfloat newOffset)
  * data (eg. water elevation data), you should override this function and use the appropriate
  * flag.
  *
- * Once data has been loaded to the OpenGL context, the Layer::glLoaded flag is set to true.
+ * Once data has been loaded to the OpenGL context, the Layer::glLoaded flag is set to true
+ * and the proxy mesh is built in the background (see Layer::BuildProxyMesh()).
+ *
+ * A warning is printed if the driver reports less free video memory than the Layer needs.
+ * Meshes that do not fit should be drawn with a ChunkedTerrainLayer.
+ *
+ * Nothing is loaded if the Layer is software only (see Layer::SetSoftwareOnly()).
  *
  */
 void Layer::LoadDataToGPU()
 {
-
-	// Dev Note: Probably smart to check buffer sizes against video card memory size
-	// because very large domains could be too large for smaller cards
+	if (softwareOnly)
+		return;
 
 	if (!glLoaded || vaoID == 0)
 	{
+		TRACE_SCOPE("gpu", "LoadDataToGPU");
+		GLProfileScope profile (layerID, GLProfiler::UploadSection);
+
+		// Very large domains can be too large for smaller cards, those should be converted
+		// with ChunkedMeshFile::Write() and drawn with a ChunkedTerrainLayer instead
+		const size_t RequiredMemory = 4*sizeof(GLfloat)*nodes.size() + 3*sizeof(GLuint)*elements.size();
+		const size_t AvailableMemory = GLResidencyManager::GetAvailableVideoMemory();
+		if (AvailableMemory > 0 && RequiredMemory > AvailableMemory)
+			DEBUG("Layer %i needs %lu bytes of video memory but only %lu bytes are free\n", layerID, (unsigned long)RequiredMemory, (unsigned long)AvailableMemory);
+
 		// Create the new VAO, VBO, and IBO
 		glGenVertexArrays(1, &vaoID);
 		glGenBuffers(1, &vboID);
@@ -386,6 +802,7 @@ void Layer::LoadDataToGPU()
 
 		// Load vertex data to the OpenGL context
 		const size_t VertexBufferSize = 4*sizeof(GLfloat)*nodes.size();
+		GLProfiler::AddBytes(VertexBufferSize);
 		glBindBuffer(GL_ARRAY_BUFFER, vboID);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), 0);
@@ -393,13 +810,7 @@ void Layer::LoadDataToGPU()
 		GLfloat *vdataPtr = (GLfloat *)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
 		if (vdataPtr)
 		{
-			for (unsigned int i=0; i<nodes.size(); i++)
-			{
-				vdataPtr[4*i+0] = (GLfloat)nodes[i].x;
-				vdataPtr[4*i+1] = (GLfloat)nodes[i].y;
-				vdataPtr[4*i+2] = (GLfloat)nodes[i].z;
-				vdataPtr[4*i+3] = (GLfloat)1.0;
-			}
+			PackVertexData(&nodes, vdataPtr);
 
 			if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE)
 			{
@@ -414,17 +825,13 @@ void Layer::LoadDataToGPU()
 
 		// Load index data to the OpenGL context
 		const size_t IndexBufferSize = 3*sizeof(GLuint)*elements.size();
+		GLProfiler::AddBytes(IndexBufferSize);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, IndexBufferSize, NULL, GL_STATIC_DRAW);
 		GLuint *idataPtr = (GLuint *)glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
 		if (idataPtr)
 		{
-			for (unsigned int i=0; i<elements.size(); i++)
-			{
-				idataPtr[3*i+0] = (GLuint)elements[i].n1-1;
-				idataPtr[3*i+1] = (GLuint)elements[i].n2-1;
-				idataPtr[3*i+2] = (GLuint)elements[i].n3-1;
-			}
+			PackIndexData(&elements, idataPtr);
 
 			if (glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_FALSE)
 			{
@@ -444,6 +851,8 @@ void Layer::LoadDataToGPU()
 		if (errorCheck == GL_NO_ERROR)
 		{
 			glLoaded = true;
+			MarkDirty(DataDirty);
+			BuildProxyMesh();
 		} else {
 			glLoaded = false;
 			DEBUG("OpenGL Error found after loading data from layer %i", layerID);
@@ -451,3 +860,361 @@ void Layer::LoadDataToGPU()
 
 	}
 }
+
+
+/**
+ * @brief Removes the Layer's data from the OpenGL context so that it can be loaded again.
+ *
+ * This function waits for the proxy mesh thread to finish, since it reads the Node and
+ * Element lists, and then deletes the vertex array object and every buffer object of the
+ * Layer. Once it returns, the Node and Element lists can be replaced, and the next call
+ * to Layer::LoadDataToGPU() uploads them as a new mesh.
+ *
+ */
+void Layer::UnloadDataFromGPU()
+{
+	if (proxyThread.joinable())
+		proxyThread.join();
+
+	proxyReady = false;
+	lodReady = false;
+	currentLOD = -1;
+	std::vector<GLuint>().swap(proxyIndices);
+	lodLevels.clear();
+	numProxyElements = 0;
+
+	if (vaoID)
+		glDeleteVertexArrays(1, &vaoID);
+	if (vboID)
+		glDeleteBuffers(1, &vboID);
+	if (iboID)
+		glDeleteBuffers(1, &iboID);
+	if (scalarBufferID)
+		glDeleteBuffers(1, &scalarBufferID);
+	if (proxyIboID)
+		glDeleteBuffers(1, &proxyIboID);
+	if (lodIboID)
+		glDeleteBuffers(1, &lodIboID);
+	vaoID = 0;
+	vboID = 0;
+	iboID = 0;
+	scalarBufferID = 0;
+	scalarBufferSize = 0;
+	proxyIboID = 0;
+	lodIboID = 0;
+
+	glLoaded = false;
+	MarkDirty(DataDirty);
+}
+
+
+/**
+ * @brief Packs Nodes into the vertex layout used by every Layer, [x, y, z, 1.0] per Node
+ *
+ * This is the loop that fills the mapped vertex buffer in Layer::LoadDataToGPU(). It is
+ * public so that it can be measured by the benchmarks without an OpenGL context.
+ *
+ * @param nodes A pointer to the node list
+ * @param vertexData Room for 4 values per Node
+ */
+void Layer::PackVertexData(std::vector<Node> *nodes, GLfloat *vertexData)
+{
+	const Node *nodeData = nodes->data();
+	const size_t count = nodes->size();
+	for (size_t i=0; i<count; i++)
+	{
+		vertexData[4*i+0] = (GLfloat)nodeData[i].x;
+		vertexData[4*i+1] = (GLfloat)nodeData[i].y;
+		vertexData[4*i+2] = (GLfloat)nodeData[i].z;
+		vertexData[4*i+3] = (GLfloat)1.0;
+	}
+}
+
+
+/**
+ * @brief Packs Elements into zero based node indices, 3 per Element
+ *
+ * This is the loop that fills the mapped index buffer in Layer::LoadDataToGPU().
+ *
+ * @param elements A pointer to the element list
+ * @param indexData Room for 3 indices per Element
+ */
+void Layer::PackIndexData(std::vector<Element> *elements, GLuint *indexData)
+{
+	const Element *elementData = elements->data();
+	const size_t count = elements->size();
+	for (size_t i=0; i<count; i++)
+	{
+		indexData[3*i+0] = (GLuint)elementData[i].n1-1;
+		indexData[3*i+1] = (GLuint)elementData[i].n2-1;
+		indexData[3*i+2] = (GLuint)elementData[i].n3-1;
+	}
+}
+
+
+/**
+ * @brief Transfers a per-node scalar value stream to the OpenGL context.
+ *
+ * This function is used to pass one scalar value per Node (eg. water elevation for the
+ * current timestep) to the OpenGL context as vertex attribute 1, alongside the packed
+ * position data in attribute 0. Values are densely packed in node order:
+ * - [s1, s2, s3, ...]
+ * .
+ *
+ * The scalar buffer is attached to the Layer's vertex array object the first time this
+ * function is called, and is created with the usage flag GL_DYNAMIC_DRAW since it is
+ * expected to change every timestep. Subsequent calls with the same number of values
+ * overwrite the existing buffer in place.
+ *
+ * Layer::LoadDataToGPU() must have been called successfully before calling this function.
+ *
+ * @param values A pointer to the scalar values
+ * @param count The number of scalar values
+ */
+void Layer::LoadScalarDataToGPU(float *values, unsigned int count)
+{
+	if (!glLoaded || vaoID == 0 || values == 0)
+		return;
+
+	TRACE_SCOPE("gpu", "LoadScalarDataToGPU");
+	GLProfileScope profile (layerID, GLProfiler::UploadSection);
+	const size_t ScalarBufferSize = sizeof(GLfloat)*count;
+	GLProfiler::AddBytes(ScalarBufferSize);
+
+	glBindVertexArray(vaoID);
+	if (scalarBufferID == 0)
+		glGenBuffers(1, &scalarBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, scalarBufferID);
+
+	if (ScalarBufferSize != scalarBufferSize)
+	{
+		glBufferData(GL_ARRAY_BUFFER, ScalarBufferSize, values, GL_DYNAMIC_DRAW);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat), 0);
+		scalarBufferSize = ScalarBufferSize;
+	} else {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, ScalarBufferSize, values);
+	}
+
+	glBindVertexArray(0);
+	MarkDirty(DataDirty);
+
+	if (glGetError() != GL_NO_ERROR)
+		DEBUG("OpenGL Error found after loading scalar data from layer %i", layerID);
+}
+
+
+/**
+ * @brief Draws the fill of a range of Elements.
+ *
+ * The Layer's vertex array object is bound, along with whichever index buffer it
+ * currently holds.
+ *
+ * @param firstElement The index of the first Element to draw
+ * @param count The number of Elements to draw
+ */
+void Layer::DrawFill(unsigned int firstElement, unsigned int count)
+{
+	GLProfileScope profile (layerID, GLProfiler::FillSection);
+	glBindVertexArray(vaoID);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glPolygonOffset(offsetValue + 1, offsetValue + 1);
+	if (fillShader->Use() == 0)
+		glDrawElements(GL_TRIANGLES, count*3, GL_UNSIGNED_INT, (GLuint*)0+3*firstElement);
+}
+
+
+/**
+ * @brief Draws the outline of a range of Elements.
+ *
+ * The Layer's vertex array object is bound, along with whichever index buffer it
+ * currently holds.
+ *
+ * @param firstElement The index of the first Element to draw
+ * @param count The number of Elements to draw
+ */
+void Layer::DrawOutline(unsigned int firstElement, unsigned int count)
+{
+	GLProfileScope profile (layerID, GLProfiler::OutlineSection);
+	glBindVertexArray(vaoID);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	glPolygonOffset(offsetValue, offsetValue);
+	if (outlineShader->Use() == 0)
+		glDrawElements(GL_TRIANGLES, count*3, GL_UNSIGNED_INT, (GLuint*)0+3*firstElement);
+}
+
+
+/**
+ * @brief Starts building the proxy mesh and levels of detail on a background thread.
+ *
+ * The proxy mesh is a coarse version of the Layer built quickly with
+ * MeshDecimator::ClusterVertices(). The levels of detail are built afterwards with
+ * MeshDecimator::QuadricSimplify(). Both share the Layer's vertex buffer object, so
+ * only index buffers are needed to draw them. Layers with fewer than
+ * ProxyElementThreshold Elements are cheap enough to draw at full resolution and do not
+ * get reduced meshes.
+ *
+ * The Node and Element lists must not be modified while the thread is running. The index
+ * buffers are created on the OpenGL thread the first time the reduced meshes are drawn.
+ *
+ */
+void Layer::BuildProxyMesh()
+{
+	if (proxyThread.joinable())
+		proxyThread.join();
+
+	proxyReady = false;
+	lodReady = false;
+	currentLOD = -1;
+	if (lodIboID)
+		glDeleteBuffers(1, &lodIboID);
+	lodIboID = 0;
+	if (elements.size() < ProxyElementThreshold)
+		return;
+
+	proxyThread = std::thread([this]() {
+		TRACE_THREAD_NAME("Layer reduced meshes");
+		std::vector<GLuint> indices;
+		if (MeshDecimator::ClusterVertices(&nodes, &elements, nodes.size()/ProxyReduction, &indices) == 0)
+		{
+			proxyIndices.swap(indices);
+			proxyReady = true;
+		}
+
+		std::vector<MeshLOD> levels;
+		if (MeshDecimator::QuadricSimplify(&nodes, &elements, LODMinElements, LODReduction, &levels) == 0)
+		{
+			lodLevels.swap(levels);
+			lodReady = true;
+		}
+	});
+}
+
+
+/**
+ * @brief Transfers the proxy mesh indices to the OpenGL context.
+ *
+ * This function does nothing until the background thread has finished building the
+ * proxy mesh, and only uploads the indices once. The CPU copy of the indices is
+ * released after uploading.
+ *
+ */
+void Layer::LoadProxyToGPU()
+{
+	if (!proxyReady || proxyIndices.size() == 0)
+		return;
+
+	TRACE_SCOPE("gpu", "LoadProxyToGPU");
+	GLProfileScope profile (layerID, GLProfiler::UploadSection);
+	GLProfiler::AddBytes(proxyIndices.size()*sizeof(GLuint));
+	if (proxyIboID == 0)
+		glGenBuffers(1, &proxyIboID);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, proxyIboID);
+	glBufferData(GL_COPY_WRITE_BUFFER, proxyIndices.size()*sizeof(GLuint), &proxyIndices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	numProxyElements = proxyIndices.size()/3;
+	std::vector<GLuint>().swap(proxyIndices);
+}
+
+
+/**
+ * @brief Transfers the levels of detail to the OpenGL context.
+ *
+ * Every level is packed into one index buffer object, one after the other, and the first
+ * Element of each level is kept in Layer::lodFirstElements. This function does nothing
+ * until the background thread has finished, and only uploads the levels once. The CPU
+ * copies of the indices are released after uploading, but the vertex maps are kept.
+ *
+ */
+void Layer::LoadLODToGPU()
+{
+	if (!lodReady || lodIboID != 0 || lodLevels.size() == 0)
+		return;
+
+	size_t totalElements = 0;
+	lodFirstElements.resize(lodLevels.size());
+	for (unsigned int i=0; i<lodLevels.size(); i++)
+	{
+		lodFirstElements[i] = totalElements;
+		totalElements += lodLevels[i].numElements;
+	}
+
+	TRACE_SCOPE("gpu", "LoadLODToGPU");
+	GLProfileScope profile (layerID, GLProfiler::UploadSection);
+	GLProfiler::AddBytes(3*sizeof(GLuint)*totalElements);
+	glGenBuffers(1, &lodIboID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, lodIboID);
+	glBufferData(GL_COPY_WRITE_BUFFER, 3*sizeof(GLuint)*totalElements, NULL, GL_STATIC_DRAW);
+	for (unsigned int i=0; i<lodLevels.size(); i++)
+	{
+		glBufferSubData(GL_COPY_WRITE_BUFFER, 3*sizeof(GLuint)*lodFirstElements[i], 3*sizeof(GLuint)*lodLevels[i].numElements, &lodLevels[i].indices[0]);
+		std::vector<GLuint>().swap(lodLevels[i].indices);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (glGetError() != GL_NO_ERROR)
+		DEBUG("OpenGL Error found after loading levels of detail from layer %i", layerID);
+}
+
+
+/**
+ * @brief Chooses the mesh drawn by the base pass.
+ *
+ * While the camera is moving and the proxy mesh is ready, the proxy mesh is chosen.
+ * Otherwise the coarsest level of detail whose error is no larger than the LOD tolerance
+ * on screen is chosen, using the fill shader's camera and the current viewport. The
+ * projected error is measured at the corner of the Layer's bounding box that is closest
+ * to the camera. If no level is good enough, the full resolution mesh is chosen.
+ *
+ * @param indexBuffer A pointer to the variable that will hold the index buffer to draw from
+ * @param firstElement A pointer to the variable that will hold the first Element to draw
+ * @param count A pointer to the variable that will hold the number of Elements to draw
+ */
+void Layer::SelectBaseMesh(GLuint *indexBuffer, unsigned int *firstElement, unsigned int *count)
+{
+	*indexBuffer = iboID;
+	*firstElement = 0;
+	*count = numElements;
+	currentLOD = -1;
+
+	if (interacting && proxyReady)
+	{
+		LoadProxyToGPU();
+		if (proxyIboID != 0)
+		{
+			*indexBuffer = proxyIboID;
+			*count = numProxyElements;
+			return;
+		}
+	}
+
+	LoadLODToGPU();
+	GLCamera *camera = fillShader ? fillShader->GetCamera() : 0;
+	if (lodIboID == 0 || camera == 0 || lodTolerance <= 0.0)
+		return;
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float pixelsPerUnit = 0.0;
+	for (int i=0; i<8; i++)
+	{
+		float x = i & 1 ? maxX : minX;
+		float y = i & 2 ? maxY : minY;
+		float z = i & 4 ? maxZ : minZ;
+		pixelsPerUnit = std::max(pixelsPerUnit, camera->GetPixelsPerUnit(x, y, z, viewport[3]));
+	}
+
+	for (int level=lodLevels.size()-1; level>=0; level--)
+	{
+		if (lodLevels[level].error*pixelsPerUnit <= lodTolerance)
+		{
+			*indexBuffer = lodIboID;
+			*firstElement = lodFirstElements[level];
+			*count = lodLevels[level].numElements;
+			currentLOD = level;
+			return;
+		}
+	}
+}
@@ -2,9 +2,15 @@
 #define LAYER_H
 
 #include "adcData.h"
+#include "MeshDecimator.h"
 #include "../Shaders/GLShader.h"
+#include "../Shaders/PickingShader.h"
+#include "../OpenGL/GLPickingBuffer.h"
+#include "../Rasterizer/MeshRasterizer.h"
 
 #include <vector>
+#include <thread>
+#include <atomic>
 
 /**
  * @brief A generic class that defines the behavior of an ADCIRC layer
@@ -20,18 +26,53 @@
  * - Set all appropriate shaders.
  * - Draw the Layer by calling Layer::Draw()
  *
+ * Drawing is split into a base pass (Layer::DrawBase(), eg. fill and outline) and an
+ * overlay pass (Layer::DrawOverlay(), eg. selected Nodes and Elements). Every Layer also
+ * keeps a set of DirtyFlag values so that a GLScene only redraws what has changed.
+ *
+ * Large Layers also build reduced versions of themselves in the background: a coarse
+ * proxy mesh that is drawn while the camera is moving, and a chain of levels of detail
+ * that are drawn instead of the full resolution mesh when their error is smaller than the
+ * LOD tolerance on screen (see Layer::SetLODTolerance()).
+ *
  */
 class Layer
 {
 	public:
+
+		/**
+		 * @brief Defines how the Layer finds Nodes and Elements under the mouse
+		 */
+		enum PickingMode {
+			QuadtreePicking,	/**< Search a CPU-side index (eg. a NodePicker) with the clicked x-y coordinates */
+			BufferPicking		/**< Read the Element under the cursor from a GLPickingBuffer */
+		};
+
+		/**
+		 * @brief Flags that describe what has changed in a Layer since it was last drawn
+		 */
+		enum DirtyFlag {
+			DataDirty = 1,		/**< Vertex, index or scalar data was loaded to the OpenGL context */
+			UniformsDirty = 2,	/**< Shaders, colors, color range or offset changed */
+			SelectionDirty = 4	/**< The selected Nodes or Elements changed */
+		};
+
 		Layer();
+		virtual ~Layer();
 
 		virtual void	Draw();
+		virtual void	DrawBase();
+		virtual bool	DrawBaseProgressive(unsigned int *progress, unsigned int budget);
+		virtual void	DrawOverlay();
+		virtual void	DrawPicking(PickingShader *shader);
+		virtual void	DrawSoftware(MeshRasterizer *rasterizer);
+		virtual bool	ApplyPickResult(PickResult *result);
 		virtual void	UpdateTimestep(int timestep);
 
 		// Getter Methods
 		unsigned int	GetID();
 		unsigned int	GetNumLayers();
+		unsigned int	GetNumNodes();
 		float		GetMinX();
 		float		GetMaxX();
 		float		GetMinY();
@@ -44,11 +85,28 @@ class Layer
 		virtual Element*	GetElement(float x, float y);
 		virtual Node*		GetSelectedNode();
 		virtual Element*	GetSelectedElement();
+		PickingMode		GetPickingMode();
+		bool			IsProxyReady();
+		unsigned int		GetNumLODLevels();
+		MeshLOD*		GetLODLevel(unsigned int level);
+		int			GetCurrentLODLevel();
+		virtual unsigned int	GetDirtyFlags();
 
 		// Setter Methods
 		void		SetOutlineShader(GLShader* newShader);
 		void		SetFillShader(GLShader* newShader);
 		void		SetOffsetValue(GLfloat newOffset);
+		void		SetColorRange(float min, float max);
+		void		SetPickingMode(PickingMode newMode);
+		void		SetInteracting(bool newInteracting);
+		void		SetLODTolerance(float pixels);
+		void		SetSoftwareOnly(bool newSoftwareOnly);
+		void		MarkDirty(unsigned int flags);
+		virtual void	ClearDirtyFlags();
+
+		// Vertex Packing
+		static void	PackVertexData(std::vector<Node> *nodes, GLfloat *vertexData);
+		static void	PackIndexData(std::vector<Element> *elements, GLuint *indexData);
 
 	protected:
 
@@ -68,21 +126,50 @@ class Layer
 		// Generic Picking Variables
 		Node*		selectedNode;		/**< The currently selected Node */
 		Element*	selectedElement;	/**< The currently selected Element */
+		PickingMode	pickingMode;		/**< The method used to find Nodes and Elements under the mouse */
 
 		// Flags
-		bool	glLoaded;			/**< Flag shows if the data has been loaded to the OpenGL context */
+		bool		glLoaded;		/**< Flag shows if the data has been loaded to the OpenGL context */
+		unsigned int	dirtyFlags;		/**< The DirtyFlag values describing what changed since the Layer was last drawn */
+		bool		interacting;		/**< Flag shows if the camera is moving, in which case the proxy mesh is drawn */
+		bool		softwareOnly;		/**< Flag shows if the Layer is only drawn with a MeshRasterizer, in which case nothing is loaded to the OpenGL context */
 
 		// OpenGL Variables
 		GLuint		vaoID;			/**< The vertex array object ID */
 		GLuint		vboID;			/**< The vertex buffer object ID */
 		GLuint		iboID;			/**< The index buffer object ID */
+		GLuint		scalarBufferID;		/**< The scalar attribute buffer object ID */
+		size_t		scalarBufferSize;	/**< The size of the scalar attribute buffer in bytes */
 		GLShader*	outlineShader;		/**< Pointer to the shader used for drawing outlines */
 		GLShader*	fillShader;		/**< Pointer to the shader used for drawing fill */
 		GLfloat		offsetValue;		/**< The value used to prevent z-fighting during draw operations */
 		static GLfloat	outlineOffset;		/**< The value used to prevent z-fighting between the fill and outline */
 
+		// Proxy Mesh Variables
+		std::vector<GLuint>	proxyIndices;		/**< The proxy mesh indices built on the background thread */
+		std::atomic<bool>	proxyReady;		/**< Set to true by the background thread when proxyIndices is complete */
+		std::thread		proxyThread;		/**< The background thread that builds the proxy mesh */
+		GLuint			proxyIboID;		/**< The proxy mesh index buffer object ID */
+		unsigned int		numProxyElements;	/**< The number of Elements in the proxy mesh */
+
+		// Level of Detail Variables
+		std::vector<MeshLOD>		lodLevels;		/**< The levels of detail built on the background thread, finest first */
+		std::vector<unsigned int>	lodFirstElements;	/**< The first Element of each level in the level of detail index buffer */
+		std::atomic<bool>		lodReady;		/**< Set to true by the background thread when lodLevels is complete */
+		GLuint				lodIboID;		/**< The index buffer object holding every level of detail */
+		float				lodTolerance;		/**< The largest error, in pixels, allowed when choosing a level of detail */
+		int				currentLOD;		/**< The level of detail drawn last, or -1 for full resolution */
+
 		// Protected Functions
 		virtual void	LoadDataToGPU();
+		void		UnloadDataFromGPU();
+		void		DrawFill(unsigned int firstElement, unsigned int count);
+		void		DrawOutline(unsigned int firstElement, unsigned int count);
+		void		BuildProxyMesh();
+		void		LoadProxyToGPU();
+		void		LoadLODToGPU();
+		void		SelectBaseMesh(GLuint *indexBuffer, unsigned int *firstElement, unsigned int *count);
+		virtual void	LoadScalarDataToGPU(float *values, unsigned int count);
 
 
 	private:
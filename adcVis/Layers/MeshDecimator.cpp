@@ -0,0 +1,640 @@
+#include "MeshDecimator.h"
+#include "../IO/TraceWriter.h"
+
+#include <algorithm>
+#include <queue>
+#include <iterator>
+#include <math.h>
+
+
+// Boundary constraint planes are weighted this many times more than the Elements' planes
+static const double BoundaryWeight = 1000.0;
+
+
+/**
+ * @brief A triangle of node indices that can be sorted and compared
+ */
+struct ProxyTriangle {
+		GLuint	n[3];	/**< The three node indices, rotated so that the smallest comes first */
+
+		bool operator<(const ProxyTriangle &other) const
+		{
+			if (n[0] != other.n[0])
+				return n[0] < other.n[0];
+			if (n[1] != other.n[1])
+				return n[1] < other.n[1];
+			return n[2] < other.n[2];
+		}
+
+		bool operator==(const ProxyTriangle &other) const
+		{
+			return n[0] == other.n[0] && n[1] == other.n[1] && n[2] == other.n[2];
+		}
+};
+
+
+/**
+ * @brief A symmetric 4x4 error quadric (Garland and Heckbert) and the Element area it covers
+ */
+struct Quadric {
+		double	q[10];	/**< The upper triangle of the matrix: a2, ab, ac, ad, b2, bc, bd, c2, cd, d2 */
+		double	area;	/**< The total area of the Element planes in the quadric */
+
+		Quadric()
+		{
+			for (int i=0; i<10; i++)
+				q[i] = 0.0;
+			area = 0.0;
+		}
+
+		void AddPlane(double a, double b, double c, double d, double weight)
+		{
+			q[0] += weight*a*a; q[1] += weight*a*b; q[2] += weight*a*c; q[3] += weight*a*d;
+			q[4] += weight*b*b; q[5] += weight*b*c; q[6] += weight*b*d;
+			q[7] += weight*c*c; q[8] += weight*c*d;
+			q[9] += weight*d*d;
+		}
+
+		void Add(const Quadric &other)
+		{
+			for (int i=0; i<10; i++)
+				q[i] += other.q[i];
+			area += other.area;
+		}
+
+		double Evaluate(const double *p) const
+		{
+			double x = p[0], y = p[1], z = p[2];
+			return q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x
+					+ q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y
+					+ q[7]*z*z + 2*q[8]*z
+					+ q[9];
+		}
+};
+
+
+/**
+ * @brief A candidate collapse of one Node onto a neighboring Node
+ */
+struct Collapse {
+		double		cost;		/**< The quadric error of the collapse */
+		GLuint		from;		/**< The Node that is removed */
+		GLuint		to;		/**< The Node that replaces it */
+		unsigned int	version;	/**< The version of the removed Node when the collapse was computed */
+
+		bool operator<(const Collapse &other) const
+		{
+			return cost > other.cost;
+		}
+};
+
+
+/**
+ * @brief The working state of QuadricSimplify()
+ */
+struct Simplifier {
+		std::vector<double>			positions;	/**< The Node positions [x1, y1, z1, ...] */
+		std::vector<GLuint>			triangles;	/**< The Node indices of every valid Element */
+		std::vector<char>			triangleAlive;	/**< Set to 0 when a triangle collapses */
+		std::vector<std::vector<GLuint> >	nodeTriangles;	/**< The triangles around every Node, may contain dead triangles */
+		std::vector<Quadric>			quadrics;	/**< The error quadric of every Node */
+		std::vector<GLuint>			parent;		/**< The Node each Node was collapsed onto, or itself */
+		std::vector<unsigned int>		versions;	/**< Incremented whenever a Node's neighborhood changes */
+		std::vector<char>			boundary;	/**< Set to 1 for Nodes on the boundary of the mesh */
+		std::priority_queue<Collapse>		heap;		/**< The candidate collapses, cheapest first */
+		unsigned int				numAlive;	/**< The number of triangles that have not collapsed */
+		std::vector<GLuint>			neighborsU;	/**< Scratch space for IsValid() */
+		std::vector<GLuint>			neighborsV;	/**< Scratch space for IsValid() */
+		std::vector<GLuint>			common;		/**< Scratch space for IsValid() */
+
+		void		Neighbors(GLuint u, std::vector<GLuint> *result);
+		unsigned int	SharedTriangles(GLuint u, GLuint v);
+		bool		IsValid(GLuint u, GLuint v);
+		void		ComputeCollapse(GLuint u);
+		void		ApplyCollapse(GLuint u, GLuint v);
+		GLuint		Root(GLuint u);
+};
+
+
+/**
+ * @brief Finds the live Nodes that share a live triangle with a Node
+ * @param u The Node
+ * @param result A pointer to the vector that will hold the sorted neighbors
+ */
+void Simplifier::Neighbors(GLuint u, std::vector<GLuint> *result)
+{
+	result->clear();
+	std::vector<GLuint> &tris = nodeTriangles[u];
+	for (unsigned int i=0; i<tris.size(); i++)
+	{
+		if (!triangleAlive[tris[i]])
+			continue;
+		for (int j=0; j<3; j++)
+		{
+			GLuint n = triangles[3*tris[i]+j];
+			if (n != u)
+				result->push_back(n);
+		}
+	}
+	std::sort(result->begin(), result->end());
+	result->erase(std::unique(result->begin(), result->end()), result->end());
+}
+
+
+/**
+ * @brief Counts the live triangles that contain both Nodes
+ * @param u The first Node
+ * @param v The second Node
+ * @return The number of live triangles on the edge between the Nodes
+ */
+unsigned int Simplifier::SharedTriangles(GLuint u, GLuint v)
+{
+	unsigned int count = 0;
+	std::vector<GLuint> &tris = nodeTriangles[u];
+	for (unsigned int i=0; i<tris.size(); i++)
+	{
+		GLuint *t = &triangles[3*tris[i]];
+		if (triangleAlive[tris[i]] && (t[0] == v || t[1] == v || t[2] == v))
+			count++;
+	}
+	return count;
+}
+
+
+/**
+ * @brief Checks that collapsing a Node onto a neighbor keeps the mesh valid
+ *
+ * A collapse is rejected if it would:
+ * - Move a boundary Node along an edge that is not on the boundary
+ * - Join two parts of the mesh that only touch at the collapsed edge (the link condition)
+ * - Flip or flatten any of the remaining triangles in the x-y plane
+ * .
+ *
+ * @param u The Node to remove
+ * @param v The Node to collapse it onto
+ * @return true if the collapse is valid
+ */
+bool Simplifier::IsValid(GLuint u, GLuint v)
+{
+	unsigned int shared = SharedTriangles(u, v);
+	if (shared == 0 || (boundary[u] && shared != 1))
+		return false;
+
+	// The only common neighbors must be the Nodes opposite the collapsed edge
+	Neighbors(u, &neighborsU);
+	Neighbors(v, &neighborsV);
+	common.clear();
+	std::set_intersection(neighborsU.begin(), neighborsU.end(), neighborsV.begin(), neighborsV.end(), std::back_inserter(common));
+	if (common.size() != shared)
+		return false;
+
+	// None of the triangles that move with u may flip
+	const double *pv = &positions[3*v];
+	std::vector<GLuint> &tris = nodeTriangles[u];
+	for (unsigned int i=0; i<tris.size(); i++)
+	{
+		GLuint *t = &triangles[3*tris[i]];
+		if (!triangleAlive[tris[i]] || t[0] == v || t[1] == v || t[2] == v)
+			continue;
+
+		const double *p[3], *q[3];
+		for (int j=0; j<3; j++)
+		{
+			p[j] = &positions[3*t[j]];
+			q[j] = t[j] == u ? pv : p[j];
+		}
+		double before = (p[1][0]-p[0][0])*(p[2][1]-p[0][1]) - (p[2][0]-p[0][0])*(p[1][1]-p[0][1]);
+		double after = (q[1][0]-q[0][0])*(q[2][1]-q[0][1]) - (q[2][0]-q[0][0])*(q[1][1]-q[0][1]);
+		if (before*after <= 0.0 || fabs(after) < 1e-3*fabs(before))
+			return false;
+	}
+	return true;
+}
+
+
+/**
+ * @brief Finds the cheapest valid collapse of a Node and adds it to the heap
+ * @param u The Node
+ */
+void Simplifier::ComputeCollapse(GLuint u)
+{
+	versions[u]++;
+	if (parent[u] != u)
+		return;
+
+	std::vector<GLuint> neighbors;
+	Neighbors(u, &neighbors);
+
+	// Only the cheapest collapses need to be checked for validity
+	std::vector<std::pair<double, GLuint> > candidates (neighbors.size());
+	for (unsigned int i=0; i<neighbors.size(); i++)
+	{
+		GLuint v = neighbors[i];
+		Quadric q = quadrics[u];
+		q.Add(quadrics[v]);
+		double cost = q.Evaluate(&positions[3*v]);
+		candidates[i] = std::make_pair(cost > 0.0 ? cost : 0.0, v);
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for (unsigned int i=0; i<candidates.size(); i++)
+	{
+		if (IsValid(u, candidates[i].second))
+		{
+			Collapse best;
+			best.cost = candidates[i].first;
+			best.from = u;
+			best.to = candidates[i].second;
+			best.version = versions[u];
+			heap.push(best);
+			return;
+		}
+	}
+}
+
+
+/**
+ * @brief Collapses a Node onto a neighbor
+ * @param u The Node to remove
+ * @param v The Node that replaces it
+ */
+void Simplifier::ApplyCollapse(GLuint u, GLuint v)
+{
+	std::vector<GLuint> &trisU = nodeTriangles[u];
+	std::vector<GLuint> &trisV = nodeTriangles[v];
+	for (unsigned int i=0; i<trisU.size(); i++)
+	{
+		GLuint tri = trisU[i];
+		if (!triangleAlive[tri])
+			continue;
+
+		GLuint *t = &triangles[3*tri];
+		if (t[0] == v || t[1] == v || t[2] == v)
+		{
+			triangleAlive[tri] = 0;
+			numAlive--;
+		} else {
+			for (int j=0; j<3; j++)
+				if (t[j] == u)
+					t[j] = v;
+			trisV.push_back(tri);
+		}
+	}
+	std::vector<GLuint>().swap(trisU);
+
+	// Drop the dead triangles around v
+	unsigned int count = 0;
+	for (unsigned int i=0; i<trisV.size(); i++)
+		if (triangleAlive[trisV[i]])
+			trisV[count++] = trisV[i];
+	trisV.resize(count);
+
+	quadrics[v].Add(quadrics[u]);
+	parent[u] = v;
+}
+
+
+/**
+ * @brief Finds the live Node that an original Node has been collapsed onto
+ * @param u The original Node
+ * @return The live Node that represents it
+ */
+GLuint Simplifier::Root(GLuint u)
+{
+	GLuint root = u;
+	while (parent[root] != root)
+		root = parent[root];
+	while (parent[u] != root)
+	{
+		GLuint next = parent[u];
+		parent[u] = root;
+		u = next;
+	}
+	return root;
+}
+
+
+/**
+ * @brief Builds a proxy mesh by clustering Nodes on a uniform grid
+ *
+ * The bounding box of the Nodes is divided into a uniform grid with roughly targetNodes
+ * cells. Every Node is assigned to a cell, and the Node closest to the center of each cell
+ * becomes the representative of every Node in that cell. Each Element is then redrawn
+ * between the representatives of its three Nodes. Elements that collapse (two or more
+ * Nodes share a representative) and duplicate Elements are removed. Element orientation
+ * is preserved.
+ *
+ * The result is densely packed in the same order Layer::LoadDataToGPU() uses for the index
+ * buffer object:
+ * - [e1n1, e1n2, e1n3, e2n1, e2n2, e2n3, ...]
+ * .
+ *
+ * This function does not modify the Node and Element lists and does not use the OpenGL
+ * context, so it can be run on a background thread as long as the lists are not modified
+ * while it runs.
+ *
+ * @param nodes A pointer to the node list
+ * @param elements A pointer to the element list
+ * @param targetNodes The approximate number of Nodes in the proxy mesh
+ * @param indices A pointer to the vector that will hold the proxy mesh indices
+ * @return 0 if the proxy mesh was built
+ * @return 1 if an error occurred
+ */
+int MeshDecimator::ClusterVertices(std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int targetNodes, std::vector<GLuint> *indices)
+{
+	if (nodes == 0 || elements == 0 || indices == 0 || nodes->size() == 0 || targetNodes == 0)
+		return 1;
+
+	TRACE_SCOPE("index", "ClusterVertices");
+
+	const unsigned int numNodes = nodes->size();
+
+	// Find the bounding box of the nodes
+	float minX = (*nodes)[0].x, maxX = (*nodes)[0].x;
+	float minY = (*nodes)[0].y, maxY = (*nodes)[0].y;
+	for (unsigned int i=1; i<numNodes; i++)
+	{
+		minX = std::min(minX, (*nodes)[i].x);
+		maxX = std::max(maxX, (*nodes)[i].x);
+		minY = std::min(minY, (*nodes)[i].y);
+		maxY = std::max(maxY, (*nodes)[i].y);
+	}
+
+	// Size the grid so that it has roughly targetNodes square cells
+	float width = std::max(maxX - minX, 1e-12f);
+	float height = std::max(maxY - minY, 1e-12f);
+	float cellSize = sqrt(width*height/targetNodes);
+	unsigned int cellsX = std::max(1u, (unsigned int)ceil(width/cellSize));
+	unsigned int cellsY = std::max(1u, (unsigned int)ceil(height/cellSize));
+
+	// Find the node closest to the center of each cell
+	const GLuint NoNode = 0xFFFFFFFF;
+	std::vector<GLuint> cellNode (cellsX*cellsY, NoNode);
+	std::vector<float> cellDistance (cellsX*cellsY, 0.0);
+	std::vector<GLuint> nodeCell (numNodes);
+	for (unsigned int i=0; i<numNodes; i++)
+	{
+		float fx = ((*nodes)[i].x - minX)/cellSize;
+		float fy = ((*nodes)[i].y - minY)/cellSize;
+		unsigned int cx = std::min(cellsX-1, (unsigned int)fx);
+		unsigned int cy = std::min(cellsY-1, (unsigned int)fy);
+		unsigned int cell = cy*cellsX + cx;
+		float dx = fx - cx - 0.5;
+		float dy = fy - cy - 0.5;
+		float distance = dx*dx + dy*dy;
+
+		nodeCell[i] = cell;
+		if (cellNode[cell] == NoNode || distance < cellDistance[cell])
+		{
+			cellNode[cell] = i;
+			cellDistance[cell] = distance;
+		}
+	}
+
+	// Redraw every element between the representatives of its nodes
+	std::vector<ProxyTriangle> triangles;
+	triangles.reserve(elements->size()/4);
+	for (unsigned int i=0; i<elements->size(); i++)
+	{
+		Element *currElement = &(*elements)[i];
+		if (currElement->n1 == 0 || currElement->n2 == 0 || currElement->n3 == 0 ||
+		    currElement->n1 > numNodes || currElement->n2 > numNodes || currElement->n3 > numNodes)
+			continue;
+
+		GLuint a = cellNode[nodeCell[currElement->n1-1]];
+		GLuint b = cellNode[nodeCell[currElement->n2-1]];
+		GLuint c = cellNode[nodeCell[currElement->n3-1]];
+		if (a == b || b == c || a == c)
+			continue;
+
+		// Rotate so that the smallest index comes first, keeping the orientation
+		ProxyTriangle t;
+		if (a < b && a < c)
+		{
+			t.n[0] = a; t.n[1] = b; t.n[2] = c;
+		} else if (b < c) {
+			t.n[0] = b; t.n[1] = c; t.n[2] = a;
+		} else {
+			t.n[0] = c; t.n[1] = a; t.n[2] = b;
+		}
+		triangles.push_back(t);
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+	triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+	indices->resize(3*triangles.size());
+	for (unsigned int i=0; i<triangles.size(); i++)
+	{
+		(*indices)[3*i+0] = triangles[i].n[0];
+		(*indices)[3*i+1] = triangles[i].n[1];
+		(*indices)[3*i+2] = triangles[i].n[2];
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Builds a chain of levels of detail with quadric error edge collapses
+ *
+ * Every Node starts with the error quadric of the planes of its Elements, weighted by
+ * Element area (Garland and Heckbert). Nodes on the boundary of the mesh also get a
+ * heavily weighted constraint plane along each boundary edge, and may only be collapsed
+ * along the boundary, so the outline of the domain is preserved.
+ *
+ * Nodes are collapsed onto their neighbors (half-edge collapses) cheapest first. Because
+ * the surviving Nodes never move, every level only contains indices into the original Node
+ * list and can be drawn from the full resolution vertex buffer object. A level is recorded
+ * every time the number of Elements falls below 1/reduction of the previous level, until
+ * fewer than minElements remain or no more valid collapses exist.
+ *
+ * The error of a level is the largest distance (in world units) that any collapse so far
+ * moved the surface, estimated from the quadric error and the area it covers.
+ *
+ * Like ClusterVertices(), this function does not modify the Node and Element lists and
+ * does not use the OpenGL context.
+ *
+ * @param nodes A pointer to the node list
+ * @param elements A pointer to the element list
+ * @param minElements Simplification stops once a level has fewer Elements than this
+ * @param reduction Each level has roughly this many times fewer Elements than the last (at least 2)
+ * @param levels A pointer to the vector that will hold the levels, finest first
+ * @return 0 if at least one level was built
+ * @return 1 if an error occurred
+ */
+int MeshDecimator::QuadricSimplify(std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int minElements, unsigned int reduction, std::vector<MeshLOD> *levels)
+{
+	if (nodes == 0 || elements == 0 || levels == 0 || nodes->size() == 0 || reduction < 2)
+		return 1;
+
+	TRACE_SCOPE("index", "QuadricSimplify");
+
+	const unsigned int numNodes = nodes->size();
+	Simplifier s;
+
+	s.positions.resize(3*numNodes);
+	for (unsigned int i=0; i<numNodes; i++)
+	{
+		s.positions[3*i+0] = (*nodes)[i].x;
+		s.positions[3*i+1] = (*nodes)[i].y;
+		s.positions[3*i+2] = (*nodes)[i].z;
+	}
+
+	s.triangles.reserve(3*elements->size());
+	for (unsigned int i=0; i<elements->size(); i++)
+	{
+		Element *currElement = &(*elements)[i];
+		if (currElement->n1 == 0 || currElement->n2 == 0 || currElement->n3 == 0 ||
+		    currElement->n1 > numNodes || currElement->n2 > numNodes || currElement->n3 > numNodes ||
+		    currElement->n1 == currElement->n2 || currElement->n2 == currElement->n3 || currElement->n1 == currElement->n3)
+			continue;
+		s.triangles.push_back(currElement->n1-1);
+		s.triangles.push_back(currElement->n2-1);
+		s.triangles.push_back(currElement->n3-1);
+	}
+
+	const unsigned int numTriangles = s.triangles.size()/3;
+	if (numTriangles == 0)
+		return 1;
+
+	s.triangleAlive.assign(numTriangles, 1);
+	s.numAlive = numTriangles;
+	s.nodeTriangles.resize(numNodes);
+	s.quadrics.resize(numNodes);
+	s.parent.resize(numNodes);
+	s.versions.assign(numNodes, 0);
+	s.boundary.assign(numNodes, 0);
+	for (unsigned int i=0; i<numNodes; i++)
+		s.parent[i] = i;
+
+	// Build the Element plane quadrics
+	std::vector<double> normals (3*numTriangles);
+	for (unsigned int t=0; t<numTriangles; t++)
+	{
+		const double *p0 = &s.positions[3*s.triangles[3*t+0]];
+		const double *p1 = &s.positions[3*s.triangles[3*t+1]];
+		const double *p2 = &s.positions[3*s.triangles[3*t+2]];
+		double e1[3] = {p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2]};
+		double e2[3] = {p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2]};
+		double n[3] = {e1[1]*e2[2]-e1[2]*e2[1], e1[2]*e2[0]-e1[0]*e2[2], e1[0]*e2[1]-e1[1]*e2[0]};
+		double length = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+		if (length <= 0.0)
+			continue;
+
+		n[0] /= length; n[1] /= length; n[2] /= length;
+		normals[3*t+0] = n[0]; normals[3*t+1] = n[1]; normals[3*t+2] = n[2];
+		double d = -(n[0]*p0[0] + n[1]*p0[1] + n[2]*p0[2]);
+		double area = 0.5*length;
+		for (int j=0; j<3; j++)
+		{
+			GLuint node = s.triangles[3*t+j];
+			s.quadrics[node].AddPlane(n[0], n[1], n[2], d, area);
+			s.quadrics[node].area += area;
+			s.nodeTriangles[node].push_back(t);
+		}
+	}
+
+	// Find the boundary edges (edges used by only one Element) and constrain them
+	std::vector<unsigned long long> edges (3*numTriangles);
+	for (unsigned int t=0; t<numTriangles; t++)
+	{
+		for (int j=0; j<3; j++)
+		{
+			unsigned long long a = s.triangles[3*t+j];
+			unsigned long long b = s.triangles[3*t+(j+1)%3];
+			edges[3*t+j] = a < b ? (a << 32 | b) : (b << 32 | a);
+		}
+	}
+	std::vector<unsigned long long> sortedEdges (edges);
+	std::sort(sortedEdges.begin(), sortedEdges.end());
+	for (unsigned int t=0; t<numTriangles; t++)
+	{
+		for (int j=0; j<3; j++)
+		{
+			std::pair<std::vector<unsigned long long>::iterator, std::vector<unsigned long long>::iterator> range;
+			range = std::equal_range(sortedEdges.begin(), sortedEdges.end(), edges[3*t+j]);
+			if (range.second - range.first != 1)
+				continue;
+
+			GLuint a = s.triangles[3*t+j];
+			GLuint b = s.triangles[3*t+(j+1)%3];
+			const double *pa = &s.positions[3*a];
+			const double *pb = &s.positions[3*b];
+			const double *n = &normals[3*t];
+			double e[3] = {pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2]};
+			double m[3] = {e[1]*n[2]-e[2]*n[1], e[2]*n[0]-e[0]*n[2], e[0]*n[1]-e[1]*n[0]};
+			double length = sqrt(m[0]*m[0] + m[1]*m[1] + m[2]*m[2]);
+			if (length > 0.0)
+			{
+				m[0] /= length; m[1] /= length; m[2] /= length;
+				double d = -(m[0]*pa[0] + m[1]*pa[1] + m[2]*pa[2]);
+				double weight = BoundaryWeight*(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+				s.quadrics[a].AddPlane(m[0], m[1], m[2], d, weight);
+				s.quadrics[b].AddPlane(m[0], m[1], m[2], d, weight);
+			}
+			s.boundary[a] = 1;
+			s.boundary[b] = 1;
+		}
+	}
+	std::vector<unsigned long long>().swap(edges);
+	std::vector<unsigned long long>().swap(sortedEdges);
+	std::vector<double>().swap(normals);
+
+	for (unsigned int i=0; i<numNodes; i++)
+		s.ComputeCollapse(i);
+
+	// Collapse cheapest first, recording a level every time the target is reached
+	levels->clear();
+	double maxError = 0.0;
+	unsigned int target = numTriangles/reduction;
+	std::vector<GLuint> neighbors;
+	while (target >= minElements && target > 0)
+	{
+		while (s.numAlive > target && !s.heap.empty())
+		{
+			Collapse c = s.heap.top();
+			s.heap.pop();
+			if (c.version != s.versions[c.from] || s.parent[c.from] != c.from || s.parent[c.to] != c.to)
+				continue;
+			if (!s.IsValid(c.from, c.to))
+			{
+				s.ComputeCollapse(c.from);
+				continue;
+			}
+
+			Quadric q = s.quadrics[c.from];
+			q.Add(s.quadrics[c.to]);
+			if (q.area > 0.0)
+				maxError = std::max(maxError, sqrt(c.cost/q.area));
+
+			s.ApplyCollapse(c.from, c.to);
+			s.ComputeCollapse(c.to);
+			s.Neighbors(c.to, &neighbors);
+			for (unsigned int i=0; i<neighbors.size(); i++)
+				s.ComputeCollapse(neighbors[i]);
+		}
+
+		unsigned int previous = levels->empty() ? numTriangles : levels->back().numElements;
+		if (s.numAlive >= previous)
+			break;
+
+		MeshLOD level;
+		level.numElements = s.numAlive;
+		level.error = maxError;
+		level.indices.reserve(3*s.numAlive);
+		for (unsigned int t=0; t<numTriangles; t++)
+			if (s.triangleAlive[t])
+				level.indices.insert(level.indices.end(), &s.triangles[3*t], &s.triangles[3*t]+3);
+		level.vertexMap.resize(numNodes);
+		for (unsigned int i=0; i<numNodes; i++)
+			level.vertexMap[i] = s.Root(i);
+		levels->push_back(level);
+
+		if (s.heap.empty())
+			break;
+		target = s.numAlive/reduction;
+	}
+
+	return levels->empty() ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+#ifndef MESHDECIMATOR_H
+#define MESHDECIMATOR_H
+
+#include "adcData.h"
+#include "../GLData.h"
+#include <vector>
+
+
+/**
+ * @brief One level of detail of a simplified mesh
+ *
+ * The indices refer to the original Node list, so a level can be drawn from the same
+ * vertex buffer object (and scalar attribute stream) as the full resolution mesh. The
+ * vertex map gives, for every original Node, the Node that represents it at this level,
+ * which can be used to sample per-node values at the level.
+ */
+struct MeshLOD {
+		std::vector<GLuint>	indices;	/**< The Element indices, densely packed [e1n1, e1n2, e1n3, ...] */
+		std::vector<GLuint>	vertexMap;	/**< The index of the Node that represents each original Node */
+		unsigned int		numElements;	/**< The number of Elements in the level */
+		float			error;		/**< The largest geometric error of the level, in world units */
+};
+
+
+/**
+ * @brief A set of functions that build reduced versions of a mesh
+ *
+ * This class provides a set of static functions that build coarse proxy meshes from
+ * Node and Element lists. Proxy meshes only contain indices into the original Node list,
+ * so they can be drawn from a Layer's existing vertex buffer object (and any scalar
+ * attribute stream) by swapping in a different index buffer.
+ *
+ * ClusterVertices() is fast enough to run every time data is loaded, while
+ * QuadricSimplify() produces much better looking levels of detail but takes longer.
+ *
+ * There is no data associated with the MeshDecimator class, so users do not need
+ * to instantiate an object to use the functions.
+ *
+ */
+class MeshDecimator
+{
+	public:
+
+		static int	ClusterVertices(std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int targetNodes, std::vector<GLuint> *indices);
+		static int	QuadricSimplify(std::vector<Node> *nodes, std::vector<Element> *elements, unsigned int minElements, unsigned int reduction, std::vector<MeshLOD> *levels);
+};
+
+#endif // MESHDECIMATOR_H
@@ -0,0 +1,227 @@
+#include "NodeGrid.h"
+#include <math.h>
+#include <float.h>
+
+
+NodeGrid::NodeGrid()
+{
+	minX = 0.0;
+	minY = 0.0;
+	cellWidth = 1.0;
+	cellHeight = 1.0;
+	columns = 0;
+	rows = 0;
+}
+
+
+/**
+ * @brief Builds the grid over a list of Nodes
+ *
+ * The number of cells is chosen so that each cell holds nodesPerCell Nodes on average,
+ * with cells about as wide as they are tall. Any existing grid is replaced. The node list
+ * is not kept, FindNode() returns indices into it.
+ *
+ * @param nodes A pointer to the node list
+ * @param nodesPerCell The average number of Nodes per cell
+ */
+void NodeGrid::Build(std::vector<Node> *nodes, unsigned int nodesPerCell)
+{
+	Clear();
+	if (nodes == 0 || nodes->empty())
+		return;
+
+	float maxX, maxY;
+	minX = maxX = (*nodes)[0].x;
+	minY = maxY = (*nodes)[0].y;
+	for (unsigned int i=1; i<nodes->size(); i++)
+	{
+		minX = fmin(minX, (*nodes)[i].x);
+		maxX = fmax(maxX, (*nodes)[i].x);
+		minY = fmin(minY, (*nodes)[i].y);
+		maxY = fmax(maxY, (*nodes)[i].y);
+	}
+
+	const float Width = maxX > minX ? maxX - minX : 1.0;
+	const float Height = maxY > minY ? maxY - minY : 1.0;
+	const double NumCells = fmax(1.0, (double)nodes->size()/(nodesPerCell > 0 ? nodesPerCell : 1));
+	columns = (int)fmax(1.0, fmin(65535.0, round(sqrt(NumCells*Width/Height))));
+	rows = (int)fmax(1.0, fmin(65535.0, ceil(NumCells/columns)));
+
+	// Widen the cells slightly so that Nodes on the upper bounds fall into the last cell
+	cellWidth = Width/columns*1.0001;
+	cellHeight = Height/rows*1.0001;
+
+	// Count the Nodes in each cell, then turn the counts into starting offsets
+	std::vector<unsigned int> cellOfNode (nodes->size());
+	cellStart.assign((size_t)columns*rows + 1, 0);
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		int column = (int)(((*nodes)[i].x - minX)/cellWidth);
+		int row = (int)(((*nodes)[i].y - minY)/cellHeight);
+		column = column < 0 ? 0 : (column >= columns ? columns-1 : column);
+		row = row < 0 ? 0 : (row >= rows ? rows-1 : row);
+		cellOfNode[i] = row*columns + column;
+		cellStart[cellOfNode[i]+1]++;
+	}
+	for (size_t i=1; i<cellStart.size(); i++)
+		cellStart[i] += cellStart[i-1];
+
+	std::vector<unsigned int> next (cellStart.begin(), cellStart.end()-1);
+	entries.resize(nodes->size());
+	for (unsigned int i=0; i<nodes->size(); i++)
+	{
+		CellEntry *entry = &entries[next[cellOfNode[i]]++];
+		entry->x = (*nodes)[i].x;
+		entry->y = (*nodes)[i].y;
+		entry->index = i;
+	}
+}
+
+
+/**
+ * @brief Finds the Node closest to a point
+ * @param x The x-coordinate
+ * @param y The y-coordinate
+ * @return The index of the closest Node in the node list passed to Build()
+ * @return -1 if the grid is empty
+ */
+int NodeGrid::FindNode(float x, float y)
+{
+	if (entries.empty())
+		return -1;
+
+	int column = (int)floor((x - minX)/cellWidth);
+	int row = (int)floor((y - minY)/cellHeight);
+	column = column < 0 ? 0 : (column >= columns ? columns-1 : column);
+	row = row < 0 ? 0 : (row >= rows ? rows-1 : row);
+
+	int closest = -1;
+	float closestDistance = FLT_MAX;
+	const int MaxRing = columns > rows ? columns : rows;
+	for (int ring=0; ring<=MaxRing; ring++)
+	{
+		if (ring == 0)
+		{
+			SearchCell(column, row, x, y, &closestDistance, &closest);
+		} else {
+			for (int c=column-ring; c<=column+ring; c++)
+			{
+				SearchCell(c, row-ring, x, y, &closestDistance, &closest);
+				SearchCell(c, row+ring, x, y, &closestDistance, &closest);
+			}
+			for (int r=row-ring+1; r<=row+ring-1; r++)
+			{
+				SearchCell(column-ring, r, x, y, &closestDistance, &closest);
+				SearchCell(column+ring, r, x, y, &closestDistance, &closest);
+			}
+		}
+
+		// Any Node outside the searched block is at least as far away as the nearest
+		// edge of the block. Edges on the boundary of the grid have nothing behind them.
+		if (closest >= 0)
+		{
+			float gap = FLT_MAX;
+			if (column-ring > 0)
+				gap = fmin(gap, x - (minX + (column-ring)*cellWidth));
+			if (column+ring < columns-1)
+				gap = fmin(gap, minX + (column+ring+1)*cellWidth - x);
+			if (row-ring > 0)
+				gap = fmin(gap, y - (minY + (row-ring)*cellHeight));
+			if (row+ring < rows-1)
+				gap = fmin(gap, minY + (row+ring+1)*cellHeight - y);
+			if (gap >= 0.0 && gap*gap >= closestDistance)
+				break;
+		}
+	}
+
+	return closest;
+}
+
+
+/**
+ * @brief Removes every Node from the grid and frees its memory
+ */
+void NodeGrid::Clear()
+{
+	std::vector<unsigned int>().swap(cellStart);
+	std::vector<CellEntry>().swap(entries);
+	columns = 0;
+	rows = 0;
+}
+
+
+/**
+ * @brief Returns the number of cells in the grid
+ * @return The number of cells
+ */
+unsigned int NodeGrid::GetNumCells()
+{
+	return (unsigned int)columns*rows;
+}
+
+
+/**
+ * @brief Returns the number of Nodes in the fullest cell
+ * @return The largest number of Nodes in one cell
+ */
+unsigned int NodeGrid::GetMaxCellCount()
+{
+	unsigned int maxCount = 0;
+	for (size_t i=0; i+1<cellStart.size(); i++)
+		if (cellStart[i+1] - cellStart[i] > maxCount)
+			maxCount = cellStart[i+1] - cellStart[i];
+	return maxCount;
+}
+
+
+/**
+ * @brief Returns the fraction of cells that hold no Nodes
+ * @return The fraction of empty cells, 0.0 - 1.0
+ */
+float NodeGrid::GetEmptyFraction()
+{
+	if (cellStart.size() < 2)
+		return 0.0;
+
+	unsigned int empty = 0;
+	for (size_t i=0; i+1<cellStart.size(); i++)
+		if (cellStart[i+1] == cellStart[i])
+			empty++;
+	return (float)empty/(cellStart.size()-1);
+}
+
+
+/**
+ * @brief Returns the memory used by the grid
+ * @return The size of the grid in bytes
+ */
+size_t NodeGrid::GetMemoryUsage()
+{
+	return cellStart.capacity()*sizeof(unsigned int) + entries.capacity()*sizeof(CellEntry);
+}
+
+
+/**
+ * @brief Checks every Node of one cell against the closest Node found so far
+ *
+ * Cells outside the grid are ignored.
+ *
+ */
+void NodeGrid::SearchCell(int column, int row, float x, float y, float *closestDistance, int *closest)
+{
+	if (column < 0 || column >= columns || row < 0 || row >= rows)
+		return;
+
+	const unsigned int Cell = row*columns + column;
+	for (unsigned int i=cellStart[Cell]; i<cellStart[Cell+1]; i++)
+	{
+		const float dx = entries[i].x - x;
+		const float dy = entries[i].y - y;
+		const float distance = dx*dx + dy*dy;
+		if (distance < *closestDistance)
+		{
+			*closestDistance = distance;
+			*closest = entries[i].index;
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef NODEGRID_H
+#define NODEGRID_H
+
+#include "adcData.h"
+#include <vector>
+
+
+/**
+ * @brief A uniform grid of cells over the x-y bounds of a mesh, used to find the Node
+ * closest to a point
+ *
+ * Every Node is put into the cell that contains it. The cells are stored in one block of
+ * memory, sorted by cell (see cellStart), with a copy of each Node's x-y coordinates next
+ * to its index, so a search only touches a few contiguous runs of memory.
+ *
+ * FindNode() searches the cell that contains the point and then rings of cells around it,
+ * stopping once no closer Node can be found in the next ring, so the result is always the
+ * closest Node (unlike the Quadtree, which only searches one leaf). Points outside the
+ * bounds of the grid are searched from the nearest cell.
+ *
+ * The grid is built in two passes over the Nodes (count, then place), so building it costs
+ * about as much as a few linear searches. It works best when the Nodes are spread evenly;
+ * on strongly graded meshes the dense cells hold many Nodes and sparse regions need many
+ * rings (see GetMaxCellCount() and GetEmptyFraction()).
+ *
+ */
+class NodeGrid
+{
+	public:
+
+		NodeGrid();
+
+		void		Build(std::vector<Node> *nodes, unsigned int nodesPerCell);
+		int		FindNode(float x, float y);
+		void		Clear();
+
+		// Getter Methods
+		unsigned int	GetNumCells();
+		unsigned int	GetMaxCellCount();
+		float		GetEmptyFraction();
+		size_t		GetMemoryUsage();
+
+	protected:
+
+		/**
+		 * @brief A Node stored in a cell
+		 */
+		struct CellEntry {
+				float		x;	/**< The x-coordinate of the Node */
+				float		y;	/**< The y-coordinate of the Node */
+				unsigned int	index;	/**< The index of the Node in the node list */
+		};
+
+		float				minX;		/**< The lower bound x-value */
+		float				minY;		/**< The lower bound y-value */
+		float				cellWidth;	/**< The width of a cell */
+		float				cellHeight;	/**< The height of a cell */
+		int				columns;	/**< The number of cells along the x-axis */
+		int				rows;		/**< The number of cells along the y-axis */
+		std::vector<unsigned int>	cellStart;	/**< The first entry of each cell, followed by the total number of entries */
+		std::vector<CellEntry>		entries;	/**< The Nodes of every cell, cell by cell */
+
+		// Protected Functions
+		void	SearchCell(int column, int row, float x, float y, float *closestDistance, int *closest);
+};
+
+#endif // NODEGRID_H
@@ -0,0 +1,414 @@
+#include "NodePicker.h"
+#include "../IO/TraceWriter.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <chrono>
+
+
+NodePicker::NodePicker()
+{
+	nodes = 0;
+	bounds[0] = bounds[1] = bounds[2] = bounds[3] = 0.0;
+	strategy = NoSearch;
+	forcedStrategy = NoSearch;
+	calibrate = false;
+	leafSize = DefaultLeafSize;
+	nodesPerCell = GridNodesPerCell;
+	quadtree = 0;
+}
+
+
+NodePicker::~NodePicker()
+{
+	Clear();
+}
+
+
+/**
+ * @brief Chooses a search for a node list and builds whatever it needs
+ *
+ * Any earlier search is dropped. The search is chosen by timing (if calibration is
+ * enabled), by heuristics, or is the one set with SetStrategy().
+ *
+ * @param newNodes A pointer to the node list
+ * @param minX The lower bound x-value
+ * @param maxX The upper bound x-value
+ * @param minY The lower bound y-value
+ * @param maxY The upper bound y-value
+ */
+void NodePicker::Build(std::vector<Node> *newNodes, float minX, float maxX, float minY, float maxY)
+{
+	TRACE_SCOPE("index", "NodePicker build");
+	Clear();
+	nodes = newNodes;
+	bounds[0] = minX;
+	bounds[1] = maxX;
+	bounds[2] = minY;
+	bounds[3] = maxY;
+
+	if (nodes == 0 || nodes->empty())
+	{
+		reason = "there are no nodes";
+		return;
+	}
+
+	if (forcedStrategy != NoSearch)
+	{
+		strategy = forcedStrategy;
+		if (strategy == GridSearch)
+			grid.Build(nodes, nodesPerCell);
+		else if (strategy == QuadtreeSearch)
+			BuildQuadtree(leafSize);
+		reason = "set by the user";
+	}
+	else if (calibrate)
+		Calibrate();
+	else
+		ChooseByHeuristics();
+
+	DEBUG("Picking %u nodes with %s search: %s\n", (unsigned int)nodes->size(), GetStrategyName(strategy), reason.data());
+}
+
+
+/**
+ * @brief Drops the search and frees any index it built
+ */
+void NodePicker::Clear()
+{
+	grid.Clear();
+	if (quadtree)
+		delete quadtree;
+	quadtree = 0;
+	nodes = 0;
+	strategy = NoSearch;
+	reason.clear();
+}
+
+
+/**
+ * @brief Finds the Node closest to a point
+ *
+ * If the Quadtree has no Nodes in the leaf that contains the point, a linear search is
+ * done instead, so a Node is always found for a non-empty node list.
+ *
+ * @param x The x-coordinate
+ * @param y The y-coordinate
+ * @return A pointer to the closest Node in the node list passed to Build()
+ * @return 0 if there are no Nodes
+ */
+Node* NodePicker::FindNode(float x, float y)
+{
+	return FindNode(strategy, x, y);
+}
+
+
+/**
+ * @brief Returns the search in use
+ * @return The search chosen by Build()
+ */
+NodePicker::Strategy NodePicker::GetStrategy()
+{
+	return strategy;
+}
+
+
+/**
+ * @brief Returns why the search in use was chosen
+ * @return A short explanation, eg. "120000 nodes are spread evenly (at most 14 per grid cell)"
+ */
+std::string NodePicker::GetReason()
+{
+	return reason;
+}
+
+
+/**
+ * @brief Returns the leaf size of the Quadtree
+ * @return The maximum number of Nodes per leaf, as used by the last Quadtree built
+ */
+unsigned int NodePicker::GetLeafSize()
+{
+	return leafSize;
+}
+
+
+/**
+ * @brief Returns the average number of Nodes per grid cell
+ * @return The number of Nodes per cell, as used by the last grid built
+ */
+unsigned int NodePicker::GetNodesPerCell()
+{
+	return nodesPerCell;
+}
+
+
+/**
+ * @brief Returns the name of a search
+ * @param strategy The search
+ * @return The name of the search
+ */
+const char* NodePicker::GetStrategyName(Strategy strategy)
+{
+	switch (strategy)
+	{
+		case NoSearch:		return "no";
+		case LinearSearch:	return "linear";
+		case GridSearch:	return "grid";
+		case QuadtreeSearch:	return "quadtree";
+	}
+	return "unknown";
+}
+
+
+/**
+ * @brief Sets whether Build() times each search instead of using heuristics
+ *
+ * Calibration takes longer to build, since every index is built at least once, but adapts
+ * to the machine.
+ *
+ * @param newCalibrate true to calibrate (default false)
+ */
+void NodePicker::SetCalibration(bool newCalibrate)
+{
+	calibrate = newCalibrate;
+}
+
+
+/**
+ * @brief Forces a search, takes effect on the next call to Build()
+ * @param newStrategy The search, or NoSearch to choose automatically (default)
+ */
+void NodePicker::SetStrategy(Strategy newStrategy)
+{
+	forcedStrategy = newStrategy;
+}
+
+
+/**
+ * @brief Chooses a search from the size and density of the mesh
+ *
+ * Small meshes use LinearSearch. Larger meshes use GridSearch, unless the Nodes are so
+ * unevenly spread that the fullest grid cell holds many times the average, in which case
+ * the Quadtree's adaptive leaves search fewer Nodes per pick.
+ *
+ */
+void NodePicker::ChooseByHeuristics()
+{
+	char text[256];
+	const unsigned int NumNodes = nodes->size();
+	if (NumNodes < LinearThreshold)
+	{
+		strategy = LinearSearch;
+		snprintf(text, sizeof(text), "%u nodes is below the linear search threshold of %u", NumNodes, LinearThreshold);
+		reason = text;
+		return;
+	}
+
+	nodesPerCell = GridNodesPerCell;
+	grid.Build(nodes, nodesPerCell);
+	const unsigned int MaxCellCount = grid.GetMaxCellCount();
+	const float EmptyFraction = grid.GetEmptyFraction();
+	if (MaxCellCount > 64*GridNodesPerCell)
+	{
+		grid.Clear();
+		BuildQuadtree(DefaultLeafSize);
+		strategy = QuadtreeSearch;
+		snprintf(text, sizeof(text), "%u nodes are graded (up to %u in one grid cell, %.0f%% of cells empty), quadtree leaves of %u",
+			 NumNodes, MaxCellCount, 100.0*EmptyFraction, leafSize);
+	} else {
+		strategy = GridSearch;
+		snprintf(text, sizeof(text), "%u nodes are spread evenly enough for a grid (up to %u in one cell, %.0f%% of cells empty)",
+			 NumNodes, MaxCellCount, 100.0*EmptyFraction);
+	}
+	reason = text;
+}
+
+
+/**
+ * @brief Chooses a search by timing the build and a sample of picks with each of them
+ *
+ * Each search is scored by its build time plus the time of ExpectedPicks picks at random
+ * points in the bounds, and the cheapest one is kept. The grid is tried with several
+ * numbers of Nodes per cell, and the Quadtree with several leaf sizes, but only on meshes
+ * small enough to build it quickly.
+ *
+ */
+void NodePicker::Calibrate()
+{
+	typedef std::chrono::steady_clock Clock;
+	const unsigned int ExpectedPicks = 100;
+	const unsigned int SamplePicks = 200;
+	const unsigned int LinearSamplePicks = 16;
+	const unsigned int MaxQuadtreeNodes = 2000000;
+	const unsigned int LeafSizes[3] = {32, 64, 128};
+	const unsigned int CellSizes[3] = {2, 4, 8};
+
+	// Query points from a fixed sequence, so calibration is repeatable
+	std::vector<float> queries (2*SamplePicks);
+	unsigned int state = 12345;
+	for (unsigned int i=0; i<2*SamplePicks; i++)
+	{
+		state = state*1664525u + 1013904223u;
+		float t = (state >> 8)*(1.0f/16777216.0f);
+		queries[i] = i%2 == 0 ? bounds[0] + t*(bounds[1] - bounds[0]) : bounds[2] + t*(bounds[3] - bounds[2]);
+	}
+
+	// Time per pick in seconds, and the build time, of each candidate
+	// The results are kept, or the compiler may drop the searches
+	Node * volatile found = 0;
+	Clock::time_point start = Clock::now();
+	for (unsigned int i=0; i<LinearSamplePicks; i++)
+		found = FindNodeLinear(queries[2*i], queries[2*i+1]);
+	const double LinearPick = std::chrono::duration<double>(Clock::now() - start).count()/LinearSamplePicks;
+	double bestCost = ExpectedPicks*LinearPick;
+	strategy = LinearSearch;
+	unsigned int bestLeafSize = 0;
+
+	double gridBuild = 0.0, gridPick = 0.0;
+	unsigned int gridCellSize = 0, bestCellSize = 0;
+	for (unsigned int i=0; i<3; i++)
+	{
+		start = Clock::now();
+		grid.Build(nodes, CellSizes[i]);
+		const double GridBuild = std::chrono::duration<double>(Clock::now() - start).count();
+		start = Clock::now();
+		for (unsigned int j=0; j<SamplePicks; j++)
+			found = FindNode(GridSearch, queries[2*j], queries[2*j+1]);
+		const double GridPick = std::chrono::duration<double>(Clock::now() - start).count()/SamplePicks;
+
+		if (i == 0 || GridBuild + ExpectedPicks*GridPick < bestCost)
+		{
+			gridBuild = GridBuild;
+			gridPick = GridPick;
+			gridCellSize = CellSizes[i];
+		}
+		if (GridBuild + ExpectedPicks*GridPick < bestCost)
+		{
+			bestCost = GridBuild + ExpectedPicks*GridPick;
+			strategy = GridSearch;
+			bestCellSize = CellSizes[i];
+		}
+	}
+
+	char text[256];
+	std::string quadtreeText = "quadtree skipped";
+	if (nodes->size() <= MaxQuadtreeNodes)
+	{
+		for (unsigned int i=0; i<3; i++)
+		{
+			start = Clock::now();
+			BuildQuadtree(LeafSizes[i]);
+			const double QuadtreeBuild = std::chrono::duration<double>(Clock::now() - start).count();
+			start = Clock::now();
+			for (unsigned int j=0; j<SamplePicks; j++)
+				found = quadtree->FindNode(queries[2*j], queries[2*j+1]);
+			const double QuadtreePick = std::chrono::duration<double>(Clock::now() - start).count()/SamplePicks;
+
+			snprintf(text, sizeof(text), "quadtree(%u) %.1f ms + %.2f us", LeafSizes[i], 1000.0*QuadtreeBuild, 1.0e6*QuadtreePick);
+			if (i == 0 || QuadtreeBuild + ExpectedPicks*QuadtreePick < bestCost)
+				quadtreeText = text;
+			if (QuadtreeBuild + ExpectedPicks*QuadtreePick < bestCost)
+			{
+				bestCost = QuadtreeBuild + ExpectedPicks*QuadtreePick;
+				strategy = QuadtreeSearch;
+				bestLeafSize = LeafSizes[i];
+			}
+		}
+	}
+
+	(void)found;
+
+	// Keep only the index that was chosen
+	if (strategy != GridSearch)
+	{
+		grid.Clear();
+	} else {
+		nodesPerCell = bestCellSize;
+		if (nodesPerCell != CellSizes[2])
+			grid.Build(nodes, nodesPerCell);
+	}
+	if (strategy == QuadtreeSearch && bestLeafSize != leafSize)
+		BuildQuadtree(bestLeafSize);
+	else if (strategy != QuadtreeSearch && quadtree)
+	{
+		delete quadtree;
+		quadtree = 0;
+	}
+
+	snprintf(text, sizeof(text), "calibrated for %u picks: linear %.2f us, grid(%u) %.1f ms + %.2f us, ",
+		 ExpectedPicks, 1.0e6*LinearPick, gridCellSize, 1000.0*gridBuild, 1.0e6*gridPick);
+	reason = text + quadtreeText;
+}
+
+
+/**
+ * @brief Builds the Quadtree with a leaf size, replacing any existing Quadtree
+ * @param newLeafSize The maximum number of Nodes per leaf
+ */
+void NodePicker::BuildQuadtree(unsigned int newLeafSize)
+{
+	if (quadtree)
+		delete quadtree;
+	leafSize = newLeafSize;
+	quadtree = new Quadtree(*nodes, leafSize, bounds[0], bounds[1], bounds[2], bounds[3]);
+}
+
+
+/**
+ * @brief Finds the Node closest to a point by checking every Node
+ */
+Node* NodePicker::FindNodeLinear(float x, float y)
+{
+	Node *closest = 0;
+	float closestDistance = FLT_MAX;
+	const size_t count = nodes ? nodes->size() : 0;
+	for (size_t i=0; i<count; i++)
+	{
+		const float dx = (*nodes)[i].x - x;
+		const float dy = (*nodes)[i].y - y;
+		const float distance = dx*dx + dy*dy;
+		if (distance < closestDistance)
+		{
+			closest = &(*nodes)[i];
+			closestDistance = distance;
+		}
+	}
+	return closest;
+}
+
+
+/**
+ * @brief Finds the Node closest to a point with a specific search
+ *
+ * The Quadtree returns a pointer to its own copy of the Node, which is mapped back to the
+ * node list by node number.
+ *
+ */
+Node* NodePicker::FindNode(Strategy search, float x, float y)
+{
+	if (nodes == 0 || nodes->empty())
+		return 0;
+
+	if (search == GridSearch)
+	{
+		int index = grid.FindNode(x, y);
+		return index >= 0 ? &(*nodes)[index] : 0;
+	}
+
+	if (search == QuadtreeSearch && quadtree)
+	{
+		Node *copy = quadtree->FindNode(x, y);
+		if (copy)
+		{
+			unsigned int index = copy->nodeNumber-1;
+			if (index < nodes->size() && (*nodes)[index].nodeNumber == copy->nodeNumber)
+				return &(*nodes)[index];
+			for (unsigned int i=0; i<nodes->size(); i++)
+				if ((*nodes)[i].nodeNumber == copy->nodeNumber)
+					return &(*nodes)[i];
+		}
+	}
+
+	return FindNodeLinear(x, y);
+}
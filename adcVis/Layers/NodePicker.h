@@ -0,0 +1,91 @@
+#ifndef NODEPICKER_H
+#define NODEPICKER_H
+
+#include "adcData.h"
+#include "NodeGrid.h"
+#include "Quadtree.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Finds the Node closest to a point, using whichever search suits the mesh
+ *
+ * Three searches are available:
+ * - LinearSearch checks every Node. It needs no memory and no build, and is the fastest
+ * choice for small meshes or when only a few picks are made.
+ * - GridSearch uses a NodeGrid. It is cheap to build and always returns the closest Node.
+ * - QuadtreeSearch uses a Quadtree, which adapts to the density of the mesh but is slow
+ * to build and only searches the leaf that contains the point.
+ * .
+ *
+ * Build() chooses a search from the size and density of the mesh (see ChooseByHeuristics()),
+ * or, if calibration is enabled, by timing a sample of picks with each search (see
+ * Calibrate()). Calibration also tunes the leaf size of the Quadtree and the number of
+ * Nodes per grid cell. GetStrategy() and GetReason() report what was chosen and why.
+ *
+ * The thresholds come from the crossover benchmark (Benchmarks/, "--benchmarks crossover"):
+ * building an index costs as much as 20 - 90 linear picks at every mesh size, and a linear
+ * pick stays well under a millisecond below LinearThreshold Nodes.
+ *
+ * The node list must not be changed between Build() and FindNode().
+ *
+ */
+class NodePicker
+{
+	public:
+
+		/**
+		 * @brief The ways of searching for the closest Node
+		 */
+		enum Strategy {
+			NoSearch,	/**< Build() has not been called, or the mesh is empty */
+			LinearSearch,	/**< Check every Node */
+			GridSearch,	/**< Search a NodeGrid */
+			QuadtreeSearch	/**< Search a Quadtree */
+		};
+
+		static const unsigned int	LinearThreshold = 100000;	/**< Meshes with fewer Nodes use LinearSearch */
+		static const unsigned int	GridNodesPerCell = 4;		/**< The average number of Nodes per grid cell when not calibrated */
+		static const unsigned int	DefaultLeafSize = 64;		/**< The Quadtree leaf size when not calibrated */
+
+		NodePicker();
+		~NodePicker();
+
+		void		Build(std::vector<Node> *newNodes, float minX, float maxX, float minY, float maxY);
+		void		Clear();
+		Node*		FindNode(float x, float y);
+
+		// Getter Methods
+		Strategy	GetStrategy();
+		std::string	GetReason();
+		unsigned int	GetLeafSize();
+		unsigned int	GetNodesPerCell();
+		static const char*	GetStrategyName(Strategy strategy);
+
+		// Setter Methods
+		void		SetCalibration(bool newCalibrate);
+		void		SetStrategy(Strategy newStrategy);
+
+	protected:
+
+		std::vector<Node>*	nodes;		/**< The node list being searched */
+		float			bounds[4];	/**< The x-y bounds of the node list */
+		Strategy		strategy;	/**< The search in use */
+		Strategy		forcedStrategy;	/**< The search set with SetStrategy(), or NoSearch to choose automatically */
+		std::string		reason;		/**< Why the search in use was chosen */
+		bool			calibrate;	/**< Set to true to choose the search by timing it */
+		unsigned int		leafSize;	/**< The leaf size of the Quadtree */
+		unsigned int		nodesPerCell;	/**< The average number of Nodes per grid cell */
+		NodeGrid		grid;		/**< The grid used by GridSearch */
+		Quadtree*		quadtree;	/**< The Quadtree used by QuadtreeSearch */
+
+		// Protected Functions
+		void		ChooseByHeuristics();
+		void		Calibrate();
+		void		BuildQuadtree(unsigned int newLeafSize);
+		Node*		FindNodeLinear(float x, float y);
+		Node*		FindNode(Strategy search, float x, float y);
+};
+
+#endif // NODEPICKER_H
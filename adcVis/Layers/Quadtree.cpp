@@ -1,4 +1,5 @@
 #include "Quadtree.h"
+#include "../IO/TraceWriter.h"
 
 
 /**
@@ -12,6 +13,7 @@
  */
 Quadtree::Quadtree(std::vector<Node> nodes, int size, float minX, float maxX, float minY, float maxY)
 {
+	TRACE_SCOPE("index", "Quadtree build");
 	nodeList = nodes;
 	binSize = size;
 
@@ -0,0 +1,228 @@
+#include "ScalarLayer.h"
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ */
+ScalarLayer::ScalarLayer()
+{
+	minValue = 0.0;
+	maxValue = 0.0;
+
+	timestepSource = 0;
+	sourceRangeSet = false;
+}
+
+
+/**
+ * @brief Draws the layer with a MeshRasterizer, colored by the values
+ *
+ * Once values have been set, the fill is colored by them through the rasterizer's
+ * ColorMap and the layer's color range, the same as a GradientShader that reads a scalar
+ * attribute. Otherwise the mesh is drawn the same as TerrainLayer::DrawSoftware(). The
+ * rasterizer is left in MeshRasterizer::SolidFill without scalars.
+ *
+ * @param rasterizer The MeshRasterizer to draw into
+ */
+void ScalarLayer::DrawSoftware(MeshRasterizer *rasterizer)
+{
+	if (rasterizer == 0 || values.empty() || values.size() != nodes.size())
+	{
+		TerrainLayer::DrawSoftware(rasterizer);
+		return;
+	}
+
+	rasterizer->SetFillMode(MeshRasterizer::ColorMappedFill);
+	rasterizer->SetColorMap(0, minValue, maxValue);
+	rasterizer->SetScalars(&values[0], values.size());
+	TerrainLayer::DrawSoftware(rasterizer);
+	rasterizer->SetScalars(0, 0);
+	rasterizer->SetFillMode(MeshRasterizer::SolidFill);
+}
+
+
+/**
+ * @brief Loads the values of a timestep from the timestep source
+ *
+ * Nothing is done if no timestep source has been set (see SetTimestepSource()). This
+ * function waits until the timestep has been read. For vector output (eg. fort.64) the
+ * magnitude of each vector is used. Unless a color range was given with the timestep
+ * source, the first timestep loaded sets the color range of every timestep.
+ *
+ * @param timestep The index of the timestep
+ */
+void ScalarLayer::UpdateTimestep(int timestep)
+{
+	if (timestepSource == 0 || timestep < 0)
+		return;
+
+	float *buffer = timestepSource->Acquire(timestep, true);
+	if (buffer == 0)
+	{
+		DEBUG("Unable to read timestep %i into layer %u\n", timestep, GetID());
+		return;
+	}
+
+	const unsigned int NumNodes = timestepSource->GetNumNodes();
+	const float *timestepValues = buffer;
+	if (timestepSource->GetNumValues() > 1)
+	{
+		magnitudes.resize(NumNodes);
+		GlobalOutputFile::ComputeMagnitude(buffer, buffer + NumNodes, &magnitudes[0], NumNodes);
+		timestepValues = &magnitudes[0];
+	}
+
+	if (sourceRangeSet)
+	{
+		SetValues(timestepValues, NumNodes, minValue, maxValue);
+	}
+	else if (SetValues(timestepValues, NumNodes) == 0)
+	{
+		sourceRangeSet = true;
+	}
+	timestepSource->Release(timestep);
+}
+
+
+/**
+ * @brief Returns the value of a Node
+ * @param nodeNumber The node number as defined in the fort.14 file
+ * @return The value of the Node, or -99999 if no value has been set for it
+ */
+float ScalarLayer::GetValue(unsigned int nodeNumber)
+{
+	return nodeNumber > 0 && nodeNumber <= values.size() ? values[nodeNumber-1] : -99999.0;
+}
+
+
+/**
+ * @brief Returns the value mapped to the lowest color
+ * @return The smallest value that is not -99999, unless a fixed color range was set
+ */
+float ScalarLayer::GetMinValue()
+{
+	return minValue;
+}
+
+
+/**
+ * @brief Returns the value mapped to the highest color
+ * @return The largest value that is not -99999, unless a fixed color range was set
+ */
+float ScalarLayer::GetMaxValue()
+{
+	return maxValue;
+}
+
+
+/**
+ * @brief Sets the value of every Node and the color range
+ *
+ * If the mesh has been loaded to the OpenGL context, the values are uploaded right away,
+ * otherwise they are uploaded along with the mesh.
+ *
+ * @param newValues The value of every Node, by node number
+ * @param count The number of values, which must match the number of Nodes once a fort.14
+ * file has been read
+ * @return 0 if the values were set successfully
+ * @return 1 if no values were given or their number does not match the mesh
+ */
+int ScalarLayer::SetValues(const float *newValues, unsigned int count)
+{
+	if (newValues == 0 || count == 0 || (fileLoaded && count != nodes.size()))
+		return 1;
+
+	float newMin = 0.0, newMax = 0.0;
+	bool first = true;
+	for (unsigned int i=0; i<count; i++)
+	{
+		if (newValues[i] == -99999.0)
+			continue;
+		if (first)
+		{
+			newMin = newMax = newValues[i];
+			first = false;
+		} else {
+			newMin = newValues[i] < newMin ? newValues[i] : newMin;
+			newMax = newValues[i] > newMax ? newValues[i] : newMax;
+		}
+	}
+	return SetValues(newValues, count, newMin, newMax);
+}
+
+
+/**
+ * @brief Sets the value of every Node and a fixed color range
+ *
+ * See SetValues(const float*, unsigned int). GetMinValue() and GetMaxValue() return the
+ * color range.
+ *
+ * @param newValues The value of every Node, by node number
+ * @param count The number of values, which must match the number of Nodes once a fort.14
+ * file has been read
+ * @param colorMin The value mapped to the lowest color
+ * @param colorMax The value mapped to the highest color
+ * @return 0 if the values were set successfully
+ * @return 1 if no values were given or their number does not match the mesh
+ */
+int ScalarLayer::SetValues(const float *newValues, unsigned int count, float colorMin, float colorMax)
+{
+	if (newValues == 0 || count == 0 || (fileLoaded && count != nodes.size()))
+		return 1;
+
+	values.assign(newValues, newValues + count);
+	minValue = colorMin;
+	maxValue = colorMax;
+	SetColorRange(minValue, maxValue);
+
+	if (glLoaded)
+		LoadScalarDataToGPU(&values[0], values.size());
+	return 0;
+}
+
+
+/**
+ * @brief Sets the prefetcher that UpdateTimestep() reads timesteps from
+ *
+ * The color range is set by the first timestep loaded.
+ *
+ * @param newSource A pointer to a running TimestepPrefetcher of an output file of this
+ * layer's mesh, or 0, the layer does not take ownership
+ */
+void ScalarLayer::SetTimestepSource(TimestepPrefetcher *newSource)
+{
+	timestepSource = newSource;
+	sourceRangeSet = false;
+}
+
+
+/**
+ * @brief Sets the prefetcher that UpdateTimestep() reads timesteps from, and a fixed color
+ * range for every timestep
+ * @param newSource A pointer to a running TimestepPrefetcher of an output file of this
+ * layer's mesh, or 0, the layer does not take ownership
+ * @param colorMin The value mapped to the lowest color
+ * @param colorMax The value mapped to the highest color
+ */
+void ScalarLayer::SetTimestepSource(TimestepPrefetcher *newSource, float colorMin, float colorMax)
+{
+	timestepSource = newSource;
+	sourceRangeSet = true;
+	minValue = colorMin;
+	maxValue = colorMax;
+	SetColorRange(minValue, maxValue);
+}
+
+
+/**
+ * @brief Loads the mesh to the OpenGL context, followed by the values if they have been set
+ *
+ * See Layer::LoadDataToGPU().
+ *
+ */
+void ScalarLayer::LoadDataToGPU()
+{
+	TerrainLayer::LoadDataToGPU();
+	if (glLoaded && values.size() == nodes.size() && !values.empty())
+		LoadScalarDataToGPU(&values[0], values.size());
+}
@@ -0,0 +1,65 @@
+#ifndef SCALARLAYER_H
+#define SCALARLAYER_H
+
+#include "TerrainLayer.h"
+#include "../IO/TimestepPrefetcher.h"
+#include <vector>
+
+
+/**
+ * @brief A subclass of TerrainLayer that colors its mesh by one value per Node
+ *
+ * The values (eg. the maximum water level of every Node, see OutputStatistics, or over a
+ * window of timesteps, see TemporalRangeIndex) are loaded to the OpenGL context as the
+ * Layer's scalar attribute stream (see Layer::LoadScalarDataToGPU()), so the Layer should
+ * be drawn with a GradientShader that reads GradientShader::ScalarAttribute. The color
+ * range is set to the smallest and largest value that is not -99999 every time values are
+ * set, unless a fixed range is given (eg. to compare the maps of several windows of time).
+ * Setting a shader resets the color range to the depth range, so shaders should be set
+ * before the values.
+ *
+ * Values can be set before or after the fort.14 file is read, and are loaded to the OpenGL
+ * context along with the mesh. Values are stored by node number, so values[i] is the
+ * value of the Node with node number i+1.
+ *
+ * The values can also follow the current timestep of an output file (eg. water elevation
+ * from a fort.63 or current speed from a fort.64): once a TimestepPrefetcher is set with
+ * SetTimestepSource(), every call to UpdateTimestep() loads that timestep's values. Every
+ * timestep is colored with the same range, so that an animation does not flicker.
+ *
+ */
+class ScalarLayer : public TerrainLayer
+{
+	public:
+		ScalarLayer();
+
+		virtual void	DrawSoftware(MeshRasterizer *rasterizer);
+		virtual void	UpdateTimestep(int timestep);
+
+		// Getter Methods
+		float		GetValue(unsigned int nodeNumber);
+		float		GetMinValue();
+		float		GetMaxValue();
+
+		// Setter Methods
+		int		SetValues(const float *newValues, unsigned int count);
+		int		SetValues(const float *newValues, unsigned int count, float colorMin, float colorMax);
+		void		SetTimestepSource(TimestepPrefetcher *newSource);
+		void		SetTimestepSource(TimestepPrefetcher *newSource, float colorMin, float colorMax);
+
+	protected:
+
+		std::vector<float>	values;		/**< The value of every Node */
+		float			minValue;	/**< The value mapped to the lowest color */
+		float			maxValue;	/**< The value mapped to the highest color */
+
+		// Timestep Variables
+		TimestepPrefetcher*	timestepSource;	/**< The prefetcher that timesteps are read from, or 0 */
+		bool			sourceRangeSet;	/**< Set to true once the color range of the timesteps has been set */
+		std::vector<float>	magnitudes;	/**< The magnitude of every vector of a vector timestep */
+
+		// Protected Functions
+		virtual void	LoadDataToGPU();
+};
+
+#endif // SCALARLAYER_H
@@ -0,0 +1,352 @@
+#include "SelectionSet.h"
+#include "../Threading/ParallelFor.h"
+
+#include <bitset>
+
+
+// The number of 64-bit words processed by each thread during set operations. Rebuilding
+// the dense list costs about 50 ns per word with a third of the indices selected, and
+// starting a thread about 17 us, so 512 words (32768 indices, about 25 us) is close to
+// the smallest block that gains from another thread. Selections of 64K or more indices
+// are split across threads.
+static const size_t WordsPerBlock = 512;
+
+
+/**
+ * @brief Returns the position of the lowest set bit in a non-zero word
+ * @param word The word to search
+ * @return The position of the lowest set bit (0 - 63)
+ */
+static inline unsigned int LowestBit(uint64_t word)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(word);
+#else
+	unsigned int bit = 0;
+	while (!((word >> bit) & 1))
+		bit++;
+	return bit;
+#endif
+}
+
+
+/**
+ * @brief Constructor creates an empty set that can hold no indices
+ */
+SelectionSet::SelectionSet()
+{
+	size = 0;
+	dirtyFirst = 0;
+	dirtyLast = 0;
+	dirty = false;
+}
+
+
+/**
+ * @brief Sets the number of possible indices and clears the set
+ * @param newSize The number of possible indices (eg. the number of Nodes in a Layer)
+ */
+void SelectionSet::Resize(unsigned int newSize)
+{
+	size = newSize;
+	bits.assign((size+63)/64, 0);
+	positions.assign(size, 0);
+	indices.clear();
+	MarkDirty(0, 0);
+}
+
+
+/**
+ * @brief Adds an index to the set
+ *
+ * The index is appended to the end of the dense list.
+ *
+ * @param index The index to add
+ * @return true if the index was added
+ * @return false if the index is out of range or already in the set
+ */
+bool SelectionSet::Add(unsigned int index)
+{
+	if (index >= size || Contains(index))
+		return false;
+
+	bits[index/64] |= (uint64_t)1 << (index%64);
+	positions[index] = indices.size();
+	indices.push_back(index);
+	MarkDirty(indices.size()-1, indices.size());
+	return true;
+}
+
+
+/**
+ * @brief Removes an index from the set
+ *
+ * The last entry in the dense list is moved into the slot of the removed index, so only
+ * that one slot needs to be uploaded again.
+ *
+ * @param index The index to remove
+ * @return true if the index was removed
+ * @return false if the index is out of range or not in the set
+ */
+bool SelectionSet::Remove(unsigned int index)
+{
+	if (index >= size || !Contains(index))
+		return false;
+
+	bits[index/64] &= ~((uint64_t)1 << (index%64));
+
+	unsigned int slot = positions[index];
+	unsigned int last = indices.back();
+	indices[slot] = last;
+	positions[last] = slot;
+	indices.pop_back();
+
+	if (slot < indices.size())
+		MarkDirty(slot, slot+1);
+	else
+		MarkDirty(0, 0);
+	return true;
+}
+
+
+/**
+ * @brief Removes all indices from the set
+ */
+void SelectionSet::Clear()
+{
+	if (indices.size() > 0)
+	{
+		bits.assign(bits.size(), 0);
+		indices.clear();
+		MarkDirty(0, 0);
+	}
+}
+
+
+/**
+ * @brief Adds all indices in another set to this set
+ * @param other The set to combine with this one, must have the same size
+ */
+void SelectionSet::Union(SelectionSet *other)
+{
+	if (other == 0 || other->size != size)
+		return;
+
+	uint64_t *dst = bits.size() > 0 ? &bits[0] : 0;
+	uint64_t *src = other->bits.size() > 0 ? &other->bits[0] : 0;
+	ParallelFor(bits.size(), WordsPerBlock, [dst, src](size_t first, size_t last) {
+		for (size_t i=first; i<last; i++)
+			dst[i] |= src[i];
+	});
+	RebuildIndices();
+}
+
+
+/**
+ * @brief Removes all indices in another set from this set
+ * @param other The set of indices to remove, must have the same size
+ */
+void SelectionSet::Subtract(SelectionSet *other)
+{
+	if (other == 0 || other->size != size)
+		return;
+
+	uint64_t *dst = bits.size() > 0 ? &bits[0] : 0;
+	uint64_t *src = other->bits.size() > 0 ? &other->bits[0] : 0;
+	ParallelFor(bits.size(), WordsPerBlock, [dst, src](size_t first, size_t last) {
+		for (size_t i=first; i<last; i++)
+			dst[i] &= ~src[i];
+	});
+	RebuildIndices();
+}
+
+
+/**
+ * @brief Selects every index that was not selected and deselects every index that was
+ */
+void SelectionSet::Invert()
+{
+	if (bits.size() == 0)
+		return;
+
+	uint64_t *dst = &bits[0];
+	ParallelFor(bits.size(), WordsPerBlock, [dst](size_t first, size_t last) {
+		for (size_t i=first; i<last; i++)
+			dst[i] = ~dst[i];
+	});
+
+	// Clear the unused bits past the end of the set
+	if (size%64 != 0)
+		bits.back() &= ((uint64_t)1 << (size%64)) - 1;
+
+	RebuildIndices();
+}
+
+
+/**
+ * @brief Returns true if the index is in the set
+ * @param index The index to test
+ * @return true if the index is in the set
+ * @return false otherwise
+ */
+bool SelectionSet::Contains(unsigned int index)
+{
+	if (index >= size)
+		return false;
+	return (bits[index/64] >> (index%64)) & 1;
+}
+
+
+/**
+ * @brief Returns the number of possible indices
+ * @return The number of possible indices
+ */
+unsigned int SelectionSet::GetSize()
+{
+	return size;
+}
+
+
+/**
+ * @brief Returns the number of indices in the set
+ * @return The number of indices in the set
+ */
+unsigned int SelectionSet::GetCount()
+{
+	return indices.size();
+}
+
+
+/**
+ * @brief Returns the dense list of indices in the set
+ *
+ * The list contains GetCount() entries in no particular order. The pointer is
+ * invalidated by any function that modifies the set.
+ *
+ * @return A pointer to the first index in the set
+ * @return 0 if the set is empty
+ */
+unsigned int* SelectionSet::GetIndices()
+{
+	return indices.size() > 0 ? &indices[0] : 0;
+}
+
+
+/**
+ * @brief Returns true if the set has changed since the last call to ClearDirty()
+ * @return true if the set has changed
+ */
+bool SelectionSet::IsDirty()
+{
+	return dirty;
+}
+
+
+/**
+ * @brief Returns the range of slots in the dense list that changed since the last call
+ * to ClearDirty()
+ *
+ * The range is clamped to the current number of indices, so it may be empty even
+ * though the set is dirty (eg. after indices were removed from the end of the list).
+ *
+ * @param first A pointer to the variable that will hold the first changed slot
+ * @param last A pointer to the variable that will hold one past the last changed slot
+ */
+void SelectionSet::GetDirtyRange(unsigned int *first, unsigned int *last)
+{
+	unsigned int count = indices.size();
+	if (first)
+		*first = dirtyFirst < count ? dirtyFirst : count;
+	if (last)
+		*last = dirtyLast < count ? dirtyLast : count;
+}
+
+
+/**
+ * @brief Marks the set as uploaded
+ */
+void SelectionSet::ClearDirty()
+{
+	dirty = false;
+	dirtyFirst = 0;
+	dirtyLast = 0;
+}
+
+
+/**
+ * @brief Extends the dirty range to include the slots [first, last)
+ * @param first The first slot that changed
+ * @param last One past the last slot that changed
+ */
+void SelectionSet::MarkDirty(unsigned int first, unsigned int last)
+{
+	if (first < last)
+	{
+		if (!dirty || dirtyFirst == dirtyLast)
+		{
+			dirtyFirst = first;
+			dirtyLast = last;
+		} else {
+			dirtyFirst = first < dirtyFirst ? first : dirtyFirst;
+			dirtyLast = last > dirtyLast ? last : dirtyLast;
+		}
+	}
+	dirty = true;
+}
+
+
+/**
+ * @brief Rebuilds the dense list and slot positions from the bitset
+ *
+ * The bitset is split into blocks of words. Each block's selected indices are counted in
+ * parallel, the counts are turned into starting offsets, and then each block writes its
+ * indices into its own part of the dense list in parallel. The whole list is marked dirty.
+ *
+ */
+void SelectionSet::RebuildIndices()
+{
+	const size_t numWords = bits.size();
+	const size_t numBlocks = (numWords + WordsPerBlock - 1)/WordsPerBlock;
+	std::vector<unsigned int> offsets(numBlocks+1, 0);
+
+	uint64_t *words = numWords > 0 ? &bits[0] : 0;
+	unsigned int *offsetPtr = &offsets[0];
+	ParallelFor(numBlocks, 1, [words, numWords, offsetPtr](size_t first, size_t last) {
+		for (size_t b=first; b<last; b++)
+		{
+			unsigned int count = 0;
+			size_t end = (b+1)*WordsPerBlock < numWords ? (b+1)*WordsPerBlock : numWords;
+			for (size_t i=b*WordsPerBlock; i<end; i++)
+				count += std::bitset<64>(words[i]).count();
+			offsetPtr[b+1] = count;
+		}
+	});
+
+	for (size_t b=0; b<numBlocks; b++)
+		offsets[b+1] += offsets[b];
+
+	indices.resize(offsets[numBlocks]);
+	unsigned int *indexPtr = indices.size() > 0 ? &indices[0] : 0;
+	unsigned int *positionPtr = positions.size() > 0 ? &positions[0] : 0;
+	ParallelFor(numBlocks, 1, [words, numWords, offsetPtr, indexPtr, positionPtr](size_t first, size_t last) {
+		for (size_t b=first; b<last; b++)
+		{
+			unsigned int slot = offsetPtr[b];
+			size_t end = (b+1)*WordsPerBlock < numWords ? (b+1)*WordsPerBlock : numWords;
+			for (size_t i=b*WordsPerBlock; i<end; i++)
+			{
+				uint64_t word = words[i];
+				while (word)
+				{
+					unsigned int index = i*64 + LowestBit(word);
+					indexPtr[slot] = index;
+					positionPtr[index] = slot;
+					slot++;
+					word &= word - 1;
+				}
+			}
+		}
+	});
+
+	MarkDirty(0, indices.size());
+}
@@ -0,0 +1,63 @@
+#ifndef SELECTIONSET_H
+#define SELECTIONSET_H
+
+#include "adcData.h"
+#include <vector>
+#include <stdint.h>
+
+
+/**
+ * @brief A set of selected Node or Element indices that can be drawn from an index buffer
+ *
+ * SelectionSet keeps two views of the same set of indices (Node number - 1 or Element
+ * number - 1):
+ * - A bitset with one bit per possible index, used for membership tests and for set
+ * operations (union, subtract, invert) that run in parallel over blocks of words
+ * - A dense list of the selected indices, which is what gets copied into an index buffer
+ * so that every selected item can be drawn with a single draw call
+ * .
+ *
+ * Adding an index appends it to the dense list and removing an index moves the last entry
+ * of the list into the removed slot, so both are O(1). The range of slots that changed
+ * since the last upload is tracked so that only that part of the index buffer needs to be
+ * updated (see TerrainLayer::UploadSelection()). Set operations rebuild the whole list.
+ *
+ */
+class SelectionSet
+{
+	public:
+
+		SelectionSet();
+
+		void		Resize(unsigned int newSize);
+		bool		Add(unsigned int index);
+		bool		Remove(unsigned int index);
+		void		Clear();
+		void		Union(SelectionSet *other);
+		void		Subtract(SelectionSet *other);
+		void		Invert();
+
+		// Getter Methods
+		bool		Contains(unsigned int index);
+		unsigned int	GetSize();
+		unsigned int	GetCount();
+		unsigned int*	GetIndices();
+		bool		IsDirty();
+		void		GetDirtyRange(unsigned int *first, unsigned int *last);
+		void		ClearDirty();
+
+	protected:
+
+		unsigned int			size;		/**< The number of possible indices (eg. the number of Nodes) */
+		std::vector<uint64_t>		bits;		/**< One bit per possible index, set if the index is selected */
+		std::vector<unsigned int>	indices;	/**< The dense list of selected indices */
+		std::vector<unsigned int>	positions;	/**< The slot in the dense list of every selected index */
+		unsigned int			dirtyFirst;	/**< The first slot of the dense list that changed since the last upload */
+		unsigned int			dirtyLast;	/**< One past the last slot of the dense list that changed since the last upload */
+		bool				dirty;		/**< Set to true when the dense list changed since the last upload */
+
+		void	MarkDirty(unsigned int first, unsigned int last);
+		void	RebuildIndices();
+};
+
+#endif // SELECTIONSET_H
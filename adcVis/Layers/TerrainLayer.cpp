@@ -1,4 +1,6 @@
 #include "TerrainLayer.h"
+#include "../OpenGL/GLProfiler.h"
+#include "../IO/TraceWriter.h"
 
 TerrainLayer::TerrainLayer()
 {
@@ -8,8 +10,15 @@ TerrainLayer::TerrainLayer()
 
 	pickingShader = new DefaultShader();
 
+	nodeSelectionBufferID = 0;
+	elementSelectionBufferID = 0;
+	nodeSelectionCapacity = 0;
+	elementSelectionCapacity = 0;
+
 	selectedNode = 0;
 	selectedElement = 0;
+
+	timeSeriesCache = 0;
 }
 
 
@@ -17,41 +26,148 @@ TerrainLayer::~TerrainLayer()
 {
 	if (pickingShader)
 		delete pickingShader;
-	if (quadtree)
-		delete quadtree;
+	if (nodeSelectionBufferID)
+		glDeleteBuffers(1, &nodeSelectionBufferID);
+	if (elementSelectionBufferID)
+		glDeleteBuffers(1, &elementSelectionBufferID);
 }
 
 
 /**
- * @brief Calls Layer::Draw() and then draws the selected node/element
+ * @brief Draws the selected nodes/elements
  *
- * This function draws the TerrainLayer in the OpenGL context. It first calls the
- * Layer::Draw() function, which draws the fill and outline, and then draws the
- * selected node and/or element using a shader that is owned by the TerrainLayer
- * object.
+ * This function draws the selected nodes and elements of the TerrainLayer on top of the
+ * fill and outline drawn by Layer::DrawBase(), using a shader that is owned by the
+ * TerrainLayer object. Any changes to the selections are uploaded first, then all selected
+ * nodes are drawn with one draw call and all selected elements with another. The picking
+ * shader uses the same camera as the fill shader.
  *
  */
-void TerrainLayer::Draw()
+void TerrainLayer::DrawOverlay()
 {
-	Layer::Draw();
+	GLProfileScope profile (GetID(), GLProfiler::OverlaySection);
+	if (pickingShader && fillShader && pickingShader->GetCamera() != fillShader->GetCamera())
+		pickingShader->SetCamera(fillShader->GetCamera());
 	if (glLoaded && vaoID != 0 && pickingShader && pickingShader->Use() == 0)
 	{
-		// Draw selected node
-		if (selectedNode > 0)
+		UploadSelection(&nodeSelection, &nodeSelectionBufferID, &nodeSelectionCapacity, 1);
+		UploadSelection(&elementSelection, &elementSelectionBufferID, &elementSelectionCapacity, 3);
+
+		glBindVertexArray(vaoID);
+
+		// Draw selected nodes
+		if (nodeSelection.GetCount() > 0)
 		{
 			glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
 			glPolygonOffset(0, 0);
-			glDrawArrays(GL_POINTS, selectedNode->nodeNumber-1, 1);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, nodeSelectionBufferID);
+			glDrawElements(GL_POINTS, nodeSelection.GetCount(), GL_UNSIGNED_INT, (GLvoid*)0);
 		}
 
-		// Draw selected element
-		if (selectedElement > 0)
+		// Draw selected elements
+		if (elementSelection.GetCount() > 0)
 		{
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 			glPolygonOffset(0, 0);
-			glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, (GLuint*)0+3*(selectedElement->elementNumber-1));
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementSelectionBufferID);
+			glDrawElements(GL_TRIANGLES, 3*elementSelection.GetCount(), GL_UNSIGNED_INT, (GLvoid*)0);
 		}
+
+		// Restore the mesh index buffer in the VAO state
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+	}
+}
+
+
+/**
+ * @brief Draws the TerrainLayer without an OpenGL context
+ *
+ * The fill and outline are drawn the same as Layer::DrawSoftware(), and the selected
+ * Nodes and Elements are drawn on top in the rasterizer's highlight color, the same
+ * as TerrainLayer::DrawOverlay().
+ *
+ * @param rasterizer The MeshRasterizer to draw into
+ */
+void TerrainLayer::DrawSoftware(MeshRasterizer *rasterizer)
+{
+	if (rasterizer == 0 || nodes.empty() || elements.empty())
+		return;
+
+	ResizeSelection();
+	rasterizer->DrawMesh(&nodes, &elements,
+			     elementSelection.GetIndices(), elementSelection.GetCount(),
+			     nodeSelection.GetIndices(), nodeSelection.GetCount());
+}
+
+
+/**
+ * @brief Updates the selected Node and Element from a GLPickingBuffer pixel
+ *
+ * If the pixel was drawn by this TerrainLayer, the Element under the pixel becomes the
+ * selected Element and the Element's Node with the largest barycentric weight (the Node
+ * closest to the cursor) becomes the selected Node. If nothing was drawn at the pixel,
+ * the selection is cleared.
+ *
+ * @param result The PickResult returned by GLPickingBuffer::GetResult()
+ * @return true if the result belonged to this TerrainLayer
+ * @return false otherwise
+ */
+bool TerrainLayer::ApplyPickResult(PickResult *result)
+{
+	if (result == 0 || pickingMode != BufferPicking)
+		return false;
+
+	if (result->layerID == 0)
+	{
+		selectedNode = 0;
+		selectedElement = 0;
+		nodeSelection.Clear();
+		elementSelection.Clear();
+		return false;
 	}
+
+	if (result->layerID != GetID() || result->elementIndex >= elements.size())
+		return false;
+
+	selectedElement = &elements[result->elementIndex];
+
+	unsigned int closestNode = selectedElement->n1;
+	float closestWeight = result->weights[0];
+	if (result->weights[1] > closestWeight)
+	{
+		closestNode = selectedElement->n2;
+		closestWeight = result->weights[1];
+	}
+	if (result->weights[2] > closestWeight)
+		closestNode = selectedElement->n3;
+	selectedNode = GetNode(closestNode);
+
+	ResizeSelection();
+	elementSelection.Clear();
+	elementSelection.Add(result->elementIndex);
+	nodeSelection.Clear();
+	if (selectedNode)
+		nodeSelection.Add(selectedNode->nodeNumber-1);
+
+	return true;
+}
+
+
+/**
+ * @brief Returns the DirtyFlag values describing what changed since the TerrainLayer was
+ * last drawn
+ *
+ * Layer::SelectionDirty is added if either selection has changes that have not been
+ * uploaded yet.
+ *
+ * @return A combination of Layer::DataDirty, Layer::UniformsDirty and Layer::SelectionDirty
+ */
+unsigned int TerrainLayer::GetDirtyFlags()
+{
+	unsigned int flags = Layer::GetDirtyFlags();
+	if (nodeSelection.IsDirty() || elementSelection.IsDirty())
+		flags |= SelectionDirty;
+	return flags;
 }
 
 
@@ -65,6 +181,55 @@ std::string TerrainLayer::GetFort14Location()
 }
 
 
+/**
+ * @brief Returns the NodePicker used to find the Node closest to a point
+ *
+ * Use it to see which search was chosen and why (NodePicker::GetStrategy() and
+ * NodePicker::GetReason()), or to enable calibration or force a search before the
+ * first pick.
+ *
+ * @return A pointer to the NodePicker
+ */
+NodePicker* TerrainLayer::GetNodePicker()
+{
+	return &nodePicker;
+}
+
+
+/**
+ * @brief Returns the cache that Node time series are read from
+ * @return A pointer to the TimeSeriesCache, or 0 if none has been set
+ */
+TimeSeriesCache* TerrainLayer::GetTimeSeriesCache()
+{
+	return timeSeriesCache;
+}
+
+
+/**
+ * @brief Reads the value of the selected Node at every timestep (eg. its hydrograph)
+ *
+ * The series is read from the TimeSeriesCache set with SetTimeSeriesCache(), which takes
+ * one contiguous read per tile of timesteps instead of a read of every timestep of the
+ * output file.
+ *
+ * @param series The vector that receives one value per timestep
+ * @return 0 if the series was read successfully
+ * @return 1 if no Node is selected or the cache is not ready
+ */
+int TerrainLayer::GetSelectedNodeSeries(std::vector<float> *series)
+{
+	if (series == 0 || selectedNode == 0 || timeSeriesCache == 0 || !timeSeriesCache->IsOpen())
+		return 1;
+
+	TRACE_SCOPE("io", "Read node series");
+	series->resize(timeSeriesCache->GetNumTimesteps());
+	if (series->empty())
+		return 1;
+	return timeSeriesCache->ReadSeries(selectedNode->nodeNumber, &(*series)[0]);
+}
+
+
 /**
  * @brief Returns a pointer to the Node with the corresponding node number
  *
@@ -98,25 +263,33 @@ Node* TerrainLayer::GetNode(unsigned int nodeNumber)
  * @brief Returns a pointer to the Node closest to the provided x-y coordinates
  *
  * This function provides access to Nodes in the node list by finding the Node
- * with the x-y coordinates closest to the provided x-y coordinates. A quick
- * lookup is possible by parsing the Quadtree used to map the Node data.
+ * with the x-y coordinates closest to the provided x-y coordinates. The search is done
+ * by the TerrainLayer's NodePicker, which is built by the first call to this function
+ * after the fort.14 file is loaded.
  *
- * The TerrainLayer::selectedNode value is set to the Node that is found, and
- * a point will be drawn over that Node using the TerrainLayer::pickingShader.
+ * The TerrainLayer::selectedNode value is set to the Node that is found, the Node
+ * selection is replaced by that Node, and a point will be drawn over that Node using
+ * the TerrainLayer::pickingShader.
  *
  * @param x The x-coordinate
  * @param y The y-coordinate
  * @return A pointer to the Node closest to the provided x-y coordinates
- * @return 0 if the click was outside the bounds of the quadtree or if there is no data loaded
+ * @return 0 if there is no data loaded
  */
 Node* TerrainLayer::GetNode(float x, float y)
 {
-	if (quadtree)
-	{
-		selectedNode = quadtree->FindNode(x, y);
-		return selectedNode;
-	}
-	return 0;
+	if (nodes.empty())
+		return 0;
+
+	if (nodePicker.GetStrategy() == NodePicker::NoSearch)
+		nodePicker.Build(&nodes, minX, maxX, minY, maxY);
+
+	selectedNode = nodePicker.FindNode(x, y);
+	ResizeSelection();
+	nodeSelection.Clear();
+	if (selectedNode)
+		nodeSelection.Add(selectedNode->nodeNumber-1);
+	return selectedNode;
 }
 
 
@@ -173,14 +346,53 @@ Element* TerrainLayer::GetElement(float x, float y)
  *
  * This function is used to set the location of the fort.14 file that will be used
  * to define the terrain in the TerrainLayer object. The fort.14 file is read
- * when this function is called.
+ * when this function is called and the mesh is loaded to the OpenGL context, so an
+ * OpenGL context must be current. If a mesh was already loaded, it is removed from the
+ * OpenGL context first (see Layer::UnloadDataFromGPU()).
  *
+ * If TerrainLayer::flipZValue is set, depths (positive down in fort.14) are converted
+ * to elevations before the mesh is loaded.
+ *
+ * A software only TerrainLayer (see Layer::SetSoftwareOnly()) only reads the file and
+ * does not need an OpenGL context.
+ *
+ * @param newLocation The fort.14 file location
+ * @return 0 if the file was read and loaded successfully
+ * @return 1 if an error occurred
  */
-void TerrainLayer::SetFort14Location(std::string newLocation)
+int TerrainLayer::SetFort14Location(std::string newLocation)
 {
+	TRACE_SCOPE("layer", "SetFort14Location");
 	fort14Location = newLocation;
+	fileLoaded = false;
+	selectedNode = 0;
+	nodePicker.Clear();
+	selectedElement = 0;
 
-	// Read the fort.14 file here
+	// The proxy mesh thread reads the Node and Element lists, and a mesh that is already
+	// in the OpenGL context has to be replaced rather than kept
+	UnloadDataFromGPU();
+
+	if (FileReader::ReadFort14(fort14Location, &nodes, &elements, &numNodes, &numElements, &minX, &maxX, &minY, &maxY, &minZ, &maxZ) != 0)
+	{
+		DEBUG("Unable to read fort.14 file %s\n", fort14Location.data());
+		return 1;
+	}
+	fileLoaded = true;
+
+	if (flipZValue)
+	{
+		TRACE_SCOPE("layer", "Flip z-values");
+		for (unsigned int i=0; i<nodes.size(); i++)
+			nodes[i].z = -nodes[i].z;
+		float oldMinZ = minZ;
+		minZ = -maxZ;
+		maxZ = -oldMinZ;
+	}
+
+	ResizeSelection();
+	LoadDataToGPU();
+	return glLoaded || softwareOnly ? 0 : 1;
 }
 
 
@@ -200,4 +412,188 @@ void TerrainLayer::SetPickingColor(float r, float g, float b, float a)
 	colors.Color1[3] = a;
 	if (pickingShader)
 		pickingShader->SetUniforms(&colors, 0);
+	MarkDirty(SelectionDirty);
+}
+
+
+/**
+ * @brief Sets the cache that the time series of the selected Node is read from
+ * @param newCache A pointer to a TimeSeriesCache of this layer's mesh, or 0, the layer
+ * does not take ownership
+ */
+void TerrainLayer::SetTimeSeriesCache(TimeSeriesCache *newCache)
+{
+	timeSeriesCache = newCache;
+}
+
+
+/**
+ * @brief Adds a Node to the Node selection
+ * @param nodeNumber The node number as defined in the fort.14 file
+ * @return true if the Node was added
+ * @return false if the node number is invalid or the Node is already selected
+ */
+bool TerrainLayer::SelectNode(unsigned int nodeNumber)
+{
+	ResizeSelection();
+	return nodeNumber > 0 && nodeSelection.Add(nodeNumber-1);
+}
+
+
+/**
+ * @brief Removes a Node from the Node selection
+ * @param nodeNumber The node number as defined in the fort.14 file
+ * @return true if the Node was removed
+ * @return false if the node number is invalid or the Node is not selected
+ */
+bool TerrainLayer::DeselectNode(unsigned int nodeNumber)
+{
+	if (selectedNode && selectedNode->nodeNumber == nodeNumber)
+		selectedNode = 0;
+	return nodeNumber > 0 && nodeSelection.Remove(nodeNumber-1);
+}
+
+
+/**
+ * @brief Adds an Element to the Element selection
+ * @param elementNumber The element number as defined in the fort.14 file
+ * @return true if the Element was added
+ * @return false if the element number is invalid or the Element is already selected
+ */
+bool TerrainLayer::SelectElement(unsigned int elementNumber)
+{
+	ResizeSelection();
+	return elementNumber > 0 && elementSelection.Add(elementNumber-1);
+}
+
+
+/**
+ * @brief Removes an Element from the Element selection
+ * @param elementNumber The element number as defined in the fort.14 file
+ * @return true if the Element was removed
+ * @return false if the element number is invalid or the Element is not selected
+ */
+bool TerrainLayer::DeselectElement(unsigned int elementNumber)
+{
+	if (selectedElement && selectedElement->elementNumber == elementNumber)
+		selectedElement = 0;
+	return elementNumber > 0 && elementSelection.Remove(elementNumber-1);
+}
+
+
+/**
+ * @brief Removes all Nodes and Elements from the selection
+ */
+void TerrainLayer::ClearSelection()
+{
+	selectedNode = 0;
+	selectedElement = 0;
+	nodeSelection.Clear();
+	elementSelection.Clear();
+}
+
+
+/**
+ * @brief Returns the Node selection
+ *
+ * The returned SelectionSet can be used directly for set operations (eg. union with
+ * another SelectionSet of the same size). Changes are uploaded on the next draw.
+ *
+ * @return A pointer to the Node selection
+ */
+SelectionSet* TerrainLayer::GetNodeSelection()
+{
+	ResizeSelection();
+	return &nodeSelection;
+}
+
+
+/**
+ * @brief Returns the Element selection
+ *
+ * The returned SelectionSet can be used directly for set operations (eg. subtract
+ * another SelectionSet of the same size). Changes are uploaded on the next draw.
+ *
+ * @return A pointer to the Element selection
+ */
+SelectionSet* TerrainLayer::GetElementSelection()
+{
+	ResizeSelection();
+	return &elementSelection;
+}
+
+
+/**
+ * @brief Sizes the selection sets to match the Node and Element lists
+ *
+ * The selections are cleared if the number of Nodes or Elements has changed.
+ *
+ */
+void TerrainLayer::ResizeSelection()
+{
+	if (nodeSelection.GetSize() != nodes.size())
+		nodeSelection.Resize(nodes.size());
+	if (elementSelection.GetSize() != elements.size())
+		elementSelection.Resize(elements.size());
+}
+
+
+/**
+ * @brief Transfers the changed part of a selection to its index buffer
+ *
+ * Only the slots of the selection's dense list that changed since the last upload are
+ * written. The index buffer grows by doubling when the selection outgrows it, in which
+ * case the whole selection is written. Node selections are written as one node index per
+ * slot and Element selections as the three node indices of the Element.
+ *
+ * @param selection The selection to upload
+ * @param bufferID A pointer to the index buffer ID, created if it is 0
+ * @param capacity A pointer to the allocated size of the index buffer in bytes
+ * @param indicesPerItem 1 for a Node selection, 3 for an Element selection
+ */
+void TerrainLayer::UploadSelection(SelectionSet *selection, GLuint *bufferID, size_t *capacity, unsigned int indicesPerItem)
+{
+	if (!selection->IsDirty())
+		return;
+
+	const unsigned int count = selection->GetCount();
+	const size_t SelectionBufferSize = indicesPerItem*sizeof(GLuint)*count;
+	unsigned int first, last;
+	selection->GetDirtyRange(&first, &last);
+
+	if (*bufferID == 0)
+		glGenBuffers(1, bufferID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, *bufferID);
+
+	if (SelectionBufferSize > *capacity)
+	{
+		size_t newCapacity = 2*(*capacity);
+		*capacity = newCapacity > SelectionBufferSize ? newCapacity : SelectionBufferSize;
+		glBufferData(GL_COPY_WRITE_BUFFER, *capacity, NULL, GL_DYNAMIC_DRAW);
+		first = 0;
+		last = count;
+	}
+
+	if (first < last)
+	{
+		unsigned int *indices = selection->GetIndices();
+		std::vector<GLuint> data (indicesPerItem*(last-first));
+		for (unsigned int i=first; i<last; i++)
+		{
+			if (indicesPerItem == 3)
+			{
+				Element *currElement = &elements[indices[i]];
+				data[3*(i-first)+0] = (GLuint)currElement->n1-1;
+				data[3*(i-first)+1] = (GLuint)currElement->n2-1;
+				data[3*(i-first)+2] = (GLuint)currElement->n3-1;
+			} else {
+				data[i-first] = (GLuint)indices[i];
+			}
+		}
+		glBufferSubData(GL_COPY_WRITE_BUFFER, indicesPerItem*sizeof(GLuint)*first, data.size()*sizeof(GLuint), &data[0]);
+		GLProfiler::AddBytes(data.size()*sizeof(GLuint));
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	selection->ClearDirty();
 }
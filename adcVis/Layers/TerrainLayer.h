@@ -2,9 +2,11 @@
 #define TERRAINLAYER_H
 
 #include "Layer.h"
-#include "Quadtree.h"
+#include "NodePicker.h"
+#include "SelectionSet.h"
 #include "../Shaders/DefaultShader.h"
 #include "../IO/FileReader.h"
+#include "../IO/TimeSeriesCache.h"
 #include <string>
 
 
@@ -15,8 +17,18 @@
  * a fort.14 file and displaying the defined mesh in an OpenGL context. It also provides
  * support for Node and Element picking.
  *
- * TODO: Find the number of nodes where quadtree becomes more efficient than linear search
- * and only use quadtree if the number of nodes in the layer is higher than that number.
+ * Any number of Nodes and Elements can be selected at once. The selections are kept in
+ * SelectionSet objects whose dense index lists are mirrored in index buffers, so all
+ * selected Nodes are highlighted with one draw call and all selected Elements with another.
+ * Picking a single Node or Element replaces the corresponding selection.
+ *
+ * Picking a Node by its x-y coordinates uses a NodePicker, which is built on the first
+ * pick after a fort.14 file is loaded and chooses between a linear search, a grid and a
+ * Quadtree based on the size and density of the mesh (see NodePicker for the measurements
+ * behind the choice).
+ *
+ * If a TimeSeriesCache has been set, the time series of the selected Node (eg. its
+ * hydrograph) can be read with GetSelectedNodeSeries() right after it has been picked.
  *
  */
 class TerrainLayer : public Layer
@@ -25,18 +37,34 @@ class TerrainLayer : public Layer
 		TerrainLayer();
 		~TerrainLayer();
 
-		virtual void	Draw();
+		virtual void	DrawOverlay();
+		virtual void	DrawSoftware(MeshRasterizer *rasterizer);
+		virtual bool	ApplyPickResult(PickResult *result);
+		virtual unsigned int	GetDirtyFlags();
 
 		// Getter Methods
 		std::string		GetFort14Location();
+		NodePicker*		GetNodePicker();
+		TimeSeriesCache*	GetTimeSeriesCache();
+		int			GetSelectedNodeSeries(std::vector<float> *series);
 		virtual Node*		GetNode(unsigned int nodeNumber);
 		virtual Node*		GetNode(float x, float y);
 		virtual Element*	GetElement(unsigned int elementNumber);
 		virtual Element*	GetElement(float x, float y);
 
 		// Setter Methods
-		void	SetFort14Location(std::string newLocation);
+		int	SetFort14Location(std::string newLocation);
 		void	SetPickingColor(float r, float g, float b, float a);
+		void	SetTimeSeriesCache(TimeSeriesCache *newCache);
+
+		// Selection Methods
+		bool		SelectNode(unsigned int nodeNumber);
+		bool		DeselectNode(unsigned int nodeNumber);
+		bool		SelectElement(unsigned int elementNumber);
+		bool		DeselectElement(unsigned int elementNumber);
+		void		ClearSelection();
+		SelectionSet*	GetNodeSelection();
+		SelectionSet*	GetElementSelection();
 
 
 	protected:
@@ -46,6 +74,10 @@ class TerrainLayer : public Layer
 
 		// Terrain Specific OpenGL Variables
 		DefaultShader	*pickingShader; /**< The fill shader used to draw the selected node/element */
+		GLuint		nodeSelectionBufferID;		/**< The index buffer holding the selected Node indices */
+		GLuint		elementSelectionBufferID;	/**< The index buffer holding the node indices of the selected Elements */
+		size_t		nodeSelectionCapacity;		/**< The allocated size of the Node selection index buffer in bytes */
+		size_t		elementSelectionCapacity;	/**< The allocated size of the Element selection index buffer in bytes */
 
 		// Flags
 		bool	flipZValue;		/**< Flag that determines if the z-value is multiplied by -1.0 before being loaded to the GPU */
@@ -53,7 +85,14 @@ class TerrainLayer : public Layer
 		bool	fileLoaded;		/**< Flag that shows if data has been successfully read from fort.14 */
 
 		// Picking variables
-		Quadtree*	quadtree;		/**< The quadtree used to find the Node closest to the clicked point */
+		NodePicker	nodePicker;		/**< Finds the Node closest to the clicked point */
+		SelectionSet	nodeSelection;		/**< The set of selected Node indices (node number - 1) */
+		SelectionSet	elementSelection;	/**< The set of selected Element indices (element number - 1) */
+		TimeSeriesCache	*timeSeriesCache;	/**< The cache the selected Node's time series is read from, not owned by the layer */
+
+		// Selection Functions
+		void	ResizeSelection();
+		void	UploadSelection(SelectionSet *selection, GLuint *bufferID, size_t *capacity, unsigned int indicesPerItem);
 
 };
 
@@ -0,0 +1,531 @@
+#include "GLCamera.h"
+
+#include <math.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+
+/**
+ * @brief Constructor initializes the camera to show the square from -1 to 1 in a 2x2 window
+ *
+ * This matches an identity Model-View-Projection Matrix until the window size is set.
+ *
+ */
+GLCamera::GLCamera()
+{
+	version = 1;
+	centerX = 0.0;
+	centerY = 0.0;
+	zoom = 1.0;
+	windowWidth = 2;
+	windowHeight = 2;
+	nearZ = -1.0;
+	farZ = 1.0;
+	inverseDirty = true;
+
+	UpdateView();
+	UpdateProjection();
+	UpdateMVP();
+	version = 1;
+}
+
+
+/**
+ * @brief Sets the size of the window the camera draws into
+ *
+ * The center of the view stays in the center of the window and the zoom level is kept, so
+ * a larger window shows more of the world.
+ *
+ * @param width The width of the window in pixels
+ * @param height The height of the window in pixels
+ */
+void GLCamera::SetWindowSize(int width, int height)
+{
+	if (width <= 0 || height <= 0 || (width == windowWidth && height == windowHeight))
+		return;
+	windowWidth = width;
+	windowHeight = height;
+	UpdateProjection();
+	UpdateMVP();
+}
+
+
+/**
+ * @brief Sets the range of z-values that are drawn
+ * @param minZ The smallest z-value that is drawn
+ * @param maxZ The largest z-value that is drawn
+ */
+void GLCamera::SetDepthRange(float minZ, float maxZ)
+{
+	if (minZ >= maxZ)
+		return;
+	nearZ = minZ;
+	farZ = maxZ;
+	UpdateProjection();
+	UpdateMVP();
+}
+
+
+/**
+ * @brief Sets the world point at the center of the window
+ * @param x The x-coordinate of the point
+ * @param y The y-coordinate of the point
+ */
+void GLCamera::SetCenter(float x, float y)
+{
+	centerX = x;
+	centerY = y;
+	UpdateView();
+	UpdateMVP();
+}
+
+
+/**
+ * @brief Sets the zoom level
+ * @param pixelsPerUnit The number of window pixels per world unit
+ */
+void GLCamera::SetZoom(float pixelsPerUnit)
+{
+	if (pixelsPerUnit <= 0.0)
+		return;
+	zoom = pixelsPerUnit;
+	UpdateView();
+	UpdateMVP();
+}
+
+
+/**
+ * @brief Moves the view by a distance in window pixels
+ *
+ * The world moves with the mouse, so dragging the mouse to the right by dx pixels moves
+ * the center of the view to the left.
+ *
+ * @param dx The distance to move to the right, in window pixels
+ * @param dy The distance to move down, in window pixels
+ */
+void GLCamera::Pan(float dx, float dy)
+{
+	centerX -= dx/zoom;
+	centerY += dy/zoom;
+	UpdateView();
+	UpdateMVP();
+}
+
+
+/**
+ * @brief Zooms in or out around a point in the window
+ *
+ * The world point under the given window point stays under it (eg. the point under the
+ * mouse cursor when zooming with the scroll wheel).
+ *
+ * @param factor The amount to multiply the zoom level by (greater than 1 zooms in)
+ * @param windowX The x-coordinate of the window point
+ * @param windowY The y-coordinate of the window point
+ */
+void GLCamera::Zoom(float factor, float windowX, float windowY)
+{
+	if (factor <= 0.0)
+		return;
+
+	// The offset of the window point from the center, in world units before and after
+	float offsetX = (windowX - 0.5*windowWidth)/zoom;
+	float offsetY = (0.5*windowHeight - windowY)/zoom;
+	zoom *= factor;
+	centerX += offsetX - offsetX/factor;
+	centerY += offsetY - offsetY/factor;
+	UpdateView();
+	UpdateMVP();
+}
+
+
+/**
+ * @brief Centers the view on a box and zooms so that the whole box is visible
+ * @param minX The minimum x-coordinate of the box
+ * @param maxX The maximum x-coordinate of the box
+ * @param minY The minimum y-coordinate of the box
+ * @param maxY The maximum y-coordinate of the box
+ */
+void GLCamera::FitBounds(float minX, float maxX, float minY, float maxY)
+{
+	float width = maxX - minX;
+	float height = maxY - minY;
+	if (width <= 0.0 && height <= 0.0)
+		return;
+
+	centerX = 0.5*(minX + maxX);
+	centerY = 0.5*(minY + maxY);
+	float zoomX = width > 0.0 ? windowWidth/width : 0.0;
+	float zoomY = height > 0.0 ? windowHeight/height : 0.0;
+	if (zoomX > 0.0 && (zoomY == 0.0 || zoomX < zoomY))
+		zoom = zoomX;
+	else
+		zoom = zoomY;
+	UpdateView();
+	UpdateMVP();
+}
+
+
+/**
+ * @brief Replaces the Model-View-Projection Matrix
+ *
+ * The matrix is used as is until the next change to the view or projection, which
+ * rebuilds it from the view and projection matrices. The camera's version number is
+ * incremented.
+ *
+ * @param newMatrix The new Model-View-Projection Matrix
+ */
+void GLCamera::SetMVPMatrix(Matrix newMatrix)
+{
+	MVPMatrix = newMatrix;
+	inverseDirty = true;
+	version++;
+}
+
+
+/**
+ * @brief Returns the camera's version number
+ *
+ * The version number starts at 1 and increases every time the camera changes. It is
+ * never 0, so 0 can be used to mean "no version seen yet".
+ *
+ * @return The camera's version number
+ */
+unsigned int GLCamera::GetVersion()
+{
+	return version;
+}
+
+
+/**
+ * @brief Returns the view matrix
+ * @return The view matrix
+ */
+Matrix GLCamera::GetViewMatrix()
+{
+	return viewMatrix;
+}
+
+
+/**
+ * @brief Returns the projection matrix
+ * @return The projection matrix
+ */
+Matrix GLCamera::GetProjectionMatrix()
+{
+	return projectionMatrix;
+}
+
+
+/**
+ * @brief Returns the world point at the center of the window
+ *
+ * If any of the values are not needed, pass in 0 for the unneeded value.
+ *
+ * @param x A pointer to the variable that will hold the x-coordinate
+ * @param y A pointer to the variable that will hold the y-coordinate
+ */
+void GLCamera::GetCenter(float *x, float *y)
+{
+	if (x)
+		*x = centerX;
+	if (y)
+		*y = centerY;
+}
+
+
+/**
+ * @brief Returns the zoom level
+ * @return The number of window pixels per world unit
+ */
+float GLCamera::GetZoom()
+{
+	return zoom;
+}
+
+
+/**
+ * @brief Returns the width of the window
+ * @return The width of the window in pixels
+ */
+int GLCamera::GetWindowWidth()
+{
+	return windowWidth;
+}
+
+
+/**
+ * @brief Returns the height of the window
+ * @return The height of the window in pixels
+ */
+int GLCamera::GetWindowHeight()
+{
+	return windowHeight;
+}
+
+
+/**
+ * @brief Converts points from window coordinates to world coordinates
+ *
+ * Every point is transformed by the inverse of MVPMatrix, so this also works after
+ * SetMVPMatrix() has been used. The inverse is only rebuilt when the camera has changed.
+ *
+ * @param count The number of points
+ * @param window The window points, packed [x1, y1, z1, x2, y2, z2, ...] where z is the
+ * depth buffer value (0.0 - 1.0)
+ * @param world The array that will hold the world points, packed the same way
+ */
+void GLCamera::Unproject(unsigned int count, const float *window, float *world)
+{
+	if (inverseDirty)
+	{
+		if (!InvertMatrix(MVPMatrix, &inverseMVPMatrix))
+			inverseMVPMatrix = IDENTITY_MATRIX;
+		inverseDirty = false;
+	}
+
+	const float *m = inverseMVPMatrix.m;
+	const float scaleX = 2.0/windowWidth;
+	const float scaleY = 2.0/windowHeight;
+#ifdef __SSE__
+	const __m128 col0 = _mm_loadu_ps(m);
+	const __m128 col1 = _mm_loadu_ps(m+4);
+	const __m128 col2 = _mm_loadu_ps(m+8);
+	const __m128 col3 = _mm_loadu_ps(m+12);
+#endif
+	for (unsigned int i=0; i<count; i++)
+	{
+		float x = window[3*i+0]*scaleX - 1.0;
+		float y = 1.0 - window[3*i+1]*scaleY;
+		float z = 2.0*window[3*i+2] - 1.0;
+		float p[4];
+#ifdef __SSE__
+		__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(x)), _mm_mul_ps(col1, _mm_set1_ps(y))),
+				      _mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(z)), col3));
+		_mm_storeu_ps(p, r);
+#else
+		for (int j=0; j<4; j++)
+			p[j] = m[j]*x + m[4+j]*y + m[8+j]*z + m[12+j];
+#endif
+		float w = p[3] != 0.0 ? 1.0/p[3] : 1.0;
+		world[3*i+0] = p[0]*w;
+		world[3*i+1] = p[1]*w;
+		world[3*i+2] = p[2]*w;
+	}
+}
+
+
+/**
+ * @brief Converts a point from window coordinates to world coordinates in the x-y plane
+ *
+ * Useful for finding the world point under the mouse cursor.
+ *
+ * @param windowX The x-coordinate of the window point
+ * @param windowY The y-coordinate of the window point
+ * @param worldX A pointer to the variable that will hold the world x-coordinate
+ * @param worldY A pointer to the variable that will hold the world y-coordinate
+ */
+void GLCamera::Unproject(float windowX, float windowY, float *worldX, float *worldY)
+{
+	float window[3] = {windowX, windowY, 0.5};
+	float world[3];
+	Unproject(1, window, world);
+	if (worldX)
+		*worldX = world[0];
+	if (worldY)
+		*worldY = world[1];
+}
+
+
+/**
+ * @brief Returns how many pixels one world unit covers at a point
+ *
+ * The length of a world unit along the x- and y-axes is projected with the
+ * Model-View-Projection Matrix at the given point, and the longer of the two is
+ * converted to pixels. This is used to turn a geometric error into a screen-space error.
+ *
+ * @param x The x-coordinate of the point
+ * @param y The y-coordinate of the point
+ * @param z The z-coordinate of the point
+ * @param viewportHeight The height of the viewport in pixels
+ * @return The number of pixels covered by one world unit at the point
+ * @return 0 if the point is behind the camera
+ */
+float GLCamera::GetPixelsPerUnit(float x, float y, float z, int viewportHeight)
+{
+	const float *m = MVPMatrix.m;
+	float w = m[3]*x + m[7]*y + m[11]*z + m[15];
+	if (w <= 0.0)
+		return 0.0;
+
+	float unitX = sqrt(m[0]*m[0] + m[1]*m[1]);
+	float unitY = sqrt(m[4]*m[4] + m[5]*m[5]);
+	float unit = unitX > unitY ? unitX : unitY;
+	return 0.5*viewportHeight*unit/w;
+}
+
+
+/**
+ * @brief Returns true if any part of a box might be visible
+ *
+ * The eight corners of the box are transformed with the Model-View-Projection Matrix, and
+ * the box is only reported as hidden if all of them are outside the same clipping plane.
+ * Boxes that are close to the edge of the view may be reported as visible even though
+ * they are not.
+ *
+ * @param minX The minimum x-coordinate of the box
+ * @param maxX The maximum x-coordinate of the box
+ * @param minY The minimum y-coordinate of the box
+ * @param maxY The maximum y-coordinate of the box
+ * @param minZ The minimum z-coordinate of the box
+ * @param maxZ The maximum z-coordinate of the box
+ * @return true if the box might be visible
+ * @return false if the box is definitely outside the view
+ */
+bool GLCamera::IsBoxVisible(float minX, float maxX, float minY, float maxY, float minZ, float maxZ)
+{
+	const float *m = MVPMatrix.m;
+	int outside[6] = {0, 0, 0, 0, 0, 0};
+	for (int i=0; i<8; i++)
+	{
+		float x = i & 1 ? maxX : minX;
+		float y = i & 2 ? maxY : minY;
+		float z = i & 4 ? maxZ : minZ;
+		float cx = m[0]*x + m[4]*y + m[8]*z + m[12];
+		float cy = m[1]*x + m[5]*y + m[9]*z + m[13];
+		float cz = m[2]*x + m[6]*y + m[10]*z + m[14];
+		float cw = m[3]*x + m[7]*y + m[11]*z + m[15];
+		outside[0] += cx < -cw;
+		outside[1] += cx > cw;
+		outside[2] += cy < -cw;
+		outside[3] += cy > cw;
+		outside[4] += cz < -cw;
+		outside[5] += cz > cw;
+	}
+	for (int i=0; i<6; i++)
+		if (outside[i] == 8)
+			return false;
+	return true;
+}
+
+
+/**
+ * @brief Multiplies two matrices
+ *
+ * Matrices are stored in column-major order, so the result transforms a point by b first
+ * and then by a. Each column of the result is a sum of the columns of a, which maps
+ * directly to four-wide SIMD operations.
+ *
+ * @param a The left matrix
+ * @param b The right matrix
+ * @return The product a*b
+ */
+Matrix GLCamera::MultiplyMatrix(const Matrix &a, const Matrix &b)
+{
+	Matrix result;
+#ifdef __SSE__
+	const __m128 col0 = _mm_loadu_ps(a.m);
+	const __m128 col1 = _mm_loadu_ps(a.m+4);
+	const __m128 col2 = _mm_loadu_ps(a.m+8);
+	const __m128 col3 = _mm_loadu_ps(a.m+12);
+	for (int j=0; j<4; j++)
+	{
+		const float *bj = b.m + 4*j;
+		__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(bj[0])), _mm_mul_ps(col1, _mm_set1_ps(bj[1]))),
+				      _mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(bj[2])), _mm_mul_ps(col3, _mm_set1_ps(bj[3]))));
+		_mm_storeu_ps(result.m + 4*j, r);
+	}
+#else
+	for (int j=0; j<4; j++)
+		for (int i=0; i<4; i++)
+			result.m[4*j+i] = a.m[i]*b.m[4*j] + a.m[4+i]*b.m[4*j+1] + a.m[8+i]*b.m[4*j+2] + a.m[12+i]*b.m[4*j+3];
+#endif
+	return result;
+}
+
+
+/**
+ * @brief Inverts a matrix
+ * @param a The matrix to invert
+ * @param result A pointer to the matrix that will hold the inverse
+ * @return true if the matrix was inverted
+ * @return false if the matrix is singular
+ */
+bool GLCamera::InvertMatrix(const Matrix &a, Matrix *result)
+{
+	const float *m = a.m;
+	float inv[16];
+
+	inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+	inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+	inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+	inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+	inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+	inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+	inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+	inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+	inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+	inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+	inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+	inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+	inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+	inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+	inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+	inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+	double det = (double)m[0]*inv[0] + (double)m[1]*inv[4] + (double)m[2]*inv[8] + (double)m[3]*inv[12];
+	if (det == 0.0)
+		return false;
+
+	float invDet = 1.0/det;
+	for (int i=0; i<16; i++)
+		result->m[i] = inv[i]*invDet;
+	return true;
+}
+
+
+/**
+ * @brief Rebuilds the view matrix from the center and zoom level
+ *
+ * World units are scaled to pixels, with the center at the origin.
+ *
+ */
+void GLCamera::UpdateView()
+{
+	viewMatrix = IDENTITY_MATRIX;
+	viewMatrix.m[0] = zoom;
+	viewMatrix.m[5] = zoom;
+	viewMatrix.m[12] = -zoom*centerX;
+	viewMatrix.m[13] = -zoom*centerY;
+}
+
+
+/**
+ * @brief Rebuilds the projection matrix from the window size and depth range
+ *
+ * Pixels around the center are scaled to clip space, and the depth range is mapped to
+ * -1 (nearest) to 1 (farthest).
+ *
+ */
+void GLCamera::UpdateProjection()
+{
+	projectionMatrix = IDENTITY_MATRIX;
+	projectionMatrix.m[0] = 2.0/windowWidth;
+	projectionMatrix.m[5] = 2.0/windowHeight;
+	projectionMatrix.m[10] = 2.0/(farZ - nearZ);
+	projectionMatrix.m[14] = -(farZ + nearZ)/(farZ - nearZ);
+}
+
+
+/**
+ * @brief Multiplies the projection and view matrices into MVPMatrix
+ *
+ * The camera's version number is incremented.
+ *
+ */
+void GLCamera::UpdateMVP()
+{
+	MVPMatrix = MultiplyMatrix(projectionMatrix, viewMatrix);
+	inverseDirty = true;
+	version++;
+}
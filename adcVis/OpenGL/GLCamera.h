@@ -4,11 +4,92 @@
 #include "../adcData.h"
 #include "../GLData.h"
 
+
+/**
+ * @brief Holds the Model-View-Projection Matrix used by all shaders
+ *
+ * The camera looks straight down the z-axis at the x-y plane with an orthographic
+ * projection. It is described by:
+ * - A view: the world point at the center of the window and the zoom level (window
+ * pixels per world unit)
+ * - A projection: the size of the window in pixels and the range of z-values that are drawn
+ * .
+ *
+ * The view matrix, projection matrix and MVPMatrix are kept up to date as the camera
+ * changes. Panning or zooming only rebuilds the view matrix and resizing only rebuilds
+ * the projection matrix, before the two are multiplied into MVPMatrix. The inverse of
+ * MVPMatrix, used by Unproject(), is only rebuilt when it is needed.
+ *
+ * Every change to the camera increments a version number, so objects that cache data
+ * derived from the camera (eg. a rendered frame) can tell if the cache is still valid
+ * by comparing version numbers instead of matrices.
+ *
+ * Window coordinates have their origin at the top left corner of the window, with y
+ * increasing downward, as they are reported by the windowing system.
+ *
+ */
 class GLCamera
 {
 	public:
 
+		GLCamera();
+
 		Matrix MVPMatrix;	/**< The Model-View-Projection Matrix */
+
+		// View and projection
+		void		SetWindowSize(int width, int height);
+		void		SetDepthRange(float minZ, float maxZ);
+		void		SetCenter(float x, float y);
+		void		SetZoom(float pixelsPerUnit);
+		void		Pan(float dx, float dy);
+		void		Zoom(float factor, float windowX, float windowY);
+		void		FitBounds(float minX, float maxX, float minY, float maxY);
+		void		SetMVPMatrix(Matrix newMatrix);
+
+		// Getter Methods
+		unsigned int	GetVersion();
+		Matrix		GetViewMatrix();
+		Matrix		GetProjectionMatrix();
+		void		GetCenter(float *x, float *y);
+		float		GetZoom();
+		int		GetWindowWidth();
+		int		GetWindowHeight();
+
+		// Coordinate conversion
+		void		Unproject(unsigned int count, const float *window, float *world);
+		void		Unproject(float windowX, float windowY, float *worldX, float *worldY);
+		float		GetPixelsPerUnit(float x, float y, float z, int viewportHeight);
+		bool		IsBoxVisible(float minX, float maxX, float minY, float maxY, float minZ, float maxZ);
+
+		// Matrix Functions
+		static Matrix	MultiplyMatrix(const Matrix &a, const Matrix &b);
+		static bool	InvertMatrix(const Matrix &a, Matrix *result);
+
+	protected:
+
+		unsigned int	version;	/**< Incremented every time the camera changes */
+
+		// View
+		float		centerX;	/**< The x-coordinate of the world point at the center of the window */
+		float		centerY;	/**< The y-coordinate of the world point at the center of the window */
+		float		zoom;		/**< The number of window pixels per world unit */
+		Matrix		viewMatrix;	/**< Moves the center to the origin and scales world units to pixels */
+
+		// Projection
+		int		windowWidth;	/**< The width of the window in pixels */
+		int		windowHeight;	/**< The height of the window in pixels */
+		float		nearZ;		/**< The smallest z-value that is drawn */
+		float		farZ;		/**< The largest z-value that is drawn */
+		Matrix		projectionMatrix;	/**< Maps pixels around the center and the depth range to clip space */
+
+		// Inverse
+		Matrix		inverseMVPMatrix;	/**< The inverse of MVPMatrix */
+		bool		inverseDirty;		/**< Set to true when inverseMVPMatrix must be rebuilt */
+
+		// Protected Functions
+		void		UpdateView();
+		void		UpdateProjection();
+		void		UpdateMVP();
 };
 
 #endif
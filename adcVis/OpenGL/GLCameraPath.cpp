@@ -0,0 +1,315 @@
+#include "GLCameraPath.h"
+
+#include <fstream>
+#include <sstream>
+#include <math.h>
+
+
+GLCameraPath::GLCameraPath()
+{
+	camera = 0;
+	currentStep = 0;
+	currentFrame = 0;
+}
+
+
+/**
+ * @brief Reads a camera path from a text file
+ *
+ * The steps are appended to the path. See GLCameraPath for the format of the file.
+ *
+ * @param fileLoc The location of the camera path file
+ * @return 0 if every line was read
+ * @return 1 if the file could not be opened or a line could not be read
+ */
+int GLCameraPath::Load(std::string fileLoc)
+{
+	std::ifstream file (fileLoc.data());
+	if (!file.is_open())
+	{
+		DEBUG("Unable to open camera path %s\n", fileLoc.data());
+		return 1;
+	}
+
+	std::string line;
+	unsigned int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::stringstream stream (line);
+		std::string command;
+		if (!(stream >> command))
+			continue;
+
+		Step step;
+		step.values[0] = step.values[1] = 0.0;
+		step.first = 0;
+		step.stride = 1;
+		step.frames = 1;
+
+		bool valid = true;
+		if (command == "fit")
+		{
+			step.type = FitStep;
+		}
+		else if (command == "zoom")
+		{
+			step.type = ZoomStep;
+			valid = (stream >> step.values[0] >> step.frames) && step.values[0] > 0.0;
+		}
+		else if (command == "pan")
+		{
+			step.type = PanStep;
+			valid = (bool)(stream >> step.values[0] >> step.values[1] >> step.frames);
+		}
+		else if (command == "timestep")
+		{
+			int last;
+			step.type = TimestepStep;
+			valid = (bool)(stream >> step.first >> last);
+			if (valid && !(stream >> step.stride))
+				step.stride = 1;
+			valid = valid && step.stride > 0 && last >= step.first;
+			if (valid)
+				step.frames = (last - step.first)/step.stride + 1;
+		}
+		else if (command == "hold")
+		{
+			step.type = HoldStep;
+			valid = (bool)(stream >> step.frames);
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid || step.frames == 0)
+		{
+			DEBUG("Unable to read line %u of camera path %s\n", lineNumber, fileLoc.data());
+			return 1;
+		}
+		steps.push_back(step);
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Appends the built-in camera path, without timestep changes
+ *
+ * See LoadDefault(unsigned int). The path has 290 frames.
+ *
+ */
+void GLCameraPath::LoadDefault()
+{
+	LoadDefault(0);
+}
+
+
+/**
+ * @brief Appends the built-in camera path
+ *
+ * The path fits the mesh, zooms in by 64x and back out, pans across the domain while
+ * zoomed in and holds still. If the Layers have output data, it then steps through the
+ * first 10 timesteps (one frame each), so that the timestep frames measure loading and
+ * drawing a new timestep. It ends by zooming in by 4x, 290 frames in all plus the
+ * timestep frames.
+ *
+ * @param numTimesteps The number of timesteps of the Layers' output, or 0 if they have none
+ */
+void GLCameraPath::LoadDefault(unsigned int numTimesteps)
+{
+	const Step DefaultSteps[] = {
+		{FitStep,	{0.0, 0.0},	0, 1, 1},
+		{HoldStep,	{0.0, 0.0},	0, 1, 19},
+		{ZoomStep,	{64.0, 0.0},	0, 1, 60},
+		{PanStep,	{-2.0, 0.0},	0, 1, 40},
+		{PanStep,	{0.0, -2.0},	0, 1, 40},
+		{ZoomStep,	{1.0/64.0, 0.0},	0, 1, 60},
+		{HoldStep,	{0.0, 0.0},	0, 1, 20},
+		{TimestepStep,	{0.0, 0.0},	0, 1, 10},
+		{FitStep,	{0.0, 0.0},	0, 1, 1},
+		{ZoomStep,	{4.0, 0.0},	0, 1, 29},
+		{HoldStep,	{0.0, 0.0},	0, 1, 20}
+	};
+	for (unsigned int i=0; i<sizeof(DefaultSteps)/sizeof(Step); i++)
+	{
+		Step step = DefaultSteps[i];
+		if (step.type == TimestepStep)
+		{
+			if (numTimesteps == 0)
+				continue;
+			step.frames = numTimesteps < step.frames ? numTimesteps : step.frames;
+		}
+		steps.push_back(step);
+	}
+}
+
+
+/**
+ * @brief Appends a step to the path
+ * @param newStep The step
+ */
+void GLCameraPath::AddStep(Step newStep)
+{
+	if (newStep.frames > 0)
+		steps.push_back(newStep);
+}
+
+
+/**
+ * @brief Removes every step from the path
+ */
+void GLCameraPath::Clear()
+{
+	steps.clear();
+	currentStep = 0;
+	currentFrame = 0;
+}
+
+
+/**
+ * @brief Rewinds the path to its first frame
+ * @param newCamera The camera moved by the path
+ * @param newLayers The Layers that receive timestep changes, and whose bounds are used by fit steps
+ */
+void GLCameraPath::Start(GLCamera *newCamera, std::vector<Layer *> *newLayers)
+{
+	camera = newCamera;
+	layers.clear();
+	if (newLayers)
+		layers = *newLayers;
+	currentStep = 0;
+	currentFrame = 0;
+}
+
+
+/**
+ * @brief Applies the changes of the next frame to the camera and Layers
+ * @return true if a frame was applied and should be rendered
+ * @return false if the path has ended or has no camera
+ */
+bool GLCameraPath::NextFrame()
+{
+	if (camera == 0 || currentStep >= steps.size())
+		return false;
+
+	ApplyFrame(&steps[currentStep], currentFrame);
+	if (++currentFrame >= steps[currentStep].frames)
+	{
+		currentStep++;
+		currentFrame = 0;
+	}
+	return true;
+}
+
+
+/**
+ * @brief Returns the total number of frames in the path
+ * @return The number of frames
+ */
+unsigned int GLCameraPath::GetNumFrames()
+{
+	unsigned int frames = 0;
+	for (unsigned int i=0; i<steps.size(); i++)
+		frames += steps[i].frames;
+	return frames;
+}
+
+
+/**
+ * @brief Returns the number of steps in the path
+ * @return The number of steps
+ */
+unsigned int GLCameraPath::GetNumSteps()
+{
+	return steps.size();
+}
+
+
+/**
+ * @brief Returns the step that produced the last frame
+ * @return The index of the step, or -1 if NextFrame() has not been called since Start()
+ */
+int GLCameraPath::GetCurrentStep()
+{
+	if (currentStep == 0 && currentFrame == 0)
+		return -1;
+	return currentFrame == 0 ? (int)currentStep-1 : (int)currentStep;
+}
+
+
+/**
+ * @brief Returns a step of the path
+ * @param index The index of the step
+ * @return A pointer to the step, or 0 if there is no such step
+ */
+GLCameraPath::Step* GLCameraPath::GetStep(unsigned int index)
+{
+	if (index >= steps.size())
+		return 0;
+	return &steps[index];
+}
+
+
+/**
+ * @brief Returns the name of a kind of step, as used in camera path files
+ * @param type The kind of step
+ * @return The name
+ */
+const char* GLCameraPath::GetStepName(StepType type)
+{
+	switch (type)
+	{
+		case FitStep:		return "fit";
+		case ZoomStep:		return "zoom";
+		case PanStep:		return "pan";
+		case TimestepStep:	return "timestep";
+		case HoldStep:		return "hold";
+	}
+	return "unknown";
+}
+
+
+/**
+ * @brief Applies one frame of a step
+ * @param step The step
+ * @param frame The frame of the step, starting at 0
+ */
+void GLCameraPath::ApplyFrame(Step *step, unsigned int frame)
+{
+	const float Width = camera->GetWindowWidth();
+	const float Height = camera->GetWindowHeight();
+
+	if (step->type == FitStep && !layers.empty())
+	{
+		float minX = layers[0]->GetMinX(), maxX = layers[0]->GetMaxX();
+		float minY = layers[0]->GetMinY(), maxY = layers[0]->GetMaxY();
+		for (unsigned int i=1; i<layers.size(); i++)
+		{
+			minX = fmin(minX, layers[i]->GetMinX());
+			maxX = fmax(maxX, layers[i]->GetMaxX());
+			minY = fmin(minY, layers[i]->GetMinY());
+			maxY = fmax(maxY, layers[i]->GetMaxY());
+		}
+		camera->FitBounds(minX, maxX, minY, maxY);
+	}
+	else if (step->type == ZoomStep)
+	{
+		camera->Zoom(pow(step->values[0], 1.0/step->frames), 0.5*Width, 0.5*Height);
+	}
+	else if (step->type == PanStep)
+	{
+		camera->Pan(step->values[0]*Width/step->frames, step->values[1]*Height/step->frames);
+	}
+	else if (step->type == TimestepStep)
+	{
+		for (unsigned int i=0; i<layers.size(); i++)
+			layers[i]->UpdateTimestep(step->first + frame*step->stride);
+	}
+}
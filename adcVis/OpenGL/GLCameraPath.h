@@ -0,0 +1,84 @@
+#ifndef GLCAMERAPATH_H
+#define GLCAMERAPATH_H
+
+#include "GLCamera.h"
+#include "../Layers/Layer.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief A scripted sequence of camera moves and timestep changes, replayed one frame at
+ * a time
+ *
+ * A camera path is a list of steps, each of which produces one or more frames. Paths are
+ * read from a text file with one step per line (anything after a '#' is ignored):
+ * - fit: fits the camera to the bounds of the Layers (1 frame)
+ * - zoom <factor> <frames>: zooms about the center of the window by factor, spread evenly over the frames
+ * - pan <dx> <dy> <frames>: moves the view by dx and dy, as fractions of the window size, spread evenly over the frames
+ * - timestep <first> <last> [stride]: calls Layer::UpdateTimestep() with each timestep in the range (1 frame each),
+ * which only changes Layers that load output data (eg. a ScalarLayer with a timestep source)
+ * - hold <frames>: leaves everything as it is (measures the cached frame path of GLScene)
+ * .
+ *
+ * Since every move is relative to the window size and the bounds of the Layers, the same
+ * path can be replayed on any mesh at any frame size.
+ *
+ */
+class GLCameraPath
+{
+	public:
+
+		/**
+		 * @brief The kinds of step in a camera path
+		 */
+		enum StepType {
+			FitStep,	/**< Fit the camera to the Layers */
+			ZoomStep,	/**< Zoom about the center of the window */
+			PanStep,	/**< Move the view */
+			TimestepStep,	/**< Change the timestep of the Layers */
+			HoldStep	/**< Change nothing */
+		};
+
+		/**
+		 * @brief One step of a camera path
+		 */
+		struct Step {
+				StepType	type;		/**< The kind of step */
+				float		values[2];	/**< The zoom factor, or the pan distances */
+				int		first;		/**< The first timestep */
+				int		stride;		/**< The number of timesteps between frames */
+				unsigned int	frames;		/**< The number of frames the step produces */
+		};
+
+		GLCameraPath();
+
+		int		Load(std::string fileLoc);
+		void		LoadDefault();
+		void		LoadDefault(unsigned int numTimesteps);
+		void		AddStep(Step newStep);
+		void		Clear();
+
+		void		Start(GLCamera *newCamera, std::vector<Layer*> *newLayers);
+		bool		NextFrame();
+
+		// Getter Methods
+		unsigned int	GetNumFrames();
+		unsigned int	GetNumSteps();
+		int		GetCurrentStep();
+		Step*		GetStep(unsigned int index);
+		static const char*	GetStepName(StepType type);
+
+	protected:
+
+		std::vector<Step>	steps;		/**< The steps of the path, in order */
+		GLCamera*		camera;		/**< The camera moved by the path */
+		std::vector<Layer*>	layers;		/**< The Layers that receive timestep changes and define the bounds */
+		unsigned int		currentStep;	/**< The step of the next frame */
+		unsigned int		currentFrame;	/**< The frame of the current step that is next */
+
+		// Protected Functions
+		void		ApplyFrame(Step *step, unsigned int frame);
+};
+
+#endif // GLCAMERAPATH_H
@@ -0,0 +1,352 @@
+#include "GLFrameExporter.h"
+
+#include <string.h>
+#include <stdio.h>
+
+
+GLFrameExporter::GLFrameExporter()
+{
+	scene = 0;
+	writer = 0;
+	width = 0;
+	height = 0;
+	fboID = 0;
+	colorID = 0;
+	depthID = 0;
+	pboIDs[0] = 0;
+	pboIDs[1] = 0;
+	currentPBO = 0;
+}
+
+
+/**
+ * @brief Deconstructor that deletes the framebuffer and pixel buffers from the OpenGL context
+ *
+ * Frames that have been rendered but not collected are dropped, call Flush() first to
+ * write them.
+ *
+ */
+GLFrameExporter::~GLFrameExporter()
+{
+	DeleteBuffers();
+}
+
+
+/**
+ * @brief Sets the scene that is rendered
+ *
+ * The scene is switched to non-interactive mode and resized to the size of the
+ * exporter's frames.
+ *
+ * @param newScene The scene
+ */
+void GLFrameExporter::SetScene(GLScene *newScene)
+{
+	scene = newScene;
+	if (scene)
+	{
+		scene->SetInteractive(false);
+		if (width > 0 && height > 0)
+			scene->Resize(width, height);
+	}
+}
+
+
+/**
+ * @brief Sets the ImageWriter that compresses and writes the frames
+ *
+ * The ImageWriter must have been started with ImageWriter::Start(). It is not stopped by
+ * the exporter, so it can be shared by several exports.
+ *
+ * @param newWriter The ImageWriter
+ */
+void GLFrameExporter::SetImageWriter(ImageWriter *newWriter)
+{
+	writer = newWriter;
+}
+
+
+/**
+ * @brief Sets the size of the exported frames and creates the offscreen buffers
+ *
+ * Any frames waiting to be collected are written first. An OpenGL context must be current.
+ *
+ * @param newWidth The width of the frames in pixels
+ * @param newHeight The height of the frames in pixels
+ * @return 0 if the buffers were created
+ * @return 1 if an error occurred
+ */
+int GLFrameExporter::SetSize(int newWidth, int newHeight)
+{
+	if (newWidth <= 0 || newHeight <= 0)
+		return 1;
+
+	Flush();
+	DeleteBuffers();
+	width = newWidth;
+	height = newHeight;
+
+	glGenFramebuffers(1, &fboID);
+	glGenRenderbuffers(1, &colorID);
+	glGenRenderbuffers(1, &depthID);
+	glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorID);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		DEBUG("Export framebuffer is incomplete (status %x)\n", status);
+		DeleteBuffers();
+		return 1;
+	}
+
+	const size_t FrameSize = 4*(size_t)width*height;
+	glGenBuffers(2, pboIDs);
+	for (int i=0; i<2; i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, FrameSize, 0, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (scene)
+		scene->Resize(width, height);
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		DEBUG("OpenGL Error found after creating the export buffers\n");
+		DeleteBuffers();
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Renders the scene to completion and queues the frame to be written
+ *
+ * The pixels of this frame are only read back during the next call to RenderFrame() or
+ * Flush(), so the GPU can finish drawing while the previous frame is being collected.
+ *
+ * @param fileLoc The location of the image file to write
+ * @return 0 if the frame was rendered and the previous frame was collected
+ * @return 1 if an error occurred
+ */
+int GLFrameExporter::RenderFrame(std::string fileLoc)
+{
+	if (scene == 0 || writer == 0 || fboID == 0)
+		return 1;
+
+	// Progressive Layers can take several passes to finish a frame
+	GLScene::RenderResult result;
+	do {
+		result = scene->Render(fboID);
+	} while (result == GLScene::ProgressiveRedraw);
+
+	if (result == GLScene::NotRendered)
+		return 1;
+
+	// Start the asynchronous read back into the current pixel buffer
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fboID);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs[currentPBO]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	pendingFiles[currentPBO] = fileLoc;
+
+	// Collect the previous frame from the other pixel buffer
+	currentPBO = 1 - currentPBO;
+	if (!pendingFiles[currentPBO].empty())
+		return CollectFrame(currentPBO);
+
+	return 0;
+}
+
+
+/**
+ * @brief Renders the scene to completion and reads the frame back right away
+ *
+ * Unlike RenderFrame(), this waits for the GPU and does not use the ImageWriter. It is
+ * meant for checking frames (eg. against a MeshRasterizer), not for exporting them.
+ *
+ * @param pixels Filled with the RGBA frame, bottom row first
+ * @return 0 if the frame was rendered and read
+ * @return 1 if an error occurred
+ */
+int GLFrameExporter::ReadFrame(std::vector<unsigned char> *pixels)
+{
+	if (scene == 0 || pixels == 0 || fboID == 0)
+		return 1;
+
+	GLScene::RenderResult result;
+	do {
+		result = scene->Render(fboID);
+	} while (result == GLScene::ProgressiveRedraw);
+
+	if (result == GLScene::NotRendered)
+		return 1;
+
+	pixels->resize(4*(size_t)width*height);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fboID);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	return glGetError() == GL_NO_ERROR ? 0 : 1;
+}
+
+
+/**
+ * @brief Exports one frame for every timestep in a range
+ *
+ * Layer::UpdateTimestep() is called on every Layer before each frame is rendered. The
+ * file name of each frame is built from a printf-style pattern that receives the
+ * timestep, eg. "frame_%05d.png". The pattern is used as the format string, so it must
+ * contain exactly one integer conversion and no other conversions (main.cpp checks the
+ * pattern given on the command line). Every frame has been written when this function
+ * returns.
+ *
+ * @param layers The Layers that change with the timestep
+ * @param first The first timestep
+ * @param last The last timestep
+ * @param stride The number of timesteps between frames
+ * @param filePattern The pattern used to build the file names
+ * @return The number of frames that could not be rendered or written
+ */
+int GLFrameExporter::ExportTimesteps(std::vector<Layer *> *layers, int first, int last, int stride, std::string filePattern)
+{
+	if (stride <= 0)
+		stride = 1;
+
+	unsigned int startErrors = writer ? writer->GetNumErrors() : 0;
+	int errors = 0;
+	char fileName[4096];
+	for (int timestep=first; timestep<=last; timestep+=stride)
+	{
+		if (layers)
+			for (unsigned int i=0; i<layers->size(); i++)
+				layers->at(i)->UpdateTimestep(timestep);
+
+		snprintf(fileName, sizeof(fileName), filePattern.data(), timestep);
+		if (RenderFrame(fileName) != 0)
+			errors++;
+	}
+	if (Flush() != 0)
+		errors++;
+
+	if (writer)
+	{
+		writer->Wait();
+		errors += writer->GetNumErrors() - startErrors;
+	}
+
+	return errors;
+}
+
+
+/**
+ * @brief Collects every rendered frame and hands it to the ImageWriter
+ * @return 0 if every frame was collected
+ * @return 1 if an error occurred
+ */
+int GLFrameExporter::Flush()
+{
+	int result = 0;
+	for (int i=0; i<2; i++)
+	{
+		if (!pendingFiles[currentPBO].empty())
+			result |= CollectFrame(currentPBO);
+		currentPBO = 1 - currentPBO;
+	}
+	return result;
+}
+
+
+/**
+ * @brief Returns the width of the exported frames
+ * @return The width in pixels
+ */
+int GLFrameExporter::GetWidth()
+{
+	return width;
+}
+
+
+/**
+ * @brief Returns the height of the exported frames
+ * @return The height in pixels
+ */
+int GLFrameExporter::GetHeight()
+{
+	return height;
+}
+
+
+/**
+ * @brief Copies a frame out of a pixel buffer object and queues it in the ImageWriter
+ * @param pbo The index of the pixel buffer object (0 or 1)
+ * @return 0 if the frame was queued
+ * @return 1 if an error occurred
+ */
+int GLFrameExporter::CollectFrame(unsigned int pbo)
+{
+	std::string fileLoc;
+	fileLoc.swap(pendingFiles[pbo]);
+	if (writer == 0)
+		return 1;
+
+	const size_t FrameSize = 4*(size_t)width*height;
+	std::vector<unsigned char> pixels;
+	writer->AcquireBuffer(&pixels);
+	pixels.resize(FrameSize);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs[pbo]);
+	void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, FrameSize, GL_MAP_READ_BIT);
+	if (data == 0)
+	{
+		DEBUG("Error mapping the pixel buffer for %s\n", fileLoc.data());
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return 1;
+	}
+	memcpy(pixels.data(), data, FrameSize);
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return writer->Submit(fileLoc, width, height, &pixels);
+}
+
+
+/**
+ * @brief Deletes the framebuffer and pixel buffers from the OpenGL context
+ */
+void GLFrameExporter::DeleteBuffers()
+{
+	if (fboID)
+		glDeleteFramebuffers(1, &fboID);
+	if (colorID)
+		glDeleteRenderbuffers(1, &colorID);
+	if (depthID)
+		glDeleteRenderbuffers(1, &depthID);
+	if (pboIDs[0])
+		glDeleteBuffers(2, pboIDs);
+
+	fboID = 0;
+	colorID = 0;
+	depthID = 0;
+	pboIDs[0] = 0;
+	pboIDs[1] = 0;
+	pendingFiles[0].clear();
+	pendingFiles[1].clear();
+	currentPBO = 0;
+}
@@ -0,0 +1,67 @@
+#ifndef GLFRAMEEXPORTER_H
+#define GLFRAMEEXPORTER_H
+
+#include "GLScene.h"
+#include "../IO/ImageWriter.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Renders a GLScene into an offscreen framebuffer and writes the frames to image files
+ *
+ * Frames are exported through a three stage pipeline, so that each stage works on a
+ * different frame at the same time:
+ * - The scene is rendered into the exporter's framebuffer, to completion
+ * - The pixels are copied into one of two pixel buffer objects without waiting for the
+ * GPU, and the pixels of the previous frame are read back from the other one
+ * - The previous frame is handed to an ImageWriter, which compresses it on a background
+ * thread
+ * .
+ *
+ * The exporter does not need a window, so it can be used with a GLHeadlessContext as
+ * well as an on-screen context. The scene is switched to non-interactive mode (see
+ * GLScene::SetInteractive()) so that every frame is drawn at full resolution.
+ *
+ */
+class GLFrameExporter
+{
+	public:
+
+		GLFrameExporter();
+		~GLFrameExporter();
+
+		void		SetScene(GLScene *newScene);
+		void		SetImageWriter(ImageWriter *newWriter);
+		int		SetSize(int newWidth, int newHeight);
+
+		int		RenderFrame(std::string fileLoc);
+		int		ReadFrame(std::vector<unsigned char> *pixels);
+		int		ExportTimesteps(std::vector<Layer*> *layers, int first, int last, int stride, std::string filePattern);
+		int		Flush();
+
+		// Getter Methods
+		int		GetWidth();
+		int		GetHeight();
+
+	protected:
+
+		GLScene*	scene;		/**< The scene that is rendered */
+		ImageWriter*	writer;		/**< The ImageWriter that compresses and writes the frames */
+		int		width;		/**< The width of the frames in pixels */
+		int		height;		/**< The height of the frames in pixels */
+
+		// OpenGL Variables
+		GLuint		fboID;		/**< The framebuffer the scene is rendered into */
+		GLuint		colorID;	/**< The color renderbuffer of the framebuffer */
+		GLuint		depthID;	/**< The depth renderbuffer of the framebuffer */
+		GLuint		pboIDs[2];	/**< The pixel buffer objects frames are read back through */
+		std::string	pendingFiles[2];	/**< The file each pixel buffer object's frame will be written to, empty if unused */
+		unsigned int	currentPBO;	/**< The pixel buffer object used by the next frame */
+
+		// Protected Functions
+		int		CollectFrame(unsigned int pbo);
+		void		DeleteBuffers();
+};
+
+#endif // GLFRAMEEXPORTER_H
@@ -0,0 +1,199 @@
+#include "GLHeadlessContext.h"
+#include "../GLData.h"
+
+#include <EGL/eglext.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+GLHeadlessContext::GLHeadlessContext()
+{
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+	surface = EGL_NO_SURFACE;
+	software = false;
+}
+
+
+GLHeadlessContext::~GLHeadlessContext()
+{
+	Destroy();
+}
+
+
+/**
+ * @brief Creates the OpenGL context and makes it current on the calling thread
+ *
+ * An OpenGL 3.3 core profile context is requested, which is what the shaders are
+ * written for.
+ *
+ * @return 0 if the context was created and GLEW was initialized
+ * @return 1 if an error occurred
+ */
+int GLHeadlessContext::Create()
+{
+	Destroy();
+
+	if (software)
+		setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+
+	// Try the surfaceless platform first, then fall back to the default display
+	bool surfaceless = true;
+	display = GetSurfacelessDisplay();
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, 0, 0))
+	{
+		surfaceless = false;
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, 0, 0))
+		{
+			DEBUG("Unable to initialize an EGL display\n");
+			display = EGL_NO_DISPLAY;
+			return 1;
+		}
+	}
+
+	const EGLint ConfigAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(display, ConfigAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+	{
+		DEBUG("No EGL configuration supports desktop OpenGL\n");
+		Destroy();
+		return 1;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		DEBUG("Unable to bind the desktop OpenGL API\n");
+		Destroy();
+		return 1;
+	}
+
+	const EGLint ContextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, ContextAttributes);
+	if (context == EGL_NO_CONTEXT)
+	{
+		DEBUG("Unable to create an OpenGL 3.3 context\n");
+		Destroy();
+		return 1;
+	}
+
+	if (!surfaceless)
+	{
+		const EGLint SurfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+		surface = eglCreatePbufferSurface(display, config, SurfaceAttributes);
+		if (surface == EGL_NO_SURFACE)
+		{
+			DEBUG("Unable to create a pbuffer surface\n");
+			Destroy();
+			return 1;
+		}
+	}
+
+	if (!eglMakeCurrent(display, surface, surface, context))
+	{
+		DEBUG("Unable to make the OpenGL context current\n");
+		Destroy();
+		return 1;
+	}
+
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK)
+	{
+		DEBUG("Unable to initialize GLEW\n");
+		Destroy();
+		return 1;
+	}
+
+	// glewInit() can leave an error behind on core profile contexts
+	glGetError();
+
+	return 0;
+}
+
+
+/**
+ * @brief Releases the context and the display connection
+ */
+void GLHeadlessContext::Destroy()
+{
+	if (display == EGL_NO_DISPLAY)
+		return;
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT)
+		eglDestroyContext(display, context);
+	if (surface != EGL_NO_SURFACE)
+		eglDestroySurface(display, surface);
+	eglTerminate(display);
+
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+	surface = EGL_NO_SURFACE;
+}
+
+
+/**
+ * @brief Forces Mesa's llvmpipe software rasterizer
+ *
+ * Must be called before Create().
+ *
+ * @param newSoftware true to render in software
+ */
+void GLHeadlessContext::SetSoftwareRendering(bool newSoftware)
+{
+	software = newSoftware;
+}
+
+
+/**
+ * @brief Checks if the context has been created
+ * @return true if the context has been created
+ */
+bool GLHeadlessContext::IsValid()
+{
+	return context != EGL_NO_CONTEXT;
+}
+
+
+/**
+ * @brief Returns the name of the renderer the context is running on
+ * @return The GL_RENDERER string, or 0 if there is no context
+ */
+const char* GLHeadlessContext::GetRenderer()
+{
+	if (!IsValid())
+		return 0;
+	return (const char*)glGetString(GL_RENDERER);
+}
+
+
+/**
+ * @brief Gets the display of the Mesa surfaceless platform
+ * @return The display, or EGL_NO_DISPLAY if the platform is not supported
+ */
+EGLDisplay GLHeadlessContext::GetSurfacelessDisplay()
+{
+	const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (extensions == 0 || strstr(extensions, "EGL_MESA_platform_surfaceless") == 0)
+		return EGL_NO_DISPLAY;
+
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay == 0)
+		return EGL_NO_DISPLAY;
+
+	return getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+}
@@ -0,0 +1,50 @@
+#ifndef GLHEADLESSCONTEXT_H
+#define GLHEADLESSCONTEXT_H
+
+#include "../adcData.h"
+#include <EGL/egl.h>
+
+
+/**
+ * @brief Creates an OpenGL context without a window system, for rendering on machines
+ * with no display
+ *
+ * The context is created through EGL. The Mesa surfaceless platform is tried first,
+ * since it needs neither a display server nor a GPU. If it is not available, the default
+ * EGL display is used with a small pbuffer surface. In both cases, all drawing is expected
+ * to go into framebuffer objects (see GLFrameExporter).
+ *
+ * On machines without a GPU, Mesa falls back to its llvmpipe software rasterizer.
+ * SetSoftwareRendering() forces llvmpipe even when a GPU driver is present.
+ *
+ * Once Create() returns 0, the context is current on the calling thread and GLEW has
+ * been initialized, so the Layer and shader classes can be used as usual.
+ *
+ */
+class GLHeadlessContext
+{
+	public:
+
+		GLHeadlessContext();
+		~GLHeadlessContext();
+
+		int		Create();
+		void		Destroy();
+		void		SetSoftwareRendering(bool software);
+
+		// Getter Methods
+		bool		IsValid();
+		const char*	GetRenderer();
+
+	protected:
+
+		EGLDisplay	display;	/**< The EGL display connection */
+		EGLContext	context;	/**< The OpenGL context */
+		EGLSurface	surface;	/**< The pbuffer surface, or EGL_NO_SURFACE on the surfaceless platform */
+		bool		software;	/**< Flag that forces Mesa's llvmpipe software rasterizer */
+
+		// Protected Functions
+		EGLDisplay	GetSurfacelessDisplay();
+};
+
+#endif // GLHEADLESSCONTEXT_H
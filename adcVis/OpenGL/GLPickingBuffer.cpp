@@ -0,0 +1,266 @@
+#include "GLPickingBuffer.h"
+
+#include <string.h>
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ *
+ * No OpenGL objects are created until Resize() is called with a current context.
+ *
+ */
+GLPickingBuffer::GLPickingBuffer()
+{
+	width = 0;
+	height = 0;
+	fboID = 0;
+	colorBufferID = 0;
+	depthBufferID = 0;
+	nextPBO = 0;
+	previousFBO = 0;
+	for (int i=0; i<2; i++)
+	{
+		pboIDs[i] = 0;
+		fences[i] = 0;
+		pixels[i][0] = pixels[i][1] = 0;
+	}
+	for (int i=0; i<4; i++)
+		previousViewport[i] = 0;
+}
+
+
+/**
+ * @brief Deconstructor that deletes all OpenGL objects owned by the picking buffer
+ */
+GLPickingBuffer::~GLPickingBuffer()
+{
+	for (int i=0; i<2; i++)
+		if (fences[i])
+			glDeleteSync(fences[i]);
+	if (pboIDs[0])
+		glDeleteBuffers(2, pboIDs);
+	if (colorBufferID)
+		glDeleteRenderbuffers(1, &colorBufferID);
+	if (depthBufferID)
+		glDeleteRenderbuffers(1, &depthBufferID);
+	if (fboID)
+		glDeleteFramebuffers(1, &fboID);
+}
+
+
+/**
+ * @brief Sets the size of the picking buffer
+ *
+ * This function should be called whenever the size of the OpenGL viewport changes so that
+ * pixels in the picking buffer line up with pixels on the screen. The framebuffer and pixel
+ * buffer objects are created the first time this function is called. Any pick that is
+ * still in flight is discarded.
+ *
+ * @param newWidth The width of the viewport in pixels
+ * @param newHeight The height of the viewport in pixels
+ * @return 0 if the framebuffer is complete
+ * @return 1 if an error occurred
+ */
+int GLPickingBuffer::Resize(int newWidth, int newHeight)
+{
+	if (newWidth <= 0 || newHeight <= 0)
+		return 1;
+
+	if (fboID == 0)
+	{
+		glGenFramebuffers(1, &fboID);
+		glGenRenderbuffers(1, &colorBufferID);
+		glGenRenderbuffers(1, &depthBufferID);
+		glGenBuffers(2, pboIDs);
+		for (int i=0; i<2; i++)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, 4*sizeof(GLuint), NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	for (int i=0; i<2; i++)
+	{
+		if (fences[i])
+		{
+			glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+	}
+
+	width = newWidth;
+	height = newHeight;
+
+	GLint currentFBO;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &currentFBO);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA32UI, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBufferID);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBufferID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, currentFBO);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		DEBUG("Picking framebuffer is incomplete (status 0x%x)", status);
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Binds the picking buffer for drawing and clears it
+ *
+ * The framebuffer and viewport that were in use are saved and restored by End().
+ *
+ */
+void GLPickingBuffer::Begin()
+{
+	if (fboID == 0)
+		return;
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFBO);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+	glViewport(0, 0, width, height);
+
+	const GLuint clearID[4] = {0, 0, 0, 0};
+	glClearBufferuiv(GL_COLOR, 0, clearID);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+
+/**
+ * @brief Restores the framebuffer and viewport that were in use before Begin()
+ */
+void GLPickingBuffer::End()
+{
+	if (fboID == 0)
+		return;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+
+/**
+ * @brief Starts an asynchronous read of a single pixel of the picking buffer
+ *
+ * The pixel is copied into a pixel buffer object by the GPU and a fence is inserted
+ * after the copy. This function returns immediately, the result is collected with
+ * GetResult() on a later frame. If two requests are already in flight, the oldest
+ * one is replaced.
+ *
+ * @param x The x-coordinate of the pixel (from the left edge of the viewport)
+ * @param y The y-coordinate of the pixel (from the bottom edge of the viewport)
+ */
+void GLPickingBuffer::RequestPixel(int x, int y)
+{
+	if (fboID == 0 || x < 0 || y < 0 || x >= width || y >= height)
+		return;
+
+	if (fences[nextPBO])
+		glDeleteSync(fences[nextPBO]);
+
+	GLint currentFBO;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &currentFBO);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fboID);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs[nextPBO]);
+	glReadPixels(x, y, 1, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, (GLvoid*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, currentFBO);
+
+	fences[nextPBO] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pixels[nextPBO][0] = x;
+	pixels[nextPBO][1] = y;
+	nextPBO = 1 - nextPBO;
+}
+
+
+/**
+ * @brief Collects the result of a previously requested pixel read if it is ready
+ *
+ * This function never waits on the GPU. If the most recent request has completed, its
+ * result is returned and any older request is discarded. Otherwise, an older request that
+ * has completed is returned. The result is consumed, so subsequent calls return false
+ * until another request completes.
+ *
+ * @param result A pointer to the PickResult that will hold the pixel data
+ * @return true if a result was collected
+ * @return false if no request has completed yet
+ */
+bool GLPickingBuffer::GetResult(PickResult *result)
+{
+	int order[2] = {1 - nextPBO, nextPBO};
+	for (int i=0; i<2; i++)
+	{
+		int index = order[i];
+		if (fences[index] == 0)
+			continue;
+
+		GLenum status = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			continue;
+
+		GLuint data[4] = {0, 0, 0, 0};
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIDs[index]);
+		GLuint *dataPtr = (GLuint *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4*sizeof(GLuint), GL_MAP_READ_BIT);
+		if (dataPtr)
+		{
+			memcpy(data, dataPtr, 4*sizeof(GLuint));
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		// This result supersedes anything older that is still in flight
+		for (int j=i; j<2; j++)
+		{
+			if (fences[order[j]])
+			{
+				glDeleteSync(fences[order[j]]);
+				fences[order[j]] = 0;
+			}
+		}
+
+		if (!dataPtr || result == 0)
+			return false;
+
+		result->x = pixels[index][0];
+		result->y = pixels[index][1];
+		if (data[0] == 0)
+		{
+			result->layerID = 0;
+			result->elementIndex = 0;
+			result->weights[0] = result->weights[1] = result->weights[2] = 0.0;
+		} else {
+			result->layerID = data[1];
+			result->elementIndex = data[0] - 1;
+			memcpy(&result->weights[0], &data[2], sizeof(float));
+			memcpy(&result->weights[1], &data[3], sizeof(float));
+			result->weights[2] = 1.0 - result->weights[0] - result->weights[1];
+		}
+		return true;
+	}
+	return false;
+}
+
+
+/**
+ * @brief Returns true if a requested pixel has not been collected yet
+ * @return true if a request is in flight
+ */
+bool GLPickingBuffer::IsPending()
+{
+	return fences[0] != 0 || fences[1] != 0;
+}
@@ -0,0 +1,76 @@
+#ifndef GLPICKINGBUFFER_H
+#define GLPICKINGBUFFER_H
+
+#include "../adcData.h"
+#include "../GLData.h"
+
+
+/**
+ * @brief Describes the contents of a single pixel of a GLPickingBuffer
+ */
+struct PickResult {
+
+		unsigned int	layerID;	/**< The ID of the Layer drawn at the pixel, 0 if nothing was drawn */
+		unsigned int	elementIndex;	/**< The index of the element drawn at the pixel (element number - 1) */
+		float		weights[3];	/**< The barycentric weights of the element's three nodes at the pixel */
+		int		x;		/**< The x-coordinate of the pixel */
+		int		y;		/**< The y-coordinate of the pixel */
+
+		PickResult()
+		{
+			layerID = 0;
+			elementIndex = 0;
+			weights[0] = weights[1] = weights[2] = 0.0;
+			x = y = 0;
+		}
+};
+
+
+/**
+ * @brief An offscreen integer framebuffer used for GPU picking
+ *
+ * GLPickingBuffer provides an offscreen framebuffer with an unsigned integer color
+ * attachment that Layers draw into with a PickingShader (see Layer::DrawPicking()).
+ * A pick costs a single pixel read no matter how large the mesh is or how far the
+ * camera is zoomed, and the result is exact to the rasterized pixel.
+ *
+ * Reading the pixel back is asynchronous so the render thread never stalls waiting
+ * for the GPU. RequestPixel() starts a copy of the pixel into one of two pixel buffer
+ * objects, and GetResult() collects it on a later frame once the GPU has signaled
+ * that the copy is done. Typical use each frame:
+ * - Call GetResult() to collect any pick requested on a previous frame
+ * - If the mouse was clicked, call Begin(), draw all Layers with Layer::DrawPicking(),
+ * call End() and then RequestPixel()
+ * .
+ *
+ */
+class GLPickingBuffer
+{
+	public:
+
+		GLPickingBuffer();
+		~GLPickingBuffer();
+
+		int	Resize(int newWidth, int newHeight);
+		void	Begin();
+		void	End();
+		void	RequestPixel(int x, int y);
+		bool	GetResult(PickResult *result);
+		bool	IsPending();
+
+	protected:
+
+		int		width;			/**< The width of the framebuffer in pixels */
+		int		height;			/**< The height of the framebuffer in pixels */
+		GLuint		fboID;			/**< The framebuffer object ID */
+		GLuint		colorBufferID;		/**< The integer color renderbuffer ID */
+		GLuint		depthBufferID;		/**< The depth renderbuffer ID */
+		GLuint		pboIDs[2];		/**< The two pixel buffer objects used for asynchronous readback */
+		GLsync		fences[2];		/**< Fences that signal when each pixel buffer object copy is done */
+		int		pixels[2][2];		/**< The x-y coordinates of the pixel requested into each pixel buffer object */
+		int		nextPBO;		/**< The pixel buffer object used by the next request */
+		GLint		previousFBO;		/**< The framebuffer that was bound before Begin() */
+		GLint		previousViewport[4];	/**< The viewport that was set before Begin() */
+};
+
+#endif // GLPICKINGBUFFER_H
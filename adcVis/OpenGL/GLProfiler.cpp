@@ -0,0 +1,702 @@
+#include "GLProfiler.h"
+
+#include <map>
+
+
+// The number of frames whose GPU timestamps may be outstanding before EndFrame() waits
+static const unsigned int MaxFramesInFlight = 2;
+
+// The number of query objects created at once when the pool runs out
+static const unsigned int QueryBatchSize = 64;
+
+
+// Initialize static members
+bool					GLProfiler::enabled = false;
+bool					GLProfiler::timerQueries = false;
+bool					GLProfiler::timerQueriesChecked = false;
+bool					GLProfiler::frameStarted = false;
+std::chrono::steady_clock::time_point	GLProfiler::frameStart;
+unsigned long				GLProfiler::frameCount = 0;
+GLProfiler::PendingFrame		GLProfiler::currentFrame = {0, 0, 0, 0.0, std::vector<GLProfiler::Record>()};
+std::vector<GLProfiler::OpenSection>	GLProfiler::openSections;
+std::deque<GLProfiler::PendingFrame>	GLProfiler::pendingFrames;
+std::vector<GLuint>			GLProfiler::freeQueries;
+std::deque<GLProfiler::FrameStats>	GLProfiler::history;
+unsigned int				GLProfiler::averagingWindow = 60;
+FILE*					GLProfiler::csvFile = 0;
+std::string				GLProfiler::csvLocation;
+unsigned int				GLProfiler::csvRows = 0;
+unsigned int				GLProfiler::csvMaxRows = 0;
+
+
+/**
+ * @brief Turns measuring on or off
+ *
+ * Turning the profiler off drops any frame that is being measured, but keeps the
+ * collected history and the CSV file.
+ *
+ * @param newEnabled true to measure (default false)
+ */
+void GLProfiler::SetEnabled(bool newEnabled)
+{
+	if (enabled == newEnabled)
+		return;
+
+	enabled = newEnabled;
+	if (!enabled)
+	{
+		openSections.clear();
+		currentFrame.records.clear();
+		currentFrame.startQuery = 0;
+		frameStarted = false;
+	}
+}
+
+
+/**
+ * @brief Sets how many of the most recent frames GetStats() and GetReport() average over
+ * @param frames The number of frames (default 60)
+ */
+void GLProfiler::SetAveragingWindow(unsigned int frames)
+{
+	averagingWindow = frames > 0 ? frames : 1;
+	while (history.size() > averagingWindow)
+		history.pop_front();
+}
+
+
+/**
+ * @brief Drops every measurement and deletes the query objects from the OpenGL context
+ *
+ * The CSV file is left open.
+ *
+ */
+void GLProfiler::Reset()
+{
+	for (unsigned int i=0; i<pendingFrames.size(); i++)
+	{
+		PendingFrame *frame = &pendingFrames[i];
+		if (frame->startQuery)
+			freeQueries.push_back(frame->startQuery);
+		if (frame->endQuery)
+			freeQueries.push_back(frame->endQuery);
+		for (unsigned int j=0; j<frame->records.size(); j++)
+		{
+			if (frame->records[j].startQuery)
+				freeQueries.push_back(frame->records[j].startQuery);
+			if (frame->records[j].endQuery)
+				freeQueries.push_back(frame->records[j].endQuery);
+		}
+	}
+	if (!freeQueries.empty())
+		glDeleteQueries(freeQueries.size(), &freeQueries[0]);
+
+	freeQueries.clear();
+	pendingFrames.clear();
+	history.clear();
+	openSections.clear();
+	currentFrame.records.clear();
+	currentFrame.startQuery = 0;
+	frameStarted = false;
+}
+
+
+/**
+ * @brief Marks the start of a frame
+ *
+ * Sections measured before the first call to BeginFrame() (eg. uploads done while loading
+ * a file) are counted in the next frame that ends.
+ *
+ */
+void GLProfiler::BeginFrame()
+{
+	if (!enabled)
+		return;
+
+	frameStarted = true;
+	frameStart = std::chrono::steady_clock::now();
+	if (currentFrame.startQuery == 0)
+		currentFrame.startQuery = IssueTimestamp();
+}
+
+
+/**
+ * @brief Marks the end of a frame and collects every earlier frame the GPU has finished
+ *
+ * Sections that are still open are closed first.
+ *
+ */
+void GLProfiler::EndFrame()
+{
+	if (!enabled)
+		return;
+
+	if (!openSections.empty())
+	{
+		DEBUG("GLProfiler: %lu sections were not ended before the end of the frame\n", (unsigned long)openSections.size());
+		while (!openSections.empty())
+			End();
+	}
+
+	if (frameStarted)
+		currentFrame.cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+	else
+		currentFrame.cpuMilliseconds = 0.0;
+	currentFrame.endQuery = currentFrame.startQuery ? IssueTimestamp() : 0;
+	currentFrame.frameNumber = frameCount++;
+	frameStarted = false;
+
+	pendingFrames.push_back(currentFrame);
+	currentFrame.records.clear();
+	currentFrame.startQuery = 0;
+	currentFrame.endQuery = 0;
+
+	CollectFrames();
+}
+
+
+/**
+ * @brief Collects every frame that has ended, waiting for the GPU if needed
+ *
+ * Use this when every measurement must be available right away, eg. after glFinish() in
+ * a benchmark. It stalls the pipeline if the GPU has not finished the frames.
+ *
+ */
+void GLProfiler::Flush()
+{
+	while (!pendingFrames.empty())
+	{
+		CollectFrame(&pendingFrames.front());
+		pendingFrames.pop_front();
+	}
+}
+
+
+/**
+ * @brief Enters a section
+ *
+ * Every call must be matched by a call to End(). Use a GLProfileScope to do this
+ * automatically.
+ *
+ * @param layerID The ID of the Layer doing the work (Layer::GetID()), or 0
+ * @param section The kind of work
+ */
+void GLProfiler::Begin(unsigned int layerID, Section section)
+{
+	if (!enabled)
+		return;
+
+	Record record;
+	record.layerID = layerID;
+	record.section = section;
+	record.startQuery = IssueTimestamp();
+	record.endQuery = 0;
+	record.cpuMilliseconds = 0.0;
+	record.bytes = 0;
+	currentFrame.records.push_back(record);
+
+	OpenSection open;
+	open.record = currentFrame.records.size()-1;
+	open.start = std::chrono::steady_clock::now();
+	openSections.push_back(open);
+}
+
+
+/**
+ * @brief Leaves the innermost section
+ */
+void GLProfiler::End()
+{
+	if (!enabled || openSections.empty())
+		return;
+
+	OpenSection open = openSections.back();
+	openSections.pop_back();
+
+	Record *record = &currentFrame.records[open.record];
+	record->cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - open.start).count();
+	record->endQuery = record->startQuery ? IssueTimestamp() : 0;
+}
+
+
+/**
+ * @brief Adds a number of uploaded bytes to the innermost section
+ *
+ * Bytes uploaded outside of any section are ignored.
+ *
+ * @param bytes The number of bytes loaded to the OpenGL context
+ */
+void GLProfiler::AddBytes(size_t bytes)
+{
+	if (!enabled || openSections.empty())
+		return;
+
+	currentFrame.records[openSections.back().record].bytes += bytes;
+}
+
+
+/**
+ * @brief Starts writing every collected frame to a CSV file
+ *
+ * Each frame adds one row for the whole frame (layer 0, section "frame") and one row per
+ * Layer and Section that did any work:
+ * - frame,layer,section,cpu_ms,gpu_ms,calls,bytes
+ * .
+ *
+ * The file is rolled over once it holds maxRows rows: the full file is renamed by
+ * appending ".1" (replacing any older one) and a new file is started, so a long session
+ * keeps between maxRows and 2*maxRows of the most recent rows on disk.
+ *
+ * @param fileLoc The location of the CSV file, which is overwritten
+ * @param maxRows The number of rows per file, or 0 to never roll over
+ * @return 0 if the file was opened
+ * @return 1 if the file could not be opened
+ */
+int GLProfiler::StartCSV(std::string fileLoc, unsigned int maxRows)
+{
+	StopCSV();
+	csvLocation = fileLoc;
+	csvMaxRows = maxRows;
+	return OpenCSV();
+}
+
+
+/**
+ * @brief Stops writing frames to the CSV file and closes it
+ *
+ * Frames that have ended but whose GPU timestamps have not been read yet are collected
+ * and written first, so the OpenGL context must still be current.
+ *
+ */
+void GLProfiler::StopCSV()
+{
+	if (csvFile)
+	{
+		Flush();
+		fclose(csvFile);
+	}
+	csvFile = 0;
+	csvRows = 0;
+}
+
+
+/**
+ * @brief Returns true if the profiler is measuring
+ * @return true if the profiler is enabled
+ */
+bool GLProfiler::IsEnabled()
+{
+	return enabled;
+}
+
+
+/**
+ * @brief Returns the Layer of the innermost open section
+ *
+ * Used by code that does not know which Layer it is working for (eg. GLShader::Use()) to
+ * attribute its work to the Layer that called it.
+ *
+ * @return The Layer ID of the innermost open section, or 0 if no section is open
+ */
+unsigned int GLProfiler::GetCurrentLayer()
+{
+	if (openSections.empty())
+		return 0;
+	return currentFrame.records[openSections.back().record].layerID;
+}
+
+
+/**
+ * @brief Returns the averages of the most recently collected frames
+ *
+ * @param layers Filled with the per-frame averages of every Layer that did work, in order of Layer ID
+ * @param frameCPU Set to the average CPU time of a frame in milliseconds
+ * @param frameGPU Set to the average GPU time of a frame in milliseconds
+ * @return The number of frames averaged
+ */
+unsigned int GLProfiler::GetStats(std::vector<LayerStats> *layers, double *frameCPU, double *frameGPU)
+{
+	std::map<unsigned int, LayerStats> sums;
+	double cpu = 0.0, gpu = 0.0;
+	for (unsigned int i=0; i<history.size(); i++)
+	{
+		FrameStats *frame = &history[i];
+		cpu += frame->cpuMilliseconds;
+		gpu += frame->gpuMilliseconds;
+		for (unsigned int j=0; j<frame->layers.size(); j++)
+		{
+			LayerStats *source = &frame->layers[j];
+			std::map<unsigned int, LayerStats>::iterator it = sums.find(source->layerID);
+			if (it == sums.end())
+			{
+				sums[source->layerID] = *source;
+				continue;
+			}
+			for (int s=0; s<NumSections; s++)
+			{
+				it->second.sections[s].cpuMilliseconds += source->sections[s].cpuMilliseconds;
+				it->second.sections[s].gpuMilliseconds += source->sections[s].gpuMilliseconds;
+				it->second.sections[s].calls += source->sections[s].calls;
+				it->second.sections[s].bytes += source->sections[s].bytes;
+			}
+		}
+	}
+
+	const double Scale = history.empty() ? 0.0 : 1.0/history.size();
+	if (layers)
+	{
+		layers->clear();
+		for (std::map<unsigned int, LayerStats>::iterator it = sums.begin(); it != sums.end(); ++it)
+		{
+			for (int s=0; s<NumSections; s++)
+			{
+				it->second.sections[s].cpuMilliseconds *= Scale;
+				it->second.sections[s].gpuMilliseconds *= Scale;
+				it->second.sections[s].calls *= Scale;
+				it->second.sections[s].bytes *= Scale;
+			}
+			layers->push_back(it->second);
+		}
+	}
+	if (frameCPU)
+		*frameCPU = cpu*Scale;
+	if (frameGPU)
+		*frameGPU = gpu*Scale;
+
+	return history.size();
+}
+
+
+/**
+ * @brief Returns the number of frames ended so far
+ *
+ * This is the frame number the next frame will have, so it can be passed to
+ * GetFrameTotals() to sum the frames that follow.
+ *
+ * @return The number of frames ended since the program started
+ */
+unsigned long GLProfiler::GetFrameCount()
+{
+	return frameCount;
+}
+
+
+/**
+ * @brief Sums the collected frames from a frame number onward
+ *
+ * Only frames still in the averaging window are summed, so call Flush() first and keep
+ * the window larger than the number of frames of interest.
+ *
+ * @param firstFrame The number of the first frame to sum (see GetFrameCount())
+ * @param frameCPU Set to the sum of the CPU times in milliseconds, or 0
+ * @param frameGPU Set to the sum of the GPU times in milliseconds, or 0
+ * @param bytes Set to the number of bytes uploaded, or 0
+ * @return The number of frames summed
+ */
+unsigned int GLProfiler::GetFrameTotals(unsigned long firstFrame, double *frameCPU, double *frameGPU, double *bytes)
+{
+	unsigned int count = 0;
+	double cpu = 0.0, gpu = 0.0, uploaded = 0.0;
+	for (unsigned int i=0; i<history.size(); i++)
+	{
+		FrameStats *frame = &history[i];
+		if (frame->frameNumber < firstFrame)
+			continue;
+		count++;
+		cpu += frame->cpuMilliseconds;
+		gpu += frame->gpuMilliseconds;
+		for (unsigned int j=0; j<frame->layers.size(); j++)
+			for (int s=0; s<NumSections; s++)
+				uploaded += frame->layers[j].sections[s].bytes;
+	}
+	if (frameCPU)
+		*frameCPU = cpu;
+	if (frameGPU)
+		*frameGPU = gpu;
+	if (bytes)
+		*bytes = uploaded;
+	return count;
+}
+
+
+/**
+ * @brief Formats the averages returned by GetStats() as lines of text for display
+ * @param lines Filled with one line for the frame, one header line, and one line per Layer and Section that did work
+ */
+void GLProfiler::GetReport(std::vector<std::string> *lines)
+{
+	if (lines == 0)
+		return;
+	lines->clear();
+
+	std::vector<LayerStats> layers;
+	double frameCPU, frameGPU;
+	unsigned int numFrames = GetStats(&layers, &frameCPU, &frameGPU);
+
+	char line[256];
+	snprintf(line, sizeof(line), "Frame %8.2f ms CPU %8.2f ms GPU  (%u frames)", frameCPU, frameGPU, numFrames);
+	lines->push_back(line);
+	lines->push_back("Layer Section     CPU ms   GPU ms  Calls  Upload KB");
+	for (unsigned int i=0; i<layers.size(); i++)
+	{
+		for (int s=0; s<NumSections; s++)
+		{
+			SectionStats *stats = &layers[i].sections[s];
+			if (stats->calls <= 0.0)
+				continue;
+
+			char layer[16];
+			if (layers[i].layerID > 0)
+				snprintf(layer, sizeof(layer), "%5u", layers[i].layerID);
+			else
+				snprintf(layer, sizeof(layer), "    -");
+			snprintf(line, sizeof(line), "%s %-9s %8.2f %8.2f %6.2f %10.1f", layer, GetSectionName((Section)s),
+				 stats->cpuMilliseconds, stats->gpuMilliseconds, stats->calls, stats->bytes/1024.0);
+			lines->push_back(line);
+		}
+	}
+}
+
+
+/**
+ * @brief Returns the short name of a Section, as used in reports and CSV files
+ * @param section The Section
+ * @return The name of the Section
+ */
+const char* GLProfiler::GetSectionName(Section section)
+{
+	switch (section)
+	{
+		case FillSection:	return "fill";
+		case OutlineSection:	return "outline";
+		case OverlaySection:	return "overlay";
+		case PickingSection:	return "picking";
+		case UploadSection:	return "upload";
+		case ShaderSection:	return "shader";
+		default:		return "unknown";
+	}
+}
+
+
+/**
+ * @brief Records the GPU time once every previously issued command has finished
+ * @return The query object, or 0 if timestamp queries are not supported
+ */
+GLuint GLProfiler::IssueTimestamp()
+{
+	if (!timerQueriesChecked)
+	{
+		timerQueriesChecked = true;
+		timerQueries = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) && glQueryCounter != 0;
+		if (!timerQueries)
+			DEBUG("GLProfiler: timestamp queries are not supported, only CPU times will be measured\n");
+	}
+	if (!timerQueries)
+		return 0;
+
+	if (freeQueries.empty())
+	{
+		freeQueries.resize(QueryBatchSize);
+		glGenQueries(QueryBatchSize, &freeQueries[0]);
+	}
+
+	GLuint query = freeQueries.back();
+	freeQueries.pop_back();
+	glQueryCounter(query, GL_TIMESTAMP);
+	return query;
+}
+
+
+/**
+ * @brief Collects the oldest pending frames whose GPU timestamps are available
+ *
+ * Queries complete in the order they were issued, so a frame is complete once its last
+ * query is. If more than MaxFramesInFlight frames are pending, the oldest ones are
+ * collected even if the GPU has to be waited on.
+ *
+ */
+void GLProfiler::CollectFrames()
+{
+	while (!pendingFrames.empty())
+	{
+		PendingFrame *frame = &pendingFrames.front();
+		if (pendingFrames.size() <= MaxFramesInFlight)
+		{
+			GLuint lastQuery = frame->endQuery;
+			for (unsigned int i=0; i<frame->records.size() && lastQuery == 0; i++)
+				if (frame->records[frame->records.size()-1-i].endQuery)
+					lastQuery = frame->records[frame->records.size()-1-i].endQuery;
+
+			if (lastQuery)
+			{
+				GLint available = 0;
+				glGetQueryObjectiv(lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available)
+					return;
+			}
+		}
+
+		CollectFrame(frame);
+		pendingFrames.pop_front();
+	}
+}
+
+
+/**
+ * @brief Reads the GPU timestamps of a frame, sums it per Layer and Section, and adds it
+ * to the history and the CSV file
+ *
+ * The frame's query objects are returned to the pool.
+ *
+ * @param frame The frame
+ */
+void GLProfiler::CollectFrame(PendingFrame *frame)
+{
+	FrameStats stats;
+	stats.frameNumber = frame->frameNumber;
+	stats.cpuMilliseconds = frame->cpuMilliseconds;
+	stats.gpuMilliseconds = GetElapsed(frame->startQuery, frame->endQuery);
+
+	std::map<unsigned int, unsigned int> layerIndex;
+	for (unsigned int i=0; i<frame->records.size(); i++)
+	{
+		Record *record = &frame->records[i];
+		std::map<unsigned int, unsigned int>::iterator it = layerIndex.find(record->layerID);
+		if (it == layerIndex.end())
+		{
+			LayerStats layer;
+			layer.layerID = record->layerID;
+			for (int s=0; s<NumSections; s++)
+			{
+				layer.sections[s].cpuMilliseconds = 0.0;
+				layer.sections[s].gpuMilliseconds = 0.0;
+				layer.sections[s].calls = 0.0;
+				layer.sections[s].bytes = 0.0;
+			}
+			it = layerIndex.insert(std::make_pair(record->layerID, (unsigned int)stats.layers.size())).first;
+			stats.layers.push_back(layer);
+		}
+
+		SectionStats *section = &stats.layers[it->second].sections[record->section];
+		section->cpuMilliseconds += record->cpuMilliseconds;
+		section->gpuMilliseconds += GetElapsed(record->startQuery, record->endQuery);
+		section->calls += 1.0;
+		section->bytes += record->bytes;
+
+		if (record->startQuery)
+			freeQueries.push_back(record->startQuery);
+		if (record->endQuery)
+			freeQueries.push_back(record->endQuery);
+	}
+	if (frame->startQuery)
+		freeQueries.push_back(frame->startQuery);
+	if (frame->endQuery)
+		freeQueries.push_back(frame->endQuery);
+
+	WriteCSV(&stats);
+	history.push_back(FrameStats());
+	history.back().frameNumber = stats.frameNumber;
+	history.back().cpuMilliseconds = stats.cpuMilliseconds;
+	history.back().gpuMilliseconds = stats.gpuMilliseconds;
+	history.back().layers.swap(stats.layers);
+	while (history.size() > averagingWindow)
+		history.pop_front();
+}
+
+
+/**
+ * @brief Returns the time between two timestamp queries, waiting for them if needed
+ * @param startQuery The earlier query
+ * @param endQuery The later query
+ * @return The elapsed time in milliseconds, or 0 if either query is 0
+ */
+double GLProfiler::GetElapsed(GLuint startQuery, GLuint endQuery)
+{
+	if (startQuery == 0 || endQuery == 0)
+		return 0.0;
+
+	GLuint64 start = 0, end = 0;
+	glGetQueryObjectui64v(startQuery, GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(endQuery, GL_QUERY_RESULT, &end);
+	return end > start ? (end - start)/1000000.0 : 0.0;
+}
+
+
+/**
+ * @brief Appends the rows of a collected frame to the CSV file, rolling the file over if it is full
+ * @param frame The collected frame
+ */
+void GLProfiler::WriteCSV(FrameStats *frame)
+{
+	if (csvFile == 0)
+		return;
+
+	if (csvMaxRows > 0 && csvRows >= csvMaxRows)
+	{
+		fclose(csvFile);
+		csvFile = 0;
+		std::string oldLocation = csvLocation + ".1";
+		remove(oldLocation.data());
+		rename(csvLocation.data(), oldLocation.data());
+		if (OpenCSV() != 0)
+			return;
+	}
+
+	fprintf(csvFile, "%lu,0,frame,%.4f,%.4f,1,0\n", frame->frameNumber, frame->cpuMilliseconds, frame->gpuMilliseconds);
+	csvRows++;
+	for (unsigned int i=0; i<frame->layers.size(); i++)
+	{
+		for (int s=0; s<NumSections; s++)
+		{
+			SectionStats *stats = &frame->layers[i].sections[s];
+			if (stats->calls <= 0.0)
+				continue;
+			fprintf(csvFile, "%lu,%u,%s,%.4f,%.4f,%.0f,%.0f\n", frame->frameNumber, frame->layers[i].layerID,
+				GetSectionName((Section)s), stats->cpuMilliseconds, stats->gpuMilliseconds, stats->calls, stats->bytes);
+			csvRows++;
+		}
+	}
+	fflush(csvFile);
+}
+
+
+/**
+ * @brief Creates the CSV file and writes the header row
+ * @return 0 if the file was opened
+ * @return 1 if the file could not be opened
+ */
+int GLProfiler::OpenCSV()
+{
+	csvRows = 0;
+	csvFile = fopen(csvLocation.data(), "w");
+	if (csvFile == 0)
+	{
+		DEBUG("GLProfiler: unable to open %s\n", csvLocation.data());
+		return 1;
+	}
+	fprintf(csvFile, "frame,layer,section,cpu_ms,gpu_ms,calls,bytes\n");
+	return 0;
+}
+
+
+/**
+ * @brief Enters a section if the profiler is enabled
+ * @param layerID The ID of the Layer doing the work, or 0
+ * @param section The kind of work
+ */
+GLProfileScope::GLProfileScope(unsigned int layerID, GLProfiler::Section section)
+{
+	active = GLProfiler::IsEnabled();
+	if (active)
+		GLProfiler::Begin(layerID, section);
+}
+
+
+/**
+ * @brief Leaves the section entered by the constructor
+ */
+GLProfileScope::~GLProfileScope()
+{
+	if (active)
+		GLProfiler::End();
+}
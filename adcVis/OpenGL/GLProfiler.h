@@ -0,0 +1,186 @@
+#ifndef GLPROFILER_H
+#define GLPROFILER_H
+
+#include "../GLData.h"
+#include "adcData.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+
+
+/**
+ * @brief Measures where the time of every frame goes, per Layer and per kind of work
+ *
+ * Drawing code marks the work it does with Begin() and End() (or a GLProfileScope), naming
+ * the Layer and the GLProfiler::Section. For every section the profiler records:
+ * - The CPU wall time between Begin() and End()
+ * - The GPU time between the same two points, measured with OpenGL timestamp queries
+ * - The number of bytes uploaded to the OpenGL context (see AddBytes())
+ * .
+ *
+ * Sections can be nested, eg. GLShader::Use() inside the fill of a Layer. The time of a
+ * nested section is also counted in the section around it.
+ *
+ * GPU results are only read once the GPU has finished the frame, so reading them never
+ * stalls the pipeline. EndFrame() collects every frame whose queries have completed, and
+ * only waits for the oldest frame when more than two frames are still in flight.
+ *
+ * Collected frames are averaged over a window of recent frames for display (see
+ * GetStats() and GetReport()), and can be appended to a CSV file as they are collected
+ * (see StartCSV()).
+ *
+ * The profiler is disabled by default, in which case every call returns immediately. All
+ * functions must be called from the thread that owns the OpenGL context.
+ *
+ */
+class GLProfiler
+{
+	public:
+
+		/**
+		 * @brief The kinds of work that are measured
+		 */
+		enum Section {
+			FillSection,		/**< Layer fill (Layer::DrawFill()) */
+			OutlineSection,		/**< Layer outline (Layer::DrawOutline()) */
+			OverlaySection,		/**< Selections and other overlays (Layer::DrawOverlay()) */
+			PickingSection,		/**< Drawing into the picking buffer (Layer::DrawPicking()) */
+			UploadSection,		/**< Loading data to the OpenGL context */
+			ShaderSection,		/**< Binding shaders and updating uniforms (GLShader::Use()) */
+			NumSections
+		};
+
+		/**
+		 * @brief The measurements of one Section, averaged per frame
+		 */
+		struct SectionStats {
+				double	cpuMilliseconds;	/**< CPU wall time in milliseconds */
+				double	gpuMilliseconds;	/**< GPU time in milliseconds */
+				double	calls;			/**< The number of times the section was entered */
+				double	bytes;			/**< The number of bytes uploaded */
+		};
+
+		/**
+		 * @brief The measurements of every Section of one Layer
+		 */
+		struct LayerStats {
+				unsigned int	layerID;		/**< The ID of the Layer (Layer::GetID()), 0 for work not done by a Layer */
+				SectionStats	sections[NumSections];	/**< The measurements of each Section */
+		};
+
+		static void		SetEnabled(bool newEnabled);
+		static void		SetAveragingWindow(unsigned int frames);
+		static void		Reset();
+
+		static void		BeginFrame();
+		static void		EndFrame();
+		static void		Flush();
+		static void		Begin(unsigned int layerID, Section section);
+		static void		End();
+		static void		AddBytes(size_t bytes);
+
+		static int		StartCSV(std::string fileLoc, unsigned int maxRows);
+		static void		StopCSV();
+
+		// Getter Methods
+		static bool		IsEnabled();
+		static unsigned int	GetCurrentLayer();
+		static unsigned int	GetStats(std::vector<LayerStats> *layers, double *frameCPU, double *frameGPU);
+		static unsigned long	GetFrameCount();
+		static unsigned int	GetFrameTotals(unsigned long firstFrame, double *frameCPU, double *frameGPU, double *bytes);
+		static void		GetReport(std::vector<std::string> *lines);
+		static const char*	GetSectionName(Section section);
+
+	protected:
+
+		/**
+		 * @brief One measured section waiting for its GPU timestamps
+		 */
+		struct Record {
+				unsigned int	layerID;		/**< The Layer that did the work */
+				Section		section;		/**< The kind of work */
+				GLuint		startQuery;		/**< The timestamp query issued by Begin(), or 0 */
+				GLuint		endQuery;		/**< The timestamp query issued by End(), or 0 */
+				double		cpuMilliseconds;	/**< The CPU wall time */
+				size_t		bytes;			/**< The number of bytes uploaded */
+		};
+
+		/**
+		 * @brief A frame whose GPU timestamps have not been read yet
+		 */
+		struct PendingFrame {
+				unsigned long		frameNumber;		/**< The number of the frame */
+				GLuint			startQuery;		/**< The timestamp query issued by BeginFrame(), or 0 */
+				GLuint			endQuery;		/**< The timestamp query issued by EndFrame(), or 0 */
+				double			cpuMilliseconds;	/**< The CPU wall time from BeginFrame() to EndFrame() */
+				std::vector<Record>	records;		/**< Every section measured during the frame */
+		};
+
+		/**
+		 * @brief A collected frame, summed per Layer and Section
+		 */
+		struct FrameStats {
+				unsigned long		frameNumber;		/**< The number of the frame */
+				double			cpuMilliseconds;	/**< The CPU wall time of the frame */
+				double			gpuMilliseconds;	/**< The GPU time of the frame */
+				std::vector<LayerStats>	layers;			/**< The sums of every Layer that did work */
+		};
+
+		/**
+		 * @brief A section that has been entered but not left
+		 */
+		struct OpenSection {
+				unsigned int				record;		/**< The index of the section's Record in the current frame */
+				std::chrono::steady_clock::time_point	start;		/**< The time Begin() was called */
+		};
+
+		static bool				enabled;		/**< Set to true to measure */
+		static bool				timerQueries;		/**< Set to true if the OpenGL context supports timestamp queries */
+		static bool				timerQueriesChecked;	/**< Set to true once timerQueries has been checked */
+		static bool				frameStarted;		/**< Set to true between BeginFrame() and EndFrame() */
+		static std::chrono::steady_clock::time_point	frameStart;	/**< The time BeginFrame() was called */
+		static unsigned long			frameCount;		/**< The number of frames ended so far */
+		static PendingFrame			currentFrame;		/**< The frame being measured */
+		static std::vector<OpenSection>		openSections;		/**< The sections entered but not left, innermost last */
+		static std::deque<PendingFrame>		pendingFrames;		/**< Ended frames whose GPU timestamps have not been read */
+		static std::vector<GLuint>		freeQueries;		/**< Query objects that can be reused */
+		static std::deque<FrameStats>		history;		/**< The most recent collected frames, oldest first */
+		static unsigned int			averagingWindow;	/**< The largest number of frames in history */
+		static FILE*				csvFile;		/**< The CSV file collected frames are written to, or 0 */
+		static std::string			csvLocation;		/**< The location of the CSV file */
+		static unsigned int			csvRows;		/**< The number of rows written to the CSV file */
+		static unsigned int			csvMaxRows;		/**< The number of rows after which the CSV file is rotated */
+
+		// Protected Functions
+		static GLuint	IssueTimestamp();
+		static void	CollectFrames();
+		static void	CollectFrame(PendingFrame *frame);
+		static double	GetElapsed(GLuint startQuery, GLuint endQuery);
+		static void	WriteCSV(FrameStats *frame);
+		static int	OpenCSV();
+};
+
+
+/**
+ * @brief Measures a GLProfiler::Section for as long as it exists
+ *
+ * Calls GLProfiler::Begin() when it is created and GLProfiler::End() when it goes out of
+ * scope, so that every return path of the measured function is covered. Nothing is
+ * measured if the profiler is disabled when the scope is created.
+ *
+ */
+class GLProfileScope
+{
+	public:
+
+		GLProfileScope(unsigned int layerID, GLProfiler::Section section);
+		~GLProfileScope();
+
+	protected:
+
+		bool	active;		/**< Set to true if GLProfiler::Begin() was called */
+};
+
+#endif // GLPROFILER_H
@@ -0,0 +1,335 @@
+#include "GLRenderBenchmark.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+
+GLRenderBenchmark::GLRenderBenchmark()
+{
+	scene = 0;
+	width = 0;
+	height = 0;
+	warmupFrames = 3;
+	fboID = 0;
+	colorID = 0;
+	depthID = 0;
+}
+
+
+/**
+ * @brief Deconstructor that deletes the framebuffer from the OpenGL context
+ */
+GLRenderBenchmark::~GLRenderBenchmark()
+{
+	DeleteBuffers();
+}
+
+
+/**
+ * @brief Sets the scene that is rendered
+ *
+ * The scene is switched to non-interactive mode and resized to the size of the
+ * benchmark's frames.
+ *
+ * @param newScene The scene
+ */
+void GLRenderBenchmark::SetScene(GLScene *newScene)
+{
+	scene = newScene;
+	if (scene)
+	{
+		scene->SetInteractive(false);
+		if (width > 0 && height > 0)
+			scene->Resize(width, height);
+	}
+}
+
+
+/**
+ * @brief Sets the size of the frames and creates the offscreen framebuffer
+ *
+ * An OpenGL context must be current.
+ *
+ * @param newWidth The width of the frames in pixels
+ * @param newHeight The height of the frames in pixels
+ * @return 0 if the framebuffer was created
+ * @return 1 if an error occurred
+ */
+int GLRenderBenchmark::SetSize(int newWidth, int newHeight)
+{
+	if (newWidth <= 0 || newHeight <= 0)
+		return 1;
+
+	DeleteBuffers();
+	width = newWidth;
+	height = newHeight;
+
+	glGenFramebuffers(1, &fboID);
+	glGenRenderbuffers(1, &colorID);
+	glGenRenderbuffers(1, &depthID);
+	glBindFramebuffer(GL_FRAMEBUFFER, fboID);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorID);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		DEBUG("Benchmark framebuffer is incomplete (status %x)\n", status);
+		DeleteBuffers();
+		return 1;
+	}
+
+	if (scene)
+		scene->Resize(width, height);
+
+	return 0;
+}
+
+
+/**
+ * @brief Sets how many frames are rendered and dropped before the path is replayed
+ *
+ * Warm-up frames are drawn at the starting camera position. They absorb one-time costs
+ * such as shader compilation and uploads done while loading.
+ *
+ * @param frames The number of frames (default 3)
+ */
+void GLRenderBenchmark::SetWarmupFrames(unsigned int frames)
+{
+	warmupFrames = frames;
+}
+
+
+/**
+ * @brief Replays a camera path and measures every frame
+ *
+ * The results of any earlier run are dropped. The GLProfiler is enabled, with an averaging
+ * window that is large enough to hold every pass of a progressively drawn frame.
+ *
+ * @param path The camera path
+ * @param camera The camera moved by the path, which must be the scene's camera
+ * @param layers The Layers that receive timestep changes
+ * @return 0 if every frame was rendered
+ * @return 1 if an error occurred
+ */
+int GLRenderBenchmark::Run(GLCameraPath *path, GLCamera *camera, std::vector<Layer *> *layers)
+{
+	results.clear();
+	if (scene == 0 || path == 0 || camera == 0 || fboID == 0)
+		return 1;
+
+	const unsigned int MaxPassesPerFrame = 1000;
+	GLProfiler::SetEnabled(true);
+	GLProfiler::SetAveragingWindow(MaxPassesPerFrame);
+	GLProfiler::Flush();
+
+	FrameResult warmup;
+	warmup.stepMilliseconds = 0.0;
+	for (unsigned int i=0; i<warmupFrames; i++)
+	{
+		scene->Invalidate();
+		if (RenderFrame(&warmup) == GLScene::NotRendered)
+			return 1;
+	}
+
+	results.reserve(path->GetNumFrames());
+	path->Start(camera, layers);
+	while (true)
+	{
+		// Applying the step is part of the frame, since a timestep step loads new data
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!path->NextFrame())
+			break;
+
+		FrameResult frame;
+		frame.step = path->GetCurrentStep();
+		frame.stepType = path->GetStep(frame.step)->type;
+		frame.stepMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (RenderFrame(&frame) == GLScene::NotRendered)
+			return 1;
+		frame.wallMilliseconds += frame.stepMilliseconds;
+		results.push_back(frame);
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Summarizes the last run
+ *
+ * The wall, CPU and GPU times are reported as the 50th, 95th and 99th percentile and the
+ * maximum over all frames, followed by the upload volume, the median time of each kind
+ * of step, and how many frames the scene redrew.
+ *
+ * @param lines Filled with the lines of the summary
+ */
+void GLRenderBenchmark::GetReport(std::vector<std::string> *lines)
+{
+	if (lines == 0)
+		return;
+	lines->clear();
+
+	char line[256];
+	snprintf(line, sizeof(line), "%u frames at %ix%i (%u warm-up frames dropped)", (unsigned int)results.size(), width, height, warmupFrames);
+	lines->push_back(line);
+	if (results.empty())
+		return;
+
+	std::vector<double> wall, cpu, gpu;
+	double totalBytes = 0.0, maxBytes = 0.0;
+	unsigned int resultCounts[5] = {0, 0, 0, 0, 0};
+	for (unsigned int i=0; i<results.size(); i++)
+	{
+		wall.push_back(results[i].wallMilliseconds);
+		cpu.push_back(results[i].cpuMilliseconds);
+		gpu.push_back(results[i].gpuMilliseconds);
+		totalBytes += results[i].uploadBytes;
+		maxBytes = std::max(maxBytes, results[i].uploadBytes);
+		resultCounts[results[i].result]++;
+	}
+
+	lines->push_back("              p50       p95       p99       max");
+	snprintf(line, sizeof(line), "Frame ms %9.2f %9.2f %9.2f %9.2f", GetPercentile(wall, 50), GetPercentile(wall, 95), GetPercentile(wall, 99), GetPercentile(wall, 100));
+	lines->push_back(line);
+	snprintf(line, sizeof(line), "CPU ms   %9.2f %9.2f %9.2f %9.2f", GetPercentile(cpu, 50), GetPercentile(cpu, 95), GetPercentile(cpu, 99), GetPercentile(cpu, 100));
+	lines->push_back(line);
+	snprintf(line, sizeof(line), "GPU ms   %9.2f %9.2f %9.2f %9.2f", GetPercentile(gpu, 50), GetPercentile(gpu, 95), GetPercentile(gpu, 99), GetPercentile(gpu, 100));
+	lines->push_back(line);
+	snprintf(line, sizeof(line), "Uploaded %.2f MB in total, at most %.2f MB in one frame", totalBytes/1.0e6, maxBytes/1.0e6);
+	lines->push_back(line);
+
+	for (int type=GLCameraPath::FitStep; type<=GLCameraPath::HoldStep; type++)
+	{
+		std::vector<double> stepWall;
+		for (unsigned int i=0; i<results.size(); i++)
+			if (results[i].stepType == type)
+				stepWall.push_back(results[i].wallMilliseconds);
+		if (stepWall.empty())
+			continue;
+		snprintf(line, sizeof(line), "%-8s %4u frames, p50 %.2f ms, p95 %.2f ms", GLCameraPath::GetStepName((GLCameraPath::StepType)type),
+			 (unsigned int)stepWall.size(), GetPercentile(stepWall, 50), GetPercentile(stepWall, 95));
+		lines->push_back(line);
+	}
+
+	snprintf(line, sizeof(line), "Redraws: %u full, %u overlay, %u cached", resultCounts[GLScene::FullRedraw],
+		 resultCounts[GLScene::OverlayRedraw], resultCounts[GLScene::CachedFrame]);
+	lines->push_back(line);
+}
+
+
+/**
+ * @brief Writes the measurements of every frame of the last run to a CSV file
+ *
+ * The columns are frame, step, type, result, wall_ms, step_ms, cpu_ms, gpu_ms and upload_bytes.
+ *
+ * @param fileLoc The location of the CSV file
+ * @return 0 if the file was written
+ * @return 1 if an error occurred
+ */
+int GLRenderBenchmark::WriteCSV(std::string fileLoc)
+{
+	FILE *file = fopen(fileLoc.data(), "w");
+	if (file == 0)
+	{
+		DEBUG("Unable to create %s\n", fileLoc.data());
+		return 1;
+	}
+
+	const char *ResultNames[] = {"none", "cached", "overlay", "progressive", "full"};
+	fprintf(file, "frame,step,type,result,wall_ms,step_ms,cpu_ms,gpu_ms,upload_bytes\n");
+	for (unsigned int i=0; i<results.size(); i++)
+	{
+		FrameResult *frame = &results[i];
+		fprintf(file, "%u,%u,%s,%s,%.4f,%.4f,%.4f,%.4f,%.0f\n", i, frame->step, GLCameraPath::GetStepName(frame->stepType),
+			ResultNames[frame->result], frame->wallMilliseconds, frame->stepMilliseconds, frame->cpuMilliseconds, frame->gpuMilliseconds, frame->uploadBytes);
+	}
+
+	bool failed = ferror(file) != 0;
+	if (fclose(file) != 0)
+		failed = true;
+	return failed ? 1 : 0;
+}
+
+
+/**
+ * @brief Returns the measurements of every frame of the last run
+ * @return A pointer to the list of frames
+ */
+std::vector<GLRenderBenchmark::FrameResult>* GLRenderBenchmark::GetResults()
+{
+	return &results;
+}
+
+
+/**
+ * @brief Returns a percentile of a list of values, using the nearest rank
+ * @param values The values
+ * @param percentile The percentile, 0 - 100
+ * @return The value at the percentile, or 0 if there are no values
+ */
+double GLRenderBenchmark::GetPercentile(std::vector<double> values, double percentile)
+{
+	if (values.empty())
+		return 0.0;
+
+	std::sort(values.begin(), values.end());
+	size_t rank = (size_t)(percentile/100.0*values.size() + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	if (rank > values.size())
+		rank = values.size();
+	return values[rank-1];
+}
+
+
+/**
+ * @brief Renders the scene to completion and waits for the GPU
+ *
+ * The frame's GPU time and uploads are collected from the GLProfiler, which may have
+ * measured several passes for one progressively drawn frame.
+ *
+ * @param frame Filled with the measurements of the frame
+ * @return What the scene had to draw in the last pass
+ */
+GLScene::RenderResult GLRenderBenchmark::RenderFrame(FrameResult *frame)
+{
+	unsigned long firstFrame = GLProfiler::GetFrameCount();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	GLScene::RenderResult result;
+	do {
+		result = scene->Render(fboID);
+	} while (result == GLScene::ProgressiveRedraw);
+	glFinish();
+
+	frame->result = result;
+	frame->wallMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	GLProfiler::Flush();
+	GLProfiler::GetFrameTotals(firstFrame, &frame->cpuMilliseconds, &frame->gpuMilliseconds, &frame->uploadBytes);
+	return result;
+}
+
+
+/**
+ * @brief Deletes the framebuffer from the OpenGL context
+ */
+void GLRenderBenchmark::DeleteBuffers()
+{
+	if (fboID)
+		glDeleteFramebuffers(1, &fboID);
+	if (colorID)
+		glDeleteRenderbuffers(1, &colorID);
+	if (depthID)
+		glDeleteRenderbuffers(1, &depthID);
+	fboID = 0;
+	colorID = 0;
+	depthID = 0;
+}
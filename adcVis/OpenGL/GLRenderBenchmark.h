@@ -0,0 +1,81 @@
+#ifndef GLRENDERBENCHMARK_H
+#define GLRENDERBENCHMARK_H
+
+#include "GLScene.h"
+#include "GLCameraPath.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Replays a GLCameraPath through a GLScene offscreen and measures every frame
+ *
+ * Each frame of the path is rendered to completion into the benchmark's own framebuffer,
+ * followed by glFinish(), so the measured frame time includes the GPU's work. For every
+ * frame the benchmark records:
+ * - The wall time from applying the path step (a camera change, or loading a new timestep)
+ * until the GPU has finished, and the part of it spent applying the step
+ * - The GPU time and uploaded bytes reported by the GLProfiler
+ * - What the GLScene had to draw (see GLScene::RenderResult)
+ * .
+ *
+ * GetReport() summarizes the frames with the 50th, 95th and 99th percentiles, and
+ * WriteCSV() writes the measurements of every frame so that runs can be compared.
+ *
+ * The scene is switched to non-interactive mode, so every frame is drawn at full
+ * resolution and the results do not depend on how fast frames are drawn. The GLProfiler
+ * is enabled by Run(), and left enabled.
+ *
+ */
+class GLRenderBenchmark
+{
+	public:
+
+		/**
+		 * @brief The measurements of one frame
+		 */
+		struct FrameResult {
+				unsigned int		step;			/**< The index of the camera path step that produced the frame */
+				GLCameraPath::StepType	stepType;		/**< The kind of step that produced the frame */
+				GLScene::RenderResult	result;			/**< What the scene had to draw */
+				double			wallMilliseconds;	/**< The time until the GPU finished the frame, including stepMilliseconds */
+				double			stepMilliseconds;	/**< The time spent applying the camera path step (eg. loading a timestep) */
+				double			cpuMilliseconds;	/**< The CPU time inside GLScene::Render() */
+				double			gpuMilliseconds;	/**< The GPU time measured by the GLProfiler */
+				double			uploadBytes;		/**< The number of bytes loaded to the OpenGL context */
+		};
+
+		GLRenderBenchmark();
+		~GLRenderBenchmark();
+
+		void		SetScene(GLScene *newScene);
+		int		SetSize(int newWidth, int newHeight);
+		void		SetWarmupFrames(unsigned int frames);
+
+		int		Run(GLCameraPath *path, GLCamera *camera, std::vector<Layer*> *layers);
+		void		GetReport(std::vector<std::string> *lines);
+		int		WriteCSV(std::string fileLoc);
+
+		// Getter Methods
+		std::vector<FrameResult>*	GetResults();
+		static double			GetPercentile(std::vector<double> values, double percentile);
+
+	protected:
+
+		GLScene*			scene;		/**< The scene that is rendered */
+		int				width;		/**< The width of the frames in pixels */
+		int				height;		/**< The height of the frames in pixels */
+		unsigned int			warmupFrames;	/**< The number of frames rendered and dropped before measuring */
+		std::vector<FrameResult>	results;	/**< The measurements of every frame of the last run */
+
+		// OpenGL Variables
+		GLuint		fboID;		/**< The framebuffer the scene is rendered into */
+		GLuint		colorID;	/**< The color renderbuffer of the framebuffer */
+		GLuint		depthID;	/**< The depth renderbuffer of the framebuffer */
+
+		// Protected Functions
+		GLScene::RenderResult	RenderFrame(FrameResult *frame);
+		void			DeleteBuffers();
+};
+
+#endif // GLRENDERBENCHMARK_H
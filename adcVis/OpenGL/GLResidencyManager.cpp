@@ -0,0 +1,487 @@
+#include "GLResidencyManager.h"
+#include "GLProfiler.h"
+#include "../IO/TraceWriter.h"
+
+#include <algorithm>
+
+
+// Queued or Ready chunks that have not been requested for this many frames are dropped
+static const unsigned int StaleFrames = 4;
+
+// The budget used when the available video memory cannot be queried
+static const size_t DefaultBudget = 256*1024*1024;
+
+// The default number of bytes loaded to the OpenGL context per frame
+static const size_t DefaultUploadBudget = 32*1024*1024;
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ *
+ * No threads are started until SetFile() is called.
+ *
+ */
+GLResidencyManager::GLResidencyManager()
+{
+	file = 0;
+	slots = 0;
+	numSlots = 0;
+	frame = 0;
+	budget = DefaultBudget;
+	uploadBudget = DefaultUploadBudget;
+	budgetBlocked = false;
+	stopping = false;
+
+	stats.residentChunks = 0;
+	stats.residentBytes = 0;
+	stats.budgetBytes = budget;
+	stats.pendingChunks = 0;
+	stats.readyChunks = 0;
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.uploads = 0;
+	stats.evictions = 0;
+}
+
+
+/**
+ * @brief Deconstructor that stops the background threads and deletes every resident chunk
+ * from the OpenGL context
+ *
+ * The OpenGL context that the chunks were loaded to must be current.
+ *
+ */
+GLResidencyManager::~GLResidencyManager()
+{
+	Clear();
+}
+
+
+/**
+ * @brief Sets the file that chunks are read from and starts the background threads
+ *
+ * Any chunks from a previous file are deleted from the OpenGL context.
+ *
+ * @param newFile A pointer to an open ChunkedMeshFile, the manager does not take ownership
+ * @param numThreads The number of background threads used to read chunks (at least 1)
+ * @return 0 if the manager is ready
+ * @return 1 if the file is not open
+ */
+int GLResidencyManager::SetFile(ChunkedMeshFile *newFile, unsigned int numThreads)
+{
+	Clear();
+	if (newFile == 0 || !newFile->IsOpen())
+		return 1;
+
+	file = newFile;
+	numSlots = file->GetNumChunks();
+	slots = new ChunkSlot[numSlots];
+	for (unsigned int i=0; i<numSlots; i++)
+	{
+		slots[i].state = Unloaded;
+		slots[i].lastUsed = 0;
+		slots[i].data = 0;
+		slots[i].vaoID = 0;
+		slots[i].vboID = 0;
+		slots[i].iboID = 0;
+		slots[i].bytes = 0;
+	}
+
+	stopping = false;
+	for (unsigned int i=0; i<std::max(1u, numThreads); i++)
+		workers.push_back(std::thread(&GLResidencyManager::WorkerLoop, this));
+	return 0;
+}
+
+
+/**
+ * @brief Sets the largest allowed size of the resident chunks
+ *
+ * Chunks are not evicted right away, only the next time room is needed. A good starting
+ * point is half of GetAvailableVideoMemory().
+ *
+ * @param bytes The video memory budget in bytes (default 256 MB)
+ */
+void GLResidencyManager::SetBudget(size_t bytes)
+{
+	budget = bytes;
+	stats.budgetBytes = bytes;
+	budgetBlocked = false;
+}
+
+
+/**
+ * @brief Sets how many bytes are loaded to the OpenGL context per frame
+ *
+ * At least one chunk is always loaded per frame if one is waiting, so that chunks larger
+ * than the upload budget are not starved.
+ *
+ * @param bytesPerFrame The largest number of bytes uploaded per frame (default 32 MB)
+ */
+void GLResidencyManager::SetUploadBudget(size_t bytesPerFrame)
+{
+	uploadBudget = bytesPerFrame;
+}
+
+
+/**
+ * @brief Starts a new frame
+ *
+ * Queued chunks that have not been requested recently are removed from the queue, and
+ * Ready chunks that have not been requested recently are released.
+ *
+ */
+void GLResidencyManager::BeginFrame()
+{
+	frame++;
+	if (slots == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock (queueMutex);
+	std::deque<unsigned int>::iterator it = requestQueue.begin();
+	while (it != requestQueue.end())
+	{
+		if (slots[*it].lastUsed + StaleFrames < frame)
+		{
+			slots[*it].state = Unloaded;
+			it = requestQueue.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	unsigned int count = 0;
+	for (unsigned int i=0; i<readyChunks.size(); i++)
+	{
+		ChunkSlot *slot = &slots[readyChunks[i]];
+		if (slot->lastUsed + StaleFrames < frame)
+		{
+			delete slot->data;
+			slot->data = 0;
+			slot->state = Unloaded;
+		} else {
+			readyChunks[count++] = readyChunks[i];
+		}
+	}
+	readyChunks.resize(count);
+}
+
+
+/**
+ * @brief Loads chunks that have been read from disk to the OpenGL context
+ *
+ * Only chunks that were requested during the previous frame are loaded, most recently
+ * requested first, until the upload budget for the frame has been used. Least recently
+ * used chunks are evicted to make room. Must be called from the thread that owns the
+ * OpenGL context, after BeginFrame() and before any calls to Request().
+ *
+ */
+void GLResidencyManager::Update()
+{
+	if (slots == 0)
+		return;
+
+	std::vector<unsigned int> ready;
+	{
+		std::lock_guard<std::mutex> lock (queueMutex);
+		ready.swap(readyChunks);
+	}
+
+	// Most recently requested first
+	ChunkSlot *s = slots;
+	std::sort(ready.begin(), ready.end(), [s](unsigned int a, unsigned int b) {
+		return s[a].lastUsed > s[b].lastUsed;
+	});
+
+	budgetBlocked = false;
+	size_t uploaded = 0;
+	unsigned int count = 0;
+	for (unsigned int i=0; i<ready.size(); i++)
+	{
+		ChunkSlot *slot = &slots[ready[i]];
+		size_t bytes = sizeof(GLfloat)*slot->data->vertices.size() + sizeof(GLuint)*slot->data->indices.size();
+		if (budgetBlocked || slot->lastUsed + 1 < frame || (uploaded > 0 && uploaded + bytes > uploadBudget))
+		{
+			ready[count++] = ready[i];
+			continue;
+		}
+		if (!MakeRoom(bytes))
+		{
+			budgetBlocked = true;
+			ready[count++] = ready[i];
+			continue;
+		}
+		Upload(ready[i]);
+		uploaded += bytes;
+	}
+	ready.resize(count);
+
+	std::lock_guard<std::mutex> lock (queueMutex);
+	readyChunks.insert(readyChunks.end(), ready.begin(), ready.end());
+}
+
+
+/**
+ * @brief Requests a chunk for the current frame
+ *
+ * If the chunk is not resident, it is queued to be read from disk.
+ *
+ * @param chunk The index of the chunk
+ * @return true if the chunk is resident and can be drawn
+ * @return false otherwise
+ */
+bool GLResidencyManager::Request(unsigned int chunk)
+{
+	if (chunk >= numSlots)
+		return false;
+
+	ChunkSlot *slot = &slots[chunk];
+	slot->lastUsed = frame;
+	if (slot->state == Resident)
+	{
+		stats.hits++;
+		return true;
+	}
+
+	stats.misses++;
+	if (slot->state == Unloaded)
+	{
+		{
+			std::lock_guard<std::mutex> lock (queueMutex);
+			slot->state = Queued;
+			requestQueue.push_back(chunk);
+		}
+		queueCondition.notify_one();
+	}
+	return false;
+}
+
+
+/**
+ * @brief Returns the vertex array object of a resident chunk
+ *
+ * The vertex array object holds the chunk's Nodes as attribute 0 and its Elements as
+ * the index buffer.
+ *
+ * @param chunk The index of the chunk
+ * @return The vertex array object ID
+ * @return 0 if the chunk is not resident
+ */
+GLuint GLResidencyManager::GetVertexArray(unsigned int chunk)
+{
+	if (chunk >= numSlots || slots[chunk].state != Resident)
+		return 0;
+	return slots[chunk].vaoID;
+}
+
+
+/**
+ * @brief Returns true if chunks have been read from disk and can be uploaded
+ *
+ * Only chunks that were requested during the current frame are counted, and none are
+ * counted while the budget is full.
+ *
+ * @return true if the next call to Update() will load chunks to the OpenGL context
+ */
+bool GLResidencyManager::HasPendingUploads()
+{
+	std::lock_guard<std::mutex> lock (queueMutex);
+	if (budgetBlocked)
+		return false;
+	for (unsigned int i=0; i<readyChunks.size(); i++)
+		if (slots[readyChunks[i]].lastUsed == frame)
+			return true;
+	return false;
+}
+
+
+/**
+ * @brief Returns the current counters
+ * @return The current ResidencyStats
+ */
+ResidencyStats GLResidencyManager::GetStats()
+{
+	std::lock_guard<std::mutex> lock (queueMutex);
+	stats.pendingChunks = 0;
+	for (unsigned int i=0; i<numSlots; i++)
+		if (slots[i].state == Queued || slots[i].state == Loading)
+			stats.pendingChunks++;
+	stats.readyChunks = readyChunks.size();
+	return stats;
+}
+
+
+/**
+ * @brief Returns the amount of free video memory reported by the driver
+ *
+ * Uses GL_NVX_gpu_memory_info or GL_ATI_meminfo, whichever is available.
+ *
+ * @return The amount of free video memory in bytes
+ * @return 0 if the driver does not report it
+ */
+size_t GLResidencyManager::GetAvailableVideoMemory()
+{
+	GLint info[4] = {0, 0, 0, 0};
+	if (GLEW_NVX_gpu_memory_info)
+		glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, info);
+	else if (GLEW_ATI_meminfo)
+		glGetIntegerv(GL_VBO_FREE_MEMORY_ATI, info);
+	return (size_t)info[0]*1024;
+}
+
+
+/**
+ * @brief The function run by every background thread
+ *
+ * Takes the newest chunk off the queue, reads it from disk and adds it to the list of
+ * chunks waiting to be uploaded, until the manager is stopped.
+ *
+ */
+void GLResidencyManager::WorkerLoop()
+{
+	TRACE_THREAD_NAME("Chunk loader");
+	while (true)
+	{
+		unsigned int chunk;
+		{
+			std::unique_lock<std::mutex> lock (queueMutex);
+			queueCondition.wait(lock, [this]() { return stopping || !requestQueue.empty(); });
+			if (stopping)
+				return;
+			chunk = requestQueue.back();
+			requestQueue.pop_back();
+			slots[chunk].state = Loading;
+		}
+
+		MeshChunkData *data = new MeshChunkData;
+		bool success = file->ReadChunk(chunk, data) == 0;
+
+		std::lock_guard<std::mutex> lock (queueMutex);
+		if (success)
+		{
+			slots[chunk].data = data;
+			slots[chunk].state = Ready;
+			readyChunks.push_back(chunk);
+		} else {
+			delete data;
+			slots[chunk].state = Unloaded;
+		}
+	}
+}
+
+
+/**
+ * @brief Loads a Ready chunk to the OpenGL context
+ * @param chunk The index of the chunk
+ */
+void GLResidencyManager::Upload(unsigned int chunk)
+{
+	TRACE_SCOPE("gpu", "Upload chunk");
+	ChunkSlot *slot = &slots[chunk];
+	MeshChunkData *data = slot->data;
+
+	glGenVertexArrays(1, &slot->vaoID);
+	glGenBuffers(1, &slot->vboID);
+	glGenBuffers(1, &slot->iboID);
+
+	glBindVertexArray(slot->vaoID);
+	glBindBuffer(GL_ARRAY_BUFFER, slot->vboID);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat)*data->vertices.size(), data->vertices.size() ? &data->vertices[0] : 0, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, slot->iboID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)*data->indices.size(), data->indices.size() ? &data->indices[0] : 0, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+
+	slot->bytes = sizeof(GLfloat)*data->vertices.size() + sizeof(GLuint)*data->indices.size();
+	GLProfiler::AddBytes(slot->bytes);
+	delete data;
+	slot->data = 0;
+	slot->state = Resident;
+
+	stats.residentChunks++;
+	stats.residentBytes += slot->bytes;
+	stats.uploads++;
+
+	if (glGetError() != GL_NO_ERROR)
+		DEBUG("OpenGL Error found after loading chunk %i\n", chunk);
+}
+
+
+/**
+ * @brief Deletes a Resident chunk from the OpenGL context
+ * @param chunk The index of the chunk
+ */
+void GLResidencyManager::Evict(unsigned int chunk)
+{
+	ChunkSlot *slot = &slots[chunk];
+	glDeleteVertexArrays(1, &slot->vaoID);
+	glDeleteBuffers(1, &slot->vboID);
+	glDeleteBuffers(1, &slot->iboID);
+	slot->vaoID = 0;
+	slot->vboID = 0;
+	slot->iboID = 0;
+	slot->state = Unloaded;
+
+	stats.residentChunks--;
+	stats.residentBytes -= slot->bytes;
+	stats.evictions++;
+	slot->bytes = 0;
+}
+
+
+/**
+ * @brief Evicts least recently used chunks until there is room in the budget
+ *
+ * Chunks requested during the current or previous frame are never evicted.
+ *
+ * @param bytes The number of bytes that are needed
+ * @return true if there is room
+ * @return false if there is not enough room even after evicting every unused chunk
+ */
+bool GLResidencyManager::MakeRoom(size_t bytes)
+{
+	while (stats.residentBytes + bytes > budget)
+	{
+		unsigned int oldest = numSlots;
+		for (unsigned int i=0; i<numSlots; i++)
+		{
+			if (slots[i].state == Resident && slots[i].lastUsed + 1 < frame &&
+			    (oldest == numSlots || slots[i].lastUsed < slots[oldest].lastUsed))
+				oldest = i;
+		}
+		if (oldest == numSlots)
+			return false;
+		Evict(oldest);
+	}
+	return true;
+}
+
+
+/**
+ * @brief Stops the background threads and releases every chunk
+ */
+void GLResidencyManager::Clear()
+{
+	{
+		std::lock_guard<std::mutex> lock (queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+	for (unsigned int i=0; i<workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	for (unsigned int i=0; i<numSlots; i++)
+	{
+		if (slots[i].state == Resident)
+			Evict(i);
+		delete slots[i].data;
+	}
+	delete[] slots;
+	slots = 0;
+	numSlots = 0;
+	file = 0;
+	requestQueue.clear();
+	readyChunks.clear();
+}
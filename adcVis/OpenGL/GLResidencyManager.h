@@ -0,0 +1,120 @@
+#ifndef GLRESIDENCYMANAGER_H
+#define GLRESIDENCYMANAGER_H
+
+#include "../GLData.h"
+#include "../IO/ChunkedMeshFile.h"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+/**
+ * @brief Counters that describe the state of a GLResidencyManager
+ */
+struct ResidencyStats {
+		unsigned int	residentChunks;		/**< The number of chunks loaded to the OpenGL context */
+		size_t		residentBytes;		/**< The size of the resident chunks' buffers in bytes */
+		size_t		budgetBytes;		/**< The largest allowed size of the resident chunks in bytes */
+		unsigned int	pendingChunks;		/**< The number of chunks waiting to be read or being read from disk */
+		unsigned int	readyChunks;		/**< The number of chunks read from disk and waiting to be uploaded */
+		unsigned long	hits;			/**< The number of requests for resident chunks */
+		unsigned long	misses;			/**< The number of requests for chunks that were not resident */
+		unsigned long	uploads;		/**< The number of chunks loaded to the OpenGL context */
+		unsigned long	evictions;		/**< The number of chunks removed from the OpenGL context */
+};
+
+
+/**
+ * @brief Keeps the chunks of a ChunkedMeshFile that are in use loaded to the OpenGL context,
+ * within a video memory budget
+ *
+ * Every frame, the drawing code calls BeginFrame(), then Update(), then Request() for
+ * every chunk it would like to draw. Requests for chunks that are not resident are queued
+ * and read from disk by a pool of background threads, newest requests first. Requests
+ * that have not been repeated for a few frames are dropped from the queue.
+ *
+ * Update() loads chunks that have been read to the OpenGL context, a limited number of
+ * bytes per frame, and makes room for them by deleting the least recently used chunks.
+ * Chunks requested during the current or previous frame are never deleted, so if every
+ * visible chunk does not fit in the budget, some of them are simply not loaded. All
+ * OpenGL calls are made from the thread that calls Update().
+ *
+ */
+class GLResidencyManager
+{
+	public:
+
+		GLResidencyManager();
+		~GLResidencyManager();
+
+		int		SetFile(ChunkedMeshFile *newFile, unsigned int numThreads);
+		void		SetBudget(size_t bytes);
+		void		SetUploadBudget(size_t bytesPerFrame);
+
+		void		BeginFrame();
+		void		Update();
+		bool		Request(unsigned int chunk);
+
+		// Getter Methods
+		GLuint		GetVertexArray(unsigned int chunk);
+		bool		HasPendingUploads();
+		ResidencyStats	GetStats();
+
+		static size_t	GetAvailableVideoMemory();
+
+	protected:
+
+		/**
+		 * @brief The states a chunk moves through
+		 */
+		enum ChunkState {
+			Unloaded,	/**< Only on disk */
+			Queued,		/**< Waiting for a background thread */
+			Loading,	/**< Being read by a background thread */
+			Ready,		/**< Read from disk, waiting to be uploaded */
+			Resident	/**< Loaded to the OpenGL context */
+		};
+
+		/**
+		 * @brief Everything the manager knows about one chunk
+		 */
+		struct ChunkSlot {
+				std::atomic<int>	state;		/**< The chunk's ChunkState */
+				unsigned int		lastUsed;	/**< The last frame the chunk was requested */
+				MeshChunkData*		data;		/**< The chunk's data while Ready */
+				GLuint			vaoID;		/**< The chunk's vertex array object ID while Resident */
+				GLuint			vboID;		/**< The chunk's vertex buffer object ID while Resident */
+				GLuint			iboID;		/**< The chunk's index buffer object ID while Resident */
+				size_t			bytes;		/**< The size of the chunk's buffers in bytes */
+		};
+
+		ChunkedMeshFile*	file;			/**< The file chunks are read from */
+		ChunkSlot*		slots;			/**< One slot for every chunk in the file */
+		unsigned int		numSlots;		/**< The number of chunks in the file */
+		unsigned int		frame;			/**< The current frame number */
+		size_t			budget;			/**< The largest allowed size of the resident chunks in bytes */
+		size_t			uploadBudget;		/**< The largest number of bytes uploaded per frame */
+		bool			budgetBlocked;		/**< Set to true when a Ready chunk did not fit in the budget */
+		ResidencyStats		stats;			/**< The current counters */
+
+		// Background threads
+		std::vector<std::thread>	workers;	/**< The threads that read chunks from disk */
+		std::mutex			queueMutex;	/**< Protects requestQueue, readyChunks and stopping */
+		std::condition_variable		queueCondition;	/**< Wakes the workers when chunks are queued */
+		std::deque<unsigned int>	requestQueue;	/**< The queued chunks, newest at the back */
+		std::vector<unsigned int>	readyChunks;	/**< The chunks that have been read and are waiting to be uploaded */
+		bool				stopping;	/**< Set to true to make the workers exit */
+
+		// Protected Functions
+		void		WorkerLoop();
+		void		Upload(unsigned int chunk);
+		void		Evict(unsigned int chunk);
+		bool		MakeRoom(size_t bytes);
+		void		Clear();
+};
+
+#endif // GLRESIDENCYMANAGER_H
@@ -0,0 +1,544 @@
+#include "GLScene.h"
+
+
+/**
+ * @brief Constructor initializes all variables to default values
+ *
+ * No OpenGL objects are created until Resize() is called with a current context.
+ *
+ */
+GLScene::GLScene()
+{
+	camera = 0;
+	cameraVersion = 0;
+	clearColor[0] = 0.0;
+	clearColor[1] = 0.0;
+	clearColor[2] = 0.0;
+	clearColor[3] = 1.0;
+	cacheValid = false;
+	frameValid = false;
+
+	interactive = true;
+	interacting = false;
+	idleDelay = std::chrono::milliseconds(150);
+	lastCameraChange = std::chrono::steady_clock::now();
+
+	progressive = false;
+	progressiveBudget = 2000000;
+	progressLayer = 0;
+	progress = 0;
+
+	width = 0;
+	height = 0;
+	baseFBO = 0;
+	baseColorID = 0;
+	baseDepthID = 0;
+	frameFBO = 0;
+	frameColorID = 0;
+	frameDepthID = 0;
+	progressFBO = 0;
+	progressColorID = 0;
+	progressDepthID = 0;
+
+	pickRequested = false;
+	pickX = 0;
+	pickY = 0;
+
+	profilerVisible = false;
+}
+
+
+/**
+ * @brief Deconstructor that deletes the cached framebuffers from the OpenGL context
+ *
+ * The scene does not own its Layers or its camera.
+ *
+ */
+GLScene::~GLScene()
+{
+	DeleteFramebuffers();
+}
+
+
+/**
+ * @brief Adds a Layer to the end of the drawing order
+ * @param newLayer A pointer to the Layer, the scene does not take ownership
+ */
+void GLScene::AddLayer(Layer *newLayer)
+{
+	if (newLayer != 0)
+	{
+		layers.push_back(newLayer);
+		newLayer->SetInteracting(interacting);
+		cacheValid = false;
+	}
+}
+
+
+/**
+ * @brief Removes a Layer from the scene
+ * @param oldLayer A pointer to the Layer to remove
+ */
+void GLScene::RemoveLayer(Layer *oldLayer)
+{
+	for (unsigned int i=0; i<layers.size(); i++)
+	{
+		if (layers[i] == oldLayer)
+		{
+			layers.erase(layers.begin()+i);
+			cacheValid = false;
+			return;
+		}
+	}
+}
+
+
+/**
+ * @brief Sets the camera whose version number is checked before every frame
+ *
+ * The camera should be the same camera that is used by the Layers' shaders.
+ *
+ * @param newCamera A pointer to the camera, the scene does not take ownership
+ */
+void GLScene::SetCamera(GLCamera *newCamera)
+{
+	camera = newCamera;
+	pickingShader.SetCamera(newCamera);
+	profilerOverlay.SetCamera(newCamera);
+	cacheValid = false;
+}
+
+
+/**
+ * @brief Sets the background color
+ * @param r Red (0.0 - 1.0)
+ * @param g Green (0.0 - 1.0)
+ * @param b Blue (0.0 - 1.0)
+ * @param a Alpha (0.0 - 1.0)
+ */
+void GLScene::SetClearColor(float r, float g, float b, float a)
+{
+	clearColor[0] = r;
+	clearColor[1] = g;
+	clearColor[2] = b;
+	clearColor[3] = a;
+	cacheValid = false;
+}
+
+
+/**
+ * @brief Sets if camera movement switches the Layers to their proxy meshes
+ *
+ * Interactive scenes draw proxy meshes while the camera is moving. A scene that renders
+ * every frame to completion, such as when exporting an animation, should turn this off
+ * so that every frame is drawn at full resolution.
+ *
+ * @param newInteractive false to always draw at full resolution (default true)
+ */
+void GLScene::SetInteractive(bool newInteractive)
+{
+	interactive = newInteractive;
+	if (!interactive && interacting)
+	{
+		SetInteracting(false);
+		cacheValid = false;
+	}
+}
+
+
+/**
+ * @brief Sets how long the camera must be still before Layers are drawn at full resolution
+ * @param milliseconds The idle delay in milliseconds (default 150)
+ */
+void GLScene::SetIdleDelay(int milliseconds)
+{
+	idleDelay = std::chrono::milliseconds(milliseconds);
+}
+
+
+/**
+ * @brief Sets how many Elements are drawn per frame while drawing progressively
+ *
+ * Smaller values keep each frame shorter but take more frames to reach full resolution.
+ *
+ * @param elementsPerFrame The maximum number of Elements drawn per frame (default 2000000)
+ */
+void GLScene::SetProgressiveBudget(unsigned int elementsPerFrame)
+{
+	if (elementsPerFrame > 0)
+		progressiveBudget = elementsPerFrame;
+}
+
+
+/**
+ * @brief Shows or hides the GLProfiler HUD
+ *
+ * Showing the HUD also enables the GLProfiler. Hiding it leaves the profiler enabled, so
+ * that a CSV file being written is not interrupted (see GLProfiler::SetEnabled()).
+ *
+ * @param visible true to draw the HUD on top of every presented frame (default false)
+ */
+void GLScene::SetProfilerVisible(bool visible)
+{
+	profilerVisible = visible;
+	if (visible)
+		GLProfiler::SetEnabled(true);
+}
+
+
+/**
+ * @brief Sets the size of the cached frames
+ *
+ * This function must be called with a current OpenGL context before the first call to
+ * Render(), and again whenever the size of the target framebuffer changes.
+ *
+ * @param newWidth The width of the target framebuffer in pixels
+ * @param newHeight The height of the target framebuffer in pixels
+ * @return 0 if the cached framebuffers are complete
+ * @return 1 if an error occurred
+ */
+int GLScene::Resize(int newWidth, int newHeight)
+{
+	if (newWidth <= 0 || newHeight <= 0)
+		return 1;
+
+	DeleteFramebuffers();
+	width = newWidth;
+	height = newHeight;
+	cacheValid = false;
+	frameValid = false;
+	progressive = false;
+
+	GLint currentFBO;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &currentFBO);
+
+	GLuint *fbos[3] = {&baseFBO, &frameFBO, &progressFBO};
+	GLuint *colors[3] = {&baseColorID, &frameColorID, &progressColorID};
+	GLuint *depths[3] = {&baseDepthID, &frameDepthID, &progressDepthID};
+	bool complete = true;
+	for (int i=0; i<3; i++)
+	{
+		glGenFramebuffers(1, fbos[i]);
+		glGenRenderbuffers(1, colors[i]);
+		glGenRenderbuffers(1, depths[i]);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, *colors[i]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, *depths[i]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, *fbos[i]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, *colors[i]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, *depths[i]);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			complete = false;
+	}
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, currentFBO);
+
+	if (!complete || pickingBuffer.Resize(width, height) != 0)
+	{
+		DEBUG("Error creating the scene framebuffers");
+		DeleteFramebuffers();
+		return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Forces every Layer to be redrawn on the next call to Render()
+ */
+void GLScene::Invalidate()
+{
+	cacheValid = false;
+}
+
+
+/**
+ * @brief Returns true if the next call to Render() will draw anything new
+ *
+ * This is true if the cached frames are invalid, the camera has changed, any Layer has
+ * a DirtyFlag set, a pick is waiting to be drawn or collected, the camera was moving on
+ * the last frame (the idle delay has to be checked), or a full resolution frame is still
+ * being drawn progressively.
+ *
+ * @return true if the scene should be rendered
+ * @return false if presenting the last frame again would produce the same image
+ */
+bool GLScene::NeedsRedraw()
+{
+	if (!cacheValid || pickRequested || pickingBuffer.IsPending() || interacting || progressive)
+		return true;
+	if (camera && camera->GetVersion() != cameraVersion)
+		return true;
+	return GetDirtyFlags() != 0;
+}
+
+
+/**
+ * @brief Renders the scene into the target framebuffer, redrawing only what has changed
+ *
+ * See the class description for what gets redrawn. The cached composited frame is always
+ * copied to the target framebuffer, which is left bound when this function returns.
+ *
+ * @param targetFBO The framebuffer to present the frame to (0 for the default framebuffer)
+ * @return The RenderResult describing what was drawn
+ */
+GLScene::RenderResult GLScene::Render(GLuint targetFBO)
+{
+	if (camera == 0 || baseFBO == 0 || frameFBO == 0)
+		return NotRendered;
+
+	GLProfiler::BeginFrame();
+	ApplyPickResults();
+
+	unsigned int flags = GetDirtyFlags();
+	bool cameraChanged = camera->GetVersion() != cameraVersion;
+	RenderResult result = CachedFrame;
+	glViewport(0, 0, width, height);
+
+	// Switch between the proxy and full resolution meshes based on camera activity
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	bool wasInteracting = interacting;
+	if (cameraChanged && cacheValid && interactive)
+	{
+		lastCameraChange = now;
+		SetInteracting(true);
+	}
+	else if (interacting && now - lastCameraChange >= idleDelay)
+	{
+		SetInteracting(false);
+	}
+
+	// Start a new base pass for every Layer
+	if (!cacheValid || cameraChanged || (wasInteracting && !interacting) || (flags & (Layer::DataDirty | Layer::UniformsDirty)))
+	{
+		cameraVersion = camera->GetVersion();
+		cacheValid = true;
+
+		if (interacting)
+		{
+			// Proxy meshes are cheap, draw them right away
+			progressive = false;
+			glBindFramebuffer(GL_FRAMEBUFFER, baseFBO);
+			glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			DrawBase();
+			result = FullRedraw;
+		} else {
+			// Full resolution meshes are drawn over as many frames as needed
+			progressive = true;
+			progressLayer = 0;
+			progress = 0;
+			glBindFramebuffer(GL_FRAMEBUFFER, progressFBO);
+			glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+	}
+
+	// Continue drawing the full resolution frame, presenting the partial frame only if
+	// there is no complete frame to show instead
+	bool baseChanged = result == FullRedraw;
+	if (progressive)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, progressFBO);
+		bool complete = DrawProgressive();
+		if (complete || !frameValid)
+		{
+			Blit(progressFBO, baseFBO, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			baseChanged = true;
+		}
+		result = complete ? FullRedraw : ProgressiveRedraw;
+	}
+
+	// Recomposite the overlays on top of the base pass
+	if (baseChanged || (flags & Layer::SelectionDirty))
+	{
+		Blit(baseFBO, frameFBO, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glBindFramebuffer(GL_FRAMEBUFFER, frameFBO);
+		DrawOverlays();
+		if (!progressive)
+			frameValid = true;
+		if (result == CachedFrame)
+			result = OverlayRedraw;
+	}
+
+	if (pickRequested)
+		DrawPicking();
+
+	for (unsigned int i=0; i<layers.size(); i++)
+		layers[i]->ClearDirtyFlags();
+
+	Blit(frameFBO, targetFBO, GL_COLOR_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+
+	if (profilerVisible)
+	{
+		std::vector<std::string> report;
+		GLProfiler::GetReport(&report);
+		profilerOverlay.SetText(&report);
+		profilerOverlay.Draw(width, height);
+	}
+	GLProfiler::EndFrame();
+
+	return result;
+}
+
+
+/**
+ * @brief Requests a pick at the given pixel
+ *
+ * The Layers that use Layer::BufferPicking are drawn into the picking buffer during the
+ * next call to Render(), and the result is applied to the Layers during a later call to
+ * Render() once the GPU has finished, without stalling.
+ *
+ * @param x The x-coordinate of the pixel (from the left edge of the viewport)
+ * @param y The y-coordinate of the pixel (from the bottom edge of the viewport)
+ */
+void GLScene::Pick(int x, int y)
+{
+	pickRequested = true;
+	pickX = x;
+	pickY = y;
+}
+
+
+/**
+ * @brief Returns the combined DirtyFlag values of every Layer
+ * @return The combined DirtyFlag values of every Layer
+ */
+unsigned int GLScene::GetDirtyFlags()
+{
+	unsigned int flags = 0;
+	for (unsigned int i=0; i<layers.size(); i++)
+		flags |= layers[i]->GetDirtyFlags();
+	return flags;
+}
+
+
+/**
+ * @brief Draws the base pass of every Layer into the currently bound framebuffer
+ */
+void GLScene::DrawBase()
+{
+	for (unsigned int i=0; i<layers.size(); i++)
+		layers[i]->DrawBase();
+}
+
+
+/**
+ * @brief Draws the next part of the full resolution frame into the currently bound framebuffer
+ *
+ * Layers are drawn in order, each with Layer::DrawBaseProgressive(), until the per-frame
+ * Element budget has been used up.
+ *
+ * @return true if every Layer has been completely drawn
+ * @return false if more frames are needed
+ */
+bool GLScene::DrawProgressive()
+{
+	unsigned int budget = progressiveBudget;
+	while (progressLayer < layers.size())
+	{
+		unsigned int before = progress;
+		bool done = layers[progressLayer]->DrawBaseProgressive(&progress, budget);
+		unsigned int drawn = progress - before;
+		budget = drawn < budget ? budget - drawn : 0;
+
+		if (!done)
+			return false;
+
+		progressLayer++;
+		progress = 0;
+		if (budget == 0 && progressLayer < layers.size())
+			return false;
+	}
+
+	progressive = false;
+	return true;
+}
+
+
+/**
+ * @brief Tells every Layer if the camera is moving
+ * @param newInteracting true if the camera is moving
+ */
+void GLScene::SetInteracting(bool newInteracting)
+{
+	interacting = newInteracting;
+	for (unsigned int i=0; i<layers.size(); i++)
+		layers[i]->SetInteracting(newInteracting);
+}
+
+
+/**
+ * @brief Draws the overlay pass of every Layer into the currently bound framebuffer
+ */
+void GLScene::DrawOverlays()
+{
+	for (unsigned int i=0; i<layers.size(); i++)
+		layers[i]->DrawOverlay();
+}
+
+
+/**
+ * @brief Draws every Layer into the picking buffer and requests the picked pixel
+ */
+void GLScene::DrawPicking()
+{
+	pickingBuffer.Begin();
+	for (unsigned int i=0; i<layers.size(); i++)
+		layers[i]->DrawPicking(&pickingShader);
+	pickingBuffer.End();
+	pickingBuffer.RequestPixel(pickX, pickY);
+	pickRequested = false;
+}
+
+
+/**
+ * @brief Applies a finished pick to every Layer
+ */
+void GLScene::ApplyPickResults()
+{
+	PickResult result;
+	if (pickingBuffer.GetResult(&result))
+		for (unsigned int i=0; i<layers.size(); i++)
+			layers[i]->ApplyPickResult(&result);
+}
+
+
+/**
+ * @brief Copies the contents of one framebuffer to another of the same size
+ * @param source The framebuffer to read from
+ * @param destination The framebuffer to draw to
+ * @param mask The buffers to copy (GL_COLOR_BUFFER_BIT and/or GL_DEPTH_BUFFER_BIT)
+ */
+void GLScene::Blit(GLuint source, GLuint destination, GLbitfield mask)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, mask, GL_NEAREST);
+}
+
+
+/**
+ * @brief Deletes the cached framebuffers from the OpenGL context
+ */
+void GLScene::DeleteFramebuffers()
+{
+	GLuint *fbos[3] = {&baseFBO, &frameFBO, &progressFBO};
+	GLuint *renderbuffers[6] = {&baseColorID, &baseDepthID, &frameColorID, &frameDepthID, &progressColorID, &progressDepthID};
+	for (int i=0; i<3; i++)
+	{
+		if (*fbos[i])
+			glDeleteFramebuffers(1, fbos[i]);
+		*fbos[i] = 0;
+	}
+	for (int i=0; i<6; i++)
+	{
+		if (*renderbuffers[i])
+			glDeleteRenderbuffers(1, renderbuffers[i]);
+		*renderbuffers[i] = 0;
+	}
+}
@@ -0,0 +1,139 @@
+#ifndef GLSCENE_H
+#define GLSCENE_H
+
+#include "GLCamera.h"
+#include "GLPickingBuffer.h"
+#include "GLProfiler.h"
+#include "GLTextOverlay.h"
+#include "../Layers/Layer.h"
+#include "../Shaders/PickingShader.h"
+#include <vector>
+#include <chrono>
+
+
+/**
+ * @brief Draws a list of Layers on demand and reuses the last frame when nothing changed
+ *
+ * GLScene composites all of its Layers into two cached framebuffers:
+ * - The base frame holds the base pass of every Layer (Layer::DrawBase())
+ * - The composited frame holds the base frame plus the overlay pass of every Layer
+ * (Layer::DrawOverlay())
+ * .
+ *
+ * Every call to Render() presents the composited frame to the target framebuffer, but only
+ * redraws what has changed since the previous call:
+ * - If the camera version changed, or any Layer has Layer::DataDirty or Layer::UniformsDirty
+ * set, every Layer is redrawn (GLScene::FullRedraw)
+ * - If only Layer::SelectionDirty is set, the cached base frame is reused and only the overlays
+ * are redrawn on top of it (GLScene::OverlayRedraw)
+ * - Otherwise the cached composited frame is copied to the target (GLScene::CachedFrame)
+ * .
+ *
+ * A window that is driven by a timer should only schedule a repaint when NeedsRedraw()
+ * returns true, so an idle scene costs nothing at all.
+ *
+ * While the camera is moving, every Layer is told to draw its coarse proxy mesh (see
+ * Layer::SetInteracting()). Once the camera has been still for the idle delay, the full
+ * resolution Layers are drawn progressively into a separate framebuffer, a limited number
+ * of Elements per frame (see Layer::DrawBaseProgressive()), while the last proxy frame
+ * keeps being presented. The finished full resolution frame then replaces it.
+ *
+ * GLScene also drives Layers that use Layer::BufferPicking. Pick() renders the Layers into
+ * a GLPickingBuffer and requests the pixel under the cursor, and the result is applied to
+ * the Layers at the start of a later Render() call.
+ *
+ * Every call to Render() is a GLProfiler frame. When the profiler HUD is visible (see
+ * SetProfilerVisible()), the averaged GLProfiler report is drawn on top of the presented
+ * frame. The HUD is not part of the cached frames.
+ *
+ */
+class GLScene
+{
+	public:
+
+		/**
+		 * @brief Describes what Render() had to draw
+		 */
+		enum RenderResult {
+			NotRendered,	/**< The scene has no camera or no framebuffers */
+			CachedFrame,	/**< The cached composited frame was presented as is */
+			OverlayRedraw,	/**< Only the overlays were redrawn on top of the cached base frame */
+			ProgressiveRedraw,	/**< Part of the full resolution frame was drawn, the previous frame was presented */
+			FullRedraw	/**< Every Layer was redrawn */
+		};
+
+		GLScene();
+		~GLScene();
+
+		void		AddLayer(Layer *newLayer);
+		void		RemoveLayer(Layer *oldLayer);
+		void		SetCamera(GLCamera *newCamera);
+		void		SetClearColor(float r, float g, float b, float a);
+		void		SetInteractive(bool newInteractive);
+		void		SetIdleDelay(int milliseconds);
+		void		SetProgressiveBudget(unsigned int elementsPerFrame);
+		void		SetProfilerVisible(bool visible);
+		int		Resize(int newWidth, int newHeight);
+		void		Invalidate();
+		bool		NeedsRedraw();
+		RenderResult	Render(GLuint targetFBO);
+		void		Pick(int x, int y);
+
+	protected:
+
+		std::vector<Layer*>	layers;		/**< The Layers drawn by the scene, in drawing order */
+		GLCamera*		camera;		/**< The camera used by the Layers' shaders */
+		unsigned int		cameraVersion;	/**< The camera version used to draw the cached frames */
+		float			clearColor[4];	/**< The background color */
+		bool			cacheValid;	/**< Set to false when the cached frames must be redrawn */
+		bool			frameValid;	/**< Set to true once a complete frame has been composited */
+
+		// Interaction
+		bool					interactive;		/**< Set to false to never draw proxy meshes (eg. when exporting frames) */
+		bool					interacting;		/**< Set to true while the camera is moving */
+		std::chrono::milliseconds		idleDelay;		/**< How long the camera must be still before drawing at full resolution */
+		std::chrono::steady_clock::time_point	lastCameraChange;	/**< The time the camera last changed */
+
+		// Progressive drawing
+		bool				progressive;		/**< Set to true while a full resolution frame is being drawn */
+		unsigned int			progressiveBudget;	/**< The maximum number of Elements drawn per frame while progressive */
+		unsigned int			progressLayer;		/**< The Layer currently being drawn progressively */
+		unsigned int			progress;		/**< The progress of the Layer currently being drawn progressively */
+
+		// Framebuffers
+		int		width;			/**< The width of the cached frames in pixels */
+		int		height;			/**< The height of the cached frames in pixels */
+		GLuint		baseFBO;		/**< The framebuffer holding the base pass of every Layer */
+		GLuint		baseColorID;		/**< The color renderbuffer of the base framebuffer */
+		GLuint		baseDepthID;		/**< The depth renderbuffer of the base framebuffer */
+		GLuint		frameFBO;		/**< The framebuffer holding the composited frame */
+		GLuint		frameColorID;		/**< The color renderbuffer of the composited framebuffer */
+		GLuint		frameDepthID;		/**< The depth renderbuffer of the composited framebuffer */
+		GLuint		progressFBO;		/**< The framebuffer holding the full resolution frame while it is being drawn */
+		GLuint		progressColorID;	/**< The color renderbuffer of the progressive framebuffer */
+		GLuint		progressDepthID;	/**< The depth renderbuffer of the progressive framebuffer */
+
+		// Picking
+		GLPickingBuffer	pickingBuffer;		/**< The integer framebuffer used for Layer::BufferPicking */
+		PickingShader	pickingShader;		/**< The shader used to draw into the picking buffer */
+		bool		pickRequested;		/**< Set to true when Pick() has been called since the last Render() */
+		int		pickX;			/**< The x-coordinate of the requested pick */
+		int		pickY;			/**< The y-coordinate of the requested pick */
+
+		// Profiling
+		bool		profilerVisible;	/**< Set to true to draw the GLProfiler report on top of the frame */
+		GLTextOverlay	profilerOverlay;	/**< Draws the GLProfiler report */
+
+		// Protected Functions
+		unsigned int	GetDirtyFlags();
+		void		DrawBase();
+		bool		DrawProgressive();
+		void		SetInteracting(bool newInteracting);
+		void		DrawOverlays();
+		void		DrawPicking();
+		void		ApplyPickResults();
+		void		Blit(GLuint source, GLuint destination, GLbitfield mask);
+		void		DeleteFramebuffers();
+};
+
+#endif // GLSCENE_H
@@ -0,0 +1,199 @@
+#include "GLTextOverlay.h"
+
+
+GLTextOverlay::GLTextOverlay()
+{
+	positionX = 8;
+	positionY = 8;
+	scale = 1;
+	textDirty = true;
+	numVertices = 0;
+	vaoID = 0;
+	vboID = 0;
+}
+
+
+/**
+ * @brief Deconstructor that deletes the vertex data from the OpenGL context
+ */
+GLTextOverlay::~GLTextOverlay()
+{
+	if (vboID)
+		glDeleteBuffers(1, &vboID);
+	if (vaoID)
+		glDeleteVertexArrays(1, &vaoID);
+}
+
+
+/**
+ * @brief Sets the camera required by the TextShader
+ *
+ * The text is not transformed by the camera, but a shader can not be used without one.
+ *
+ * @param newCamera A pointer to the camera
+ */
+void GLTextOverlay::SetCamera(GLCamera *newCamera)
+{
+	shader.SetCamera(newCamera);
+}
+
+
+/**
+ * @brief Sets the text to draw
+ *
+ * Characters outside of printable ASCII are drawn as '?'.
+ *
+ * @param lines The lines of text, top line first
+ */
+void GLTextOverlay::SetText(std::vector<std::string> *lines)
+{
+	if (lines == 0 || *lines == text)
+		return;
+
+	text = *lines;
+	textDirty = true;
+}
+
+
+/**
+ * @brief Sets the position of the top left corner of the text block
+ * @param x The distance from the left edge of the viewport in pixels (default 8)
+ * @param y The distance from the top edge of the viewport in pixels (default 8)
+ */
+void GLTextOverlay::SetPosition(int x, int y)
+{
+	positionX = x;
+	positionY = y;
+	textDirty = true;
+}
+
+
+/**
+ * @brief Sets the size of the text
+ * @param newScale The size of one font texel in pixels (default 1)
+ */
+void GLTextOverlay::SetScale(int newScale)
+{
+	scale = newScale > 0 ? newScale : 1;
+	textDirty = true;
+}
+
+
+/**
+ * @brief Sets the text and background colors
+ *
+ * Colors are in the range 0.0 - 1.0. The background is blended with the scene using its
+ * alpha value.
+ *
+ */
+void GLTextOverlay::SetColors(float textR, float textG, float textB, float textA,
+			      float backgroundR, float backgroundG, float backgroundB, float backgroundA)
+{
+	UniformColors colors;
+	colors.Color1[0] = textR;
+	colors.Color1[1] = textG;
+	colors.Color1[2] = textB;
+	colors.Color1[3] = textA;
+	colors.Color2[0] = backgroundR;
+	colors.Color2[1] = backgroundG;
+	colors.Color2[2] = backgroundB;
+	colors.Color2[3] = backgroundA;
+	shader.SetUniforms(&colors, 0);
+}
+
+
+/**
+ * @brief Draws the text into the currently bound framebuffer
+ *
+ * Blending is enabled while drawing and disabled again afterwards.
+ *
+ * @param viewportWidth The width of the viewport in pixels
+ * @param viewportHeight The height of the viewport in pixels
+ */
+void GLTextOverlay::Draw(int viewportWidth, int viewportHeight)
+{
+	if (textDirty)
+		BuildVertices();
+	if (numVertices == 0)
+		return;
+
+	shader.SetViewportSize(viewportWidth, viewportHeight);
+	if (shader.Use() != 0)
+		return;
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glPolygonOffset(0, 0);
+	glBindVertexArray(vaoID);
+	glDrawArrays(GL_TRIANGLES, 0, numVertices);
+	glBindVertexArray(0);
+	glDisable(GL_BLEND);
+}
+
+
+/**
+ * @brief Builds two triangles for every character cell and loads them to the OpenGL context
+ *
+ * Each vertex is [x, y, u, v], see TextShader. A blank cell is added around the text as a
+ * margin.
+ *
+ */
+void GLTextOverlay::BuildVertices()
+{
+	textDirty = false;
+	numVertices = 0;
+	if (text.empty())
+		return;
+
+	unsigned int columns = 0;
+	for (unsigned int i=0; i<text.size(); i++)
+		if (text[i].size() > columns)
+			columns = text[i].size();
+	columns += 2;
+	const unsigned int rows = text.size() + 2;
+
+	const float CellWidth = TextShader::GlyphWidth*scale;
+	const float CellHeight = TextShader::GlyphHeight*scale;
+	std::vector<GLfloat> vertices;
+	vertices.reserve(24*rows*columns);
+	for (unsigned int row=0; row<rows; row++)
+	{
+		for (unsigned int column=0; column<columns; column++)
+		{
+			char c = ' ';
+			if (row > 0 && row <= text.size() && column > 0 && column <= text[row-1].size())
+				c = text[row-1][column-1];
+			if (c < TextShader::FirstGlyph || c >= TextShader::FirstGlyph + TextShader::NumGlyphs)
+				c = '?';
+
+			const float x0 = positionX + column*CellWidth;
+			const float y0 = positionY + row*CellHeight;
+			const float x1 = x0 + CellWidth;
+			const float y1 = y0 + CellHeight;
+			const float u0 = (c - TextShader::FirstGlyph)*TextShader::GlyphWidth;
+			const float u1 = u0 + TextShader::GlyphWidth;
+			const float v0 = 0.0;
+			const float v1 = TextShader::GlyphHeight;
+			const GLfloat quad[24] = {x0, y0, u0, v0,  x1, y0, u1, v0,  x1, y1, u1, v1,
+						  x0, y0, u0, v0,  x1, y1, u1, v1,  x0, y1, u0, v1};
+			vertices.insert(vertices.end(), quad, quad+24);
+		}
+	}
+
+	if (vaoID == 0)
+	{
+		glGenVertexArrays(1, &vaoID);
+		glGenBuffers(1, &vboID);
+		glBindVertexArray(vaoID);
+		glBindBuffer(GL_ARRAY_BUFFER, vboID);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4*sizeof(GLfloat), 0);
+		glBindVertexArray(0);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vboID);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(GLfloat), &vertices[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	numVertices = vertices.size()/4;
+}
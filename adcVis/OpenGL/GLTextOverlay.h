@@ -0,0 +1,50 @@
+#ifndef GLTEXTOVERLAY_H
+#define GLTEXTOVERLAY_H
+
+#include "GLCamera.h"
+#include "../Shaders/TextShader.h"
+
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Draws a block of text in a corner of the viewport, on top of everything else
+ *
+ * The text is drawn with a TextShader on a translucent background, one quad per
+ * character cell. Lines are padded to the length of the longest line so that the
+ * background is a solid rectangle. The vertex data is only rebuilt when the text changes.
+ *
+ */
+class GLTextOverlay
+{
+	public:
+
+		GLTextOverlay();
+		~GLTextOverlay();
+
+		void	SetCamera(GLCamera *newCamera);
+		void	SetText(std::vector<std::string> *lines);
+		void	SetPosition(int x, int y);
+		void	SetScale(int newScale);
+		void	SetColors(float textR, float textG, float textB, float textA,
+				  float backgroundR, float backgroundG, float backgroundB, float backgroundA);
+		void	Draw(int viewportWidth, int viewportHeight);
+
+	protected:
+
+		TextShader			shader;		/**< The shader used to draw the text */
+		std::vector<std::string>	text;		/**< The lines of text */
+		int				positionX;	/**< The distance from the left edge of the viewport in pixels */
+		int				positionY;	/**< The distance from the top edge of the viewport in pixels */
+		int				scale;		/**< The size of a font texel in pixels */
+		bool				textDirty;	/**< Set to true when the vertex data must be rebuilt */
+		unsigned int			numVertices;	/**< The number of vertices in the vertex buffer */
+		GLuint				vaoID;		/**< The vertex array object ID */
+		GLuint				vboID;		/**< The vertex buffer object ID */
+
+		// Protected Functions
+		void	BuildVertices();
+};
+
+#endif // GLTEXTOVERLAY_H
@@ -0,0 +1,812 @@
+#include "MeshRasterizer.h"
+#include "../Threading/ParallelFor.h"
+#include "../IO/TraceWriter.h"
+
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** The distance outside the image, in pixels, within which vertices are snapped to subpixels */
+static const float GuardBand = 8192.0;
+
+/** Triangles whose bounding box is smaller than this many subpixels use 32-bit edge functions */
+static const int SmallTriangleSize = 1 << 14;
+
+
+/**
+ * @brief Rounds a division towards negative infinity
+ */
+static inline int FloorDiv(long long a, int b)
+{
+	long long q = a/b;
+	if ((a % b != 0) && ((a < 0) != (b < 0)))
+		q--;
+	return (int)q;
+}
+
+
+/**
+ * @brief Rounds towards negative infinity without calling the math library
+ *
+ * Values too large for an int are clamped first.
+ */
+static inline int FastFloor(float value)
+{
+	value = value < -1.0e9f ? -1.0e9f : (value > 1.0e9f ? 1.0e9f : value);
+	int i = (int)value;
+	return value < i ? i-1 : i;
+}
+
+
+/**
+ * @brief Checks if an edge of a counter-clockwise triangle is a top or left edge
+ *
+ * Window coordinates have y increasing upward, so the left edges of a counter-clockwise
+ * triangle point down and its top edge points left.
+ */
+static inline bool IsTopLeft(long long dx, long long dy)
+{
+	return dy < 0 || (dy == 0 && dx < 0);
+}
+
+
+/**
+ * @brief Converts a color component to an unsigned byte the way OpenGL writes it to an
+ * RGBA8 framebuffer
+ */
+static inline unsigned char ToByte(float c)
+{
+	if (c <= 0.0)
+		return 0;
+	if (c >= 1.0)
+		return 255;
+	return (unsigned char)(c*255.0 + 0.5);
+}
+
+
+/**
+ * @brief Constructor initializes a rasterizer with no image, a white solid fill and a
+ * black wireframe
+ */
+MeshRasterizer::MeshRasterizer()
+{
+	width = 0;
+	height = 0;
+	tilesX = 0;
+	tilesY = 0;
+
+	camera = 0;
+	numThreads = GetNumThreads();
+	fillMode = SolidFill;
+	drawWireframe = true;
+	minValue = 0.0;
+	maxValue = 1.0;
+	scalars = 0;
+	numScalars = 0;
+
+	SetFillColor(1.0, 1.0, 1.0, 1.0);
+	SetHighlightColor(1.0, 0.0, 0.0, 1.0);
+	wireColor[0] = wireColor[1] = wireColor[2] = 0;
+	wireColor[3] = 255;
+
+	ColorMap defaultMap;
+	defaultMap.BuildTable(&colorTable);
+}
+
+
+/**
+ * @brief Sets the size of the image and clears it to transparent black
+ * @param newWidth The width of the image in pixels
+ * @param newHeight The height of the image in pixels
+ * @return 0 if the image was resized
+ * @return 1 if the size is invalid
+ */
+int MeshRasterizer::SetSize(int newWidth, int newHeight)
+{
+	if (newWidth <= 0 || newHeight <= 0)
+		return 1;
+
+	width = newWidth;
+	height = newHeight;
+	tilesX = (width + TileSize - 1)/TileSize;
+	tilesY = (height + TileSize - 1)/TileSize;
+	pixels.assign(4*(size_t)width*height, 0);
+	return 0;
+}
+
+
+/**
+ * @brief Sets the camera whose Model-View-Projection Matrix transforms the Nodes
+ *
+ * The camera's depth range is ignored, every Element in front of the camera is drawn.
+ *
+ * @param newCamera The camera
+ */
+void MeshRasterizer::SetCamera(GLCamera *newCamera)
+{
+	camera = newCamera;
+}
+
+
+/**
+ * @brief Sets the number of threads used to draw
+ * @param newNumThreads The number of threads, or 0 to use one per core
+ */
+void MeshRasterizer::SetNumThreads(unsigned int newNumThreads)
+{
+	numThreads = newNumThreads > 0 ? newNumThreads : GetNumThreads();
+}
+
+
+/**
+ * @brief Sets how the fill of a mesh is colored
+ * @param newMode The new FillMode
+ */
+void MeshRasterizer::SetFillMode(FillMode newMode)
+{
+	fillMode = newMode;
+}
+
+
+/**
+ * @brief Sets the color used by MeshRasterizer::SolidFill
+ * @param r Red (0.0 - 1.0)
+ * @param g Green (0.0 - 1.0)
+ * @param b Blue (0.0 - 1.0)
+ * @param a Alpha (0.0 - 1.0)
+ */
+void MeshRasterizer::SetFillColor(float r, float g, float b, float a)
+{
+	fillColor[0] = ToByte(r);
+	fillColor[1] = ToByte(g);
+	fillColor[2] = ToByte(b);
+	fillColor[3] = ToByte(a);
+}
+
+
+/**
+ * @brief Sets the ColorMap and color range used by MeshRasterizer::ColorMappedFill
+ *
+ * The map is sampled right away, so it can be modified or deleted afterwards.
+ *
+ * @param map The ColorMap, or 0 to keep the current one
+ * @param min The scalar value mapped to the first color stop
+ * @param max The scalar value mapped to the last color stop
+ */
+void MeshRasterizer::SetColorMap(ColorMap *map, float min, float max)
+{
+	if (map)
+		map->BuildTable(&colorTable);
+	minValue = min;
+	maxValue = max;
+}
+
+
+/**
+ * @brief Sets the per-Node scalar values used by MeshRasterizer::ColorMappedFill
+ *
+ * The values are read during DrawMesh(), they are not copied.
+ *
+ * @param values One value per Node, in the same order as the Node list, or 0 to use the
+ * Node z-values. Elements with a Node of -99999 (dry) are not filled.
+ * @param count The number of values
+ */
+void MeshRasterizer::SetScalars(const float *values, unsigned int count)
+{
+	scalars = values;
+	numScalars = values ? count : 0;
+}
+
+
+/**
+ * @brief Sets if the outline of every Element is drawn, and its color
+ * @param draw true to draw the outline
+ * @param r Red (0.0 - 1.0)
+ * @param g Green (0.0 - 1.0)
+ * @param b Blue (0.0 - 1.0)
+ * @param a Alpha (0.0 - 1.0)
+ */
+void MeshRasterizer::SetWireframe(bool draw, float r, float g, float b, float a)
+{
+	drawWireframe = draw;
+	wireColor[0] = ToByte(r);
+	wireColor[1] = ToByte(g);
+	wireColor[2] = ToByte(b);
+	wireColor[3] = ToByte(a);
+}
+
+
+/**
+ * @brief Sets the color of highlighted Elements and Nodes
+ * @param r Red (0.0 - 1.0)
+ * @param g Green (0.0 - 1.0)
+ * @param b Blue (0.0 - 1.0)
+ * @param a Alpha (0.0 - 1.0)
+ */
+void MeshRasterizer::SetHighlightColor(float r, float g, float b, float a)
+{
+	highlightColor[0] = ToByte(r);
+	highlightColor[1] = ToByte(g);
+	highlightColor[2] = ToByte(b);
+	highlightColor[3] = ToByte(a);
+}
+
+
+/**
+ * @brief Fills the whole image with a color
+ * @param r Red (0.0 - 1.0)
+ * @param g Green (0.0 - 1.0)
+ * @param b Blue (0.0 - 1.0)
+ * @param a Alpha (0.0 - 1.0)
+ */
+void MeshRasterizer::Clear(float r, float g, float b, float a)
+{
+	const unsigned char color[4] = {ToByte(r), ToByte(g), ToByte(b), ToByte(a)};
+	unsigned int packed;
+	memcpy(&packed, color, 4);
+
+	unsigned int *image = (unsigned int*)pixels.data();
+	const size_t NumPixels = (size_t)width*height;
+	ParallelFor(NumPixels, 1 << 16, [&](size_t first, size_t last) {
+		for (size_t i=first; i<last; i++)
+			image[i] = packed;
+	});
+}
+
+
+/**
+ * @brief Draws a mesh on top of the image
+ *
+ * The fill of every Element is drawn first, then the outline of every Element, then the
+ * highlighted Elements and Nodes. Meshes drawn by separate calls are layered in the order
+ * of the calls, the same as Layers in a GLScene.
+ *
+ * @param nodes The Node list
+ * @param elements The Element list, whose node numbers refer to the Node list
+ * @param highlightElements The indices (element number - 1) of the highlighted Elements, or 0
+ * @param numHighlightElements The number of highlighted Elements
+ * @param highlightNodes The indices (node number - 1) of the highlighted Nodes, or 0
+ * @param numHighlightNodes The number of highlighted Nodes
+ * @return 0 if the mesh was drawn
+ * @return 1 if there is no image, no camera or no mesh
+ */
+int MeshRasterizer::DrawMesh(std::vector<Node> *nodes, std::vector<Element> *elements,
+			     const unsigned int *highlightElements, unsigned int numHighlightElements,
+			     const unsigned int *highlightNodes, unsigned int numHighlightNodes)
+{
+	if (width == 0 || camera == 0 || nodes == 0 || elements == 0)
+		return 1;
+
+	TRACE_SCOPE("render", "MeshRasterizer::DrawMesh");
+	TransformNodes(nodes);
+	BinElements(elements, 0, elements->size(), &bins, numThreads);
+	BinElements(elements, highlightElements, highlightElements ? numHighlightElements : 0, &highlightBins, 1);
+	if (highlightNodes == 0)
+		numHighlightNodes = 0;
+
+	// Threads take the next undrawn tile until every tile is done
+	const int NumTiles = tilesX*tilesY;
+	std::atomic<int> nextTile(0);
+	ParallelFor(numThreads, 1, [&](size_t, size_t) {
+		TRACE_SCOPE("render", "Draw tiles");
+		for (int tile = nextTile++; tile < NumTiles; tile = nextTile++)
+			DrawTile(tile, elements, highlightNodes, numHighlightNodes);
+	});
+
+	return 0;
+}
+
+
+/**
+ * @brief Returns the width of the image
+ * @return The width in pixels
+ */
+int MeshRasterizer::GetWidth()
+{
+	return width;
+}
+
+
+/**
+ * @brief Returns the height of the image
+ * @return The height in pixels
+ */
+int MeshRasterizer::GetHeight()
+{
+	return height;
+}
+
+
+/**
+ * @brief Returns the RGBA image, bottom row first
+ * @return A pointer to 4*width*height bytes
+ */
+const unsigned char* MeshRasterizer::GetPixels()
+{
+	return pixels.data();
+}
+
+
+/**
+ * @brief Transforms every Node to window coordinates and looks up its scalar value
+ *
+ * Nodes are transformed by the camera's MVPMatrix and the viewport, exactly as the vertex
+ * shaders and OpenGL do, then snapped to subpixels.
+ *
+ * @param nodes The Node list
+ */
+void MeshRasterizer::TransformNodes(std::vector<Node> *nodes)
+{
+	TRACE_SCOPE("render", "Transform nodes");
+	const size_t NumNodes = nodes->size();
+	windowX.resize(NumNodes);
+	windowY.resize(NumNodes);
+	fixedX.resize(NumNodes);
+	fixedY.resize(NumNodes);
+	lineX.resize(NumNodes);
+	lineY.resize(NumNodes);
+	values.resize(NumNodes);
+	visible.resize(NumNodes);
+
+	const float *m = camera->MVPMatrix.m;
+	const float HalfWidth = 0.5*width;
+	const float HalfHeight = 0.5*height;
+	const float SubpixelScale = (float)(1 << SubpixelBits);
+
+	ParallelFor(NumNodes, 16384, [&](size_t first, size_t last) {
+		for (size_t i=first; i<last; i++)
+		{
+			const Node &node = (*nodes)[i];
+			float clipX = m[0]*node.x + m[4]*node.y + m[8]*node.z + m[12];
+			float clipY = m[1]*node.x + m[5]*node.y + m[9]*node.z + m[13];
+			float clipW = m[3]*node.x + m[7]*node.y + m[11]*node.z + m[15];
+			values[i] = i < numScalars ? scalars[i] : node.z;
+
+			if (clipW <= 0.0)
+			{
+				visible[i] = 0;
+				continue;
+			}
+
+			float x = (clipX/clipW + 1.0)*HalfWidth;
+			float y = (clipY/clipW + 1.0)*HalfHeight;
+			windowX[i] = x;
+			windowY[i] = y;
+			if (x > -GuardBand && x < width + GuardBand && y > -GuardBand && y < height + GuardBand)
+			{
+				fixedX[i] = (int)floorf(x*SubpixelScale + 0.5);
+				fixedY[i] = (int)floorf(y*SubpixelScale + 0.5);
+				lineX[i] = fixedX[i]/SubpixelScale;
+				lineY[i] = fixedY[i]/SubpixelScale;
+				visible[i] = 1;
+			} else {
+				lineX[i] = x;
+				lineY[i] = y;
+				visible[i] = 2;
+			}
+		}
+	});
+}
+
+
+/**
+ * @brief Sorts Elements into the tiles their bounding boxes touch
+ *
+ * The Elements are split into one contiguous range per thread, and each thread fills its
+ * own set of bins, so reading the sets in order keeps the Elements in their original order.
+ *
+ * @param elements The Element list
+ * @param list The indices of the Elements to sort, or 0 to sort the first count Elements
+ * @param count The number of Elements to sort
+ * @param binSet The bins, one set of tiles per thread
+ * @param numBinThreads The number of threads
+ */
+void MeshRasterizer::BinElements(std::vector<Element> *elements, const unsigned int *list, unsigned int count, std::vector<std::vector<unsigned int> > *binSet, unsigned int numBinThreads)
+{
+	TRACE_SCOPE("render", "Bin elements");
+	const int NumTiles = tilesX*tilesY;
+	if (count < 4096*numBinThreads)
+		numBinThreads = 1;
+	binSet->resize(numBinThreads*NumTiles);
+	for (unsigned int i=0; i<binSet->size(); i++)
+		(*binSet)[i].clear();
+
+	const unsigned int NumNodes = visible.size();
+	ParallelFor(numBinThreads, 1, [&](size_t firstThread, size_t lastThread) {
+		for (size_t t=firstThread; t<lastThread; t++)
+		{
+			std::vector<unsigned int> *threadBins = &(*binSet)[t*NumTiles];
+			unsigned int first = (unsigned int)((unsigned long long)count*t/numBinThreads);
+			unsigned int last = (unsigned int)((unsigned long long)count*(t+1)/numBinThreads);
+			for (unsigned int k=first; k<last; k++)
+			{
+				unsigned int e = list ? list[k] : k;
+				if (e >= elements->size())
+					continue;
+				const Element &element = (*elements)[e];
+				unsigned int a = element.n1-1, b = element.n2-1, c = element.n3-1;
+				if (a >= NumNodes || b >= NumNodes || c >= NumNodes || !visible[a] || !visible[b] || !visible[c])
+					continue;
+
+				float minX = fminf(windowX[a], fminf(windowX[b], windowX[c]));
+				float maxX = fmaxf(windowX[a], fmaxf(windowX[b], windowX[c]));
+				float minY = fminf(windowY[a], fminf(windowY[b], windowY[c]));
+				float maxY = fmaxf(windowY[a], fmaxf(windowY[b], windowY[c]));
+				if (maxX < 0.0 || maxY < 0.0 || minX >= width || minY >= height)
+					continue;
+
+				int tileX0 = minX > 0.0 ? (int)minX/TileSize : 0;
+				int tileY0 = minY > 0.0 ? (int)minY/TileSize : 0;
+				int tileX1 = maxX < width ? (int)maxX/TileSize : tilesX-1;
+				int tileY1 = maxY < height ? (int)maxY/TileSize : tilesY-1;
+				for (int ty=tileY0; ty<=tileY1; ty++)
+					for (int tx=tileX0; tx<=tileX1; tx++)
+						threadBins[ty*tilesX+tx].push_back(e);
+			}
+		}
+	});
+}
+
+
+/**
+ * @brief Draws every pass of one tile
+ * @param tile The index of the tile
+ * @param elements The Element list
+ * @param highlightNodes The indices of the highlighted Nodes
+ * @param numHighlightNodes The number of highlighted Nodes
+ */
+void MeshRasterizer::DrawTile(int tile, std::vector<Element> *elements, const unsigned int *highlightNodes, unsigned int numHighlightNodes)
+{
+	const int NumTiles = tilesX*tilesY;
+	const int NumSets = bins.size()/NumTiles;
+	const int tileX = tile % tilesX;
+	const int tileY = tile / tilesX;
+	const int tileRect[4] = {tileX*TileSize, tileY*TileSize,
+				 std::min((tileX+1)*TileSize, width), std::min((tileY+1)*TileSize, height)};
+	const unsigned char *solidColor = fillMode == SolidFill ? fillColor : 0;
+
+	// Fill
+	for (int set=0; set<NumSets; set++)
+	{
+		std::vector<unsigned int> &bin = bins[set*NumTiles+tile];
+		for (unsigned int i=0; i<bin.size(); i++)
+			FillTriangle((*elements)[bin[i]], tileRect, solidColor);
+	}
+
+	// Outline
+	if (drawWireframe)
+	{
+		for (int set=0; set<NumSets; set++)
+		{
+			std::vector<unsigned int> &bin = bins[set*NumTiles+tile];
+			for (unsigned int i=0; i<bin.size(); i++)
+			{
+				const Element &element = (*elements)[bin[i]];
+				DrawLine(element.n1-1, element.n2-1, tileRect);
+				DrawLine(element.n2-1, element.n3-1, tileRect);
+				DrawLine(element.n3-1, element.n1-1, tileRect);
+			}
+		}
+	}
+
+	// Highlighted Elements and Nodes
+	std::vector<unsigned int> &highlightBin = highlightBins[tile];
+	for (unsigned int i=0; i<highlightBin.size(); i++)
+		FillTriangle((*elements)[highlightBin[i]], tileRect, highlightColor);
+
+	for (unsigned int i=0; i<numHighlightNodes; i++)
+	{
+		unsigned int n = highlightNodes[i];
+		if (n >= visible.size() || visible[n] != 1)
+			continue;
+		int x = FastFloor(windowX[n]);
+		int y = FastFloor(windowY[n]);
+		if (x >= tileRect[0] && x < tileRect[2] && y >= tileRect[1] && y < tileRect[3])
+			memcpy(&pixels[4*((size_t)y*width + x)], highlightColor, 4);
+	}
+}
+
+
+/**
+ * @brief Fills the part of an Element that lies inside a tile
+ *
+ * Edge functions are evaluated in fixed point at pixel centers. Pixels exactly on an edge
+ * belong to the triangle only if the edge is a top or left edge, so pixels on edges shared
+ * by two Elements are drawn exactly once.
+ *
+ * When coloring by scalar value, Elements with a dry Node (a scalar value of -99999) are
+ * not filled, the same as GradientShader discards them.
+ *
+ * @param element The Element
+ * @param tileRect The tile [x0, y0, x1, y1), in pixels
+ * @param solidColor The color to fill with, or 0 to color by scalar value
+ */
+void MeshRasterizer::FillTriangle(const Element &element, const int *tileRect, const unsigned char *solidColor)
+{
+	unsigned int a = element.n1-1, b = element.n2-1, c = element.n3-1;
+	if (visible[a] != 1 || visible[b] != 1 || visible[c] != 1)
+	{
+		FillLargeTriangle(a, b, c, tileRect, solidColor);
+		return;
+	}
+
+	long long x0 = fixedX[a], y0 = fixedY[a];
+	long long x1 = fixedX[b], y1 = fixedY[b];
+	long long x2 = fixedX[c], y2 = fixedY[c];
+	float v0 = values[a], v1 = values[b], v2 = values[c];
+	if (solidColor == 0 && numScalars > 0 && (v0 == -99999.0 || v1 == -99999.0 || v2 == -99999.0))
+		return;
+
+	// Make the triangle counter-clockwise
+	long long area = (x1-x0)*(y2-y0) - (y1-y0)*(x2-x0);
+	if (area == 0)
+		return;
+	if (area < 0)
+	{
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	// Pixels whose centers lie inside the bounding box, clipped to the tile
+	const int One = 1 << SubpixelBits;
+	const int Half = One/2;
+	long long minX = std::min(x0, std::min(x1, x2)), maxX = std::max(x0, std::max(x1, x2));
+	long long minY = std::min(y0, std::min(y1, y2)), maxY = std::max(y0, std::max(y1, y2));
+	int pixelX0 = std::max(FloorDiv(minX - Half + One - 1, One), tileRect[0]);
+	int pixelX1 = std::min(FloorDiv(maxX - Half, One), tileRect[2]-1);
+	int pixelY0 = std::max(FloorDiv(minY - Half + One - 1, One), tileRect[1]);
+	int pixelY1 = std::min(FloorDiv(maxY - Half, One), tileRect[3]-1);
+	if (pixelX0 > pixelX1 || pixelY0 > pixelY1)
+		return;
+
+	// Edge functions at the center of the first pixel, and their steps per pixel
+	long long startX = (long long)pixelX0*One + Half;
+	long long startY = (long long)pixelY0*One + Half;
+	long long ex[3] = {x2-x1, x0-x2, x1-x0};
+	long long ey[3] = {y2-y1, y0-y2, y1-y0};
+	long long ox[3] = {x1, x2, x0};
+	long long oy[3] = {y1, y2, y0};
+	long long rowStart[3], stepX[3], stepY[3];
+	int bias[3];
+	for (int i=0; i<3; i++)
+	{
+		rowStart[i] = ex[i]*(startY - oy[i]) - ey[i]*(startX - ox[i]);
+		stepX[i] = -ey[i]*One;
+		stepY[i] = ex[i]*One;
+		bias[i] = IsTopLeft(ex[i], ey[i]) ? 0 : -1;
+	}
+
+	// Weights that turn edge functions into interpolated values
+	const float InvArea = 1.0/(double)area;
+	const float w0 = v0*InvArea, w1 = v1*InvArea, w2 = v2*InvArea;
+
+#ifdef __SSE2__
+	if (maxX - minX < SmallTriangleSize && maxY - minY < SmallTriangleSize)
+	{
+		// Every edge function inside the bounding box fits in 32 bits
+		const __m128i Lanes = _mm_set_epi32(3, 2, 1, 0);
+		__m128i row[3], step4[3], rowStep[3], biasVec[3];
+		for (int i=0; i<3; i++)
+		{
+			int laneValues[4] = {(int)rowStart[i], (int)(rowStart[i] + stepX[i]), (int)(rowStart[i] + 2*stepX[i]), (int)(rowStart[i] + 3*stepX[i])};
+			row[i] = _mm_loadu_si128((const __m128i*)laneValues);
+			step4[i] = _mm_set1_epi32((int)(4*stepX[i]));
+			rowStep[i] = _mm_set1_epi32((int)stepY[i]);
+			biasVec[i] = _mm_set1_epi32(bias[i]);
+		}
+		const __m128 W0 = _mm_set1_ps(w0), W1 = _mm_set1_ps(w1), W2 = _mm_set1_ps(w2);
+		unsigned int packedColor = 0;
+		if (solidColor)
+			memcpy(&packedColor, solidColor, 4);
+
+		for (int y=pixelY0; y<=pixelY1; y++)
+		{
+			__m128i e0 = row[0], e1 = row[1], e2 = row[2];
+			unsigned char *line = &pixels[4*((size_t)y*width)];
+			for (int x=pixelX0; x<=pixelX1; x+=4)
+			{
+				// A pixel is outside if any biased edge function is negative
+				__m128i outside = _mm_or_si128(_mm_or_si128(_mm_add_epi32(e0, biasVec[0]), _mm_add_epi32(e1, biasVec[1])), _mm_add_epi32(e2, biasVec[2]));
+				__m128i inRange = _mm_cmplt_epi32(Lanes, _mm_set1_epi32(pixelX1 - x + 1));
+				int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(outside, inRange)));
+				if (mask)
+				{
+					if (solidColor)
+					{
+						for (int lane=0; lane<4; lane++)
+							if (mask & (1 << lane))
+								memcpy(line + 4*(x+lane), &packedColor, 4);
+					} else {
+						float interpolated[4];
+						__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(e0), W0), _mm_mul_ps(_mm_cvtepi32_ps(e1), W1)), _mm_mul_ps(_mm_cvtepi32_ps(e2), W2));
+						_mm_storeu_ps(interpolated, v);
+						for (int lane=0; lane<4; lane++)
+							if (mask & (1 << lane))
+								ShadePixel(line + 4*(x+lane), interpolated[lane], 0);
+					}
+				}
+				e0 = _mm_add_epi32(e0, step4[0]);
+				e1 = _mm_add_epi32(e1, step4[1]);
+				e2 = _mm_add_epi32(e2, step4[2]);
+			}
+			row[0] = _mm_add_epi32(row[0], rowStep[0]);
+			row[1] = _mm_add_epi32(row[1], rowStep[1]);
+			row[2] = _mm_add_epi32(row[2], rowStep[2]);
+		}
+		return;
+	}
+#endif
+
+	for (int y=pixelY0; y<=pixelY1; y++)
+	{
+		long long e0 = rowStart[0], e1 = rowStart[1], e2 = rowStart[2];
+		unsigned char *line = &pixels[4*((size_t)y*width)];
+		for (int x=pixelX0; x<=pixelX1; x++)
+		{
+			if (e0 + bias[0] >= 0 && e1 + bias[1] >= 0 && e2 + bias[2] >= 0)
+				ShadePixel(line + 4*x, e0*w0 + e1*w1 + e2*w2, solidColor);
+			e0 += stepX[0];
+			e1 += stepX[1];
+			e2 += stepX[2];
+		}
+		rowStart[0] += stepY[0];
+		rowStart[1] += stepY[1];
+		rowStart[2] += stepY[2];
+	}
+}
+
+
+/**
+ * @brief Fills the part of an Element with a Node outside the guard band that lies inside
+ * a tile
+ *
+ * These Elements are huge on screen (the camera is zoomed far in), so there are few of
+ * them. Edge functions are evaluated in double precision without snapping. Dry Elements
+ * are skipped the same as in FillTriangle().
+ *
+ * @param a The index of the first Node
+ * @param b The index of the second Node
+ * @param c The index of the third Node
+ * @param tileRect The tile [x0, y0, x1, y1), in pixels
+ * @param solidColor The color to fill with, or 0 to color by scalar value
+ */
+void MeshRasterizer::FillLargeTriangle(unsigned int a, unsigned int b, unsigned int c, const int *tileRect, const unsigned char *solidColor)
+{
+	double x0 = windowX[a], y0 = windowY[a];
+	double x1 = windowX[b], y1 = windowY[b];
+	double x2 = windowX[c], y2 = windowY[c];
+	float v0 = values[a], v1 = values[b], v2 = values[c];
+	if (solidColor == 0 && numScalars > 0 && (v0 == -99999.0 || v1 == -99999.0 || v2 == -99999.0))
+		return;
+
+	double area = (x1-x0)*(y2-y0) - (y1-y0)*(x2-x0);
+	if (area == 0.0)
+		return;
+	if (area < 0.0)
+	{
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	double ex[3] = {x2-x1, x0-x2, x1-x0};
+	double ey[3] = {y2-y1, y0-y2, y1-y0};
+	double ox[3] = {x1, x2, x0};
+	double oy[3] = {y1, y2, y0};
+	bool topLeft[3];
+	for (int i=0; i<3; i++)
+		topLeft[i] = ey[i] < 0.0 || (ey[i] == 0.0 && ex[i] < 0.0);
+
+	for (int y=tileRect[1]; y<tileRect[3]; y++)
+	{
+		double py = y + 0.5;
+		unsigned char *line = &pixels[4*((size_t)y*width)];
+		for (int x=tileRect[0]; x<tileRect[2]; x++)
+		{
+			double px = x + 0.5;
+			double e[3];
+			bool inside = true;
+			for (int i=0; i<3 && inside; i++)
+			{
+				e[i] = ex[i]*(py - oy[i]) - ey[i]*(px - ox[i]);
+				inside = e[i] > 0.0 || (e[i] == 0.0 && topLeft[i]);
+			}
+			if (inside)
+				ShadePixel(line + 4*x, (float)((e[0]*v0 + e[1]*v1 + e[2]*v2)/area), solidColor);
+		}
+	}
+}
+
+
+/**
+ * @brief Draws the part of one Element edge that lies inside a tile
+ *
+ * Like OpenGL, one pixel is drawn per column (or row, for steep lines) that the line
+ * crosses, at the pixel center. The first end point is included and the last end point
+ * is not, so the outline of an Element is closed without drawing any corner twice.
+ *
+ * @param a The index of the Node the line starts at
+ * @param b The index of the Node the line ends at
+ * @param tileRect The tile [x0, y0, x1, y1), in pixels
+ */
+void MeshRasterizer::DrawLine(unsigned int a, unsigned int b, const int *tileRect)
+{
+	float xa = lineX[a], ya = lineY[a];
+	float xb = lineX[b], yb = lineY[b];
+	float dx = xb - xa;
+	float dy = yb - ya;
+
+	bool xMajor = fabsf(dx) >= fabsf(dy);
+	float start = xMajor ? xa : ya;
+	float end = xMajor ? xb : yb;
+
+	// The pixels whose centers lie in [start, end) along the major axis
+	int first, last;
+	if (end > start)
+	{
+		first = -FastFloor(0.5 - start);
+		last = -FastFloor(0.5 - end) - 1;
+	} else {
+		first = FastFloor(end - 0.5) + 1;
+		last = FastFloor(start - 0.5);
+	}
+	first = std::max(first, xMajor ? tileRect[0] : tileRect[1]);
+	last = std::min(last, xMajor ? tileRect[2]-1 : tileRect[3]-1);
+	if (first > last)
+		return;
+
+	float origin = xMajor ? ya : xa;
+	float slope = xMajor ? dy/dx : dx/dy;
+	int minorMin = xMajor ? tileRect[1] : tileRect[0];
+	int minorMax = xMajor ? tileRect[3]-1 : tileRect[2]-1;
+	for (int i=first; i<=last; i++)
+	{
+		int j = FastFloor(origin + (i + 0.5 - start)*slope);
+		if (j < minorMin || j > minorMax)
+			continue;
+		int x = xMajor ? i : j;
+		int y = xMajor ? j : i;
+		memcpy(&pixels[4*((size_t)y*width + x)], wireColor, 4);
+	}
+}
+
+
+/**
+ * @brief Writes the color of one pixel
+ *
+ * Scalar values are colored the same way as GradientShader: the value is turned into a
+ * texture coordinate with ColorMap::TextureCoordinate() and the colormap table is sampled
+ * with linear filtering and edge clamping.
+ *
+ * @param pixel A pointer to the RGBA pixel
+ * @param value The interpolated scalar value
+ * @param solidColor The color to write, or 0 to color by value
+ */
+void MeshRasterizer::ShadePixel(unsigned char *pixel, float value, const unsigned char *solidColor)
+{
+	if (solidColor)
+	{
+		memcpy(pixel, solidColor, 4);
+		return;
+	}
+
+	const int TableSize = ColorMap::TableSize;
+	float position = ColorMap::TextureCoordinate(value, minValue, maxValue)*TableSize - 0.5;
+	int lower = (int)floorf(position);
+	float weight = position - lower;
+	int upper = lower + 1;
+	lower = lower < 0 ? 0 : (lower > TableSize-1 ? TableSize-1 : lower);
+	upper = upper < 0 ? 0 : (upper > TableSize-1 ? TableSize-1 : upper);
+
+	const float *c0 = &colorTable[4*lower];
+	const float *c1 = &colorTable[4*upper];
+	for (int i=0; i<4; i++)
+		pixel[i] = ToByte((1.0 - weight)*c0[i] + weight*c1[i]);
+}
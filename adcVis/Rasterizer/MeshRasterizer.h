@@ -0,0 +1,119 @@
+#ifndef MESHRASTERIZER_H
+#define MESHRASTERIZER_H
+
+#include "adcData.h"
+#include "../OpenGL/GLCamera.h"
+#include "../Shaders/ColorMap.h"
+#include <vector>
+
+
+/**
+ * @brief Draws triangle meshes into an RGBA image on the CPU, without an OpenGL context
+ *
+ * MeshRasterizer is a software replacement for the OpenGL drawing path, for machines
+ * where no OpenGL implementation is available. It draws the same things a Layer draws:
+ * - The fill, either in a solid color (like DefaultShader) or colored by a per-Node scalar
+ * through a ColorMap (like GradientShader, which leaves Elements with a dry Node unfilled)
+ * - The wireframe outline of every Element
+ * - Highlighted Elements and Nodes on top of everything else
+ * .
+ *
+ * The image is split into square tiles. Triangles are first sorted into the tiles their
+ * bounding boxes touch, by several threads at once, and then every tile is drawn by
+ * whichever thread gets to it first. Inside a tile, triangles are drawn in the order they
+ * were given, fill before outline before highlight, so the result matches the order the
+ * OpenGL path draws in.
+ *
+ * Coverage follows the OpenGL rules so that images are comparable with the OpenGL path
+ * pixel by pixel: vertices are snapped to 1/256 of a pixel, pixels are sampled at their
+ * centers, the top-left rule decides pixels on shared edges, and colormap lookups use
+ * ColorMap::TextureCoordinate() with linear filtering. Edge functions of small triangles
+ * are evaluated for four pixels at a time with SSE2.
+ *
+ * The image is stored bottom row first, the same as glReadPixels(), so it can be written
+ * with ImageWriter in the same way as a frame read back from OpenGL.
+ *
+ */
+class MeshRasterizer
+{
+	public:
+
+		/**
+		 * @brief Defines how the fill of a mesh is colored
+		 */
+		enum FillMode {
+			SolidFill,	/**< Every Element is filled with the fill color */
+			ColorMappedFill	/**< Every pixel is colored by the interpolated scalar value through the ColorMap */
+		};
+
+		MeshRasterizer();
+
+		int		SetSize(int newWidth, int newHeight);
+		void		SetCamera(GLCamera *newCamera);
+		void		SetNumThreads(unsigned int newNumThreads);
+		void		SetFillMode(FillMode newMode);
+		void		SetFillColor(float r, float g, float b, float a);
+		void		SetColorMap(ColorMap *map, float min, float max);
+		void		SetScalars(const float *values, unsigned int count);
+		void		SetWireframe(bool draw, float r, float g, float b, float a);
+		void		SetHighlightColor(float r, float g, float b, float a);
+
+		void		Clear(float r, float g, float b, float a);
+		int		DrawMesh(std::vector<Node> *nodes, std::vector<Element> *elements,
+					 const unsigned int *highlightElements, unsigned int numHighlightElements,
+					 const unsigned int *highlightNodes, unsigned int numHighlightNodes);
+
+		// Getter Methods
+		int		GetWidth();
+		int		GetHeight();
+		const unsigned char*	GetPixels();
+
+		static const int	TileSize = 64;		/**< The width and height of a tile in pixels */
+		static const int	SubpixelBits = 8;	/**< The number of fractional bits vertices are snapped to */
+
+	protected:
+
+		// Image
+		int				width;		/**< The width of the image in pixels */
+		int				height;		/**< The height of the image in pixels */
+		int				tilesX;		/**< The number of tile columns */
+		int				tilesY;		/**< The number of tile rows */
+		std::vector<unsigned char>	pixels;		/**< The RGBA image, bottom row first */
+
+		// Drawing state
+		GLCamera*		camera;			/**< The camera whose MVPMatrix transforms the Nodes */
+		unsigned int		numThreads;		/**< The number of threads used to draw */
+		FillMode		fillMode;		/**< How the fill is colored */
+		unsigned char		fillColor[4];		/**< The solid fill color */
+		unsigned char		wireColor[4];		/**< The outline color */
+		unsigned char		highlightColor[4];	/**< The color of highlighted Elements and Nodes */
+		bool			drawWireframe;		/**< Flag that shows if the outline is drawn */
+		std::vector<float>	colorTable;		/**< The ColorMap sampled with ColorMap::BuildTable() */
+		float			minValue;		/**< The scalar value mapped to the first color stop */
+		float			maxValue;		/**< The scalar value mapped to the last color stop */
+		const float*		scalars;		/**< The per-Node scalar values, or 0 to use the Node z-values */
+		unsigned int		numScalars;		/**< The number of values in scalars */
+
+		// Per-draw data
+		std::vector<float>		windowX;	/**< The x-coordinate of every Node in window pixels */
+		std::vector<float>		windowY;	/**< The y-coordinate of every Node in window pixels */
+		std::vector<int>		fixedX;		/**< The x-coordinate of every Node in subpixels */
+		std::vector<int>		fixedY;		/**< The y-coordinate of every Node in subpixels */
+		std::vector<float>		lineX;		/**< The x-coordinate of every Node used to draw outlines, snapped if possible */
+		std::vector<float>		lineY;		/**< The y-coordinate of every Node used to draw outlines, snapped if possible */
+		std::vector<float>		values;		/**< The scalar value of every Node */
+		std::vector<unsigned char>	visible;	/**< 0 for Nodes behind the camera, 1 inside the guard band, 2 outside it */
+		std::vector<std::vector<unsigned int> >	bins;		/**< The Elements that touch each tile, one set of tiles per thread */
+		std::vector<std::vector<unsigned int> >	highlightBins;	/**< The highlighted Elements that touch each tile */
+
+		// Protected Functions
+		void		TransformNodes(std::vector<Node> *nodes);
+		void		BinElements(std::vector<Element> *elements, const unsigned int *list, unsigned int count, std::vector<std::vector<unsigned int> > *binSet, unsigned int numBinThreads);
+		void		DrawTile(int tile, std::vector<Element> *elements, const unsigned int *highlightNodes, unsigned int numHighlightNodes);
+		void		FillTriangle(const Element &element, const int *tileRect, const unsigned char *solidColor);
+		void		FillLargeTriangle(unsigned int a, unsigned int b, unsigned int c, const int *tileRect, const unsigned char *solidColor);
+		void		DrawLine(unsigned int a, unsigned int b, const int *tileRect);
+		void		ShadePixel(unsigned char *pixel, float value, const unsigned char *solidColor);
+};
+
+#endif // MESHRASTERIZER_H
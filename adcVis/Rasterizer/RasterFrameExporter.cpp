@@ -0,0 +1,149 @@
+#include "RasterFrameExporter.h"
+
+#include <string.h>
+#include <stdio.h>
+
+
+RasterFrameExporter::RasterFrameExporter()
+{
+	rasterizer = 0;
+	writer = 0;
+	clearColor[0] = 0.0;
+	clearColor[1] = 0.0;
+	clearColor[2] = 0.0;
+	clearColor[3] = 1.0;
+}
+
+
+/**
+ * @brief Sets the rasterizer the Layers are drawn with
+ * @param newRasterizer The MeshRasterizer, which must have been given a size and a camera
+ */
+void RasterFrameExporter::SetRasterizer(MeshRasterizer *newRasterizer)
+{
+	rasterizer = newRasterizer;
+}
+
+
+/**
+ * @brief Sets the ImageWriter that compresses and writes the frames
+ *
+ * The ImageWriter must have been started with ImageWriter::Start(). It is not stopped by
+ * the exporter, so it can be shared by several exports.
+ *
+ * @param newWriter The ImageWriter
+ */
+void RasterFrameExporter::SetImageWriter(ImageWriter *newWriter)
+{
+	writer = newWriter;
+}
+
+
+/**
+ * @brief Sets the color every frame is cleared to
+ * @param r Red (0.0 - 1.0)
+ * @param g Green (0.0 - 1.0)
+ * @param b Blue (0.0 - 1.0)
+ * @param a Alpha (0.0 - 1.0)
+ */
+void RasterFrameExporter::SetClearColor(float r, float g, float b, float a)
+{
+	clearColor[0] = r;
+	clearColor[1] = g;
+	clearColor[2] = b;
+	clearColor[3] = a;
+}
+
+
+/**
+ * @brief Adds a Layer to the end of the drawing order
+ * @param newLayer The Layer, the exporter does not take ownership
+ */
+void RasterFrameExporter::AddLayer(Layer *newLayer)
+{
+	if (newLayer)
+		layers.push_back(newLayer);
+}
+
+
+/**
+ * @brief Clears the rasterizer's image and draws every Layer into it
+ *
+ * The frame is not written, read it with MeshRasterizer::GetPixels().
+ *
+ * @return 0 if the frame was drawn
+ * @return 1 if no rasterizer has been set or it has no size
+ */
+int RasterFrameExporter::Render()
+{
+	if (rasterizer == 0 || rasterizer->GetWidth() == 0)
+		return 1;
+
+	rasterizer->Clear(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+	for (unsigned int i=0; i<layers.size(); i++)
+		layers[i]->DrawSoftware(rasterizer);
+	return 0;
+}
+
+
+/**
+ * @brief Draws a frame and queues it to be written
+ * @param fileLoc The location of the image file to write
+ * @return 0 if the frame was drawn and queued
+ * @return 1 if an error occurred
+ */
+int RasterFrameExporter::RenderFrame(std::string fileLoc)
+{
+	if (writer == 0 || Render() != 0)
+		return 1;
+
+	const size_t FrameSize = 4*(size_t)rasterizer->GetWidth()*rasterizer->GetHeight();
+	std::vector<unsigned char> pixels;
+	writer->AcquireBuffer(&pixels);
+	pixels.resize(FrameSize);
+	memcpy(pixels.data(), rasterizer->GetPixels(), FrameSize);
+
+	return writer->Submit(fileLoc, rasterizer->GetWidth(), rasterizer->GetHeight(), &pixels);
+}
+
+
+/**
+ * @brief Exports one frame for every timestep in a range
+ *
+ * See GLFrameExporter::ExportTimesteps(), the file pattern must contain exactly one
+ * integer conversion. Every frame has been written when this function returns.
+ *
+ * @param layers The Layers that change with the timestep
+ * @param first The first timestep
+ * @param last The last timestep
+ * @param stride The number of timesteps between frames
+ * @param filePattern The pattern used to build the file names
+ * @return The number of frames that could not be drawn or written
+ */
+int RasterFrameExporter::ExportTimesteps(std::vector<Layer *> *layers, int first, int last, int stride, std::string filePattern)
+{
+	if (stride <= 0)
+		stride = 1;
+
+	unsigned int startErrors = writer ? writer->GetNumErrors() : 0;
+	int errors = 0;
+	char fileName[4096];
+	for (int timestep=first; timestep<=last; timestep+=stride)
+	{
+		if (layers)
+			for (unsigned int i=0; i<layers->size(); i++)
+				layers->at(i)->UpdateTimestep(timestep);
+
+		snprintf(fileName, sizeof(fileName), filePattern.data(), timestep);
+		if (RenderFrame(fileName) != 0)
+			errors++;
+	}
+
+	if (writer)
+	{
+		writer->Wait();
+		errors += writer->GetNumErrors() - startErrors;
+	}
+
+	return errors;
+}
@@ -0,0 +1,47 @@
+#ifndef RASTERFRAMEEXPORTER_H
+#define RASTERFRAMEEXPORTER_H
+
+#include "MeshRasterizer.h"
+#include "../Layers/Layer.h"
+#include "../IO/ImageWriter.h"
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Draws Layers with a MeshRasterizer and writes the frames to image files
+ *
+ * This is the CPU counterpart of GLFrameExporter, for machines where no OpenGL context
+ * can be created. Every frame is cleared to the clear color, every Layer is drawn with
+ * Layer::DrawSoftware() in the order it was added, and the image is handed to an
+ * ImageWriter, which compresses it on a background thread while the next frame is drawn.
+ *
+ * The Layers should be software only (see Layer::SetSoftwareOnly()) so that they can
+ * read their files without an OpenGL context. The rasterizer's size, camera and colors
+ * are set by the caller.
+ *
+ */
+class RasterFrameExporter
+{
+	public:
+
+		RasterFrameExporter();
+
+		void		SetRasterizer(MeshRasterizer *newRasterizer);
+		void		SetImageWriter(ImageWriter *newWriter);
+		void		SetClearColor(float r, float g, float b, float a);
+		void		AddLayer(Layer *newLayer);
+
+		int		Render();
+		int		RenderFrame(std::string fileLoc);
+		int		ExportTimesteps(std::vector<Layer*> *layers, int first, int last, int stride, std::string filePattern);
+
+	protected:
+
+		MeshRasterizer*		rasterizer;	/**< The rasterizer the Layers are drawn with */
+		ImageWriter*		writer;		/**< The ImageWriter that compresses and writes the frames */
+		std::vector<Layer*>	layers;		/**< The Layers drawn in every frame, in drawing order */
+		float			clearColor[4];	/**< The color every frame is cleared to */
+};
+
+#endif // RASTERFRAMEEXPORTER_H
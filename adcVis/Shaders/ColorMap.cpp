@@ -0,0 +1,124 @@
+#include "ColorMap.h"
+
+
+/**
+ * @brief Constructor initializes the map to a five stop blue-to-red gradient
+ */
+ColorMap::ColorMap()
+{
+	const GLfloat defaultStops[20] = {0.0, 0.0, 0.5, 1.0,
+					  0.0, 0.8, 1.0, 1.0,
+					  0.0, 0.8, 0.0, 1.0,
+					  1.0, 1.0, 0.0, 1.0,
+					  0.8, 0.0, 0.0, 1.0};
+	stops.assign(defaultStops, defaultStops+20);
+}
+
+
+/**
+ * @brief Replaces the color stops of the map
+ *
+ * Color1 through Color8 of the UniformColors struct are read in order and used as
+ * evenly spaced color stops. Reading stops at the first color that has not been set
+ * (ie. all four components are -1.0). If fewer than two colors are set, the map is
+ * not modified.
+ *
+ * @param colors The UniformColors struct containing the new color stops
+ */
+void ColorMap::SetColors(UniformColors *colors)
+{
+	if (colors == 0)
+		return;
+
+	float *colorList[8] = {colors->Color1, colors->Color2, colors->Color3, colors->Color4,
+			       colors->Color5, colors->Color6, colors->Color7, colors->Color8};
+
+	std::vector<GLfloat> newStops;
+	for (int i=0; i<8; i++)
+	{
+		float *c = colorList[i];
+		if (c[0] == -1.0 && c[1] == -1.0 && c[2] == -1.0 && c[3] == -1.0)
+			break;
+		newStops.insert(newStops.end(), c, c+4);
+	}
+
+	if (newStops.size() >= 8)
+		stops = newStops;
+}
+
+
+/**
+ * @brief Returns the number of color stops in the map
+ * @return The number of color stops in the map
+ */
+int ColorMap::GetNumStops()
+{
+	return stops.size()/4;
+}
+
+
+/**
+ * @brief Samples the map into a lookup table of ColorMap::TableSize RGBA values
+ *
+ * Entry i of the table holds the color at position i/(TableSize-1) along the gradient,
+ * so the first and last entries are exactly the first and last color stops.
+ *
+ * @param table A pointer to the vector that will hold the densely packed RGBA table
+ */
+void ColorMap::BuildTable(std::vector<GLfloat> *table)
+{
+	if (table == 0)
+		return;
+
+	table->resize(4*TableSize);
+	for (int i=0; i<TableSize; i++)
+		Sample((float)i/(TableSize-1), &(*table)[4*i]);
+}
+
+
+/**
+ * @brief Evaluates the gradient at a single position
+ * @param t The position along the gradient (0.0 - 1.0), values outside the range are clamped
+ * @param rgba A pointer to four floats that will hold the resulting color
+ */
+void ColorMap::Sample(float t, float *rgba)
+{
+	int numStops = GetNumStops();
+	if (t < 0.0)
+		t = 0.0;
+	else if (t > 1.0)
+		t = 1.0;
+
+	float position = t*(numStops-1);
+	int lower = (int)position;
+	if (lower >= numStops-1)
+		lower = numStops-2;
+	float weight = position - lower;
+
+	for (int i=0; i<4; i++)
+		rgba[i] = (1.0-weight)*stops[4*lower+i] + weight*stops[4*(lower+1)+i];
+}
+
+
+/**
+ * @brief Maps a scalar value to a texture coordinate in a sampled lookup table
+ *
+ * The value is normalized to the range [min, max] and then mapped onto the centers of
+ * the first and last texels so that linear texture filtering reproduces the gradient
+ * exactly at both ends. GradientShader performs the same computation on the GPU.
+ *
+ * @param value The scalar value
+ * @param min The scalar value mapped to the first color stop
+ * @param max The scalar value mapped to the last color stop
+ * @return The texture coordinate (0.0 - 1.0)
+ */
+float ColorMap::TextureCoordinate(float value, float min, float max)
+{
+	float range = max - min;
+	float t = range != 0.0 ? (value - min)/range : 0.0;
+	if (t < 0.0)
+		t = 0.0;
+	else if (t > 1.0)
+		t = 1.0;
+	return (0.5 + t*(TableSize-1))/TableSize;
+}
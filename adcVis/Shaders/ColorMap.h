@@ -0,0 +1,39 @@
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include "../GLData.h"
+#include <vector>
+
+
+/**
+ * @brief Defines a piecewise linear color gradient that can be sampled into a lookup table
+ *
+ * A ColorMap is a list of up to eight evenly spaced RGBA color stops. The map is sampled
+ * into a fixed-size table of RGBA values that is uploaded as a 1D texture by GradientShader.
+ * The same table is used by CPU-side renderers so that both paths produce identical colors
+ * for identical scalar values.
+ *
+ * The default ColorMap runs from dark blue, through cyan, green and yellow, to red.
+ *
+ */
+class ColorMap
+{
+	public:
+
+		ColorMap();
+
+		void	SetColors(UniformColors *colors);
+		int	GetNumStops();
+		void	BuildTable(std::vector<GLfloat> *table);
+		void	Sample(float t, float *rgba);
+
+		static const int	TableSize = 256;	/**< The number of RGBA entries in a sampled lookup table */
+
+		static float	TextureCoordinate(float value, float min, float max);
+
+	protected:
+
+		std::vector<GLfloat>	stops;	/**< The RGBA color stops, densely packed [r1, g1, b1, a1, r2, ...] */
+};
+
+#endif // COLORMAP_H
@@ -1,4 +1,6 @@
 #include "GLShader.h"
+#include "../OpenGL/GLProfiler.h"
+#include "../IO/TraceWriter.h"
 
 /**
  * @brief Constructor initializes all variables to default values
@@ -14,6 +16,7 @@ GLShader::GLShader()
 	loaded = false;
 	uniformsSet = false;
 	cameraSet = false;
+	compileAttempted = false;
 }
 
 
@@ -34,7 +37,9 @@ GLShader::~GLShader()
  * @brief Tells the OpenGL context to use this shader program
  *
  * Tells the OpenGL context to use this shader program for all subsequent
- * drawing operations.
+ * drawing operations. The shader program is compiled the first time this function
+ * is called, since a current OpenGL context is not guaranteed to exist when the
+ * shader object is constructed.
  *
  * @return 0 if command successfully sent to OpenGL context
  * @return 1 if uniforms have not been set
@@ -43,6 +48,15 @@ GLShader::~GLShader()
  */
 int GLShader::Use()
 {
+	GLProfileScope profile (GLProfiler::GetCurrentLayer(), GLProfiler::ShaderSection);
+
+	if (cameraSet && !loaded && !compileAttempted)
+	{
+		TRACE_SCOPE("gpu", "CompileShader");
+		compileAttempted = true;
+		CompileShader();
+	}
+
 	if (cameraSet)
 		if (loaded)
 			if (uniformsSet)
@@ -82,6 +96,17 @@ void GLShader::SetCamera(GLCamera *newCam)
 }
 
 
+/**
+ * @brief Returns the camera used by this shader
+ * @return A pointer to the camera used by this shader
+ * @return 0 if the camera has not been set
+ */
+GLCamera* GLShader::GetCamera()
+{
+	return camera;
+}
+
+
 /**
  * @brief Compiles individual parts of a shader program.
  *
@@ -98,6 +123,7 @@ void GLShader::SetCamera(GLCamera *newCam)
  */
 GLuint GLShader::CompileShaderPart(std::string source, GLenum shaderType)
 {
+	TRACE_SCOPE("gpu", "CompileShaderPart");
 	const char *src = source.data();
 	GLuint shaderID = glCreateShader(shaderType);
 
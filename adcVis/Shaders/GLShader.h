@@ -24,11 +24,12 @@ class GLShader
 
 		// Constructor/Destructor
 		GLShader();
-		~GLShader();
+		virtual ~GLShader();
 
 		// Public functions common to all shaders
 		int	Use();
 		void	SetCamera(GLCamera *newCam);
+		GLCamera*	GetCamera();
 
 
 		/**
@@ -69,6 +70,7 @@ class GLShader
 		bool	loaded;		/**< Set to true after successfully setting programID */
 		bool	cameraSet;	/**< Set to true when the camera pointer has been set */
 		bool	uniformsSet;	/**< Set to true when all user-accessible uniforms have been set to expected values*/
+		bool	compileAttempted;	/**< Set to true after the first call to CompileShader() */
 
 		// Protected Functions
 		GLuint	CompileShaderPart(std::string source, GLenum shaderType);
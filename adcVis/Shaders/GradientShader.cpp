@@ -0,0 +1,217 @@
+#include "GradientShader.h"
+
+
+/**
+ * @brief Constructor initializes the color range to [0.0, 1.0] and the scalar source
+ * to the position z-coordinate
+ *
+ * The constructor initializes the color range, hard-codes the vertex and fragment
+ * shader source and marks the colormap texture for upload. The shader program is
+ * compiled the first time it is used in the OpenGL context.
+ *
+ * The vertex shader flags every dry vertex (a scalar attribute of -99999). The flag is
+ * interpolated across each triangle, so it is above zero in every fragment of a triangle
+ * with a dry vertex, and the fragment shader discards those fragments.
+ *
+ */
+GradientShader::GradientShader()
+{
+	scalarSource = PositionZ;
+	minValue = 0.0;
+	maxValue = 1.0;
+
+	textureID = 0;
+	textureDirty = true;
+	MVPUniform = -1;
+	MinUniform = -1;
+	MaxUniform = -1;
+	SourceUniform = -1;
+	ColorMapUniform = -1;
+
+	uniformsSet = true;
+
+	vertexShaderSource = "#version 330\n"
+			     "layout(location=0) in vec4 in_Position;"
+			     "layout(location=1) in float in_Value;"
+			     "out float ex_Value;"
+			     "out float ex_Dry;"
+			     "uniform mat4 MVPMatrix;"
+			     "uniform int UseValueAttribute;"
+			     "void main(void)"
+			     "{"
+				     "gl_Position = MVPMatrix*in_Position;"
+				     "ex_Value = UseValueAttribute != 0 ? in_Value : in_Position.z;"
+				     "ex_Dry = UseValueAttribute != 0 && in_Value == -99999.0 ? 1.0 : 0.0;"
+			     "}";
+
+	fragmentShaderSource = "#version 330\n"
+			       "in float ex_Value;"
+			       "in float ex_Dry;"
+			       "out vec4 out_Color;"
+			       "uniform sampler1D ColorMap;"
+			       "uniform float MinValue;"
+			       "uniform float MaxValue;"
+			       "void main(void)"
+			       "{"
+				       "if (ex_Dry > 0.0)"
+					       "discard;"
+				       "float range = MaxValue - MinValue;"
+				       "float t = range != 0.0 ? clamp((ex_Value - MinValue)/range, 0.0, 1.0) : 0.0;"
+				       "float size = float(textureSize(ColorMap, 0));"
+				       "out_Color = texture(ColorMap, (0.5 + t*(size - 1.0))/size);"
+			       "}";
+}
+
+
+/**
+ * @brief Deconstructor that deletes the colormap texture from the OpenGL context
+ */
+GradientShader::~GradientShader()
+{
+	if (textureID)
+		glDeleteTextures(1, &textureID);
+}
+
+
+/**
+ * @brief Sets the color stops and the color range used by the shader
+ *
+ * Color1 through Color8 of the UniformColors struct are used as evenly spaced color
+ * stops (see ColorMap::SetColors()). Changing the colors only rebuilds the small
+ * colormap texture.
+ *
+ * Value1 of the UniformValues struct is the scalar value mapped to the first color
+ * stop and Value2 is the scalar value mapped to the last color stop. Changing the
+ * range only changes two uniforms, no vertex data is uploaded.
+ *
+ * @param colors The UniformColors struct with updated color stops
+ * @param values The UniformValues struct with an updated min (Value1) and max (Value2)
+ */
+void GradientShader::SetUniforms(UniformColors *colors, UniformValues *values)
+{
+	if (colors != 0)
+	{
+		colorMap.SetColors(colors);
+		textureDirty = true;
+	}
+
+	if (values != 0)
+	{
+		if (values->Value1 != -99999.0)
+			minValue = values->Value1;
+		if (values->Value2 != -99999.0)
+			maxValue = values->Value2;
+	}
+}
+
+
+/**
+ * @brief Sets where the shader reads the scalar value from
+ *
+ * Use GradientShader::PositionZ to color by the z-coordinate packed into the vertex
+ * buffer object and GradientShader::ScalarAttribute to color by the separate scalar
+ * attribute stream loaded with Layer::LoadScalarDataToGPU().
+ *
+ * @param newSource The new scalar source
+ */
+void GradientShader::SetScalarSource(ScalarSource newSource)
+{
+	scalarSource = newSource;
+}
+
+
+/**
+ * @brief Attempts to compile and link the shader program.
+ *
+ * This shader only requires a vertex shader and a fragment shader. CompileShader attempts
+ * to compile and link the shader program from the hard-coded source. Successful compilation
+ * results in a non-zero value for programID, caches all uniform locations and sets loaded
+ * equal to true.
+ *
+ */
+void GradientShader::CompileShader()
+{
+	GLuint vertexShaderID = CompileShaderPart(vertexShaderSource, GL_VERTEX_SHADER);
+	GLuint fragmentShaderID = CompileShaderPart(fragmentShaderSource, GL_FRAGMENT_SHADER);
+
+	if (vertexShaderID && fragmentShaderID)
+	{
+		programID = glCreateProgram();
+		glAttachShader(programID, vertexShaderID);
+		glAttachShader(programID, fragmentShaderID);
+		glLinkProgram(programID);
+		glDeleteShader(vertexShaderID);
+		glDeleteShader(fragmentShaderID);
+
+		GLint result;
+		glGetProgramiv(programID, GL_LINK_STATUS, &result);
+		if (result == GL_TRUE)
+		{
+			MVPUniform = glGetUniformLocation(programID, "MVPMatrix");
+			MinUniform = glGetUniformLocation(programID, "MinValue");
+			MaxUniform = glGetUniformLocation(programID, "MaxValue");
+			SourceUniform = glGetUniformLocation(programID, "UseValueAttribute");
+			ColorMapUniform = glGetUniformLocation(programID, "ColorMap");
+			loaded = true;
+		} else {
+			loaded = false;
+		}
+	}
+}
+
+
+/**
+ * @brief Transfers all shader uniform values to the
+ * shader object in the OpenGL context.
+ *
+ * This function uploads the colormap texture if the color stops have changed, binds
+ * it to texture unit 0 and transfers the Model-View-Projection Matrix, the color range
+ * and the scalar source to the shader object in the OpenGL context, only if the shader
+ * is in full working order.
+ *
+ */
+void GradientShader::UpdateUniforms()
+{
+	if (uniformsSet && loaded && cameraSet)
+	{
+		glUseProgram(programID);
+
+		if (textureDirty)
+			UploadColorMap();
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_1D, textureID);
+
+		glUniformMatrix4fv(MVPUniform, 1, GL_FALSE, camera->MVPMatrix.m);
+		glUniform1f(MinUniform, minValue);
+		glUniform1f(MaxUniform, maxValue);
+		glUniform1i(SourceUniform, scalarSource == ScalarAttribute ? 1 : 0);
+		glUniform1i(ColorMapUniform, 0);
+	}
+}
+
+
+/**
+ * @brief Samples the ColorMap and uploads it to the 1D colormap texture
+ *
+ * The texture is created the first time this function is called. Linear filtering and
+ * edge clamping are used so that the texture lookup interpolates between table entries
+ * the same way ColorMap::Sample() does.
+ *
+ */
+void GradientShader::UploadColorMap()
+{
+	std::vector<GLfloat> table;
+	colorMap.BuildTable(&table);
+
+	if (textureID == 0)
+		glGenTextures(1, &textureID);
+
+	glBindTexture(GL_TEXTURE_1D, textureID);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA32F, ColorMap::TableSize, 0, GL_RGBA, GL_FLOAT, &table[0]);
+
+	textureDirty = false;
+}
@@ -0,0 +1,66 @@
+#ifndef GRADIENTSHADER_H
+#define GRADIENTSHADER_H
+
+
+#include "GLShader.h"
+#include "ColorMap.h"
+
+
+/**
+ * @brief A shader that colors geometry by a scalar value using a 1D colormap texture
+ *
+ * GradientShader maps a per-vertex scalar value through a ColorMap that is stored in
+ * a 1D texture. The scalar is normalized by a minimum and maximum value that are passed
+ * to the shader as uniforms, so changing the color range never touches any vertex data.
+ *
+ * The scalar can come from one of two places:
+ * - The z-coordinate of the interleaved position attribute (location 0), which is how
+ * Layer::LoadDataToGPU() packs depth
+ * - A separate scalar attribute stream (location 1), which is how Layer::LoadScalarDataToGPU()
+ * packs per-node values such as water elevation
+ * .
+ *
+ * Elements with a dry Node (a scalar attribute of -99999) are not drawn, so dry areas
+ * show whatever is drawn below them instead of the bottom of the colormap.
+ *
+ */
+class GradientShader : public GLShader
+{
+	public:
+
+		/**
+		 * @brief Defines where the shader reads the scalar value that is mapped to a color
+		 */
+		enum ScalarSource {
+			PositionZ,		/**< Use the z-coordinate of the position attribute */
+			ScalarAttribute		/**< Use the separate scalar attribute stream */
+		};
+
+		GradientShader();
+		~GradientShader();
+
+		void	SetUniforms(UniformColors *colors, UniformValues *values);
+		void	SetScalarSource(ScalarSource newSource);
+
+	protected:
+
+		ColorMap	colorMap;	/**< The color gradient sampled into the colormap texture */
+		ScalarSource	scalarSource;	/**< Where the scalar value is read from */
+		GLfloat		minValue;	/**< The scalar value mapped to the first color stop */
+		GLfloat		maxValue;	/**< The scalar value mapped to the last color stop */
+
+		// OpenGL Variables
+		GLuint	textureID;		/**< The 1D colormap texture ID */
+		bool	textureDirty;		/**< Set to true when the colormap texture needs to be uploaded */
+		GLint	MVPUniform;		/**< Location of the Model-View-Projection Matrix uniform */
+		GLint	MinUniform;		/**< Location of the minimum value uniform */
+		GLint	MaxUniform;		/**< Location of the maximum value uniform */
+		GLint	SourceUniform;		/**< Location of the scalar source uniform */
+		GLint	ColorMapUniform;	/**< Location of the colormap sampler uniform */
+
+		void	CompileShader();
+		void	UpdateUniforms();
+		void	UploadColorMap();
+};
+
+#endif // GRADIENTSHADER_H
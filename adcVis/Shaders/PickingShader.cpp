@@ -0,0 +1,142 @@
+#include "PickingShader.h"
+
+
+/**
+ * @brief Constructor initializes the layer ID to 0 and hard-codes the shader source
+ *
+ * The constructor hard-codes the vertex, geometry and fragment shader source. The
+ * shader program is compiled the first time it is used in the OpenGL context.
+ *
+ */
+PickingShader::PickingShader()
+{
+	layerID = 0;
+
+	uniformsSet = true;
+
+	vertexShaderSource = "#version 330\n"
+			     "layout(location=0) in vec4 in_Position;"
+			     "uniform mat4 MVPMatrix;"
+			     "void main(void)"
+			     "{"
+				     "gl_Position = MVPMatrix*in_Position;"
+			     "}";
+
+	geometryShaderSource = "#version 330\n"
+			       "layout(triangles) in;"
+			       "layout(triangle_strip, max_vertices=3) out;"
+			       "out vec3 ex_Barycentric;"
+			       "void main(void)"
+			       "{"
+				       "gl_Position = gl_in[0].gl_Position;"
+				       "gl_PrimitiveID = gl_PrimitiveIDIn;"
+				       "ex_Barycentric = vec3(1.0, 0.0, 0.0);"
+				       "EmitVertex();"
+				       "gl_Position = gl_in[1].gl_Position;"
+				       "gl_PrimitiveID = gl_PrimitiveIDIn;"
+				       "ex_Barycentric = vec3(0.0, 1.0, 0.0);"
+				       "EmitVertex();"
+				       "gl_Position = gl_in[2].gl_Position;"
+				       "gl_PrimitiveID = gl_PrimitiveIDIn;"
+				       "ex_Barycentric = vec3(0.0, 0.0, 1.0);"
+				       "EmitVertex();"
+				       "EndPrimitive();"
+			       "}";
+
+	fragmentShaderSource = "#version 330\n"
+			       "in vec3 ex_Barycentric;"
+			       "out uvec4 out_ID;"
+			       "uniform uint LayerID;"
+			       "void main(void)"
+			       "{"
+				       "out_ID = uvec4(uint(gl_PrimitiveID) + 1u, LayerID,"
+						      "floatBitsToUint(ex_Barycentric.x),"
+						      "floatBitsToUint(ex_Barycentric.y));"
+			       "}";
+}
+
+
+/**
+ * @brief Does nothing, the picking shader does not use colors or generic values
+ * @param colors Ignored
+ * @param values Ignored
+ */
+void PickingShader::SetUniforms(UniformColors *colors, UniformValues *values)
+{
+	(void)colors;
+	(void)values;
+}
+
+
+/**
+ * @brief Sets the Layer ID that is written into the picking buffer
+ *
+ * This function is called by Layer::DrawPicking() before every draw so that picking
+ * results can be matched back to the Layer that produced them.
+ *
+ * @param newID The ID of the Layer about to be drawn
+ */
+void PickingShader::SetLayerID(unsigned int newID)
+{
+	layerID = newID;
+}
+
+
+/**
+ * @brief Attempts to compile and link the shader program.
+ *
+ * This shader requires a vertex shader, a geometry shader and a fragment shader.
+ * CompileShader attempts to compile and link the shader program from the hard-coded
+ * source. Successful compilation results in a non-zero value for programID and sets
+ * loaded equal to true.
+ *
+ */
+void PickingShader::CompileShader()
+{
+	GLuint vertexShaderID = CompileShaderPart(vertexShaderSource, GL_VERTEX_SHADER);
+	GLuint geometryShaderID = CompileShaderPart(geometryShaderSource, GL_GEOMETRY_SHADER);
+	GLuint fragmentShaderID = CompileShaderPart(fragmentShaderSource, GL_FRAGMENT_SHADER);
+
+	if (vertexShaderID && geometryShaderID && fragmentShaderID)
+	{
+		programID = glCreateProgram();
+		glAttachShader(programID, vertexShaderID);
+		glAttachShader(programID, geometryShaderID);
+		glAttachShader(programID, fragmentShaderID);
+		glLinkProgram(programID);
+		glDeleteShader(vertexShaderID);
+		glDeleteShader(geometryShaderID);
+		glDeleteShader(fragmentShaderID);
+
+		GLint result;
+		glGetProgramiv(programID, GL_LINK_STATUS, &result);
+		if (result == GL_TRUE)
+			loaded = true;
+		else
+			loaded = false;
+
+	}
+}
+
+
+/**
+ * @brief Transfers all shader uniform values to the
+ * shader object in the OpenGL context.
+ *
+ * This function transfers the Model-View-Matrix and the Layer ID to the shader object
+ * in the OpenGL context, only if the shader is in full working order.
+ *
+ */
+void PickingShader::UpdateUniforms()
+{
+	if (uniformsSet && loaded && cameraSet)
+	{
+		glUseProgram(programID);
+
+		GLint MVPUniform = glGetUniformLocation(programID, "MVPMatrix");
+		GLint LayerUniform = glGetUniformLocation(programID, "LayerID");
+
+		glUniformMatrix4fv(MVPUniform, 1, GL_FALSE, camera->MVPMatrix.m);
+		glUniform1ui(LayerUniform, layerID);
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef PICKINGSHADER_H
+#define PICKINGSHADER_H
+
+
+#include "GLShader.h"
+
+
+/**
+ * @brief A shader that writes element and barycentric data into an integer picking buffer
+ *
+ * PickingShader is used to render Layers into a GLPickingBuffer. Instead of a color, every
+ * fragment receives an unsigned integer RGBA value:
+ * - R: The index of the element (the triangle's position in the index buffer) plus one,
+ * so that 0 always means "nothing was drawn here"
+ * - G: The ID of the Layer that was drawn (see Layer::GetID())
+ * - B: The bits of the fragment's barycentric weight for the element's first node
+ * - A: The bits of the fragment's barycentric weight for the element's second node
+ * .
+ *
+ * The barycentric weights are generated by a geometry shader, so the vertex data used
+ * for normal drawing does not need to change.
+ *
+ */
+class PickingShader : public GLShader
+{
+	public:
+
+		PickingShader();
+		void SetUniforms(UniformColors *colors, UniformValues *values);
+		void SetLayerID(unsigned int newID);
+
+	protected:
+
+		GLuint	layerID;	/**< The ID of the Layer currently being drawn */
+
+		void CompileShader();
+		void UpdateUniforms();
+
+		std::string	geometryShaderSource;	/**< Full source code for the geometry shader */
+};
+
+#endif // PICKINGSHADER_H
@@ -0,0 +1,293 @@
+#include "TextShader.h"
+
+#include <vector>
+
+
+// The 5x7 font, one byte per column from left to right, with the top row in bit 0
+static const unsigned char FontColumns[TextShader::NumGlyphs][5] = {
+	{0x00, 0x00, 0x00, 0x00, 0x00},	// ' '
+	{0x00, 0x00, 0x5F, 0x00, 0x00},	// '!'
+	{0x00, 0x07, 0x00, 0x07, 0x00},	// '"'
+	{0x14, 0x7F, 0x14, 0x7F, 0x14},	// '#'
+	{0x24, 0x2A, 0x7F, 0x2A, 0x12},	// '$'
+	{0x23, 0x13, 0x08, 0x64, 0x62},	// '%'
+	{0x36, 0x49, 0x55, 0x22, 0x50},	// '&'
+	{0x00, 0x05, 0x03, 0x00, 0x00},	// '''
+	{0x00, 0x1C, 0x22, 0x41, 0x00},	// '('
+	{0x00, 0x41, 0x22, 0x1C, 0x00},	// ')'
+	{0x14, 0x08, 0x3E, 0x08, 0x14},	// '*'
+	{0x08, 0x08, 0x3E, 0x08, 0x08},	// '+'
+	{0x00, 0x50, 0x30, 0x00, 0x00},	// ','
+	{0x08, 0x08, 0x08, 0x08, 0x08},	// '-'
+	{0x00, 0x60, 0x60, 0x00, 0x00},	// '.'
+	{0x20, 0x10, 0x08, 0x04, 0x02},	// '/'
+	{0x3E, 0x51, 0x49, 0x45, 0x3E},	// '0'
+	{0x00, 0x42, 0x7F, 0x40, 0x00},	// '1'
+	{0x42, 0x61, 0x51, 0x49, 0x46},	// '2'
+	{0x21, 0x41, 0x45, 0x4B, 0x31},	// '3'
+	{0x18, 0x14, 0x12, 0x7F, 0x10},	// '4'
+	{0x27, 0x45, 0x45, 0x45, 0x39},	// '5'
+	{0x3C, 0x4A, 0x49, 0x49, 0x30},	// '6'
+	{0x01, 0x71, 0x09, 0x05, 0x03},	// '7'
+	{0x36, 0x49, 0x49, 0x49, 0x36},	// '8'
+	{0x06, 0x49, 0x49, 0x29, 0x1E},	// '9'
+	{0x00, 0x36, 0x36, 0x00, 0x00},	// ':'
+	{0x00, 0x56, 0x36, 0x00, 0x00},	// ';'
+	{0x08, 0x14, 0x22, 0x41, 0x00},	// '<'
+	{0x14, 0x14, 0x14, 0x14, 0x14},	// '='
+	{0x00, 0x41, 0x22, 0x14, 0x08},	// '>'
+	{0x02, 0x01, 0x51, 0x09, 0x06},	// '?'
+	{0x32, 0x49, 0x79, 0x41, 0x3E},	// '@'
+	{0x7E, 0x11, 0x11, 0x11, 0x7E},	// 'A'
+	{0x7F, 0x49, 0x49, 0x49, 0x36},	// 'B'
+	{0x3E, 0x41, 0x41, 0x41, 0x22},	// 'C'
+	{0x7F, 0x41, 0x41, 0x22, 0x1C},	// 'D'
+	{0x7F, 0x49, 0x49, 0x49, 0x41},	// 'E'
+	{0x7F, 0x09, 0x09, 0x09, 0x01},	// 'F'
+	{0x3E, 0x41, 0x49, 0x49, 0x7A},	// 'G'
+	{0x7F, 0x08, 0x08, 0x08, 0x7F},	// 'H'
+	{0x00, 0x41, 0x7F, 0x41, 0x00},	// 'I'
+	{0x20, 0x40, 0x41, 0x3F, 0x01},	// 'J'
+	{0x7F, 0x08, 0x14, 0x22, 0x41},	// 'K'
+	{0x7F, 0x40, 0x40, 0x40, 0x40},	// 'L'
+	{0x7F, 0x02, 0x0C, 0x02, 0x7F},	// 'M'
+	{0x7F, 0x04, 0x08, 0x10, 0x7F},	// 'N'
+	{0x3E, 0x41, 0x41, 0x41, 0x3E},	// 'O'
+	{0x7F, 0x09, 0x09, 0x09, 0x06},	// 'P'
+	{0x3E, 0x41, 0x51, 0x21, 0x5E},	// 'Q'
+	{0x7F, 0x09, 0x19, 0x29, 0x46},	// 'R'
+	{0x46, 0x49, 0x49, 0x49, 0x31},	// 'S'
+	{0x01, 0x01, 0x7F, 0x01, 0x01},	// 'T'
+	{0x3F, 0x40, 0x40, 0x40, 0x3F},	// 'U'
+	{0x1F, 0x20, 0x40, 0x20, 0x1F},	// 'V'
+	{0x3F, 0x40, 0x38, 0x40, 0x3F},	// 'W'
+	{0x63, 0x14, 0x08, 0x14, 0x63},	// 'X'
+	{0x07, 0x08, 0x70, 0x08, 0x07},	// 'Y'
+	{0x61, 0x51, 0x49, 0x45, 0x43},	// 'Z'
+	{0x00, 0x7F, 0x41, 0x41, 0x00},	// '['
+	{0x02, 0x04, 0x08, 0x10, 0x20},	// '\'
+	{0x00, 0x41, 0x41, 0x7F, 0x00},	// ']'
+	{0x04, 0x02, 0x01, 0x02, 0x04},	// '^'
+	{0x40, 0x40, 0x40, 0x40, 0x40},	// '_'
+	{0x00, 0x01, 0x02, 0x04, 0x00},	// '`'
+	{0x20, 0x54, 0x54, 0x54, 0x78},	// 'a'
+	{0x7F, 0x48, 0x44, 0x44, 0x38},	// 'b'
+	{0x38, 0x44, 0x44, 0x44, 0x20},	// 'c'
+	{0x38, 0x44, 0x44, 0x48, 0x7F},	// 'd'
+	{0x38, 0x54, 0x54, 0x54, 0x18},	// 'e'
+	{0x08, 0x7E, 0x09, 0x01, 0x02},	// 'f'
+	{0x0C, 0x52, 0x52, 0x52, 0x3E},	// 'g'
+	{0x7F, 0x08, 0x04, 0x04, 0x78},	// 'h'
+	{0x00, 0x44, 0x7D, 0x40, 0x00},	// 'i'
+	{0x20, 0x40, 0x44, 0x3D, 0x00},	// 'j'
+	{0x7F, 0x10, 0x28, 0x44, 0x00},	// 'k'
+	{0x00, 0x41, 0x7F, 0x40, 0x00},	// 'l'
+	{0x7C, 0x04, 0x18, 0x04, 0x78},	// 'm'
+	{0x7C, 0x08, 0x04, 0x04, 0x78},	// 'n'
+	{0x38, 0x44, 0x44, 0x44, 0x38},	// 'o'
+	{0x7C, 0x14, 0x14, 0x14, 0x08},	// 'p'
+	{0x08, 0x14, 0x14, 0x18, 0x7C},	// 'q'
+	{0x7C, 0x08, 0x04, 0x04, 0x08},	// 'r'
+	{0x48, 0x54, 0x54, 0x54, 0x20},	// 's'
+	{0x04, 0x3F, 0x44, 0x40, 0x20},	// 't'
+	{0x3C, 0x40, 0x40, 0x20, 0x7C},	// 'u'
+	{0x1C, 0x20, 0x40, 0x20, 0x1C},	// 'v'
+	{0x3C, 0x40, 0x30, 0x40, 0x3C},	// 'w'
+	{0x44, 0x28, 0x10, 0x28, 0x44},	// 'x'
+	{0x0C, 0x50, 0x50, 0x50, 0x3C},	// 'y'
+	{0x44, 0x64, 0x54, 0x4C, 0x44},	// 'z'
+	{0x00, 0x08, 0x36, 0x41, 0x00},	// '{'
+	{0x00, 0x00, 0x7F, 0x00, 0x00},	// '|'
+	{0x00, 0x41, 0x36, 0x08, 0x00},	// '}'
+	{0x08, 0x04, 0x08, 0x10, 0x08}	// '~'
+};
+
+
+/**
+ * @brief Constructor initializes the text color to white on a translucent black
+ * background and hard-codes the shader source
+ *
+ * The shader program is compiled and the font texture is created the first time the
+ * shader is used in the OpenGL context.
+ *
+ */
+TextShader::TextShader()
+{
+	textColor[0] = 1.0;
+	textColor[1] = 1.0;
+	textColor[2] = 1.0;
+	textColor[3] = 1.0;
+	backgroundColor[0] = 0.0;
+	backgroundColor[1] = 0.0;
+	backgroundColor[2] = 0.0;
+	backgroundColor[3] = 0.6;
+	viewportSize[0] = 1.0;
+	viewportSize[1] = 1.0;
+	textureID = 0;
+
+	uniformsSet = true;
+
+	vertexShaderSource = "#version 330\n"
+			     "layout(location=0) in vec4 in_Position;"
+			     "out vec2 ex_Texel;"
+			     "uniform vec2 ViewportSize;"
+			     "void main(void)"
+			     "{"
+				     "gl_Position = vec4(2.0*in_Position.x/ViewportSize.x - 1.0, 1.0 - 2.0*in_Position.y/ViewportSize.y, 0.0, 1.0);"
+				     "ex_Texel = in_Position.zw;"
+			     "}";
+
+	fragmentShaderSource = "#version 330\n"
+			       "in vec2 ex_Texel;"
+			       "out vec4 out_Color;"
+			       "uniform sampler2D Font;"
+			       "uniform vec4 TextColor;"
+			       "uniform vec4 BackgroundColor;"
+			       "void main(void)"
+			       "{"
+				       "float coverage = texelFetch(Font, ivec2(floor(ex_Texel)), 0).r;"
+				       "out_Color = mix(BackgroundColor, TextColor, coverage);"
+			       "}";
+}
+
+
+/**
+ * @brief Deconstructor that deletes the font texture from the OpenGL context
+ */
+TextShader::~TextShader()
+{
+	if (textureID)
+		glDeleteTextures(1, &textureID);
+}
+
+
+/**
+ * @brief Sets the colors used by the shader.
+ *
+ * Color1 in the UniformColors struct is the text color and Color2 is the background
+ * color. Use an alpha below 1.0 with blending enabled to see the scene through the
+ * background.
+ *
+ * @param colors The UniformColors struct with updated values
+ * @param values Ignored
+ */
+void TextShader::SetUniforms(UniformColors *colors, UniformValues *values)
+{
+	(void)values;
+	if (colors != 0)
+	{
+		for (int i=0; i<4; i++)
+		{
+			if (colors->Color1[i] != -1.0)
+				textColor[i] = colors->Color1[i];
+			if (colors->Color2[i] != -1.0)
+				backgroundColor[i] = colors->Color2[i];
+		}
+	}
+}
+
+
+/**
+ * @brief Sets the size of the viewport that vertex positions are given in
+ *
+ * This function should be called before every draw, since the shader does not follow the
+ * camera's window size.
+ *
+ * @param width The width of the viewport in pixels
+ * @param height The height of the viewport in pixels
+ */
+void TextShader::SetViewportSize(int width, int height)
+{
+	viewportSize[0] = width > 0 ? width : 1;
+	viewportSize[1] = height > 0 ? height : 1;
+}
+
+
+/**
+ * @brief Attempts to compile and link the shader program.
+ *
+ * This shader only requires a vertex shader and a fragment shader. CompileShader attempts
+ * to compile and link the shader program from the hard-coded source. Successful compilation
+ * results in a non-zero value for programID and sets loaded equal to true.
+ *
+ */
+void TextShader::CompileShader()
+{
+	GLuint vertexShaderID = CompileShaderPart(vertexShaderSource, GL_VERTEX_SHADER);
+	GLuint fragmentShaderID = CompileShaderPart(fragmentShaderSource, GL_FRAGMENT_SHADER);
+
+	if (vertexShaderID && fragmentShaderID)
+	{
+		programID = glCreateProgram();
+		glAttachShader(programID, vertexShaderID);
+		glAttachShader(programID, fragmentShaderID);
+		glLinkProgram(programID);
+		glDeleteShader(vertexShaderID);
+		glDeleteShader(fragmentShaderID);
+
+		GLint result;
+		glGetProgramiv(programID, GL_LINK_STATUS, &result);
+		if (result == GL_TRUE)
+			loaded = true;
+		else
+			loaded = false;
+
+	}
+}
+
+
+/**
+ * @brief Transfers all shader uniform values to the
+ * shader object in the OpenGL context.
+ *
+ * This function creates the font texture if needed, binds it to texture unit 0 and
+ * transfers the viewport size and colors to the shader object in the OpenGL context,
+ * only if the shader is in full working order.
+ *
+ */
+void TextShader::UpdateUniforms()
+{
+	if (uniformsSet && loaded && cameraSet)
+	{
+		glUseProgram(programID);
+
+		if (textureID == 0)
+			UploadFont();
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+
+		glUniform2fv(glGetUniformLocation(programID, "ViewportSize"), 1, viewportSize);
+		glUniform4fv(glGetUniformLocation(programID, "TextColor"), 1, textColor);
+		glUniform4fv(glGetUniformLocation(programID, "BackgroundColor"), 1, backgroundColor);
+		glUniform1i(glGetUniformLocation(programID, "Font"), 0);
+	}
+}
+
+
+/**
+ * @brief Expands the font into a single channel texture with one row of character cells
+ *
+ * Texel row 0 is the top row of the cells. The last column and row of every cell are left
+ * empty to space the characters apart.
+ *
+ */
+void TextShader::UploadFont()
+{
+	const int TextureWidth = NumGlyphs*GlyphWidth;
+	std::vector<unsigned char> texels (TextureWidth*GlyphHeight, 0);
+	for (int glyph=0; glyph<NumGlyphs; glyph++)
+		for (int column=0; column<5; column++)
+			for (int row=0; row<7; row++)
+				if (FontColumns[glyph][column] & (1 << row))
+					texels[row*TextureWidth + glyph*GlyphWidth + column] = 255;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, TextureWidth, GlyphHeight, 0, GL_RED, GL_UNSIGNED_BYTE, &texels[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,50 @@
+#ifndef TEXTSHADER_H
+#define TEXTSHADER_H
+
+
+#include "GLShader.h"
+
+
+/**
+ * @brief A shader that draws text from a built-in bitmap font in window pixels
+ *
+ * TextShader is used to draw text on top of a scene, such as the GLProfiler HUD. It does
+ * not use the camera's Model-View-Projection Matrix. Instead, vertex attribute 0 holds:
+ * - x, y: The position in pixels from the top left corner of the viewport
+ * - u, v: The position in texels of the font texture
+ * .
+ *
+ * The font is a fixed-width 5x7 pixel font covering printable ASCII, stored in one row
+ * of cells that are GlyphWidth by GlyphHeight texels, so the cell of character c starts
+ * at u = (c - FirstGlyph)*GlyphWidth. Every texel of a cell is drawn, in the text color
+ * where the glyph is set and in the background color everywhere else, so a block of text
+ * is drawn on a solid background without a separate pass.
+ *
+ */
+class TextShader : public GLShader
+{
+	public:
+
+		TextShader();
+		~TextShader();
+		void SetUniforms(UniformColors *colors, UniformValues *values);
+		void SetViewportSize(int width, int height);
+
+		static const int	GlyphWidth = 6;		/**< The width of a character cell in texels */
+		static const int	GlyphHeight = 8;	/**< The height of a character cell in texels */
+		static const int	FirstGlyph = 32;	/**< The first character in the font (space) */
+		static const int	NumGlyphs = 95;		/**< The number of characters in the font */
+
+	protected:
+
+		GLfloat		textColor[4];		/**< RGBA color of the characters (0.0 - 1.0) */
+		GLfloat		backgroundColor[4];	/**< RGBA color behind the characters (0.0 - 1.0) */
+		GLfloat		viewportSize[2];	/**< The size of the viewport in pixels */
+		GLuint		textureID;		/**< The font texture ID */
+
+		void CompileShader();
+		void UpdateUniforms();
+		void UploadFont();
+};
+
+#endif // TEXTSHADER_H
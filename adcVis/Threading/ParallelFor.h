@@ -0,0 +1,62 @@
+/** @file */
+
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief Returns the number of threads used by ParallelFor()
+ * @return The number of hardware threads, or 1 if it cannot be determined
+ */
+inline unsigned int GetNumThreads()
+{
+	unsigned int numThreads = std::thread::hardware_concurrency();
+	return numThreads > 0 ? numThreads : 1;
+}
+
+
+/**
+ * @brief Splits the range [0, count) into contiguous blocks and processes each block
+ * on its own thread
+ *
+ * The function is called as function(first, last) once per block, where [first, last)
+ * is the block's part of the range. The range is split into at most GetNumThreads()
+ * blocks, and no block is smaller than minBlockSize unless the whole range is. The first
+ * block runs on the calling thread, and this function returns once all blocks are done.
+ *
+ * Blocks are processed concurrently, so the function must only write to data that
+ * belongs to its own block.
+ *
+ * @param count The number of items in the range
+ * @param minBlockSize The smallest number of items worth giving to a thread
+ * @param function The function called for every block
+ */
+template <typename Function>
+void ParallelFor(size_t count, size_t minBlockSize, Function function)
+{
+	if (count == 0)
+		return;
+
+	size_t numBlocks = minBlockSize > 0 ? count/minBlockSize : count;
+	if (numBlocks > GetNumThreads())
+		numBlocks = GetNumThreads();
+	if (numBlocks <= 1)
+	{
+		function((size_t)0, count);
+		return;
+	}
+
+	size_t blockSize = (count + numBlocks - 1)/numBlocks;
+	std::vector<std::thread> threads;
+	for (size_t first=blockSize; first<count; first+=blockSize)
+		threads.push_back(std::thread(function, first, first+blockSize < count ? first+blockSize : count));
+	function((size_t)0, blockSize);
+
+	for (unsigned int i=0; i<threads.size(); i++)
+		threads[i].join();
+}
+
+#endif // PARALLELFOR_H
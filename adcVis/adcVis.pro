@@ -8,7 +8,9 @@ QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-LIBS += -lGLEW -lGLU -lGL
+CONFIG += c++11 thread
+
+LIBS += -lGLEW -lGLU -lGL -lpng -lz
 
 TARGET = adcVis
 TEMPLATE = app
@@ -22,8 +24,37 @@ SOURCES += main.cpp\
     Shaders/DefaultShader.cpp \
     Layers/Layer.cpp \
     Layers/TerrainLayer.cpp \
+    Layers/ScalarLayer.cpp \
     IO/FileReader.cpp \
-    Layers/Quadtree.cpp
+    Layers/Quadtree.cpp \
+    Layers/NodeGrid.cpp \
+    Layers/NodePicker.cpp \
+    Shaders/ColorMap.cpp \
+    Shaders/GradientShader.cpp \
+    Shaders/PickingShader.cpp \
+    OpenGL/GLPickingBuffer.cpp \
+    Layers/SelectionSet.cpp \
+    OpenGL/GLScene.cpp \
+    Layers/MeshDecimator.cpp \
+    IO/ChunkedMeshFile.cpp \
+    IO/GlobalOutputFile.cpp \
+    IO/TimestepPrefetcher.cpp \
+    IO/QuantizedTimestepStore.cpp \
+    IO/TimeSeriesCache.cpp \
+    IO/ChunkedOutputFile.cpp \
+    IO/OutputStatistics.cpp \
+    IO/TemporalRangeIndex.cpp \
+    OpenGL/GLResidencyManager.cpp \
+    Layers/ChunkedTerrainLayer.cpp \
+    IO/ImageWriter.cpp \
+    OpenGL/GLFrameExporter.cpp \
+    OpenGL/GLProfiler.cpp \
+    OpenGL/GLTextOverlay.cpp \
+    OpenGL/GLCameraPath.cpp \
+    OpenGL/GLRenderBenchmark.cpp \
+    Shaders/TextShader.cpp \
+    Rasterizer/MeshRasterizer.cpp \
+    Rasterizer/RasterFrameExporter.cpp
 
 HEADERS  += MainWindow.h \
     Shaders/GLShader.h \
@@ -36,10 +67,66 @@ HEADERS  += MainWindow.h \
     Shaders/DefaultShader.h \
     Layers/Layer.h \
     Layers/TerrainLayer.h \
+    Layers/ScalarLayer.h \
     IO/FileReader.h \
-    Layers/Quadtree.h
+    Layers/Quadtree.h \
+    Layers/NodeGrid.h \
+    Layers/NodePicker.h \
+    Shaders/ColorMap.h \
+    Shaders/GradientShader.h \
+    Shaders/PickingShader.h \
+    OpenGL/GLPickingBuffer.h \
+    Layers/SelectionSet.h \
+    Threading/ParallelFor.h \
+    OpenGL/GLScene.h \
+    Layers/MeshDecimator.h \
+    IO/ChunkedMeshFile.h \
+    IO/GlobalOutputFile.h \
+    IO/TimestepPrefetcher.h \
+    IO/QuantizedTimestepStore.h \
+    IO/TimeSeriesCache.h \
+    IO/ChunkedOutputFile.h \
+    IO/OutputStatistics.h \
+    IO/TemporalRangeIndex.h \
+    OpenGL/GLResidencyManager.h \
+    Layers/ChunkedTerrainLayer.h \
+    IO/ImageWriter.h \
+    OpenGL/GLFrameExporter.h \
+    OpenGL/GLProfiler.h \
+    OpenGL/GLTextOverlay.h \
+    OpenGL/GLCameraPath.h \
+    OpenGL/GLRenderBenchmark.h \
+    Shaders/TextShader.h \
+    IO/TraceWriter.h \
+    Rasterizer/MeshRasterizer.h \
+    Rasterizer/RasterFrameExporter.h
 
 FORMS    += MainWindow.ui
 
+# Build with "qmake CONFIG+=headless" to add the --headless batch export mode, which
+# renders through EGL and does not need a display
+headless {
+    DEFINES += ADCVIS_HEADLESS
+    LIBS += -lEGL
+    SOURCES += OpenGL/GLHeadlessContext.cpp
+    HEADERS += OpenGL/GLHeadlessContext.h
+}
+
+# Build with "qmake CONFIG+=trace" to compile in the TRACE_SCOPE markers and the
+# --trace <file> option, which writes a Chrome trace of startup and rendering
+trace {
+    DEFINES += ADCVIS_TRACE
+    SOURCES += IO/TraceWriter.cpp
+}
+
+# Build with "qmake CONFIG+=netcdf" to read ADCIRC NetCDF output (fort.63.nc, fort.64.nc)
+# with the local libnetcdf
+netcdf {
+    DEFINES += ADCVIS_NETCDF
+    LIBS += -lnetcdf
+    SOURCES += IO/NetcdfOutputFile.cpp
+    HEADERS += IO/NetcdfOutputFile.h
+}
+
 OTHER_FILES += \
     docConfig
@@ -1,11 +1,560 @@
 #include "MainWindow.h"
+#include "IO/TraceWriter.h"
 #include <QApplication>
+#include <string.h>
+
+#ifdef ADCVIS_HEADLESS
+#include "OpenGL/GLHeadlessContext.h"
+#include "OpenGL/GLFrameExporter.h"
+#include "OpenGL/GLRenderBenchmark.h"
+#include "Rasterizer/RasterFrameExporter.h"
+#include "Layers/ScalarLayer.h"
+#include "Shaders/DefaultShader.h"
+#include "Shaders/GradientShader.h"
+#include "IO/GlobalOutputFile.h"
+#include "IO/TimestepPrefetcher.h"
+#include "Threading/ParallelFor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+
+/**
+ * @brief The command line options of the headless mode
+ */
+struct HeadlessOptions {
+		std::string	fort14;		/**< The fort.14 file */
+		std::string	fort63;		/**< The output file drawn on the mesh, or empty to draw the mesh only */
+		std::string	pattern;	/**< The printf-style pattern of the frame files */
+		std::string	profile;	/**< The CSV file that receives the profiler timings, or empty */
+		std::string	benchmarkPath;	/**< The camera path to benchmark, or empty to export frames */
+		std::string	report;		/**< The CSV file that receives the benchmark measurements, or empty */
+		int		warmup;		/**< The benchmark frames dropped before measuring */
+		int		width;		/**< The frame width in pixels */
+		int		height;		/**< The frame height in pixels */
+		int		first;		/**< The first exported timestep */
+		int		last;		/**< The last exported timestep */
+		int		stride;		/**< The number of timesteps between exported frames */
+		unsigned int	threads;	/**< The number of PNG encoding threads, or 0 for one per core */
+		int		compression;	/**< The PNG compression level */
+		bool		llvmpipe;	/**< Ask Mesa for its llvmpipe OpenGL driver, this is not the CPU rasterizer (see cpu) */
+		bool		cpu;		/**< Draw with a MeshRasterizer instead of OpenGL */
+		bool		compare;	/**< Draw every frame with OpenGL and a MeshRasterizer and count the pixels that differ */
+		bool		fixedRange;	/**< Color every timestep with colorMin and colorMax */
+		float		colorMin;	/**< The value mapped to the lowest color */
+		float		colorMax;	/**< The value mapped to the highest color */
+};
+
+
+/**
+ * @brief Prints the command line options of the headless mode
+ */
+static void PrintHeadlessUsage(const char *program)
+{
+	fprintf(stderr, "Usage: %s --headless --fort14 <file> --output <pattern> [options]\n"
+			"  --output <pattern>         file pattern with one integer conversion that receives the timestep, eg. frame_%%05d.png\n"
+			"  --fort63 <file>            color the mesh by an output file (fort.63, or the speed of a fort.64)\n"
+			"  --range <min:max>          color range of the output file (default the range of the first frame)\n"
+			"  --size <width>x<height>    frame size in pixels (default 1920x1080)\n"
+			"  --timesteps <first:last[:stride]>  timesteps to render (default 0:0)\n"
+			"  --threads <n>              PNG encoding threads (default one per core)\n"
+			"  --compression <0-9>        PNG compression level (default 1)\n"
+			"  --cpu                      draw with the CPU rasterizer instead of OpenGL (used when no OpenGL context can be created)\n"
+			"  --llvmpipe                 force Mesa's llvmpipe OpenGL driver, not the CPU rasterizer (see --cpu)\n"
+			"  --compare                  draw every timestep with OpenGL and the CPU rasterizer and print the pixels that differ, instead of exporting\n"
+			"                             (with --fort63, again with every 7th node dry)\n"
+			"  --profile <file>           write per-layer CPU/GPU timings of every frame to a CSV file\n"
+			"  --benchmark <path>         replay a camera path file (or \"default\") instead of exporting, and print frame time percentiles\n"
+			"  --report <file>            write the per-frame benchmark measurements to a CSV file\n"
+			"  --warmup <n>               benchmark frames rendered and dropped before measuring (default 3)\n", program);
+}
+
+
+/**
+ * @brief Checks that a frame file pattern can be passed to snprintf() with one timestep
+ *
+ * The pattern must contain exactly one integer conversion (eg. %05d), with optional flags,
+ * width and precision. The only other % allowed is %% for a percent sign.
+ *
+ * @param pattern The pattern given with --output
+ * @return true if the pattern is safe to use
+ * @return false otherwise
+ */
+static bool IsFramePattern(std::string pattern)
+{
+	int conversions = 0;
+	for (size_t i=0; i<pattern.size(); i++)
+	{
+		if (pattern[i] != '%')
+			continue;
+		if (i+1 < pattern.size() && pattern[i+1] == '%')
+		{
+			i++;
+			continue;
+		}
+
+		i++;
+		while (i < pattern.size() && strchr("-+ 0#", pattern[i]))
+			i++;
+		while (i < pattern.size() && isdigit((unsigned char)pattern[i]))
+			i++;
+		if (i < pattern.size() && pattern[i] == '.')
+			i++;
+		while (i < pattern.size() && isdigit((unsigned char)pattern[i]))
+			i++;
+		if (i >= pattern.size() || !strchr("diuoxX", pattern[i]))
+			return false;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+
+/**
+ * @brief Counts the pixels of two RGBA images that differ by more than a tolerance
+ * @param a The first image
+ * @param b The second image
+ * @param numPixels The number of pixels in each image
+ * @param tolerance The largest difference allowed in any channel
+ * @return The number of pixels that have a channel that differs by more than the tolerance
+ */
+static unsigned int CountDifferentPixels(const unsigned char *a, const unsigned char *b, size_t numPixels, int tolerance)
+{
+	unsigned int count = 0;
+	for (size_t i=0; i<numPixels; i++)
+	{
+		for (int c=0; c<4; c++)
+		{
+			if (abs((int)a[4*i+c] - (int)b[4*i+c]) > tolerance)
+			{
+				count++;
+				break;
+			}
+		}
+	}
+	return count;
+}
+
+
+/**
+ * @brief Draws every timestep with OpenGL and with a MeshRasterizer and prints how many
+ * pixels differ
+ *
+ * A pixel differs if any of its channels differs by more than 8, which allows for the
+ * rounding of colors and color map lookups.
+ *
+ * With an output file, every timestep is drawn a second time with every 7th Node set to
+ * -99999, so that the dry Elements are compared as well.
+ *
+ * @param options The command line options
+ * @param exporter The OpenGL exporter, with its size and scene set
+ * @param rasterExporter The MeshRasterizer exporter, drawing the same Layers
+ * @param rasterizer The rasterizer used by rasterExporter
+ * @param layers The Layers that change with the timestep
+ * @param terrain The Layer colored by the output file
+ * @return 0 if every frame was drawn by both
+ * @return 1 if an error occurred
+ */
+static int CompareBackends(HeadlessOptions *options, GLFrameExporter *exporter, RasterFrameExporter *rasterExporter,
+			   MeshRasterizer *rasterizer, std::vector<Layer*> *layers, ScalarLayer *terrain)
+{
+	const size_t NumPixels = (size_t)rasterizer->GetWidth()*rasterizer->GetHeight();
+	std::vector<unsigned char> glPixels;
+	std::vector<float> dryValues;
+	for (int timestep=options->first; timestep<=options->last; timestep+=(options->stride > 0 ? options->stride : 1))
+	{
+		for (unsigned int i=0; i<layers->size(); i++)
+			layers->at(i)->UpdateTimestep(timestep);
+
+		for (int pass=0; pass<(options->fort63.empty() ? 1 : 2); pass++)
+		{
+			if (pass == 1)
+			{
+				dryValues.resize(terrain->GetNumNodes());
+				for (unsigned int i=0; i<dryValues.size(); i++)
+					dryValues[i] = i % 7 == 0 ? -99999.0 : terrain->GetValue(i+1);
+				terrain->SetValues(&dryValues[0], dryValues.size(), terrain->GetMinValue(), terrain->GetMaxValue());
+			}
+
+			if (exporter->ReadFrame(&glPixels) != 0 || rasterExporter->Render() != 0)
+			{
+				fprintf(stderr, "Unable to draw timestep %i\n", timestep);
+				return 1;
+			}
+			printf("Timestep %i%s: %u of %lu pixels differ\n", timestep, pass == 1 ? " with every 7th Node dry" : "",
+			       CountDifferentPixels(&glPixels[0], rasterizer->GetPixels(), NumPixels, 8), (unsigned long)NumPixels);
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Builds the Layer and shader stack and renders every frame
+ *
+ * The mesh is drawn with the same shaders as the interactive viewer. If an output file
+ * was given, the mesh is colored by it instead, with a ScalarLayer that loads every
+ * frame's timestep from a TimestepPrefetcher.
+ *
+ * Without an OpenGL context, the Layers are software only and every frame is drawn by a
+ * MeshRasterizer with the same colors as the shaders.
+ *
+ * @param options The command line options
+ * @param context The current headless context, or 0 to draw with the CPU rasterizer
+ * @param path The camera path to benchmark, used if options->benchmarkPath is set, and
+ * filled with the default path if it is "default"
+ * @return 0 if every frame was rendered
+ * @return 1 if an error occurred
+ */
+static int RenderHeadless(HeadlessOptions *options, GLHeadlessContext *context, GLCameraPath *path)
+{
+	GlobalOutputFile outputFile;
+	TimestepPrefetcher prefetcher;
+	if (!options->fort63.empty())
+	{
+		if (outputFile.Open(options->fort63) != 0 || outputFile.GetNumTimesteps() == 0)
+		{
+			fprintf(stderr, "Unable to read %s\n", options->fort63.data());
+			return 1;
+		}
+		if (options->benchmarkPath.empty() && (options->first < 0 || options->last >= (int)outputFile.GetNumTimesteps()))
+		{
+			fprintf(stderr, "%s has timesteps 0 to %u\n", options->fort63.data(), outputFile.GetNumTimesteps()-1);
+			return 1;
+		}
+	}
+
+	GLCamera camera;
+	DefaultShader fillShader, outlineShader;
+	GradientShader gradientShader;
+	UniformColors fillColors, outlineColors;
+	fillColors.Color1[0] = 0.1;
+	fillColors.Color1[1] = 0.8;
+	fillColors.Color1[2] = 0.1;
+	fillColors.Color1[3] = 1.0;
+	outlineColors.Color1[0] = 0.2;
+	outlineColors.Color1[1] = 0.2;
+	outlineColors.Color1[2] = 0.2;
+	outlineColors.Color1[3] = 1.0;
+	fillShader.SetUniforms(&fillColors, 0);
+	outlineShader.SetUniforms(&outlineColors, 0);
+	fillShader.SetCamera(&camera);
+	outlineShader.SetCamera(&camera);
+	gradientShader.SetScalarSource(GradientShader::ScalarAttribute);
+	gradientShader.SetCamera(&camera);
+
+	ScalarLayer terrain;
+	terrain.SetSoftwareOnly(context == 0);
+	terrain.SetFillShader(outputFile.IsOpen() ? (GLShader*)&gradientShader : (GLShader*)&fillShader);
+	terrain.SetOutlineShader(&outlineShader);
+	if (terrain.SetFort14Location(options->fort14) != 0)
+	{
+		fprintf(stderr, "Unable to load %s\n", options->fort14.data());
+		return 1;
+	}
+
+	if (outputFile.IsOpen())
+	{
+		if (outputFile.GetNumNodes() != terrain.GetNumNodes())
+		{
+			fprintf(stderr, "%s does not match the nodes of %s\n", options->fort63.data(), options->fort14.data());
+			return 1;
+		}
+		prefetcher.Start(&outputFile, 8, GetNumThreads());
+		if (options->fixedRange)
+			terrain.SetTimestepSource(&prefetcher, options->colorMin, options->colorMax);
+		else
+			terrain.SetTimestepSource(&prefetcher);
+	}
+
+	camera.SetWindowSize(options->width, options->height);
+	camera.SetDepthRange(terrain.GetMinZ() - 1.0, terrain.GetMaxZ() + 1.0);
+	camera.FitBounds(terrain.GetMinX(), terrain.GetMaxX(), terrain.GetMinY(), terrain.GetMaxY());
+
+	GLScene scene;
+	scene.SetCamera(&camera);
+	scene.SetClearColor(1.0, 1.0, 1.0, 1.0);
+	scene.AddLayer(&terrain);
+
+	std::vector<Layer*> layers;
+	layers.push_back(&terrain);
+
+	// The rasterizer draws with the colors of the shaders and the scene, the highlight is
+	// the default picking color of a TerrainLayer
+	MeshRasterizer rasterizer;
+	rasterizer.SetSize(options->width, options->height);
+	rasterizer.SetCamera(&camera);
+	rasterizer.SetFillColor(fillColors.Color1[0], fillColors.Color1[1], fillColors.Color1[2], fillColors.Color1[3]);
+	rasterizer.SetWireframe(true, outlineColors.Color1[0], outlineColors.Color1[1], outlineColors.Color1[2], outlineColors.Color1[3]);
+	rasterizer.SetHighlightColor(1.0, 1.0, 1.0, 1.0);
+	RasterFrameExporter rasterExporter;
+	rasterExporter.SetRasterizer(&rasterizer);
+	rasterExporter.SetClearColor(1.0, 1.0, 1.0, 1.0);
+	rasterExporter.AddLayer(&terrain);
+
+	int result = 1;
+	if (context == 0)
+	{
+		ImageWriter writer;
+		writer.SetCompressionLevel(options->compression);
+		if (writer.Start(options->threads, 0) == 0)
+		{
+			rasterExporter.SetImageWriter(&writer);
+			int errors = rasterExporter.ExportTimesteps(&layers, options->first, options->last, options->stride, options->pattern);
+			writer.Finish();
+			if (errors > 0)
+				fprintf(stderr, "%i frames could not be written\n", errors);
+			result = errors > 0 ? 1 : 0;
+		}
+	} else if (options->compare) {
+		GLFrameExporter exporter;
+		if (exporter.SetSize(options->width, options->height) == 0)
+		{
+			exporter.SetScene(&scene);
+			result = CompareBackends(options, &exporter, &rasterExporter, &rasterizer, &layers, &terrain);
+		}
+	} else if (!options->benchmarkPath.empty()) {
+		if (options->benchmarkPath == "default")
+			path->LoadDefault(outputFile.IsOpen() ? outputFile.GetNumTimesteps() : 0);
+		for (unsigned int i=0; i<path->GetNumSteps() && !outputFile.IsOpen(); i++)
+			if (path->GetStep(i)->type == GLCameraPath::TimestepStep)
+			{
+				fprintf(stderr, "Timestep steps do not change anything without --fort63\n");
+				break;
+			}
+
+		GLRenderBenchmark benchmark;
+		benchmark.SetWarmupFrames(options->warmup);
+		if (benchmark.SetSize(options->width, options->height) == 0)
+		{
+			benchmark.SetScene(&scene);
+			result = benchmark.Run(path, &camera, &layers);
+
+			std::vector<std::string> lines;
+			benchmark.GetReport(&lines);
+			printf("Renderer: %s\n", context->GetRenderer());
+			for (unsigned int i=0; i<lines.size(); i++)
+				printf("%s\n", lines[i].data());
+			if (!options->report.empty() && benchmark.WriteCSV(options->report) != 0)
+			{
+				fprintf(stderr, "Unable to write %s\n", options->report.data());
+				result = 1;
+			}
+		}
+	} else {
+		ImageWriter writer;
+		writer.SetCompressionLevel(options->compression);
+		GLFrameExporter exporter;
+		if (writer.Start(options->threads, 0) == 0 && exporter.SetSize(options->width, options->height) == 0)
+		{
+			exporter.SetScene(&scene);
+			exporter.SetImageWriter(&writer);
+
+			int errors = exporter.ExportTimesteps(&layers, options->first, options->last, options->stride, options->pattern);
+			writer.Finish();
+			if (errors > 0)
+				fprintf(stderr, "%i frames could not be written\n", errors);
+			result = errors > 0 ? 1 : 0;
+		}
+	}
+
+	terrain.SetTimestepSource(0);
+	prefetcher.Stop();
+	return result;
+}
+
+
+/**
+ * @brief Renders a range of timesteps to image files without a window
+ *
+ * Builds the same Layer and shader stack as the interactive viewer against a
+ * GLHeadlessContext, then exports every frame through a GLFrameExporter. With --fort63,
+ * every frame shows its own timestep of the output file. With --cpu, or when no OpenGL
+ * context can be created, frames are drawn by a MeshRasterizer instead.
+ *
+ * @return 0 if every frame was written
+ * @return 1 if an error occurred
+ */
+static int RunHeadless(int argc, char *argv[])
+{
+	HeadlessOptions options;
+	options.warmup = 3;
+	options.width = 1920;
+	options.height = 1080;
+	options.first = 0;
+	options.last = 0;
+	options.stride = 1;
+	options.threads = 0;
+	options.compression = 1;
+	options.llvmpipe = false;
+	options.cpu = false;
+	options.compare = false;
+	options.fixedRange = false;
+	options.colorMin = 0.0;
+	options.colorMax = 0.0;
+
+	for (int i=1; i<argc; i++)
+	{
+		bool hasValue = i+1 < argc;
+		if (strcmp(argv[i], "--headless") == 0)
+			continue;
+		else if (strcmp(argv[i], "--fort14") == 0 && hasValue)
+			options.fort14 = argv[++i];
+		else if (strcmp(argv[i], "--fort63") == 0 && hasValue)
+			options.fort63 = argv[++i];
+		else if (strcmp(argv[i], "--range") == 0 && hasValue)
+			options.fixedRange = sscanf(argv[++i], "%f:%f", &options.colorMin, &options.colorMax) == 2;
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+			options.pattern = argv[++i];
+		else if (strcmp(argv[i], "--size") == 0 && hasValue)
+			sscanf(argv[++i], "%dx%d", &options.width, &options.height);
+		else if (strcmp(argv[i], "--timesteps") == 0 && hasValue)
+		{
+			if (sscanf(argv[++i], "%d:%d:%d", &options.first, &options.last, &options.stride) < 2)
+				options.last = options.first;
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--compression") == 0 && hasValue)
+			options.compression = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--llvmpipe") == 0)
+			options.llvmpipe = true;
+		else if (strcmp(argv[i], "--cpu") == 0)
+			options.cpu = true;
+		else if (strcmp(argv[i], "--compare") == 0)
+			options.compare = true;
+		else if (strcmp(argv[i], "--profile") == 0 && hasValue)
+			options.profile = argv[++i];
+		else if (strcmp(argv[i], "--benchmark") == 0 && hasValue)
+			options.benchmarkPath = argv[++i];
+		else if (strcmp(argv[i], "--report") == 0 && hasValue)
+			options.report = argv[++i];
+		else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+			options.warmup = atoi(argv[++i]);
+		else
+		{
+			PrintHeadlessUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (options.fort14.empty() || (options.pattern.empty() && options.benchmarkPath.empty() && !options.compare) ||
+	    options.width <= 0 || options.height <= 0 || options.warmup < 0)
+	{
+		PrintHeadlessUsage(argv[0]);
+		return 1;
+	}
+
+	// The pattern is used as a format string, so it must take exactly one timestep
+	if (!options.pattern.empty() && !IsFramePattern(options.pattern))
+	{
+		fprintf(stderr, "The output pattern must contain exactly one integer conversion (eg. %%05d) and no other %% except %%%%\n");
+		PrintHeadlessUsage(argv[0]);
+		return 1;
+	}
+
+	// Benchmarks and comparisons measure the OpenGL path
+	if (options.cpu && (!options.benchmarkPath.empty() || options.compare))
+	{
+		fprintf(stderr, "--cpu cannot be used with --benchmark or --compare\n");
+		PrintHeadlessUsage(argv[0]);
+		return 1;
+	}
+
+	// The default path is built once the output file is open
+	GLCameraPath path;
+	if (!options.benchmarkPath.empty() && options.benchmarkPath != "default" && path.Load(options.benchmarkPath) != 0)
+	{
+		fprintf(stderr, "Unable to read camera path %s\n", options.benchmarkPath.data());
+		return 1;
+	}
+
+	// Exports fall back to the CPU rasterizer when OpenGL is not available
+	GLHeadlessContext context;
+	bool useOpenGL = !options.cpu;
+	if (useOpenGL)
+	{
+		context.SetSoftwareRendering(options.llvmpipe);
+		if (context.Create() != 0)
+		{
+			if (!options.benchmarkPath.empty() || options.compare)
+			{
+				fprintf(stderr, "Unable to create a headless OpenGL context\n");
+				return 1;
+			}
+			fprintf(stderr, "Unable to create a headless OpenGL context, drawing with the CPU rasterizer\n");
+			useOpenGL = false;
+		} else {
+			DEBUG("Rendering with %s\n", context.GetRenderer());
+		}
+	}
+
+	if (!options.profile.empty() && !useOpenGL)
+	{
+		fprintf(stderr, "--profile needs OpenGL and is ignored by the CPU rasterizer\n");
+	}
+	else if (!options.profile.empty())
+	{
+		GLProfiler::SetEnabled(true);
+		if (GLProfiler::StartCSV(options.profile, 0) != 0)
+			fprintf(stderr, "Unable to write %s\n", options.profile.data());
+	}
+
+	// Every Layer and shader is destroyed before the context
+	int result = RenderHeadless(&options, useOpenGL ? &context : 0, &path);
+
+	GLProfiler::StopCSV();
+	GLProfiler::Reset();
+	context.Destroy();
+	return result;
+}
+#endif
+
 
 int main(int argc, char *argv[])
 {
-	QApplication a(argc, argv);
-	MainWindow w;
-	w.show();
+#ifdef ADCVIS_TRACE
+	// The trace covers everything from here until the application exits, and the option
+	// is removed so that the rest of the command line is parsed as usual
+	for (int i=1; i+1<argc; i++)
+	{
+		if (strcmp(argv[i], "--trace") == 0)
+		{
+			if (TraceWriter::Start(argv[i+1]) != 0)
+				fprintf(stderr, "Unable to write trace file %s\n", argv[i+1]);
+			for (int j=i; j+2<=argc; j++)
+				argv[j] = argv[j+2];
+			argc -= 2;
+			break;
+		}
+	}
+	TRACE_THREAD_NAME("Main");
+#endif
+
+	int result;
+#ifdef ADCVIS_HEADLESS
+	// Headless mode runs before QApplication, which needs a display
+	for (int i=1; i<argc; i++)
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			result = RunHeadless(argc, argv);
+#ifdef ADCVIS_TRACE
+			TraceWriter::Stop();
+#endif
+			return result;
+		}
+#endif
+
+	{
+		QApplication a(argc, argv);
+		MainWindow w;
+		w.show();
+		result = a.exec();
+	}
 
-	return a.exec();
+#ifdef ADCVIS_TRACE
+	TraceWriter::Stop();
+#endif
+	return result;
 }